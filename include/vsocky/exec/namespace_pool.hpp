@@ -0,0 +1,106 @@
+#pragma once
+
+#include "vsocky/utils/error.hpp"
+
+#include <cstddef>
+#include <deque>
+#include <expected>
+#include <optional>
+#include <system_error>
+#include <vector>
+
+// =============================================================================
+// NAMESPACE TEMPLATES
+// =============================================================================
+// unshare(CLONE_NEWNET) costs milliseconds: the kernel builds a whole network
+// stack (loopback device, routing tables, netfilter hooks, sysctls). Doing
+// that for every job puts it on the request path.
+//
+// So the supervisor builds a few namespace sets at startup and keeps them
+// alive by holding their /proc/self/ns/* fds - no process has to live in
+// them. A job's child setns()es into a set before exec; afterwards the set
+// is reset and handed to the next job:
+//
+//   startup:  unshare() -> lo up, hostname -> open /proc/self/ns/{net,ipc,uts}
+//             -> setns() back home                       (repeat per set)
+//   spawn:    acquire() -> child: enter_namespaces() -> exec
+//   reap:     (UID sweep killed everything) -> release() -> reset
+//
+// Only namespaces an unprivileged job can't reconfigure are templated:
+//   net  - no CAP_NET_ADMIN, so no routes/addresses to undo; its sockets
+//          die with its processes
+//   uts  - can't sethostname()
+//   ipc  - CAN be dirtied: SysV shm/sem/msg and POSIX message queues
+//          outlive their creator. But an IPC namespace is cheap to make
+//          (nothing to configure), so reset replaces it with a fresh one
+//          rather than hunting down each kind of object
+// Mount and PID namespaces aren't pooled: a mount namespace is a snapshot of
+// the mount table taken at creation, and a PID namespace dies with its init.
+//
+// Everything here runs in the (single-threaded, root) supervisor - setns()
+// into a mount or user namespace needs a single-threaded caller, and we keep
+// that property so the templates could grow one.
+// =============================================================================
+
+namespace vsocky {
+
+struct namespace_set {
+    int net_fd = -1;
+    int ipc_fd = -1;
+    int uts_fd = -1;
+};
+
+class NamespacePool {
+public:
+    // Build count sets. resource_unavailable if namespaces can't be created
+    // (not root, or the kernel lacks CONFIG_NET_NS etc.)
+    static std::expected<NamespacePool, std::error_code> create(size_t count);
+
+    NamespacePool(NamespacePool&& other) noexcept;
+    NamespacePool& operator=(NamespacePool&& other) = delete;
+    NamespacePool(const NamespacePool&) = delete;
+    NamespacePool& operator=(const NamespacePool&) = delete;
+    ~NamespacePool() noexcept;
+
+    // Slot index of a free set, or nullopt if all are in use
+    std::optional<size_t> acquire() noexcept;
+
+    const namespace_set& get(size_t slot) const noexcept {
+        return sets_[slot];
+    }
+
+    // Reset the set and return it to the pool. Call only once no process
+    // is left in it (after the job's UID sweep).
+    void release(size_t slot) noexcept;
+
+    size_t available() const noexcept {
+        return free_.size();
+    }
+    size_t capacity() const noexcept {
+        return sets_.size();
+    }
+
+private:
+    NamespacePool() noexcept = default;
+
+    bool build_set(namespace_set& set) noexcept;
+    bool reset_set(namespace_set& set) noexcept;
+    static void close_set(namespace_set& set) noexcept;
+
+    std::vector<namespace_set> sets_;
+    std::deque<size_t> free_;
+    namespace_set home_;  // The supervisor's own namespaces, to return to
+};
+
+// =============================================================================
+// For the child between fork() and exec() (async-signal-safe)
+// =============================================================================
+
+// setns() into every namespace of the set
+bool enter_namespaces(const namespace_set& set) noexcept;
+
+// Slow path when the pool is empty: a fresh set of the same kinds,
+// configured like a template (lo up, hostname)
+bool unshare_namespaces() noexcept;
+
+} // namespace vsocky
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstdint>
+#include <system_error>
+
+#include <sys/types.h>
+
+// =============================================================================
+// PER-JOB PERF COUNTERS
+// =============================================================================
+// Wall and CPU time inside a shared microVM depend on what the neighbours
+// are doing: the same program can land on either side of a time limit on
+// two runs. Retired instructions barely move between runs, so they make a
+// limit that gives the same verdict every time.
+//
+// The supervisor opens the counters on a freshly forked job before it
+// execs (the child waits for a go-ahead), with
+//   enable_on_exec - counting starts at the job's first instruction, not
+//                    in our setup code
+//   inherit        - everything the job forks is counted too; a read()
+//                    sums the whole tree
+//   exclude_kernel - syscall work varies with the host; user code doesn't
+//
+// Hardware counters often aren't exposed to guests. Each counter opens
+// independently, so task-clock still works without a PMU; valid() says
+// which ones did.
+// =============================================================================
+
+namespace vsocky {
+
+enum perf_counter_flags : uint32_t {
+    perf_instructions = 1 << 0,  // Retired user-space instructions (hardware)
+    perf_task_clock = 1 << 1,    // CPU time in ns as the kernel counts it (software)
+};
+
+struct perf_reading {
+    uint32_t valid = 0;  // perf_counter_flags that were counted
+    uint64_t instructions = 0;
+    uint64_t task_clock_ns = 0;
+};
+
+class PerfCounters {
+public:
+    PerfCounters() noexcept = default;
+    PerfCounters(PerfCounters&& other) noexcept;
+    PerfCounters& operator=(PerfCounters&& other) noexcept;
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+    ~PerfCounters() noexcept;
+
+    // Open the requested counters on pid (which must not have exec'd yet).
+    // Returns the errno of the first counter that couldn't be opened (the
+    // others may still be valid) or success.
+    std::error_code open(pid_t pid, uint32_t which) noexcept;
+
+    uint32_t valid() const noexcept;
+
+    // Totals so far, including children (live and exited)
+    perf_reading read() const noexcept;
+
+private:
+    void close() noexcept;
+
+    int instructions_fd_ = -1;
+    int task_clock_fd_ = -1;
+};
+
+} // namespace vsocky
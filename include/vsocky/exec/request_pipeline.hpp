@@ -0,0 +1,103 @@
+#pragma once
+
+#include "vsocky/utils/error.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <system_error>
+#include <vector>
+
+// =============================================================================
+// REQUEST PIPELINE
+// =============================================================================
+// A compiled-language job spends most of its latency in two places: getting
+// its inputs over vsock and compiling. They don't depend on each other
+// entirely - the compiler needs the sources, not the 200 MB of test data
+// uploaded after them - so they can overlap:
+//
+//   upload   [src][src][data.......................]
+//   compile            [compile.........]
+//   run                                    [run....]   <- waits for both
+//
+// Each input names the earliest stage that needs it (compile or run). This
+// is the per-request state machine the reactor drives with events - input
+// complete, compile finished, run finished - and asks what to start next.
+// It does no I/O itself.
+//
+//   RequestPipeline p({input_stage::compile, input_stage::run}, true);
+//   p.input_complete(0);
+//   p.next();  // start_compile - input 1 still uploading
+//   p.compile_finished(true);
+//   p.next();  // none - waiting for input 1
+//   p.input_complete(1);
+//   p.next();  // start_run
+//
+// A failed compile finishes the request at once; the rest of its upload is
+// then dropped (accepting_uploads() is false).
+// =============================================================================
+
+namespace vsocky {
+
+enum class input_stage : uint8_t {
+    compile = 0,  // Sources, headers, build files
+    run = 1,      // Test data, stdin - not needed until the program starts
+};
+
+enum class pipeline_action : uint8_t {
+    none = 0,
+    start_compile,  // Every compile input is in (run inputs may still be arriving)
+    start_run,      // Every input is in and the compile, if any, succeeded
+    finish,         // Send the final response; the request is done
+};
+
+class RequestPipeline {
+public:
+    // inputs[i]: stage that first needs input i. Without a compile step
+    // every input is a run input.
+    RequestPipeline(std::vector<input_stage> inputs, bool compiled);
+
+    // Input `index` has fully arrived (and checked out).
+    // invalid_field_value for an index out of range, invalid_message_format
+    // for one already complete. Ignored once finished.
+    std::error_code input_complete(uint32_t index) noexcept;
+
+    // The step started by the last start_compile / start_run is over.
+    // Stray calls (step not running) are ignored.
+    void compile_finished(bool succeeded) noexcept;
+    void run_finished() noexcept;
+
+    // Upload broken, deadline passed, cancelled: finish without starting
+    // anything else (a step already running is the caller's to kill)
+    void abort() noexcept;
+
+    // What to do now. Call after every event until it returns none; each
+    // action is returned at most once.
+    pipeline_action next() noexcept;
+
+    bool accepting_uploads() const noexcept {
+        return !finished_;
+    }
+    size_t inputs_pending() const noexcept {
+        return pending_total_;
+    }
+    // Inputs that completed while the compile was already running - how
+    // much upload the overlap hid
+    size_t inputs_overlapped() const noexcept {
+        return overlapped_;
+    }
+
+private:
+    enum class step : uint8_t { waiting, running, succeeded, failed, skipped };
+
+    std::vector<input_stage> stages_;
+    std::vector<bool> complete_;
+    size_t pending_compile_ = 0;
+    size_t pending_total_ = 0;
+    size_t overlapped_ = 0;
+    step compile_;
+    step run_ = step::waiting;
+    bool aborted_ = false;
+    bool finished_ = false;
+};
+
+} // namespace vsocky
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+// =============================================================================
+// LOCK-FREE SINGLE-PRODUCER / SINGLE-CONSUMER RING
+// =============================================================================
+// The front end and the supervisor are separate PROCESSES sharing one memory
+// mapping. A mutex would work across processes (PTHREAD_PROCESS_SHARED) but
+// a crashed holder leaves it locked forever; with exactly one writer and one
+// reader per direction we don't need one at all:
+//
+//   head  - written only by the producer: next slot to fill
+//   tail  - written only by the consumer: next slot to drain
+//
+//   producer: slots[head % N] = item;  head.store(head + 1, release)
+//   consumer: if (tail != head.load(acquire)) { item = slots[tail % N]; tail.store(tail + 1, release) }
+//
+// release/acquire makes the slot contents visible before the index that
+// publishes them. head and tail are 64-bit and never wrap in practice.
+//
+// Each index lives on its own cache line: otherwise every push would
+// invalidate the consumer's cached copy of tail and vice versa ("false
+// sharing"), which costs more than the copy itself.
+//
+// std::atomic<uint64_t> is lock-free on every platform we target, which also
+// means it's address-free - safe to use from two processes that map the same
+// pages at different addresses.
+// =============================================================================
+
+namespace vsocky {
+
+inline constexpr size_t cache_line_size = 64;
+
+// The shared part: placed in the shared mapping, never copied
+template <typename T, size_t Capacity>
+struct spsc_ring_storage {
+    static_assert(std::is_trivially_copyable_v<T>, "ring items are copied as raw bytes between processes");
+    static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "capacity must be a power of two");
+    static_assert(std::atomic<uint64_t>::is_always_lock_free);
+
+    alignas(cache_line_size) std::atomic<uint64_t> head{0};
+    alignas(cache_line_size) std::atomic<uint64_t> tail{0};
+    alignas(cache_line_size) T slots[Capacity];
+};
+
+enum class ring_push_result {
+    full,
+    pushed,       // Consumer is busy draining - no need to wake it
+    pushed_wake,  // Consumer may be asleep - signal its eventfd
+};
+
+// -----------------------------------------------------------------------------
+// One side's view of a shared ring. Each process holds its own spsc_ring
+// object (with its own cached copy of the other side's index) pointing at the
+// same storage. Use only try_push() on one side and only try_pop() on the other.
+// -----------------------------------------------------------------------------
+template <typename T, size_t Capacity>
+class spsc_ring {
+public:
+    using storage = spsc_ring_storage<T, Capacity>;
+
+    explicit spsc_ring(storage* shared) noexcept : shared_(shared) {}
+
+    // =========================================================================
+    // WAKEUPS WITHOUT A SYSCALL PER ITEM
+    // =========================================================================
+    // The consumer drains until empty and only then sleeps on an eventfd.
+    // So the producer only has to signal when the consumer may have seen an
+    // empty ring - i.e. when it had already consumed everything before our
+    // item. Under load (ring non-empty) pushes cost no syscall at all.
+    //
+    // The seq_cst fences pair with the one in consumer_may_sleep(): either the
+    // producer sees the consumer's final tail (and wakes it), or the consumer
+    // sees the new head (and doesn't sleep). Never neither.
+    // =========================================================================
+    ring_push_result try_push(const T& item) noexcept {
+        const uint64_t head = shared_->head.load(std::memory_order_relaxed);
+        if (head - cached_other_ >= Capacity) {
+            cached_other_ = shared_->tail.load(std::memory_order_acquire);
+            if (head - cached_other_ >= Capacity) {
+                return ring_push_result::full;
+            }
+        }
+
+        shared_->slots[head % Capacity] = item;
+        shared_->head.store(head + 1, std::memory_order_release);
+
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        cached_other_ = shared_->tail.load(std::memory_order_relaxed);
+        return cached_other_ == head ? ring_push_result::pushed_wake : ring_push_result::pushed;
+    }
+
+    bool try_pop(T& out) noexcept {
+        const uint64_t tail = shared_->tail.load(std::memory_order_relaxed);
+        if (tail == cached_other_) {
+            cached_other_ = shared_->head.load(std::memory_order_acquire);
+            if (tail == cached_other_) {
+                return false;
+            }
+        }
+
+        out = shared_->slots[tail % Capacity];
+        shared_->tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer: call after try_pop() returned false, right before blocking.
+    // false means an item slipped in - drain again instead of sleeping.
+    bool consumer_may_sleep() noexcept {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        cached_other_ = shared_->head.load(std::memory_order_acquire);
+        return cached_other_ == shared_->tail.load(std::memory_order_relaxed);
+    }
+
+private:
+    storage* shared_;
+
+    // Producer: last tail we saw. Consumer: last head we saw.
+    // Refreshed only when the cached value says full/empty.
+    uint64_t cached_other_ = 0;
+};
+
+} // namespace vsocky
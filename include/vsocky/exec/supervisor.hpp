@@ -0,0 +1,317 @@
+#pragma once
+
+#include "vsocky/exec/spsc_ring.hpp"
+#include "vsocky/utils/cpu_partition.hpp"
+#include "vsocky/utils/error.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <system_error>
+
+#include <sys/types.h>
+
+// =============================================================================
+// PRIVILEGE SEPARATION
+// =============================================================================
+// The code that parses untrusted input (frames, JSON, paths) is the code most
+// likely to have a bug. It shouldn't also be the code that can setuid(),
+// write cgroups and install seccomp filters. So at startup we split:
+//
+//   +-------------------------+         +-------------------------------+
+//   | FRONT END (unprivileged)|         | SUPERVISOR (keeps privileges) |
+//   | reactor, framing, JSON, | cmd ring|  fork/exec, rlimits, uid      |
+//   | responses               | ------> |  switch, kill, reap           |
+//   |                         | <------ |                               |
+//   +-------------------------+ results +-------------------------------+
+//
+// The two rings live in one memfd mapping shared across fork(); each has an
+// eventfd for wakeups. Submitting a spawn is a memcpy into the ring plus (at
+// most) one eventfd write - no socket round trip, no serialization.
+//
+// Captured output (capture_flags) can't go through the rings: it comes back
+// as memfds, passed over a unix socketpair (SCM_RIGHTS) right before the
+// completion that announces them.
+//
+// The supervisor trusts nothing it reads from the ring: strings are bounded
+// and NUL-checked, and it decides the UID jobs run as itself - a
+// compromised front end can't ask for uid 0.
+//
+// FORK BEFORE THREADS: start_supervisor() forks, and a child forked from a
+// multithreaded process may inherit locks held by threads that don't exist
+// in it. Call it first thing in main(), before any thread is started.
+// =============================================================================
+
+namespace vsocky {
+
+// -----------------------------------------------------------------------------
+// Ring records (fixed-size, trivially copyable: they're memcpy'd between
+// processes)
+// -----------------------------------------------------------------------------
+
+enum class supervisor_op : uint32_t {
+    spawn = 1,
+    kill = 2,      // SIGKILL the job's whole process group
+    shutdown = 3,  // Kill every job and exit
+    cancel = 4,    // kill, then remove the job's workdir (see SupervisorClient::cancel)
+    release = 5,   // A finished job's workdir is no longer needed (SupervisorClient::release)
+};
+
+inline constexpr size_t max_exec_args_bytes = 2048;
+inline constexpr size_t max_exec_path_bytes = 256;
+inline constexpr size_t max_template_name_bytes = 64;
+
+// Streams to capture in a memfd instead of a file (supervisor_command::capture_flags)
+enum capture_flags : uint32_t {
+    capture_stdout = 1 << 0,
+    capture_stderr = 1 << 1,
+};
+
+inline constexpr uint64_t default_capture_limit_bytes = uint64_t{16} * 1024 * 1024;
+
+struct supervisor_command {
+    supervisor_op op = supervisor_op::spawn;
+    uint32_t argc = 0;
+    uint64_t request_id = 0;
+
+    // Limits (0 = none)
+    uint32_t wall_time_limit_ms = 0;     // Enforced by the supervisor (SIGKILL)
+    uint32_t cpu_time_limit_ms = 0;      // RLIMIT_CPU (rounded up to seconds)
+    uint64_t memory_limit_bytes = 0;     // RLIMIT_AS
+    uint64_t file_size_limit_bytes = 0;  // RLIMIT_FSIZE
+    uint32_t max_processes = 0;          // RLIMIT_NPROC
+    uint64_t instruction_limit = 0;      // Retired instructions (see perf_counters.hpp)
+
+    // Request deadline, CLOCK_MONOTONIC ns (see deadline.hpp). A spawn
+    // dequeued after it is dropped unrun (supervisor_event::expired); one
+    // that runs has its wall time limit capped at what's left.
+    uint64_t deadline_ns = 0;
+
+    // perf_counter_flags to measure; instruction_limit implies perf_instructions
+    uint32_t perf_counters = 0;
+
+    // Captured streams go to a memfd of at most capture_limit_bytes
+    // (0 = default_capture_limit_bytes) instead of stdout_path/stderr_path.
+    // The program's writes are never seen by the front end while it runs -
+    // no pipe wakeups - and come back with its exited completion. Writes
+    // past the limit fail with EPERM; the program isn't killed for them.
+    uint32_t capture_flags = 0;
+    uint64_t capture_limit_bytes = 0;
+
+    // Scheduling class. The supervisor's job_sched is a floor: a command can
+    // ask for a more yielding class (bulk regrading: idle), never a less one.
+    job_sched_policy sched_policy = job_sched_policy::normal;
+
+    // NUL-terminated. workdir must lie beneath supervisor_options::workspace_root;
+    // stdio paths are opened relative to it, as the job's UID (empty = /dev/null)
+    std::array<char, max_exec_path_bytes> workdir{};
+    std::array<char, max_exec_path_bytes> stdin_path{};
+    std::array<char, max_exec_path_bytes> stdout_path{};
+    std::array<char, max_exec_path_bytes> stderr_path{};
+
+    // If set, workdir becomes an overlay of this registered template (see
+    // workspace_template.hpp) until released. It has to be an existing,
+    // empty directory; the spawn fails otherwise.
+    std::array<char, max_template_name_bytes> workspace_template{};
+
+    // Interactive problems: a non-zero interactor_argc means args holds a
+    // second command line after the job's - a trusted interactor - and the
+    // two run side by side, the job's stdout piped to the interactor's
+    // stdin and the interactor's stdout to the job's stdin. stdin_path and
+    // stdout_path are unused then, and capture_stdout captures the
+    // interactor's stderr (its verdict text) instead - nothing of it is
+    // ever in the job's workdir, where the job could replace it. The
+    // interactor starts in "/", not the workdir, with HOME=/tmp and no
+    // TMPDIR. It gets its own pooled UID (so the job can't signal or trace
+    // it), no rlimits and no perf counters; the wall clock and the
+    // deadline bound both.
+    uint32_t interactor_argc = 0;
+
+    // argc (+ interactor_argc) NUL-terminated strings back to back;
+    // argv[0] is looked up in PATH
+    std::array<char, max_exec_args_bytes> args{};
+};
+
+enum class supervisor_event : uint32_t {
+    started = 1,       // Child is running (pid valid)
+    exited = 2,        // Child was reaped (status fields valid)
+    spawn_failed = 3,  // Never ran; error_number says why
+    expired = 4,       // Never ran: deadline_ns had passed when it was dequeued
+    cancelled = 5,     // Answer to a cancel for a job that wasn't running
+};
+
+struct supervisor_completion {
+    supervisor_event event = supervisor_event::started;
+    int32_t pid = 0;
+    uint64_t request_id = 0;
+    uint32_t uid = 0;         // started/exited: UID the job ran as
+
+    int32_t exit_code = 0;    // If exited normally
+    int32_t term_signal = 0;  // If killed by a signal (0 otherwise)
+    int32_t error_number = 0; // spawn_failed: errno from the failing step
+    bool wall_time_exceeded = false;
+    bool deadline_exceeded = false;  // The wall time kill came from deadline_ns, not the limit
+    bool cancelled = false;          // Killed by a cancel (workdir already removed)
+
+    uint64_t wall_time_us = 0;
+    uint64_t user_time_us = 0;
+    uint64_t system_time_us = 0;
+    uint64_t max_rss_kb = 0;
+
+    // Requested perf counters (perf_valid: which ones could be counted)
+    uint32_t perf_valid = 0;
+    bool instruction_limit_exceeded = false;
+    uint64_t instructions = 0;
+    uint64_t task_clock_ns = 0;
+
+    // exited: capture_flags streams that came back, sealed at the size the
+    // program wrote. The fds are filled in by SupervisorClient::poll() (the
+    // supervisor sends -1); the caller owns them. capture_error is the
+    // errno if the handover failed (the output is lost, the result isn't).
+    uint32_t captured = 0;
+    int32_t capture_error = 0;
+    int32_t stdout_fd = -1;
+    int32_t stderr_fd = -1;
+    uint64_t stdout_bytes = 0;
+    uint64_t stderr_bytes = 0;
+
+    // exited, interactive jobs: how the interactor ended (its exit code is
+    // the verdict). Sent once both are reaped; the rest is the job's.
+    bool interactive = false;
+    int32_t interactor_exit_code = 0;
+    int32_t interactor_term_signal = 0;
+};
+
+// Ring capacity = max commands in flight before submit() reports full
+inline constexpr size_t supervisor_ring_capacity = 64;
+
+using command_ring = spsc_ring<supervisor_command, supervisor_ring_capacity>;
+using completion_ring = spsc_ring<supervisor_completion, supervisor_ring_capacity * 2>;
+
+// Helpers to fill a command (return false if it doesn't fit)
+bool set_command_args(supervisor_command& cmd, std::span<const std::string_view> argv) noexcept;
+bool set_interactive_args(supervisor_command& cmd, std::span<const std::string_view> argv,
+                          std::span<const std::string_view> interactor_argv) noexcept;
+bool set_command_path(std::array<char, max_exec_path_bytes>& field, std::string_view path) noexcept;
+bool set_command_template(supervisor_command& cmd, std::string_view name) noexcept;
+
+struct supervisor_options {
+    // Directory every job workdir must lie strictly beneath (empty = jobs
+    // can't have one). The supervisor walks down to a workdir from here
+    // one component at a time and never follows a symlink on the way.
+    std::string workspace_root;
+
+    // Credentials jobs run under; -1 = keep the supervisor's own
+    // (only meaningful when the supervisor runs as root)
+    uid_t job_uid = static_cast<uid_t>(-1);
+    gid_t job_gid = static_cast<gid_t>(-1);
+
+    // If non-zero, every job gets its own UID/GID from
+    // [uid_pool_base, uid_pool_base + uid_pool_size) instead of job_uid/gid,
+    // and spawns fail with EAGAIN while all of them are busy (see uid_pool.hpp)
+    uid_t uid_pool_base = 0;
+    size_t uid_pool_size = 0;
+
+    // If non-zero, jobs run in their own net/ipc/uts namespaces, entered
+    // from this many pre-built templates (see namespace_pool.hpp); when all
+    // are busy the child unshares fresh ones (slower, still isolated).
+    // Pair with the UID pool: a template is only reused once the sweep has
+    // emptied it.
+    size_t namespace_pool_size = 0;
+
+    // Workspace templates: <template_root>/<name> directories that jobs
+    // can start from (empty = templates disabled). Each job's changes go
+    // to a tmpfs of up to template_upper_bytes.
+    std::string template_root;
+    uint64_t template_upper_bytes = uint64_t{256} * 1024 * 1024;
+    std::string template_scratch_root = "/run/vsocky-overlay";
+
+    // CPU partitioning (see cpu_partition.hpp): the vCPUs jobs run on
+    // (empty = the supervisor's own) and their minimum scheduling class.
+    // Interactors are placed the same way.
+    std::optional<cpu_set_t> job_cpus;
+    job_sched_policy job_sched = job_sched_policy::normal;
+};
+
+// -----------------------------------------------------------------------------
+// Front end's handle on the supervisor process
+// -----------------------------------------------------------------------------
+class SupervisorClient {
+public:
+    SupervisorClient(SupervisorClient&& other) noexcept;
+    SupervisorClient& operator=(SupervisorClient&& other) = delete;
+    SupervisorClient(const SupervisorClient&) = delete;
+    SupervisorClient& operator=(const SupervisorClient&) = delete;
+
+    // Sends shutdown and reaps the supervisor
+    ~SupervisorClient() noexcept;
+
+    // Queue a command; resource_unavailable if the ring is full
+    std::error_code submit(const supervisor_command& cmd) noexcept;
+
+    // Ask the supervisor to SIGKILL a running job
+    std::error_code kill(uint64_t request_id) noexcept;
+
+    // Abandon a job: SIGKILL it and, once it's reaped and swept, delete
+    // workdir (which the job's UID owns, so the front end can't). The final
+    // event is its exited completion with cancelled set, or a cancelled
+    // event if it wasn't running. workdir is only removed if it's a
+    // directory owned by a pooled UID that no job holds - a confused front
+    // end can't point it anywhere else. invalid_field_value if it doesn't fit.
+    std::error_code cancel(uint64_t request_id, std::string_view workdir = {}) noexcept;
+
+    // The front end has collected a finished job's outputs: unmount its
+    // template overlay, if it had one, and delete workdir under the same
+    // rules as cancel(). No completion; ignored while the job still runs.
+    std::error_code release(uint64_t request_id, std::string_view workdir) noexcept;
+
+    // Pop one completion (non-blocking). Receives its captured output fds,
+    // if any: close stdout_fd / stderr_fd when done with them.
+    bool poll(supervisor_completion& out) noexcept;
+
+    // Block until a completion is available or timeout_ms passes
+    // (tests and simple callers; the reactor watches notify_fd() instead)
+    bool wait(supervisor_completion& out, int timeout_ms) noexcept;
+
+    // Readable when completions may be waiting. Read it (8 bytes) to reset,
+    // then poll() until empty.
+    int notify_fd() const noexcept {
+        return completion_event_fd_;
+    }
+
+    pid_t pid() const noexcept {
+        return pid_;
+    }
+
+    // Stop the supervisor (kills all jobs) and reap it
+    void shutdown() noexcept;
+
+private:
+    friend std::expected<SupervisorClient, std::error_code> start_supervisor(const supervisor_options&);
+    SupervisorClient() noexcept = default;
+    void receive_output(supervisor_completion& out) noexcept;
+
+    void* mapping_ = nullptr;
+    size_t mapping_size_ = 0;
+    pid_t pid_ = -1;
+    int command_event_fd_ = -1;
+    int completion_event_fd_ = -1;
+    int output_fd_ = -1;                    // Our end of the captured-output socketpair
+    command_ring commands_{nullptr};        // We produce
+    completion_ring completions_{nullptr};  // We consume
+};
+
+// Fork the supervisor. The caller becomes the front end and should then
+// call drop_privileges(). See FORK BEFORE THREADS.
+std::expected<SupervisorClient, std::error_code> start_supervisor(const supervisor_options& options = {});
+
+// Permanently switch to uid/gid (clears supplementary groups, sets
+// no_new_privs). internal_error if any step fails - don't continue then.
+std::error_code drop_privileges(uid_t uid, gid_t gid) noexcept;
+
+} // namespace vsocky
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <optional>
+#include <vector>
+
+#include <sys/types.h>
+
+// =============================================================================
+// SANDBOX UID POOL
+// =============================================================================
+// Two jobs running as the same UID are not isolated from each other: each
+// can kill() or ptrace() the other and read the other's files in /tmp. With
+// a single `sandbox` user that forces one job per VM at a time.
+//
+// Instead the supervisor hands every job its own UID from a range
+// [base, base + count) and takes it back after the job is reaped:
+//
+//   acquire() -> uid 20003 (gid 20003) -> job runs -> reaped
+//             -> kill every process still running as 20003 -> release()
+//
+// The UIDs don't need /etc/passwd entries - setresuid() takes any number.
+// Free UIDs are handed out oldest-released first, so a UID rests as long as
+// possible before reuse.
+//
+// Not thread-safe: owned by the (single-threaded) supervisor process.
+// =============================================================================
+
+namespace vsocky {
+
+struct sandbox_identity {
+    uid_t uid;
+    gid_t gid;
+};
+
+class UidPool {
+public:
+    // UIDs (and matching GIDs) base .. base + count - 1
+    UidPool(uid_t base, size_t count);
+
+    std::optional<sandbox_identity> acquire() noexcept;
+
+    // Return a UID; ignores UIDs outside the pool and double releases
+    void release(uid_t uid) noexcept;
+
+    bool owns(uid_t uid) const noexcept {
+        return uid >= base_ && uid - base_ < in_use_.size();
+    }
+
+    // Checked out (running a job, or retired after a failed sweep)
+    bool in_use(uid_t uid) const noexcept {
+        return owns(uid) && in_use_[uid - base_];
+    }
+
+    size_t available() const noexcept {
+        return free_.size();
+    }
+    size_t capacity() const noexcept {
+        return in_use_.size();
+    }
+
+private:
+    uid_t base_;
+    std::deque<uint32_t> free_;  // Offsets from base_, FIFO
+    std::vector<bool> in_use_;
+};
+
+// Kill every process running as uid (what's left of a job after its
+// process group is gone, e.g. a daemon that called setsid()). Must be
+// called as root. Returns false if the sweep couldn't run.
+bool kill_all_processes_of(uid_t uid) noexcept;
+
+} // namespace vsocky
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "vsocky/utils/error.hpp"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <system_error>
+
+// =============================================================================
+// WORKSPACE TEMPLATES
+// =============================================================================
+// Many jobs start from the same scaffold - a course starter repo with
+// hundreds of files. Writing it out per job costs hundreds of creates and
+// writes, and as many unlinks afterwards. Instead the scaffold is
+// registered once, as a directory under the template root, and each job
+// gets an overlay of it:
+//
+//   workdir  = overlay( lower: <template root>/<name>   read-only, shared
+//                       upper: fresh tmpfs               the job's changes )
+//
+// One mount to set up, one umount to throw away - whatever the job wrote
+// lived only in the tmpfs. The tmpfs is mounted on a private scratch
+// directory and lazily detached right after the overlay is built, so the
+// overlay is the only mount left: the tmpfs goes with it.
+//
+// A registered template must not change while any overlay uses it (the
+// kernel doesn't support modifying a lower layer under a live overlay).
+// To update one, register it under a new name.
+//
+// Ownership comes from the template: the supervisor chowns only the
+// overlay's root to the job's UID, as with a plain workdir. Files a job
+// should be able to modify in place have to be writable in the template.
+//
+// Mounting needs CAP_SYS_ADMIN, so all of this runs in the supervisor.
+// =============================================================================
+
+namespace vsocky {
+
+// Template names are one path component: [A-Za-z0-9._-], 1-63 characters,
+// not starting with '.'
+bool is_valid_template_name(std::string_view name) noexcept;
+
+// Mount the overlay of template_dir on target (an existing, empty
+// directory). upper_bytes caps the tmpfs holding the job's changes.
+// scratch_root is where the tmpfs is briefly mounted; it's created if
+// needed. Returns the errno of the failing step (0 on success).
+int mount_template_workspace(const std::string& template_dir, const std::string& target,
+                             const std::string& scratch_root, uint64_t upper_bytes) noexcept;
+
+// Throw the overlay away (lazy: a process still inside it doesn't block).
+// Returns the errno of umount2 (0 on success).
+int unmount_template_workspace(const std::string& target) noexcept;
+
+} // namespace vsocky
@@ -0,0 +1,149 @@
+#pragma once
+
+#include "vsocky/protocol/load_frames.hpp"
+#include "vsocky/storage/artifact_cache.hpp"
+#include "vsocky/vsocket/connection.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <system_error>
+#include <vector>
+
+// =============================================================================
+// FLEET ROUTER (HOST SIDE)
+// =============================================================================
+// Everything else in this tree runs inside the guest. This is the other end:
+// the host process that owns many microVMs and has to decide which one gets
+// the next job. Random placement throws away what makes a VM fast - its warm
+// helper pool and its compile artifact cache - so the router keeps, per VM:
+//
+//   - a small pool of open connections (no connect per job)
+//   - the last load report (queue depth, warm pool, cache summary), refreshed
+//     by calling refresh() periodically
+//   - how many jobs it handed to that VM since the last report
+//
+// and places each job on the VM with the lowest estimated wait:
+//
+//   cost = (queue_depth + running_jobs + routed_since_report) * 1000 / capacity
+//        + cold_start_penalty       if the warm pool is enabled but empty
+//        - cache_affinity_bonus     if the VM's cache summary has the artifact
+//
+// Units are "thousandths of a job slot". With the defaults a cache hit is
+// worth waiting behind one extra job per slot, but not two - affinity wins
+// over balance only while the cached VM isn't clearly busier.
+//
+// Thread-safety: every public method may be called from any thread.
+// =============================================================================
+
+namespace vsocky {
+
+// Opens a new connection to one VM (vsock in production, Unix socket in tests)
+using vm_connector = std::function<std::expected<Connection, std::error_code>()>;
+
+struct router_options {
+    size_t pool_size = 4;               // Idle connections kept per VM
+    int timeout_ms = 500;               // Load query round trip
+    int64_t cold_start_penalty = 500;
+    int64_t cache_affinity_bonus = 1500;
+};
+
+// What a job tells the router to help placement
+struct job_hint {
+    std::optional<artifact_key> artifact;  // Compile cache key, if compiled
+};
+
+// Point-in-time view of one VM (for stats endpoints and tests)
+struct vm_snapshot {
+    std::string id;
+    bool healthy = false;
+    load_report load;
+    uint32_t routed_since_report = 0;
+    size_t idle_connections = 0;
+};
+
+class FleetRouter {
+    struct vm_state;
+
+public:
+    // -------------------------------------------------------------------------
+    // A routed job: a pooled connection to the chosen VM, held for the job's
+    // duration. Destroying the lease returns the connection to the pool;
+    // call discard() first if the connection is in an unknown state (I/O
+    // error, timeout mid-response) so it isn't reused.
+    // -------------------------------------------------------------------------
+    class lease {
+    public:
+        lease(lease&& other) noexcept = default;
+        lease& operator=(lease&& other) noexcept;
+        lease(const lease&) = delete;
+        lease& operator=(const lease&) = delete;
+        ~lease() noexcept;
+
+        const std::string& vm_id() const noexcept;
+        Connection& connection() noexcept {
+            return conn_;
+        }
+        void discard() noexcept {
+            conn_.close();
+        }
+
+    private:
+        friend class FleetRouter;
+        lease(std::shared_ptr<vm_state> vm, Connection conn, size_t pool_size) noexcept
+            : vm_(std::move(vm)), conn_(std::move(conn)), pool_size_(pool_size) {}
+        void release() noexcept;
+
+        std::shared_ptr<vm_state> vm_;
+        Connection conn_;
+        size_t pool_size_;
+    };
+
+    explicit FleetRouter(router_options options = {}) noexcept : options_(options) {}
+
+    // Register a VM (replaces an existing VM with the same id). New VMs
+    // start unhealthy and become routable after their first refresh().
+    void add_vm(const std::string& id, vm_connector connect);
+    void remove_vm(const std::string& id);
+
+    // Query every VM's load report; VMs that don't answer are marked
+    // unhealthy until a later refresh succeeds. Returns the healthy count.
+    size_t refresh();
+
+    // Pick a VM for a job and lend out a connection to it
+    // resource_unavailable if no healthy VM can be connected to
+    std::expected<lease, std::error_code> route(const job_hint& hint = {});
+
+    std::vector<vm_snapshot> snapshot() const;
+
+private:
+    struct vm_state {
+        std::string id;
+        vm_connector connect;
+
+        // Guarded by FleetRouter::mutex_
+        bool healthy = false;
+        load_report load;
+        uint32_t routed_since_report = 0;
+
+        // Guarded by pool_mutex (taken without mutex_ so I/O never blocks routing)
+        std::mutex pool_mutex;
+        std::vector<Connection> idle;
+    };
+
+    std::expected<Connection, std::error_code> checkout(vm_state& vm);
+    int64_t cost_locked(const vm_state& vm, const job_hint& hint) const noexcept;
+
+    router_options options_;
+
+    mutable std::mutex mutex_;
+    std::map<std::string, std::shared_ptr<vm_state>> vms_;
+};
+
+} // namespace vsocky
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "vsocky/vsocket/connection.hpp"
+#include "vsocky/vsocket/frame_trace.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <functional>
+#include <system_error>
+#include <vector>
+
+// =============================================================================
+// TRACE REPLAY
+// =============================================================================
+// Plays a recorded trace (frame_trace.hpp) back against a server: every
+// recorded connection becomes a new connection, opened when its first frame
+// is due, and its frames are sent in order at their recorded offsets
+// (divided by speed), or back to back with speed 0.
+//
+// Responses are read and counted but not checked - replay is for load, not
+// correctness (job output depends on the VM anyway). Single-threaded: the
+// replayer reads whatever arrived on every connection between sends, so a
+// server blocked writing responses never deadlocks against us.
+// =============================================================================
+
+namespace vsocky {
+
+using replay_connector = std::function<std::expected<Connection, std::error_code>()>;
+
+struct replay_options {
+    double speed = 1.0;           // 2.0 = twice as fast; 0 = no pacing at all
+    int io_timeout_ms = 5000;     // Per frame sent
+    int drain_timeout_ms = 2000;  // After the last frame: stop once quiet this long
+};
+
+struct replay_stats {
+    size_t connections = 0;
+    size_t failed_connections = 0;  // Couldn't connect, or dropped mid-trace
+    size_t frames_sent = 0;
+    size_t frames_skipped = 0;      // Belonged to a failed connection
+    uint64_t bytes_sent = 0;
+    size_t frames_received = 0;
+    uint64_t bytes_received = 0;
+    uint64_t duration_ns = 0;
+    uint64_t max_lag_ns = 0;        // Worst delay behind the recorded schedule
+};
+
+replay_stats replay_trace(const std::vector<trace_record>& records,
+                          const replay_connector& connect,
+                          const replay_options& options = {});
+
+} // namespace vsocky
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "vsocky/storage/blob_store.hpp"
+
+#include <cstdint>
+#include <expected>
+#include <span>
+#include <system_error>
+#include <vector>
+
+// =============================================================================
+// BLOB DEDUP EXCHANGE
+// =============================================================================
+// Binary frames (see frame_type in message_framer.hpp), so hashes and blob
+// contents travel as raw bytes instead of hex/base64 inside JSON:
+//
+//   host  -> guest   blob_query    [hash][hash][hash]...       (32 bytes each)
+//   guest -> host    blob_missing  [hash]...                   (subset we lack)
+//   host  -> guest   blob_upload   [hash][content bytes...]    (one per blob)
+//
+// A blob that doesn't fit in one frame (default_max_frame_payload) is sent
+// in pieces instead, which the guest appends to a temp file as they come:
+//
+//   host  -> guest   blob_chunk    [hash][next content bytes...]  (in order)
+//   host  -> guest   blob_end      [hash][u64 total size]
+//
+// Chunks of different blobs may interleave. blob_end carries the size the
+// host sent, so a lost chunk fails on the size before it fails the hash.
+//
+// After that the job request can reference every file by hash and the
+// workspace is built with BlobStore::materialize_workspace().
+// =============================================================================
+
+namespace vsocky {
+
+inline constexpr size_t blob_hash_size = 32;
+inline constexpr size_t blob_end_size = blob_hash_size + 8;
+
+// Answer a blob_query payload with a blob_missing payload
+// invalid_message_format if the payload isn't a whole number of hashes
+std::expected<std::vector<uint8_t>, std::error_code>
+handle_blob_query(const BlobStore& store, std::span<const uint8_t> payload);
+
+// Store the blob carried by a blob_upload payload
+// invalid_message_format if shorter than a hash; otherwise as BlobStore::put()
+std::error_code handle_blob_upload(BlobStore& store, std::span<const uint8_t> payload) noexcept;
+
+// Build a blob_end payload
+std::vector<uint8_t> encode_blob_end(const blob_hash& hash, uint64_t size);
+
+struct blob_upload_limits {
+    size_t max_pending = 16;                      // Blobs in flight at once
+    uint64_t max_blob_bytes = uint64_t{4} << 30;  // Per blob
+};
+
+// The blob_chunk / blob_end state of one connection
+class BlobUploadAssembler {
+public:
+    explicit BlobUploadAssembler(BlobStore& store, const blob_upload_limits& limits = {}) noexcept
+        : store_(store), limits_(limits) {}
+
+    // Append a blob_chunk payload to its blob, starting it on first use
+    // - invalid_message_format: shorter than a hash
+    // - resource_unavailable: max_pending blobs already open, disk error
+    // - message_too_large: the blob would exceed max_blob_bytes (dropped)
+    std::error_code handle_chunk(std::span<const uint8_t> payload) noexcept;
+
+    // Finish the blob named by a blob_end payload (a blob with no chunks
+    // is the empty blob). invalid_field_value on a size or hash mismatch;
+    // the partial blob is dropped either way.
+    std::error_code handle_end(std::span<const uint8_t> payload) noexcept;
+
+    size_t pending() const noexcept {
+        return pending_.size();
+    }
+
+private:
+    BlobStore& store_;
+    blob_upload_limits limits_;
+    std::vector<BlobWriter> pending_;  // A handful at most: linear search
+};
+
+} // namespace vsocky
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// =============================================================================
+// BIG-ENDIAN FIELDS
+// =============================================================================
+// Every integer on the wire - frame headers, binary payloads, trace files -
+// is unsigned and big-endian (network order), 1 to 8 bytes wide. These are
+// the only codecs for them; payload layouts are documented next to their
+// encode/decode functions.
+//
+// Widths are given in bytes; a value wider than its field is truncated to
+// the low bytes, so callers check ranges before encoding.
+// =============================================================================
+
+namespace vsocky {
+
+// Write the low `bytes` bytes of value at out; returns the end of the field
+constexpr uint8_t* put_be(uint8_t* out, uint64_t value, size_t bytes) noexcept {
+    for (size_t i = bytes; i-- > 0;) {
+        *out++ = static_cast<uint8_t>(value >> (i * 8));
+    }
+    return out;
+}
+
+// Append the low `bytes` bytes of value to out
+inline void append_be(std::vector<uint8_t>& out, uint64_t value, size_t bytes) {
+    for (size_t i = bytes; i-- > 0;) {
+        out.push_back(static_cast<uint8_t>(value >> (i * 8)));
+    }
+}
+
+// Read a `bytes`-wide field at p
+constexpr uint64_t get_be(const uint8_t* p, size_t bytes) noexcept {
+    uint64_t value = 0;
+    for (size_t i = 0; i < bytes; ++i) {
+        value = (value << 8) | p[i];
+    }
+    return value;
+}
+
+constexpr uint32_t get_be32(const uint8_t* p) noexcept {
+    return static_cast<uint32_t>(get_be(p, 4));
+}
+
+} // namespace vsocky
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <span>
+#include <system_error>
+#include <vector>
+
+// =============================================================================
+// CANCELLATION
+// =============================================================================
+// When a user re-submits, the host abandons the first job - but without a
+// way to say so it keeps running here until its limit, starving the
+// replacement. So:
+//
+//   host  -> guest   cancel     u64 request id
+//   guest -> host    cancelled  u64 request id, u8 cancel_outcome
+//
+// cancelled is the request's final response, sent once its process group
+// is dead and its UID and workspace are released (SupervisorClient::cancel)
+// - never before, so the host can count the slot as free when it arrives.
+// A cancel for a request that already finished still gets one (finished);
+// the host must expect the request's own result to race with it.
+// =============================================================================
+
+namespace vsocky {
+
+inline constexpr size_t cancel_size = 8;
+inline constexpr size_t cancelled_size = 9;
+
+enum class cancel_outcome : uint8_t {
+    dequeued = 0,  // Was still queued; never ran
+    killed = 1,    // Was running; killed
+    finished = 2,  // Had already finished, or the ID is unknown
+};
+
+struct cancelled_info {
+    uint64_t request_id = 0;
+    cancel_outcome outcome = cancel_outcome::finished;
+};
+
+std::vector<uint8_t> encode_cancel(uint64_t request_id);
+std::vector<uint8_t> encode_cancelled(const cancelled_info& info);
+
+// invalid_message_format on a wrong size (or, for cancelled, an unknown outcome)
+std::expected<uint64_t, std::error_code> decode_cancel(std::span<const uint8_t> payload) noexcept;
+std::expected<cancelled_info, std::error_code> decode_cancelled(std::span<const uint8_t> payload) noexcept;
+
+} // namespace vsocky
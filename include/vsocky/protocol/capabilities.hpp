@@ -0,0 +1,62 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+// =============================================================================
+// SERVER CAPABILITIES
+// =============================================================================
+// Feature names the host can rely on when talking to this process. They are
+// advertised in the ready message so a host fleet with mixed guest images
+// can tell what each VM supports without probing.
+//
+// The list is built at startup from what is actually switched on and
+// served: a capability the host would try and get no answer for is worse
+// than one it doesn't know about. Each entry names the features it needs;
+// main.cpp works out which of them this process has.
+//
+// Keep names stable, lowercase, snake_case - hosts match on them literally.
+// Add an entry here whenever a new optional feature lands.
+// =============================================================================
+
+namespace vsocky {
+
+// Parts of the server a capability can depend on (bit flags)
+enum capability_feature : uint32_t {
+    feature_ready_notify = 1u << 0,    // --notify-port: the ready message goes out
+    feature_frame_dispatch = 1u << 1,  // An event loop answers frames on connections
+    feature_prefault = 1u << 2,        // --prefault and the prefaulter started
+    feature_supervisor = 1u << 3,      // --user: a supervisor is there to run jobs
+};
+
+struct capability {
+    std::string_view name;
+    uint32_t requires_features;  // All of these must be present
+};
+
+inline constexpr auto known_capabilities = std::to_array<capability>({
+    {"blob_store", feature_frame_dispatch},   // Content-addressed blobs: blob_query / blob_upload / blob_chunk frames
+    {"cancel", feature_frame_dispatch | feature_supervisor},  // cancel frame -> cancelled (cancel_frames.hpp)
+    {"capture", feature_frame_dispatch | feature_supervisor},  // stdout/stderr in sealed memfds, sent as file_chunk frames
+    {"chunked_upload", feature_frame_dispatch | feature_supervisor},  // upload_chunk / upload_end after the request; compile overlaps them
+    {"file_fetch", feature_frame_dispatch},   // Output files: file_list / file_fetch -> file_chunk frames
+    {"framed_json", feature_frame_dispatch},  // Length-prefixed frames carrying JSON (message_framer.hpp)
+    {"interactive", feature_frame_dispatch | feature_supervisor},  // Job piped to a trusted interactor, one verdict
+    {"prefault", feature_prefault},           // SIGUSR1 triggers a post-restore prefault pass
+    {"ready_notify", feature_ready_notify},   // Ready message sent to the host once listening
+});
+
+// Names of the capabilities whose features are all in `features`
+inline std::vector<std::string_view> enabled_capabilities(uint32_t features) {
+    std::vector<std::string_view> names;
+    for (const auto& cap : known_capabilities) {
+        if ((cap.requires_features & ~features) == 0) {
+            names.push_back(cap.name);
+        }
+    }
+    return names;
+}
+
+} // namespace vsocky
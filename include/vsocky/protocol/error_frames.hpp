@@ -0,0 +1,41 @@
+#pragma once
+
+#include "vsocky/utils/sys_error.hpp"
+#include "vsocky/vsocket/connection.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <system_error>
+
+// =============================================================================
+// ERROR FRAMES
+// =============================================================================
+// A json frame telling the host a request failed:
+//
+//   {"type":"error","code":"read_failed","message":"read failed",
+//    "errno":104,"errno_name":"ECONNRESET","id":42}
+//
+// errno / errno_name only when there is one, id only when the error
+// belongs to a request (non-zero id).
+//
+// Errors come in storms - a host restart resets every connection at once -
+// so this path allocates nothing. Everything up to "message" is rendered
+// per error_code at compile time; at runtime it's a memcpy of that fragment
+// plus two integers, into a buffer on the stack.
+// =============================================================================
+
+namespace vsocky {
+
+// Upper bound of a rendered error message
+inline constexpr size_t max_error_message_bytes = 192;
+
+// Render the frame payload into out; returns the written part
+std::string_view render_error_message(sys_error error, uint64_t request_id,
+                                      std::span<char, max_error_message_bytes> out) noexcept;
+
+// Render and send it as a json frame
+std::error_code send_error(Connection& conn, sys_error error, uint64_t request_id, int timeout_ms) noexcept;
+
+} // namespace vsocky
@@ -0,0 +1,86 @@
+#pragma once
+
+#include "vsocky/storage/workspace_files.hpp"
+#include "vsocky/vsocket/connection.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <span>
+#include <string>
+#include <system_error>
+#include <vector>
+
+// =============================================================================
+// OUTPUT FILE RETRIEVAL
+// =============================================================================
+// Two requests (frame types in message_framer.hpp):
+//
+//   host -> guest  file_list                      -> json frame:
+//     {"type":"files","files":[{"path":"out/plot.png","size":5120,"mode":420}]}
+//
+//   host -> guest  file_fetch [u16 len][path]...  -> for each path, in order:
+//     guest -> host  file_chunk [u32 index][bytes]   zero or more
+//     guest -> host  file_end   [u32 index][u8 status][u64 size]
+//
+// file_chunk carries raw bytes - no base64. The chunk payload is never read
+// into our memory either: we write the 9-byte frame header + index, then
+// Connection::send_file() has the kernel copy the file data straight from
+// the page cache into the socket.
+//
+// A file's size is taken when it is opened; a program still appending to it
+// gets a consistent prefix. If it SHRINKS mid-transfer we've already promised
+// bytes we can't send, so the stream is broken and the caller must close
+// the connection (stream_workspace_files returns read_failed).
+//
+// stream_file() sends a single open file the same way - a job's captured
+// stdout/stderr memfd (supervisor.hpp), which is sealed at its final size
+// and so can't shrink under us.
+// =============================================================================
+
+namespace vsocky {
+
+enum class file_status : uint8_t {
+    ok = 0,
+    not_found = 1,   // No such file
+    refused = 2,     // Unsafe path, symlink, or not a regular file
+    read_error = 3,  // Couldn't stat/read it
+};
+
+inline constexpr size_t default_file_chunk_size = size_t{256} * 1024;
+
+// Render the reply to file_list
+std::string build_file_list_message(std::span<const workspace_file> files);
+
+// Encode / decode the file_fetch path list. Encoding fails with
+// message_too_large if a path is longer than its u16 length field allows.
+std::expected<std::vector<uint8_t>, std::error_code>
+encode_file_fetch(std::span<const std::string> paths);
+std::expected<std::vector<std::string>, std::error_code>
+decode_file_fetch(std::span<const uint8_t> payload);
+
+struct file_end_info {
+    uint32_t index = 0;
+    file_status status = file_status::ok;
+    uint64_t size = 0;
+};
+
+// Decode a file_end payload (invalid_message_format if malformed)
+std::expected<file_end_info, std::error_code>
+decode_file_end(std::span<const uint8_t> payload) noexcept;
+
+// Stream one open file as file_chunk... file_end frames under index (fd
+// stays open). Non-success only when the connection can no longer be used.
+std::error_code stream_file(Connection& conn, uint32_t index, int fd, int timeout_ms,
+                            size_t chunk_size = default_file_chunk_size) noexcept;
+
+// Stream every requested file as file_chunk... file_end frames
+// Per-file problems are reported in file_end; the return value is only
+// non-success when the connection itself can no longer be used.
+std::error_code stream_workspace_files(Connection& conn,
+                                       const std::string& root,
+                                       std::span<const std::string> paths,
+                                       int timeout_ms,
+                                       size_t chunk_size = default_file_chunk_size) noexcept;
+
+} // namespace vsocky
@@ -0,0 +1,131 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// =============================================================================
+// WHY A HAND-ROLLED JSON WRITER?
+// =============================================================================
+// simdjson is a (very fast) parser only - it doesn't serialize. Our responses
+// are small, flat documents, so a tiny append-only writer is all we need:
+//
+//   JsonWriter w;
+//   w.begin_object();
+//   w.key("type").value("ready");
+//   w.key("port").value(52000u);
+//   w.end_object();
+//   // w.str() == R"({"type":"ready","port":52000})"
+//
+// It tracks just enough state to place commas correctly; it does NOT check
+// that begin/end calls are balanced - that's the caller's job.
+// =============================================================================
+
+namespace vsocky {
+
+// Append s to out as a quoted, escaped JSON string
+void append_json_string(std::string& out, std::string_view s);
+
+class JsonWriter {
+public:
+    JsonWriter() = default;
+
+    // Start with a pre-reserved buffer (avoids regrowth for known sizes)
+    explicit JsonWriter(size_t reserve) {
+        out_.reserve(reserve);
+    }
+
+    JsonWriter& begin_object() {
+        separate();
+        out_.push_back('{');
+        need_comma_ = false;
+        return *this;
+    }
+
+    JsonWriter& end_object() {
+        out_.push_back('}');
+        need_comma_ = true;
+        return *this;
+    }
+
+    JsonWriter& begin_array() {
+        separate();
+        out_.push_back('[');
+        need_comma_ = false;
+        return *this;
+    }
+
+    JsonWriter& end_array() {
+        out_.push_back(']');
+        need_comma_ = true;
+        return *this;
+    }
+
+    // Object key - must be followed by exactly one value/begin_*
+    JsonWriter& key(std::string_view name) {
+        separate();
+        append_json_string(out_, name);
+        out_.push_back(':');
+        need_comma_ = false;
+        return *this;
+    }
+
+    JsonWriter& value(std::string_view s) {
+        separate();
+        append_json_string(out_, s);
+        need_comma_ = true;
+        return *this;
+    }
+
+    // Without this overload a string literal would pick value(bool)
+    JsonWriter& value(const char* s) {
+        return value(std::string_view(s));
+    }
+
+    JsonWriter& value(bool b) {
+        return raw(b ? "true" : "false");
+    }
+
+    JsonWriter& value(int64_t n);
+    JsonWriter& value(uint64_t n);
+    JsonWriter& value(int n) {
+        return value(static_cast<int64_t>(n));
+    }
+    JsonWriter& value(unsigned n) {
+        return value(static_cast<uint64_t>(n));
+    }
+
+    JsonWriter& null() {
+        return raw("null");
+    }
+
+    // Insert an already-valid JSON fragment as one value
+    JsonWriter& raw(std::string_view fragment) {
+        separate();
+        out_.append(fragment);
+        need_comma_ = true;
+        return *this;
+    }
+
+    const std::string& str() const noexcept {
+        return out_;
+    }
+
+    // Move the finished document out (the writer is empty afterwards)
+    std::string take() noexcept {
+        need_comma_ = false;
+        return std::move(out_);
+    }
+
+private:
+    void separate() {
+        if (need_comma_) {
+            out_.push_back(',');
+        }
+    }
+
+    std::string out_;
+    bool need_comma_ = false;
+};
+
+} // namespace vsocky
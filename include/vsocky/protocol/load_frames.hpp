@@ -0,0 +1,57 @@
+#pragma once
+
+#include "vsocky/storage/artifact_cache.hpp"
+#include "vsocky/vsocket/ready_notifier.hpp"
+
+#include <cstdint>
+#include <expected>
+#include <span>
+#include <system_error>
+#include <vector>
+
+// =============================================================================
+// LOAD REPORTS
+// =============================================================================
+// The host router asks each VM how busy it is before placing jobs:
+//
+//   host  -> guest   load_query    (empty)
+//   guest -> host    load_report   27-byte header + cache summary, big-endian:
+//
+//     u8  version (2)
+//     u32 queue_depth      jobs accepted but not started
+//     u32 running_jobs     jobs executing right now
+//     u32 capacity         jobs that can run concurrently
+//     u8  warm_pool.enabled
+//     u32 warm_pool.ready
+//     u32 warm_pool.target
+//     u8  summary probes
+//     u32 summary length   bytes that follow, sized from the cache's entries
+//     u8[length] artifact cache summary (Bloom filter, artifact_cache.hpp)
+//
+// Small on purpose: the router polls every VM every few hundred ms, so the
+// report must be cheap to build, send and parse. The summary grows with the
+// cache (~1.2 bytes per artifact) up to artifact_summary::max_size_bytes.
+// =============================================================================
+
+namespace vsocky {
+
+inline constexpr uint8_t load_report_version = 2;
+inline constexpr size_t load_report_header_size = 1 + 4 * 3 + 1 + 4 * 2 + 1 + 4;
+inline constexpr size_t load_report_max_size = load_report_header_size + artifact_summary::max_size_bytes;
+
+struct load_report {
+    uint32_t queue_depth = 0;
+    uint32_t running_jobs = 0;
+    uint32_t capacity = 1;
+    warm_pool_status warm_pool;
+    artifact_summary cache;
+};
+
+std::vector<uint8_t> encode_load_report(const load_report& report);
+
+// invalid_message_format on a wrong size, unknown version or a summary
+// outside artifact_summary's limits
+std::expected<load_report, std::error_code>
+decode_load_report(std::span<const uint8_t> payload) noexcept;
+
+} // namespace vsocky
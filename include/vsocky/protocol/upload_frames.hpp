@@ -0,0 +1,57 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <span>
+#include <system_error>
+#include <vector>
+
+// =============================================================================
+// CHUNKED INPUT UPLOAD
+// =============================================================================
+// A request's inputs (sources, test data, stdin) don't have to be inside
+// the request JSON. The request lists them, in order, each with the stage
+// that first needs it (request_pipeline.hpp), and the bytes follow as
+// binary frames:
+//
+//   host -> guest   upload_chunk  [u64 request id][u32 index][bytes...]
+//   host -> guest   upload_end    [u64 request id][u32 index][u64 total size]
+//
+// Chunks of one input arrive in order; inputs may interleave. upload_end
+// carries the size the host sent so a lost or duplicated chunk is caught
+// before the input is used. Send compile inputs first: the compile starts
+// as soon as the last of them ends, while the rest is still on the wire.
+// =============================================================================
+
+namespace vsocky {
+
+inline constexpr size_t upload_chunk_header_size = 12;
+inline constexpr size_t upload_end_size = 20;
+
+struct upload_chunk_view {
+    uint64_t request_id = 0;
+    uint32_t index = 0;
+    std::span<const uint8_t> data;  // Points into the frame payload
+};
+
+struct upload_end_info {
+    uint64_t request_id = 0;
+    uint32_t index = 0;
+    uint64_t size = 0;
+};
+
+// Header to put in front of the chunk bytes (sent as one frame payload)
+std::array<uint8_t, upload_chunk_header_size> encode_upload_chunk_header(uint64_t request_id,
+                                                                         uint32_t index) noexcept;
+std::vector<uint8_t> encode_upload_chunk(uint64_t request_id, uint32_t index, std::span<const uint8_t> data);
+std::vector<uint8_t> encode_upload_end(const upload_end_info& info);
+
+// invalid_message_format if too short / the wrong size
+std::expected<upload_chunk_view, std::error_code>
+decode_upload_chunk(std::span<const uint8_t> payload) noexcept;
+std::expected<upload_end_info, std::error_code>
+decode_upload_end(std::span<const uint8_t> payload) noexcept;
+
+} // namespace vsocky
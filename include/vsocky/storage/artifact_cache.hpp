@@ -0,0 +1,284 @@
+#pragma once
+
+#include "vsocky/utils/error.hpp"
+#include "vsocky/utils/sha256.hpp"
+#include "vsocky/vsocket/connection.hpp"
+#include "vsocky/vsocket/message_framer.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <expected>
+#include <functional>
+#include <mutex>
+#include <numbers>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// =============================================================================
+// COMPILE ARTIFACT CACHE (LOCAL + HOST-BACKED)
+// =============================================================================
+// Compiling the same popular source over and over is the single biggest
+// waste in a compiled-language job. Two tiers:
+//
+//   lookup(key)
+//     1. Local directory cache in the guest          -> hit: done
+//     2. Host artifact service over a 2nd vsock conn -> hit: also store locally
+//     3. Miss: caller compiles, then insert(key, artifact)
+//                -> stored locally + published to the host in the background
+//
+// A freshly booted VM has an empty local tier, but the host tier is shared by
+// the whole fleet, so popular sources still hit.
+//
+// Host protocol (frame types in message_framer.hpp):
+//   guest -> host  artifact_get  [key]          host -> guest  artifact_hit [bytes]
+//                                                            | artifact_miss
+//   guest -> host  artifact_put  [key][bytes]   (fire and forget)
+// =============================================================================
+
+namespace vsocky {
+
+using artifact_key = sha256_digest;
+
+// Key for a compilation: hash of every input that affects the output
+// (language, compiler version, flags, source...). Each part is length-prefixed
+// so ("ab","c") and ("a","bc") hash differently.
+artifact_key make_artifact_key(std::span<const std::string_view> parts) noexcept;
+
+// -----------------------------------------------------------------------------
+// Compact summary of which artifacts a cache holds (a Bloom filter)
+// -----------------------------------------------------------------------------
+// Lets a host router prefer the VM that already has a job's artifact without
+// shipping every key. may_contain() can give false positives (a wasted
+// preference), never false negatives.
+//
+// The bit array is sized from the number of entries for a target false
+// positive rate: -ln(p) / ln(2)^2 bits per key (~9.6 at 1%) and
+// -log2(p) probes (7 at 1%). It is clamped to [min_size_bytes,
+// max_size_bytes] so an empty cache still has a usable filter and a huge one
+// can't blow up the load report - past ~54k keys the rate degrades instead.
+//
+// Keys are SHA-256 digests, so their bytes already are independent hashes:
+// probe i is h1 + i * h2 (Kirsch-Mitzenmacher double hashing) with h1 and h2
+// the key's first two 64-bit words.
+// -----------------------------------------------------------------------------
+class artifact_summary {
+public:
+    static constexpr double default_false_positive_rate = 0.01;
+    static constexpr size_t min_size_bytes = 64;
+    static constexpr size_t max_size_bytes = size_t{64} * 1024;
+    static constexpr size_t max_probes = 16;
+
+    // Sized for `expected_entries` keys at `false_positive_rate`
+    explicit artifact_summary(size_t expected_entries = 0,
+                              double false_positive_rate = default_false_positive_rate) {
+        const double p = std::clamp(false_positive_rate, 1e-6, 0.5);
+        const double bits_per_key = -std::log(p) / (std::numbers::ln2 * std::numbers::ln2);
+        const double bits = std::ceil(static_cast<double>(expected_entries) * bits_per_key);
+        bits_.resize(static_cast<size_t>(
+            std::clamp(std::ceil(bits / 8), double{min_size_bytes}, double{max_size_bytes})));
+        probes_ = std::clamp<size_t>(static_cast<size_t>(std::lround(-std::log2(p))), 1, max_probes);
+    }
+
+    // A received filter (load_frames.hpp checks the limits before calling):
+    // 1..max_size_bytes bytes, 1..max_probes probes
+    artifact_summary(std::span<const uint8_t> bits, size_t probes)
+        : bits_(bits.begin(), bits.end()), probes_(probes) {}
+
+    void add(const artifact_key& key) noexcept {
+        for (size_t i = 0; i < probes_; ++i) {
+            const size_t bit = probe_bit(key, i);
+            bits_[bit / 8] |= static_cast<uint8_t>(1u << (bit % 8));
+        }
+    }
+
+    bool may_contain(const artifact_key& key) const noexcept {
+        for (size_t i = 0; i < probes_; ++i) {
+            const size_t bit = probe_bit(key, i);
+            if ((bits_[bit / 8] & (1u << (bit % 8))) == 0) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    std::span<const uint8_t> bytes() const noexcept {
+        return bits_;
+    }
+    size_t probes() const noexcept {
+        return probes_;
+    }
+
+private:
+    size_t probe_bit(const artifact_key& key, size_t i) const noexcept {
+        uint64_t h1 = 0, h2 = 0;
+        for (size_t b = 0; b < 8; ++b) {
+            h1 = (h1 << 8) | key[b];
+            h2 = (h2 << 8) | key[8 + b];
+        }
+        return static_cast<size_t>((h1 + i * h2) % (bits_.size() * 8));
+    }
+
+    std::vector<uint8_t> bits_;
+    size_t probes_;
+};
+
+// -----------------------------------------------------------------------------
+// Local tier: one file per artifact, LRU eviction under a byte budget
+// -----------------------------------------------------------------------------
+class LocalArtifactCache {
+public:
+    LocalArtifactCache(std::string root, uint64_t budget_bytes);
+
+    // Create the directory and index whatever is already in it
+    std::error_code open() noexcept;
+
+    std::optional<std::vector<uint8_t>> load(const artifact_key& key);
+
+    // Store (replacing any previous entry), then evict LRU entries over budget
+    std::error_code store(const artifact_key& key, std::span<const uint8_t> data) noexcept;
+
+    // Change the budget (e.g. after a config reload); evicts immediately if needed
+    void set_budget(uint64_t budget_bytes) noexcept;
+
+    uint64_t size_bytes() const noexcept;
+    size_t entries() const noexcept;
+
+    // Bloom summary of every cached key (for load reports to the host),
+    // sized for the current number of entries
+    artifact_summary summary() const;
+
+private:
+    struct entry {
+        uint64_t size;
+        uint64_t last_used;  // Logical clock, bigger = more recent
+    };
+
+    std::string path_of(const artifact_key& key) const;
+    void evict_locked() noexcept;
+
+    struct key_hasher {
+        size_t operator()(const artifact_key& key) const noexcept;
+    };
+
+    std::string root_;
+    uint64_t budget_;
+
+    mutable std::mutex mutex_;
+    std::unordered_map<artifact_key, entry, key_hasher> index_;
+    uint64_t used_ = 0;
+    uint64_t clock_ = 0;
+};
+
+// -----------------------------------------------------------------------------
+// Remote tier: client for the host artifact service
+// -----------------------------------------------------------------------------
+
+// Opens a connection to the artifact service (vsock in production,
+// Unix socket in tests)
+using artifact_connector = std::function<std::expected<Connection, std::error_code>()>;
+
+artifact_connector vsock_artifact_connector(uint32_t cid, uint32_t port, int timeout_ms);
+artifact_connector unix_artifact_connector(std::string path, int timeout_ms);
+
+struct remote_cache_options {
+    int timeout_ms = 250;            // Per fetch - compiling must not wait long on the host
+    int reconnect_backoff_ms = 5000; // After a failed connect, skip the remote tier this long
+    size_t max_pending_publishes = 64;
+    size_t max_artifact_size = default_max_frame_payload;
+};
+
+struct remote_cache_stats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t errors = 0;     // Connect/IO failures (treated as misses)
+    uint64_t published = 0;
+    uint64_t dropped = 0;    // Publishes discarded because the queue was full
+};
+
+class RemoteArtifactClient {
+public:
+    explicit RemoteArtifactClient(artifact_connector connect, remote_cache_options options = {});
+
+    // Drains nothing - pending publishes are dropped; call flush() first if they matter
+    ~RemoteArtifactClient() noexcept;
+
+    RemoteArtifactClient(const RemoteArtifactClient&) = delete;
+    RemoteArtifactClient& operator=(const RemoteArtifactClient&) = delete;
+
+    // Ask the host; nullopt on miss OR on any error (the caller just compiles)
+    std::optional<std::vector<uint8_t>> fetch(const artifact_key& key);
+
+    // Queue an artifact for upload on the background thread
+    // Returns false if the queue is full (the artifact is dropped)
+    bool publish_async(const artifact_key& key, std::vector<uint8_t> data);
+
+    // Block until every queued publish has been attempted
+    void flush();
+
+    remote_cache_stats stats() const noexcept;
+
+private:
+    using clock = std::chrono::steady_clock;
+
+    // Ensure conn is connected, honouring the reconnect backoff
+    bool ensure_connected(std::optional<Connection>& conn, clock::time_point& retry_after);
+    void publisher_loop() noexcept;
+
+    artifact_connector connect_;
+    remote_cache_options options_;
+
+    // Fetch side: one connection, one request at a time
+    std::mutex fetch_mutex_;
+    std::optional<Connection> fetch_conn_;
+    clock::time_point fetch_retry_after_{};
+
+    // Publish side: its own connection, owned by the publisher thread
+    std::mutex queue_mutex_;
+    std::condition_variable queue_cv_;
+    std::condition_variable idle_cv_;
+    std::deque<std::pair<artifact_key, std::vector<uint8_t>>> queue_;
+    bool publishing_ = false;
+    bool stopping_ = false;
+
+    std::atomic<uint64_t> hits_{0};
+    std::atomic<uint64_t> misses_{0};
+    std::atomic<uint64_t> errors_{0};
+    std::atomic<uint64_t> published_{0};
+    std::atomic<uint64_t> dropped_{0};
+
+    std::thread publisher_;  // Last member: starts after everything above exists
+};
+
+// -----------------------------------------------------------------------------
+// Both tiers together
+// -----------------------------------------------------------------------------
+class ArtifactCache {
+public:
+    // remote may be null (no host service configured)
+    ArtifactCache(LocalArtifactCache& local, RemoteArtifactClient* remote) noexcept
+        : local_(local), remote_(remote) {}
+
+    // Local first, then the host; a host hit is copied into the local tier
+    std::optional<std::vector<uint8_t>> lookup(const artifact_key& key);
+
+    // After a fresh compile: store locally and publish to the host
+    void insert(const artifact_key& key, std::vector<uint8_t> artifact);
+
+private:
+    LocalArtifactCache& local_;
+    RemoteArtifactClient* remote_;
+};
+
+} // namespace vsocky
@@ -0,0 +1,144 @@
+#pragma once
+
+#include "vsocky/utils/error.hpp"
+#include "vsocky/utils/sha256.hpp"
+
+#include <cstdint>
+#include <expected>
+#include <span>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+// =============================================================================
+// CONTENT-ADDRESSED BLOB STORE
+// =============================================================================
+// Test fixtures and datasets are identical across thousands of jobs, so
+// re-sending them (base64-encoded!) with every request wastes most of our
+// bandwidth. Instead:
+//
+//   1. Host asks:   "which of these hashes do you have?"   (missing())
+//   2. Host sends:  only the blobs we lack, raw bytes      (put())
+//   3. Request:     references files by hash
+//   4. We build the workspace by linking from the store    (materialize())
+//
+// On-disk layout (two-level fan-out keeps directories small):
+//
+//   <root>/ab/abcdef0123...   (file name = full lowercase hex SHA-256)
+//
+// Stored files are read-only (0444) and owned by us, so a sandboxed program
+// that receives a hard link can read it and unlink its own name for it, but
+// can never modify the shared copy.
+// =============================================================================
+
+namespace vsocky {
+
+using blob_hash = sha256_digest;
+
+// How a workspace file may be used by the program
+enum class materialize_mode {
+    read_only,  // Hard link (free) - falls back to reflink, then copy
+    writable,   // Reflink (free on btrfs/xfs) - falls back to copy
+};
+
+// A workspace file that should contain the blob with the given hash
+struct blob_file_ref {
+    std::string path;  // Relative to the workspace root, no ".." components
+    blob_hash hash;
+    materialize_mode mode = materialize_mode::read_only;
+};
+
+// A blob arriving in pieces (blob_chunk frames, see blob_frames.hpp): the
+// bytes go straight to a temp file inside the store and are hashed on the
+// way, so a blob larger than a frame never sits in memory as a whole.
+// Nothing appears under the blob's name until commit() checked the hash.
+class BlobWriter {
+public:
+    BlobWriter(BlobWriter&& other) noexcept;
+    BlobWriter& operator=(BlobWriter&& other) noexcept;
+    BlobWriter(const BlobWriter&) = delete;
+    BlobWriter& operator=(const BlobWriter&) = delete;
+
+    // Not committed: the temp file is removed
+    ~BlobWriter() noexcept;
+
+    // resource_unavailable on a disk error
+    std::error_code append(std::span<const uint8_t> data) noexcept;
+
+    // Verify and publish. invalid_field_value if the bytes don't hash to
+    // hash(); either way the writer is spent afterwards.
+    std::error_code commit() noexcept;
+
+    const blob_hash& hash() const noexcept {
+        return hash_;
+    }
+    uint64_t size() const noexcept {
+        return size_;
+    }
+
+private:
+    friend class BlobStore;
+    BlobWriter(const blob_hash& hash, std::string temp_path, std::string final_path, int fd) noexcept;
+    void discard() noexcept;
+
+    blob_hash hash_;
+    std::string temp_path_;
+    std::string final_path_;
+    int fd_ = -1;
+    sha256 hasher_;
+    uint64_t size_ = 0;
+};
+
+class BlobStore {
+public:
+    explicit BlobStore(std::string root);
+
+    // Create the root directory if needed (resource_unavailable on failure)
+    std::error_code open() noexcept;
+
+    // Is this blob stored?
+    bool contains(const blob_hash& hash) const noexcept;
+
+    // Of the given hashes, return those we DON'T have (order preserved,
+    // duplicates reported once) - this is what the host uploads next
+    std::vector<blob_hash> missing(std::span<const blob_hash> hashes) const;
+
+    // Store a blob after checking its content really hashes to `hash`
+    // - invalid_field_value: content doesn't match the hash
+    // - resource_unavailable: disk error
+    // Storing a blob we already have is a cheap no-op.
+    std::error_code put(const blob_hash& hash, std::span<const uint8_t> data) noexcept;
+
+    // Start storing a blob whose content will follow in pieces
+    // (resource_unavailable on a disk error). Same checks as put(), done
+    // by BlobWriter::commit().
+    std::expected<BlobWriter, std::error_code> begin_put(const blob_hash& hash) noexcept;
+
+    // Create `dest` (absolute path) with the blob's content
+    // Returns invalid_field_value if the blob is unknown
+    std::error_code materialize(const blob_hash& hash,
+                                const std::string& dest,
+                                materialize_mode mode) const noexcept;
+
+    // Materialize every file of a workspace, creating parent directories
+    // Paths are validated first: absolute paths and ".." are rejected with
+    // invalid_field_value before anything is created.
+    std::error_code materialize_workspace(const std::string& workspace_root,
+                                          std::span<const blob_file_ref> files) const noexcept;
+
+    // Path of a blob inside the store (whether or not it exists)
+    std::string blob_path(const blob_hash& hash) const;
+
+    const std::string& root() const noexcept {
+        return root_;
+    }
+
+private:
+    std::string root_;
+};
+
+// True if `path` is a safe workspace-relative path (no escape from the root)
+bool is_safe_relative_path(std::string_view path) noexcept;
+
+} // namespace vsocky
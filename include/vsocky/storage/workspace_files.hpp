@@ -0,0 +1,58 @@
+#pragma once
+
+#include "vsocky/utils/error.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <span>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+// =============================================================================
+// WORKSPACE OUTPUT FILES
+// =============================================================================
+// Programs write files the host wants back (plots, generated code,
+// binaries). The workspace is controlled by untrusted code, so everything
+// here assumes it is hostile:
+//
+// - Symlinks are never followed. A program can create `out -> /etc` and ask
+//   the host to fetch `out/shadow`; opening component-by-component with
+//   O_NOFOLLOW makes that fail instead of escaping the workspace.
+// - Only regular files are listed or opened (no FIFOs that would block us,
+//   no device nodes).
+// - Listing is bounded, so a program that creates a million files can't
+//   make the reply unbounded.
+// =============================================================================
+
+namespace vsocky {
+
+struct workspace_file {
+    std::string path;  // Relative to the workspace root, '/'-separated
+    uint64_t size = 0;
+    uint32_t mode = 0; // Permission bits only
+};
+
+struct workspace_list_options {
+    size_t max_entries = 1024;
+    size_t max_depth = 16;
+};
+
+// Every regular file under root, sorted by path. Paths listed in `exclude`
+// (the job's inputs, typically) are left out.
+// resource_unavailable if root can't be opened; message_too_large if more
+// than max_entries files would be returned.
+std::expected<std::vector<workspace_file>, std::error_code>
+list_workspace_files(const std::string& root,
+                     std::span<const std::string> exclude = {},
+                     const workspace_list_options& options = {});
+
+// Open a workspace file for reading without following any symlink on the way
+// invalid_field_value for unsafe paths, symlinks and non-regular files;
+// resource_unavailable if it doesn't exist. The caller owns the returned fd.
+std::expected<int, std::error_code>
+open_workspace_file(const std::string& root, std::string_view path) noexcept;
+
+} // namespace vsocky
@@ -0,0 +1,100 @@
+#pragma once
+
+#include "vsocky/utils/base64.hpp"
+#include "vsocky/utils/error.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <span>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+// =============================================================================
+// STREAMING INPUT UPLOAD
+// =============================================================================
+// The receiving end of upload_chunk / upload_end (upload_frames.hpp): every
+// chunk is written to its workspace file as it arrives, so an input never
+// exists in our memory as a whole. A file carried inline in JSON as one
+// base64 string costs its size three times over (text, decoded copy,
+// write) - this costs one frame.
+//
+// Inputs that still come as base64 text (older hosts, JSON-only
+// transports) go through write_base64(), which decodes piece by piece
+// with base64_decoder.
+//
+// The same rules as workspace_files.hpp apply: paths are opened
+// component by component with O_NOFOLLOW, and files are created
+// O_EXCL - an upload can't write through a symlink, or overwrite a file
+// that's already there (a materialized blob, another input).
+// =============================================================================
+
+namespace vsocky {
+
+struct upload_limits {
+    uint64_t max_file_bytes = uint64_t{1} << 30;   // Per input
+    uint64_t max_total_bytes = uint64_t{4} << 30;  // Whole request
+};
+
+class WorkspaceUpload {
+public:
+    // paths[i] is input i, relative to root (which must exist).
+    // invalid_field_value if any path is unsafe; resource_unavailable if
+    // root can't be opened.
+    static std::expected<WorkspaceUpload, std::error_code>
+    create(const std::string& root, std::vector<std::string> paths, const upload_limits& limits = {});
+
+    WorkspaceUpload(WorkspaceUpload&& other) noexcept;
+    WorkspaceUpload& operator=(WorkspaceUpload&&) = delete;
+    WorkspaceUpload(const WorkspaceUpload&) = delete;
+    WorkspaceUpload& operator=(const WorkspaceUpload&) = delete;
+
+    // Closes whatever is still open (unfinished files stay, truncated)
+    ~WorkspaceUpload() noexcept;
+
+    // Append to input `index`, creating the file (and its parent
+    // directories) on first use. Errors:
+    // - invalid_field_value: unknown index, or the path is blocked (a
+    //   symlink or non-directory on the way, the file already exists)
+    // - invalid_message_format: the input was already finished
+    // - message_too_large: a size limit would be exceeded
+    // - write_failed: disk full, I/O error
+    std::error_code write(uint32_t index, std::span<const uint8_t> data) noexcept;
+
+    // Same, for a piece of the input's base64 text
+    // (invalid_base64_encoding for bad text)
+    std::error_code write_base64(uint32_t index, std::string_view text) noexcept;
+
+    // The input is complete: check it is `size` bytes and close it.
+    // invalid_field_value on a size mismatch (chunk lost or duplicated);
+    // an input with no chunks at all is created empty.
+    std::error_code finish(uint32_t index, uint64_t size) noexcept;
+
+    bool finished(uint32_t index) const noexcept {
+        return index < inputs_.size() && inputs_[index].finished;
+    }
+    uint64_t bytes_written() const noexcept {
+        return total_;
+    }
+
+private:
+    struct input {
+        std::string path;
+        int fd = -1;
+        uint64_t size = 0;
+        bool finished = false;
+        base64_decoder decoder;
+    };
+
+    WorkspaceUpload() noexcept = default;
+    std::error_code open_input(input& in) noexcept;
+
+    int root_fd_ = -1;
+    upload_limits limits_;
+    uint64_t total_ = 0;
+    std::vector<input> inputs_;
+};
+
+} // namespace vsocky
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstddef>
+
+// =============================================================================
+// WHY BUNDLE AN ALLOCATOR?
+// =============================================================================
+// The Alpine build links musl statically, and musl's malloc is built for
+// size, not speed: every malloc/free takes a global lock and does a fair
+// amount of bookkeeping. Single-threaded that's merely slow; once the
+// reactor has helper threads (offload pool, prefaulter, artifact publisher)
+// they all contend on that one lock, and it tops the profile.
+//
+// USE_BUNDLED_MALLOC (on by default for static musl builds, opt-in
+// elsewhere: glibc's malloc has per-thread arenas already) links in
+// src/utils/allocator.cpp, which replaces malloc/free and friends for the
+// whole binary - libc and libstdc++ included.
+//
+// HOW IT WORKS:
+// - Sizes up to 32 KiB are rounded to one of 40 size classes (4 per power of
+//   two). Each thread keeps a free list per class: malloc and free are a
+//   pointer pop/push, with no lock and no atomic.
+// - Thread caches refill from / spill to a central list per class, in
+//   batches, under that class's own lock. Threads only meet there.
+// - Objects live in 256 KiB spans, all objects of a span one class. A span
+//   starts with a header, so free() finds the class by masking the pointer.
+//   The central lists are per span: a batch handed back goes to the spans
+//   its objects came from, so the allocator sees when a span is empty.
+// - Anything bigger is its own mmap (with the same header in front). Up to
+//   16 recently freed ones of at most 1 MiB are kept for reuse - growing
+//   vectors and strings free and allocate those in turns - the rest go back
+//   to the kernel.
+//
+// An empty span goes to a pool any class can take it from. 16 of them stay
+// as they are; past that, an emptied span's pages (all but the header's)
+// go back to the kernel with madvise(MADV_DONTNEED). It stays mapped and
+// is reused like the others - a burst of small allocations doesn't pin its
+// peak for the life of the process.
+//
+// Compare against the libc allocator with vsocky-alloc-bench (system
+// malloc) and vsocky-alloc-bench-bundled, or scripts/bench-alloc.sh for
+// glibc and musl side by side.
+// =============================================================================
+
+namespace vsocky {
+
+// Memory the bundled allocator got from the kernel
+struct allocator_stats {
+    size_t span_bytes = 0;           // Mapped for small-object spans (never unmapped)
+    size_t released_span_bytes = 0;  // ...of which empty and handed back to the kernel
+    size_t large_bytes = 0;       // Live large allocations
+    size_t large_allocations = 0; // ...and how many there are
+};
+
+// Only defined when the bundled allocator is linked in (VSOCKY_BUNDLED_MALLOC)
+allocator_stats bundled_allocator_stats() noexcept;
+
+} // namespace vsocky
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <array>
 #include <expected>
 #include <span>
 #include <string>
@@ -125,4 +126,30 @@ base64_decode(std::string_view encoded);
 std::expected<std::string, std::error_code>
 base64_decode_string(std::string_view encoded);
 
+// Incremental decoder for base64 text that arrives in pieces (a large
+// upload split across frames). Pieces may split anywhere - mid-quantum
+// too; the leftover characters are carried to the next call, so memory
+// stays at the size of one piece instead of the whole file.
+class base64_decoder {
+public:
+    // Bytes decode() may produce for text_size more characters
+    static constexpr size_t max_output(size_t text_size) noexcept {
+        return (text_size + 3) / 4 * 3;
+    }
+
+    // Decode text into out (at least max_output(text.size()) bytes) and
+    // return how many bytes were written. invalid_base64_encoding on a bad
+    // character or data after padding; the decoder is unusable after that.
+    std::expected<size_t, std::error_code> decode(std::string_view text, std::span<uint8_t> out) noexcept;
+
+    // End of input: invalid_base64_encoding if it stopped mid-quantum
+    std::error_code finish() const noexcept;
+
+private:
+    std::array<int8_t, 4> carry_{};
+    size_t carried_ = 0;
+    bool padded_ = false;  // Saw the final quantum
+    bool failed_ = false;
+};
+
 } // namespace vsocky
\ No newline at end of file
@@ -0,0 +1,130 @@
+#pragma once
+
+#include "vsocky/utils/cpu_partition.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+// =============================================================================
+// RUNTIME CONFIGURATION
+// =============================================================================
+// Tunables that operators want to change without restarting the server
+// (a restart throws away warm pools and caches). The file format is
+// deliberately trivial - one "key = value" per line:
+//
+//   # vsocky.conf
+//   worker_count        = 4
+//   warm_pool_size      = 8
+//   compile_cache_bytes = 512M     # K, M and G suffixes are powers of 1024
+//   default_time_limit_ms = 2000
+//   job_sched           = batch          # normal, batch or idle
+//
+// Unknown keys are an error: a typo silently ignored is worse than a
+// reload that's refused (the old config simply stays active).
+// =============================================================================
+
+namespace vsocky {
+
+struct server_config {
+    // Pools
+    size_t warm_pool_size = 0;       // Pre-spawned helpers (0 = disabled)
+    size_t workspace_pool_size = 4;  // Pre-created workspaces
+
+    // Limits
+    size_t max_message_size = size_t{16} * 1024 * 1024;        // Per frame
+    size_t max_concurrent_jobs = 0;                           // 0 = one per vCPU
+    uint32_t default_time_limit_ms = 5000;
+    uint64_t default_memory_limit_bytes = uint64_t{256} * 1024 * 1024;
+    size_t max_output_bytes = size_t{1} * 1024 * 1024;         // stdout + stderr
+
+    // Cache budgets
+    uint64_t compile_cache_bytes = uint64_t{256} * 1024 * 1024;
+
+    // Threads
+    size_t worker_count = 0;  // 0 = one per vCPU
+
+    // CPU partitioning (see cpu_partition.hpp) - read at startup only, a
+    // reload doesn't move running threads or the supervisor
+    size_t server_cpus = 0;  // vCPUs reserved for the server (0 = share all)
+    job_sched_policy job_sched = job_sched_policy::normal;  // batch if server_cpus is set
+};
+
+// Parse config text. On failure returns invalid_field_value (bad value or
+// unknown key) and, if detail is non-null, a "line N: ..." explanation.
+// Keys not mentioned keep their defaults.
+std::expected<server_config, std::error_code>
+parse_config(std::string_view text, std::string* detail = nullptr);
+
+// Read and parse a config file (resource_unavailable if it can't be read)
+std::expected<server_config, std::error_code>
+load_config_file(const std::string& path, std::string* detail = nullptr);
+
+// =============================================================================
+// RCU-STYLE CONFIG PUBLICATION
+// =============================================================================
+// Readers are on the hot path and must never take a lock, so the current
+// config lives behind an atomic pointer. Readers are main-loop code only -
+// the grace period below is defined by that loop, so no other thread may
+// call current() (a worker would need its own copy or an epoch scheme):
+//
+//   Reader:  const auto& cfg = store.current();   // one acquire load
+//   Writer:  store.publish(new_config);           // build, then swap pointer
+//
+// A reader that loaded the old pointer just before a swap keeps using the
+// old (immutable) version - that's fine, it's still a consistent snapshot.
+// The old version can't be freed immediately for exactly that reason, so
+// publish() moves it to a retired list ("read-copy-update").
+//
+// GRACE PERIOD:
+// reclaim() frees retired versions. Call it only at a quiescent point: a
+// moment where no reader can still hold a reference obtained before the last
+// publish() (for us: the top of the main loop, between events). Readers must
+// therefore not keep a config reference across loop iterations. If you're
+// unsure, don't reclaim - a retired config is ~100 bytes and reloads are rare.
+//
+// Nothing reads current() yet: the event loop that would consult it per
+// request is still a TODO in main.cpp, so today a SIGHUP reload is parsed,
+// validated and published but changes no behaviour.
+// =============================================================================
+class config_store {
+public:
+    explicit config_store(server_config initial = {});
+    ~config_store() noexcept;
+
+    config_store(const config_store&) = delete;
+    config_store& operator=(const config_store&) = delete;
+
+    // Current config - lock-free, main-loop thread only (see GRACE PERIOD)
+    const server_config& current() const noexcept {
+        return *current_.load(std::memory_order_acquire);
+    }
+
+    // Bumped on every publish() - cheap "has anything changed?" check
+    uint64_t generation() const noexcept {
+        return generation_.load(std::memory_order_acquire);
+    }
+
+    // Atomically replace the current config (writers are serialized)
+    void publish(const server_config& next);
+
+    // Free retired versions; returns how many were freed. See GRACE PERIOD.
+    size_t reclaim() noexcept;
+
+private:
+    std::atomic<const server_config*> current_;
+    std::atomic<uint64_t> generation_{0};
+
+    // Writer-side state only - readers never touch these
+    std::mutex writer_mutex_;
+    std::vector<std::unique_ptr<const server_config>> retired_;
+};
+
+} // namespace vsocky
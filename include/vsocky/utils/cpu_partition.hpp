@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <string>
+#include <system_error>
+
+#include <sched.h>  // cpu_set_t, SCHED_*
+
+// =============================================================================
+// KEEPING JOBS OFF THE SERVER'S vCPUs
+// =============================================================================
+// The reactor spends most of its time asleep and needs a CPU the moment a
+// frame arrives. A CPU-bound student program on the same vCPU gets its full
+// timeslice first (a few ms under CFS) - latency every connection pays.
+//
+// With server_cpus = N in the config, the first N vCPUs this process may
+// use are reserved for the server (reactor, worker threads, supervisor) and
+// jobs get the rest:
+//
+//   4 vCPUs, server_cpus = 1:   server -> 0      jobs -> 1-3
+//
+// The first ones because vCPU 0 is where virtio interrupts usually land -
+// the server wants those, jobs don't. main() pins itself before any thread
+// or the supervisor exists, so everything it starts inherits the mask; the
+// supervisor applies the job mask in each child before exec.
+//
+// job_sched additionally drops jobs to SCHED_BATCH (no wakeup preemption)
+// or SCHED_IDLE (runs only when nothing else wants the CPU), at nice 19
+// with RLIMIT_NICE 0. With server_cpus set it defaults to batch;
+// "job_sched = normal" turns that off.
+//
+// LIMITS:
+// Affinity is a placement, not a wall: a job may sched_setaffinity() itself
+// onto the server's vCPUs. Combined with SCHED_IDLE that gains it only idle
+// time there; a hard boundary needs a cpuset cgroup.
+// SCHED_BATCH isn't binding either: any task may switch back to
+// SCHED_OTHER. The nice value is what holds - an unprivileged job can't
+// lower it again, or leave SCHED_IDLE, with RLIMIT_NICE at 0.
+// =============================================================================
+
+namespace vsocky {
+
+// Scheduling class for jobs, least to most yielding
+enum class job_sched_policy : uint8_t {
+    normal = 0,  // SCHED_OTHER
+    batch = 1,   // SCHED_BATCH
+    idle = 2,    // SCHED_IDLE
+};
+
+constexpr int sched_policy_value(job_sched_policy policy) noexcept {
+    switch (policy) {
+        case job_sched_policy::batch: return SCHED_BATCH;
+        case job_sched_policy::idle: return SCHED_IDLE;
+        case job_sched_policy::normal: break;
+    }
+    return SCHED_OTHER;
+}
+
+struct cpu_partition {
+    cpu_set_t server;
+    cpu_set_t jobs;
+    // Too few vCPUs to split (server_cpus >= available): both sets are
+    // everything, and only job_sched separates the two
+    bool shared = false;
+};
+
+// Split the vCPUs this process may run on (its affinity mask) into the
+// first server_cpus for the server and the rest for jobs.
+// invalid_field_value if server_cpus is 0; resource_unavailable if the
+// mask can't be read.
+std::expected<cpu_partition, std::error_code> partition_cpus(size_t server_cpus) noexcept;
+
+// Restrict the calling thread (and everything it starts from now on) to cpus
+std::error_code pin_current_thread(const cpu_set_t& cpus) noexcept;
+
+// "0-1,4" - for logs
+std::string format_cpu_list(const cpu_set_t& cpus);
+
+} // namespace vsocky
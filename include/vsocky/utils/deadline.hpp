@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+
+// =============================================================================
+// REQUEST DEADLINES
+// =============================================================================
+// Under overload the host gives up on a request (and usually retries it
+// elsewhere) long before we get to it. Running that copy anyway only burns
+// a slot the retry needs. So a request may say how long it's worth:
+//
+//   "deadline_unix_ms": absolute, host wall clock (ms since the epoch)
+//   "budget_ms":        relative to when the host sent it
+//
+// Both are turned into one local CLOCK_MONOTONIC deadline on receipt - the
+// clock the front end and the supervisor share - so nothing downstream
+// cares which form was used or whether our wall clock is right. With both
+// given, the earlier wins.
+//
+// WHICH TO USE: a VM restored from a snapshot wakes up with the wall clock
+// of the snapshot until something resyncs it, so deadline_unix_ms is only
+// as good as the guest's clock sync. budget_ms is counted from receipt
+// (vsock transit is microseconds) and is always safe.
+//
+// Deadlines are in nanoseconds of CLOCK_MONOTONIC (= steady_clock);
+// 0 means none.
+// =============================================================================
+
+namespace vsocky {
+
+struct request_timing {
+    std::optional<uint64_t> deadline_unix_ms{};
+    std::optional<uint64_t> budget_ms{};
+};
+
+// Current CLOCK_MONOTONIC / CLOCK_REALTIME readings
+uint64_t monotonic_now_ns() noexcept;
+uint64_t unix_now_ms() noexcept;
+
+// Local deadline for a request received at received_ns (monotonic), when
+// the wall clock read received_unix_ms. 0 if the request has neither field.
+// A deadline already in the past comes back as received_ns - expired, not
+// "none".
+uint64_t resolve_deadline(const request_timing& timing, uint64_t received_ns,
+                          uint64_t received_unix_ms) noexcept;
+
+inline bool deadline_passed(uint64_t deadline_ns, uint64_t now_ns) noexcept {
+    return deadline_ns != 0 && now_ns >= deadline_ns;
+}
+
+// limit_ms (0 = unlimited) capped at the time left before deadline_ns,
+// rounded up so an unexpired deadline never becomes "no limit".
+// Only meaningful while the deadline hasn't passed.
+uint32_t cap_to_deadline(uint32_t limit_ms, uint64_t deadline_ns, uint64_t now_ns) noexcept;
+
+} // namespace vsocky
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstddef>
 #include <system_error>
 #include <string_view>
 
@@ -66,9 +67,15 @@ namespace vsocky {
         
         // General errors
         timeout,                // = 18 (implicit)
-        interrupted             // = 19 (implicit)
+        interrupted,            // = 19 (implicit)
+        
+        // Outbound connection errors (guest -> host)
+        connect_failed          // = 20 (implicit)
     };
 
+    // One past the last value - for tables indexed by error_code
+    inline constexpr size_t error_code_count = static_cast<size_t>(error_code::connect_failed) + 1;
+
     // =============================================================================
     // STEP 2: Human-Readable Error Messages
     // =============================================================================
@@ -128,11 +135,44 @@ namespace vsocky {
                 return "timeout";
             case error_code::interrupted:
                 return "interrupted";
+                
+            // Outbound connection errors
+            case error_code::connect_failed:
+                return "connect failed";
         }
         
         return "unknown error";
     }
 
+    // The enumerator's own name ("read_failed") - the stable, machine-readable
+    // form that goes on the wire in error frames (error_frames.hpp)
+    constexpr std::string_view error_code_name(error_code ec) noexcept {
+        switch (ec) {
+            case error_code::success: return "success";
+            case error_code::socket_creation_failed: return "socket_creation_failed";
+            case error_code::bind_failed: return "bind_failed";
+            case error_code::listen_failed: return "listen_failed";
+            case error_code::accept_failed: return "accept_failed";
+            case error_code::connection_closed: return "connection_closed";
+            case error_code::read_failed: return "read_failed";
+            case error_code::write_failed: return "write_failed";
+            case error_code::message_too_large: return "message_too_large";
+            case error_code::invalid_message_format: return "invalid_message_format";
+            case error_code::invalid_json: return "invalid_json";
+            case error_code::missing_required_field: return "missing_required_field";
+            case error_code::invalid_field_value: return "invalid_field_value";
+            case error_code::unsupported_message_type: return "unsupported_message_type";
+            case error_code::unsupported_language: return "unsupported_language";
+            case error_code::resource_unavailable: return "resource_unavailable";
+            case error_code::internal_error: return "internal_error";
+            case error_code::invalid_base64_encoding: return "invalid_base64_encoding";
+            case error_code::timeout: return "timeout";
+            case error_code::interrupted: return "interrupted";
+            case error_code::connect_failed: return "connect_failed";
+        }
+        return "unknown";
+    }
+
     // =============================================================================
     // STEP 3: Error Category Implementation
     // =============================================================================
@@ -157,6 +197,10 @@ namespace vsocky {
         // - Returns: String description of the error
         //
         // This is called by std::error_code::message()
+        //
+        // The signature makes it allocate on every call - fine for startup
+        // errors and logs, not for paths that can fail thousands of times a
+        // second. Those use error_to_string() / sys_error (sys_error.hpp).
         std::string message(int ev) const override {
             // Reuse our error_to_string function, converting string_view to string
             return std::string(error_to_string(static_cast<error_code>(ev)));
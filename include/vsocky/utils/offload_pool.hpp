@@ -0,0 +1,152 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include <sys/types.h>
+
+// =============================================================================
+// WHY AN OFFLOAD POOL?
+// =============================================================================
+// The reactor is one thread. Everything it does between two epoll_wait()s
+// delays every other connection - and filesystem syscalls have no
+// non-blocking mode: mkdir, chown, a cgroup write or an artifact cache stat
+// just block. Usually for microseconds, but unlinking a workspace with
+// 100k files on tmpfs takes hundreds of milliseconds, and that's exactly
+// what a finished job asks for.
+//
+// So those calls run here, on a few worker threads:
+//
+//   reactor                         worker
+//   submit(work, done) ----------> work()       (blocks as long as it likes)
+//   epoll_wait() wakes  <--------- eventfd
+//   drain() -> done(errno)
+//
+// Completions run on the reactor thread, in drain(), so they can touch
+// reactor state without locks. notify_fd() is an ordinary eventfd: register
+// it with epoll like any socket.
+//
+// TWO LANES:
+// A cleanup can take a worker for a long time. Work submitted as
+// offload_lane::bulk never gets the last worker, so workspace setup for the
+// next job doesn't queue behind the previous job's rm -rf.
+// =============================================================================
+
+namespace vsocky {
+
+// Which queue a piece of work goes to
+enum class offload_lane : uint8_t {
+    latency,  // A request is waiting on it: setup, lookups, cgroup writes
+    bulk,     // Nobody is waiting: cleanup, eviction
+};
+
+struct offload_options {
+    // Worker threads; at least 2, so bulk work can't take all of them
+    size_t threads = 2;
+
+    // Submissions beyond this many queued items are refused
+    size_t max_queued = 4096;
+};
+
+// Runs blocking work off the reactor thread, completes on it
+class offload_pool {
+public:
+    // Blocking part: runs on a worker, returns 0 or an errno
+    using work = std::move_only_function<int()>;
+    // Completion: runs on the reactor thread (in drain()) with work's result
+    using completion = std::move_only_function<void(int)>;
+
+    explicit offload_pool(offload_options options = {}) noexcept;
+
+    // Stops the workers (queued work still runs; completions are dropped)
+    ~offload_pool() noexcept;
+
+    // Owns threads and an eventfd - not copyable or movable
+    offload_pool(const offload_pool&) = delete;
+    offload_pool& operator=(const offload_pool&) = delete;
+
+    // Create the eventfd and start the workers
+    // Returns resource_unavailable if either can't be created
+    std::error_code start() noexcept;
+
+    // Finish the queued work and join the workers. Completions for it are
+    // left for one last drain().
+    void stop() noexcept;
+
+    // Queue work; done runs later in drain(). Reactor thread only.
+    // Returns resource_unavailable when not started or the queue is full
+    // (done is not called then).
+    std::error_code submit(work fn, completion done, offload_lane lane = offload_lane::latency) noexcept;
+
+    // Run the completions of finished work; returns how many ran.
+    // Call when notify_fd() is readable (calling it spuriously is harmless).
+    size_t drain() noexcept;
+
+    // Readable while completions are waiting (-1 before start())
+    int notify_fd() const noexcept {
+        return event_fd_;
+    }
+
+    // Submitted and not yet drained
+    size_t in_flight() const noexcept {
+        return in_flight_;
+    }
+
+private:
+    struct task {
+        work fn;
+        completion done;
+        int result = 0;
+    };
+
+    void worker_loop() noexcept;
+
+    offload_options options_;
+
+    // Guards everything up to the workers. Held only to move tasks around,
+    // never while work or a completion runs.
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::deque<task> latency_queue_;
+    std::deque<task> bulk_queue_;
+    std::vector<task> finished_;
+    size_t bulk_running_ = 0;
+    bool stopping_ = false;
+
+    size_t in_flight_ = 0;  // Reactor thread only
+    int event_fd_ = -1;
+    std::vector<std::thread> workers_;
+};
+
+// =============================================================================
+// BLOCKING FILESYSTEM PRIMITIVES
+// =============================================================================
+// What the reactor hands to the pool. Each returns 0 or an errno, so it can
+// be the whole body of a work item:
+//
+//   pool.submit([path] { return remove_tree(path); },
+//               [](int err) { ... }, offload_lane::bulk);
+// =============================================================================
+
+// rm -rf path (never follows symlinks). A missing path is success.
+int remove_tree(const std::string& path) noexcept;
+
+// mkdir -p path; the directories it creates get mode and, when uid isn't
+// -1, are chowned to uid:gid
+int make_directories(const std::string& path, mode_t mode, uid_t uid = static_cast<uid_t>(-1),
+                     gid_t gid = static_cast<gid_t>(-1)) noexcept;
+
+// Create or truncate path and write data with a single write() where
+// possible - cgroup control files parse each write() on its own
+int write_file(const std::string& path, std::string_view data, mode_t mode = 0644) noexcept;
+
+} // namespace vsocky
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <span>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include <sys/types.h>
+
+// =============================================================================
+// WHY PREFAULT AFTER A SNAPSHOT RESTORE?
+// =============================================================================
+// Firecracker restores guest memory lazily: the snapshot file is mapped and
+// every guest page is only pulled in by the host the first time it is touched.
+// From inside the guest the pages still look resident, so the first request
+// after a restore pays a host-side fault (an EPT violation + file read) on
+// every hot page it touches - reactor state, buffer pools, parser tables...
+//
+// The fix is simple: touch those pages ourselves, in the background, before
+// the first request arrives. One read per page is enough to make the host
+// populate it. For file-backed mappings we also issue MADV_WILLNEED so the
+// guest kernel starts readahead.
+//
+// WHAT GETS TOUCHED:
+// 1. Explicitly registered regions (anything we know is hot)
+// 2. Optionally, every readable mapping of our own process that the guest
+//    kernel reports as resident (mincore) - that is exactly the working set
+//    we had when the snapshot was taken
+// 3. Registered helper processes (warm pools) - read remotely with
+//    process_vm_readv, which faults their pages in without stopping them
+//
+// WHEN:
+// The guest can't tell on its own that it was restored, so whoever resumes
+// the VM (init script, host agent) sends SIGUSR1 and signal_handler forwards
+// it to notify_fd(). The pass then runs on a low-priority background thread.
+// =============================================================================
+
+namespace vsocky {
+
+// Knobs for a prefault pass
+struct prefault_options {
+    // Walk /proc/self/maps and touch every page that is resident in the guest
+    bool include_self_maps = true;
+
+    // Upper bound on bytes touched per pass (guards against huge mappings)
+    size_t max_bytes = size_t{512} * 1024 * 1024;
+};
+
+// What a pass actually did - useful for logging and for tests
+struct prefault_stats {
+    size_t regions = 0;    // Local regions visited
+    size_t pages = 0;      // Local pages touched
+    size_t processes = 0;  // Warm-pool processes read
+    size_t remote_pages = 0;  // Pages faulted in inside those processes
+};
+
+// Touches hot memory so snapshot-restore faults happen off the request path
+class prefaulter {
+public:
+    explicit prefaulter(prefault_options options = {}) noexcept;
+
+    // Stops the background thread (if running)
+    ~prefaulter() noexcept;
+
+    // Owns a thread and an eventfd - not copyable or movable
+    prefaulter(const prefaulter&) = delete;
+    prefaulter& operator=(const prefaulter&) = delete;
+
+    // Register a region that must be warm before the first request
+    void add_region(std::span<const std::byte> memory);
+
+    // Register / forget a warm-pool process whose memory should be warmed too
+    void add_process(pid_t pid);
+    void remove_process(pid_t pid);
+
+    // Run one pass synchronously on the calling thread
+    prefault_stats run_once() noexcept;
+
+    // Start the background thread that runs a pass each time request() is called
+    // Returns resource_unavailable if the eventfd can't be created
+    std::error_code start() noexcept;
+
+    // Stop the background thread and wait for it to exit
+    void stop() noexcept;
+
+    // Ask the background thread for a pass
+    // Async-signal-safe: it is a single write() on an eventfd
+    void request() noexcept;
+
+    // eventfd that triggers a pass when written to (-1 before start())
+    // Handed to signal_handler so SIGUSR1 can trigger a pass directly
+    int notify_fd() const noexcept {
+        return event_fd_;
+    }
+
+    // Number of completed background passes and the stats of the latest one
+    uint64_t passes() const noexcept {
+        return passes_.load(std::memory_order_acquire);
+    }
+    prefault_stats last_stats() const noexcept;
+
+private:
+    struct region {
+        uintptr_t begin;
+        uintptr_t end;
+    };
+
+    void worker_loop() noexcept;
+
+    prefault_options options_;
+
+    // Guards regions_, pids_ and last_stats_ (never touched on the request path)
+    mutable std::mutex mutex_;
+    std::vector<region> regions_;
+    std::vector<pid_t> pids_;
+    prefault_stats last_stats_;
+
+    int event_fd_ = -1;
+    std::atomic<bool> stopping_{false};
+    std::atomic<uint64_t> passes_{0};
+    std::thread worker_;
+};
+
+} // namespace vsocky
@@ -0,0 +1,96 @@
+#pragma once
+
+// =============================================================================
+// USDT PROBES (static tracepoints)
+// =============================================================================
+// When the metrics aren't detailed enough we want to line up vsocky's own
+// stages with what the kernel sees (scheduling, page faults, vsock), on a
+// production VM, without rebuilding or restarting it:
+//
+//   bpftrace -e 'usdt:/usr/local/bin/vsocky:vsocky:frame_read
+//                { @bytes[arg0] = hist(arg1); }'
+//   perf probe -x /usr/local/bin/vsocky sdt_vsocky:spawn && perf record -e sdt_vsocky:spawn ...
+//
+// A probe site compiles to a single `nop` plus an ELF note (section
+// .note.stapsdt, never loaded) recording the nop's address, the probe name
+// and where each argument lives (register, stack slot or constant). A
+// tracer attaching rewrites the nop into a breakpoint; until then the cost
+// is one nop, and arguments are only *described* - nothing is computed or
+// moved for them beyond what the compiler already had in registers.
+//
+// This is the note format of <sys/sdt.h> (systemtap), reimplemented here
+// because the Alpine/musl build image doesn't ship that header. Probes with
+// semaphores (to skip expensive argument setup when nobody listens) aren't
+// supported - keep arguments to values that are already at hand.
+//
+// Probes in vsocky (provider "vsocky"):
+//   accept          (fd)                          connection accepted
+//   frame_read      (type, payload_bytes)         complete frame framed
+//   frame_write     (type, payload_bytes)         frame sent
+//   spawn           (request_id, pid)             job exec'd (supervisor)
+//   exit            (request_id, pid, wait_status) job reaped (supervisor)
+//
+// Build with -DVSOCKY_NO_PROBES (cmake -DENABLE_PROBES=OFF) to compile them
+// out entirely.
+// =============================================================================
+
+#if !defined(VSOCKY_NO_PROBES) && defined(__ELF__) && (defined(__x86_64__) || defined(__aarch64__)) && \
+    (defined(__GNUC__) || defined(__clang__))
+
+// Argument spec: "<size>@<operand>", negative size for signed values; the
+// "n" operand is printed with %n, which negates it - hence the leading minus
+#define VSOCKY_PROBE_ARG_SIZE(x) \
+    (-static_cast<int>(sizeof(x)) * (static_cast<decltype(+(x))>(-1) < static_cast<decltype(+(x))>(0) ? -1 : 1))
+
+#define VSOCKY_PROBE_NOTE(provider, name, args)                                      \
+    "990: nop\n"                                                                     \
+    ".pushsection .note.stapsdt,\"?\",\"note\"\n"                                    \
+    ".balign 4\n"                                                                    \
+    ".4byte 992f-991f, 994f-993f, 3\n"                                               \
+    "991: .asciz \"stapsdt\"\n"                                                      \
+    "992: .balign 4\n"                                                               \
+    "993: .8byte 990b\n"                                                             \
+    ".8byte _.stapsdt.base\n"                                                        \
+    ".8byte 0\n"                                                                     \
+    ".asciz \"" #provider "\"\n"                                                     \
+    ".asciz \"" #name "\"\n"                                                         \
+    ".asciz \"" args "\"\n"                                                          \
+    "994: .balign 4\n"                                                               \
+    ".popsection\n"                                                                  \
+    ".ifndef _.stapsdt.base\n"                                                       \
+    ".pushsection .stapsdt.base,\"aG\",\"progbits\",.stapsdt.base,comdat\n"          \
+    ".weak _.stapsdt.base\n"                                                         \
+    ".hidden _.stapsdt.base\n"                                                       \
+    "_.stapsdt.base: .space 1\n"                                                     \
+    ".size _.stapsdt.base, 1\n"                                                      \
+    ".popsection\n"                                                                  \
+    ".endif\n"
+
+#define VSOCKY_PROBE_OPERAND(n, x) [s##n] "n"(VSOCKY_PROBE_ARG_SIZE(x)), [a##n] "nor"(x)
+
+#define VSOCKY_PROBE0(name) \
+    __asm__ __volatile__(VSOCKY_PROBE_NOTE(vsocky, name, "") ::)
+
+#define VSOCKY_PROBE1(name, x1)                                              \
+    __asm__ __volatile__(VSOCKY_PROBE_NOTE(vsocky, name, "%n[s1]@%[a1]") \
+                         ::VSOCKY_PROBE_OPERAND(1, x1))
+
+#define VSOCKY_PROBE2(name, x1, x2)                                                      \
+    __asm__ __volatile__(VSOCKY_PROBE_NOTE(vsocky, name, "%n[s1]@%[a1] %n[s2]@%[a2]") \
+                         ::VSOCKY_PROBE_OPERAND(1, x1), VSOCKY_PROBE_OPERAND(2, x2))
+
+#define VSOCKY_PROBE3(name, x1, x2, x3)                                                               \
+    __asm__ __volatile__(VSOCKY_PROBE_NOTE(vsocky, name, "%n[s1]@%[a1] %n[s2]@%[a2] %n[s3]@%[a3]") \
+                         ::VSOCKY_PROBE_OPERAND(1, x1), VSOCKY_PROBE_OPERAND(2, x2),               \
+                         VSOCKY_PROBE_OPERAND(3, x3))
+
+#else
+
+// Arguments are still evaluated (cast away), so a probe never hides a side
+// effect or leaves a variable "unused" in one build only
+#define VSOCKY_PROBE0(name) ((void)0)
+#define VSOCKY_PROBE1(name, x1) ((void)(x1))
+#define VSOCKY_PROBE2(name, x1, x2) ((void)(x1), (void)(x2))
+#define VSOCKY_PROBE3(name, x1, x2, x3) ((void)(x1), (void)(x2), (void)(x3))
+
+#endif
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <string>
+#include <system_error>
+
+// =============================================================================
+// BUILT-IN SAMPLING PROFILER
+// =============================================================================
+// Guest rootfs images don't carry perf, and release binaries are stripped -
+// but hot spots only show up under real load, on real VMs. So the server
+// can profile itself:
+//
+//   1. One perf_event_open() per thread of ours (software cpu-clock, user
+//      space only - allowed at perf_event_paranoid <= 2 without privileges),
+//      each with a small mmap'd ring buffer the kernel writes samples into
+//   2. Every sample is a user-space call chain (frame pointers - see
+//      ENABLE_FRAME_POINTERS in CMakeLists.txt; code built without them,
+//      like libc, cuts the chain short)
+//   3. Addresses are reported as module+offset, where offset is the address
+//      as the linker laid out the module - exactly what addr2line wants
+//   4. Stacks are folded ("thread;outer;...;inner count", one per line)
+//
+// Symbolization happens offline, against the unstripped build of the same
+// binary:
+//
+//   scripts/symbolize-folded.sh build/vsocky < raw.folded | flamegraph.pl > cpu.svg
+//
+// Threads started while a profile is running aren't sampled.
+// =============================================================================
+
+namespace vsocky {
+
+struct profile_options {
+    uint32_t duration_ms = 5000;  // 1 .. max_profile_duration_ms
+    uint32_t frequency_hz = 99;   // Per thread; 99, not 100, to avoid lockstep with timers
+};
+
+inline constexpr uint32_t max_profile_duration_ms = 60'000;
+inline constexpr uint32_t max_profile_frequency_hz = 1000;
+
+struct profile_result {
+    std::string folded;   // Raw (unsymbolized) folded stacks, sorted
+    size_t samples = 0;
+    size_t lost = 0;      // Samples the kernel dropped (ring buffer full)
+    size_t threads = 0;   // Threads sampled
+};
+
+// Profile every thread of this process except the caller, blocking the
+// caller for the duration.
+//   invalid_field_value   - options out of range
+//   resource_unavailable  - perf_event_open() refused (paranoid level,
+//                           seccomp, no perf support in the kernel)
+std::expected<profile_result, std::error_code> profile_self(const profile_options& options);
+
+} // namespace vsocky
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+
+// =============================================================================
+// SHA-256
+// =============================================================================
+// Used to name content-addressed blobs: the name of a file IS the hash of its
+// bytes, so "do you have file X?" becomes "do you have hash H?" and identical
+// files are stored once no matter how many jobs send them.
+//
+// Small self-contained implementation (FIPS 180-4) so the static musl build
+// doesn't need OpenSSL. Incremental: update() may be called any number of
+// times, so large uploads can be hashed chunk by chunk.
+// =============================================================================
+
+namespace vsocky {
+
+using sha256_digest = std::array<uint8_t, 32>;
+
+class sha256 {
+public:
+    sha256() noexcept {
+        reset();
+    }
+
+    void reset() noexcept;
+
+    void update(std::span<const uint8_t> data) noexcept;
+
+    void update(std::string_view data) noexcept {
+        update(std::span(reinterpret_cast<const uint8_t*>(data.data()), data.size()));
+    }
+
+    // Finish and return the digest (the object must be reset() before reuse)
+    sha256_digest finish() noexcept;
+
+    // One-shot convenience
+    static sha256_digest hash(std::span<const uint8_t> data) noexcept {
+        sha256 h;
+        h.update(data);
+        return h.finish();
+    }
+
+private:
+    void compress(const uint8_t* block) noexcept;
+
+    std::array<uint32_t, 8> state_;
+    std::array<uint8_t, 64> block_;
+    size_t block_used_ = 0;
+    uint64_t total_bytes_ = 0;
+};
+
+// Lowercase hex (64 chars)
+std::string to_hex(const sha256_digest& digest);
+
+// Parse 64 hex chars (either case); nullopt if malformed
+std::optional<sha256_digest> parse_sha256_hex(std::string_view hex) noexcept;
+
+} // namespace vsocky
@@ -36,7 +36,9 @@
 
 namespace vsocky {
 
-// Handles SIGTERM and SIGINT for graceful shutdown
+// Handles SIGTERM and SIGINT for graceful shutdown, SIGHUP as a config
+// reload request, and forwards SIGUSR1 ("the VM was just restored from a
+// snapshot") to an eventfd
 class signal_handler {
 public:
     // Set up signal handlers - call once at program start
@@ -55,6 +57,22 @@ public:
     // - memory_order_release: Ensures our write is visible to other threads
     static void reset() noexcept {
         shutdown_requested_.store(false, std::memory_order_release);
+        reload_requested_.store(false, std::memory_order_release);
+    }
+    
+    // Check-and-clear the reload request set by SIGHUP
+    // - exchange(): Atomically reads the old value and stores the new one, so
+    //   a SIGHUP arriving right now is either seen by this call or the next -
+    //   never lost
+    static bool consume_reload_request() noexcept {
+        return reload_requested_.exchange(false, std::memory_order_acq_rel);
+    }
+    
+    // Set the eventfd that SIGUSR1 writes to (-1 disables forwarding)
+    // The prefaulter passes its notify_fd() here so a restore signal starts
+    // a prefault pass without going through the main loop.
+    static void set_restore_notify_fd(int fd) noexcept {
+        restore_notify_fd_.store(fd, std::memory_order_release);
     }
     
 private:
@@ -68,6 +86,13 @@ private:
     // - atomic<bool>: Thread-safe boolean that can be safely accessed from signal handlers
     // - Must be defined in the .cpp file (declaration here, definition there)
     static std::atomic<bool> shutdown_requested_;
+    
+    // Set by SIGHUP, cleared by consume_reload_request()
+    static std::atomic<bool> reload_requested_;
+    
+    // eventfd to poke on SIGUSR1 (-1 = none)
+    // atomic<int> is lock-free, so reading it in the handler is safe
+    static std::atomic<int> restore_notify_fd_;
 };
 
 } // namespace vsocky
\ No newline at end of file
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "vsocky/utils/error.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <system_error>
+
+// =============================================================================
+// ERRORS THAT KEEP THEIR ERRNO
+// =============================================================================
+// std::error_code holds one number: ours (read_failed) OR the kernel's
+// (ECONNRESET), not both. Collapsing to ours keeps callers simple but
+// throws away exactly what you need when a host restart produces
+// thousands of resets: were they resets, timeouts, or ENOMEM?
+//
+// sys_error is the pair, in 8 bytes: trivially copyable, no allocation to
+// create, compare or format. It converts to std::error_code (the vsocky
+// code) so it drops into existing error paths; format_sys_error() renders
+// it into a caller's buffer - never ec.message(), which allocates.
+// =============================================================================
+
+namespace vsocky {
+
+struct sys_error {
+    error_code code = error_code::success;
+    int32_t sys_errno = 0;  // errno behind it, 0 if none (EOF, timeout, ...)
+
+    constexpr explicit operator bool() const noexcept {
+        return code != error_code::success;
+    }
+    operator std::error_code() const noexcept {
+        return make_error_code(code);
+    }
+    constexpr bool operator==(const sys_error&) const noexcept = default;
+    constexpr bool operator==(error_code other) const noexcept {
+        return code == other;  // Whatever the errno
+    }
+};
+
+static_assert(sizeof(sys_error) == 8);
+
+// "ECONNRESET" for the errnos a socket/file path commonly sees, else empty
+std::string_view errno_name(int sys_errno) noexcept;
+
+// Longest format_sys_error() output
+inline constexpr size_t max_sys_error_text = 64;
+
+// "read failed (ECONNRESET)", "read failed (errno 1234)", or just
+// "timeout" without an errno. Truncated to fit out; returns what was written.
+std::string_view format_sys_error(sys_error error, std::span<char> out) noexcept;
+
+} // namespace vsocky
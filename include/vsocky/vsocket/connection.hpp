@@ -1,9 +1,12 @@
 #pragma once
 
 #include "vsocky/utils/error.hpp"
+#include "vsocky/utils/sys_error.hpp"
 
 #include <cstdint>
+#include <expected>
 #include <span>
+#include <string_view>
 #include <system_error>
 #include <optional>
 
@@ -71,6 +74,10 @@ public:
     // =========================================================================
     // CORE I/O OPERATIONS
     // =========================================================================
+    // These return a sys_error: the code below plus the errno behind it
+    // (ECONNRESET vs EPIPE vs EIO - the code folds them together). sys_errno
+    // is 0 for EOF, timeouts and short files. It converts to std::error_code
+    // for callers that only need the code.
     
     // Read data from the connection into the provided buffer
     // Parameters:
@@ -86,7 +93,7 @@ public:
     // We always use non-blocking sockets. If no data is available, read
     // returns immediately with EAGAIN/EWOULDBLOCK rather than blocking.
     // This lets us implement timeouts and check for shutdown signals.
-    std::error_code read(std::span<uint8_t> buffer, size_t& bytes_read) noexcept;
+    sys_error read(std::span<uint8_t> buffer, size_t& bytes_read) noexcept;
     
     // Write data to the connection from the provided buffer
     // Parameters:
@@ -99,7 +106,47 @@ public:
     //
     // IMPORTANT: Partial writes are possible! If you want to send 1000 bytes,
     // write() might only accept 500. Check bytes_written and loop if needed.
-    std::error_code write(std::span<const uint8_t> data, size_t& bytes_written) noexcept;
+    sys_error write(std::span<const uint8_t> data, size_t& bytes_written) noexcept;
+    
+    // Write ALL of data, waiting for socket buffer space when it is full
+    // Returns:
+    //   - success: Every byte was sent
+    //   - timeout: No progress for timeout_ms milliseconds
+    //   - connection_closed / write_failed: As for write()
+    //
+    // Only for small control messages and helper threads - the event loop
+    // must never block, so it uses write() and waits for EPOLLOUT instead.
+    sys_error write_all(std::span<const uint8_t> data, int timeout_ms) noexcept;
+    
+    // Send count bytes of a file, starting at offset, straight from the
+    // page cache to the socket with sendfile() - the data never enters our
+    // address space. Waits for socket buffer space like write_all().
+    // Returns:
+    //   - success: count bytes were sent
+    //   - read_failed: the file ended early or can't be read
+    //   - timeout / connection_closed / write_failed: As for write_all()
+    sys_error send_file(int in_fd, uint64_t offset, size_t count, int timeout_ms) noexcept;
+    
+    // Block until the fd is readable (or writable), up to timeout_ms
+    // Returns success, timeout, or connection_closed (hang-up/error)
+    std::error_code wait_readable(int timeout_ms) const noexcept;
+    std::error_code wait_writable(int timeout_ms) const noexcept;
+    
+    // =========================================================================
+    // OUTBOUND CONNECTIONS
+    // =========================================================================
+    // Most of the time we're the server and Connections come from accept().
+    // A few features need the guest to dial out instead (e.g. telling the
+    // host we're ready). These factories create a non-blocking socket,
+    // connect with a timeout, and hand back an owning Connection.
+    
+    // Connect to a VSock address (use VMADDR_CID_HOST = 2 for the host)
+    static std::expected<Connection, std::error_code>
+    connect_vsock(uint32_t cid, uint32_t port, int timeout_ms) noexcept;
+    
+    // Connect to a Unix domain socket (tests and local stand-ins)
+    static std::expected<Connection, std::error_code>
+    connect_unix(std::string_view path, int timeout_ms) noexcept;
     
     // =========================================================================
     // UTILITY OPERATIONS
@@ -0,0 +1,34 @@
+#pragma once
+
+#include "vsocky/vsocket/connection.hpp"
+#include "vsocky/vsocket/message_framer.hpp"
+
+#include <cstdint>
+#include <expected>
+#include <span>
+#include <system_error>
+
+// =============================================================================
+// BLOCKING FRAME I/O
+// =============================================================================
+// Helpers for the places that talk frames synchronously: outbound helper
+// connections (ready notification, artifact service) and tests. They wait
+// with poll() and a timeout, so they must NOT be used on the event loop.
+// =============================================================================
+
+namespace vsocky {
+
+// Send one frame (header + payload)
+std::error_code send_frame(Connection& conn,
+                           frame_type type,
+                           std::span<const uint8_t> payload,
+                           int timeout_ms) noexcept;
+
+// Read from conn until framer yields a frame
+// - timeout: nothing complete within timeout_ms
+// - connection_closed: EOF before a complete frame
+// - message_too_large: framer rejected a header
+std::expected<Frame, std::error_code>
+receive_frame(Connection& conn, MessageFramer& framer, int timeout_ms);
+
+} // namespace vsocky
@@ -0,0 +1,99 @@
+#pragma once
+
+#include "vsocky/utils/error.hpp"
+#include "vsocky/vsocket/message_framer.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <vector>
+
+// =============================================================================
+// REQUEST TRACES
+// =============================================================================
+// Synthetic benchmarks don't have production's mix of languages, payload
+// sizes and bursts. With --trace FILE the server records every frame it
+// receives, with its arrival time, and vsocky-replay plays the file back
+// against a local server - at the original pacing or flat out.
+//
+// FILE FORMAT (big-endian like the wire protocol):
+//
+//   "VSKTRACE" | u32 version (1) | u64 start, ns since the Unix epoch
+//   then per frame:
+//   varint ns since the previous frame | varint connection id | frame
+//
+// where "frame" is the frame exactly as it came off the wire (5-byte header
+// + payload), so replay writes it back out unchanged. Varint deltas keep
+// the per-frame overhead to a few bytes.
+//
+// Recording is a mutex + memcpy into a 64 KiB buffer; a full buffer is one
+// write() - meant for tmpfs. Recording stops (truncated()) once max_bytes
+// are written; a trace cut short by a crash reads back up to its last
+// complete frame.
+// =============================================================================
+
+namespace vsocky {
+
+inline constexpr char frame_trace_magic[8] = {'V', 'S', 'K', 'T', 'R', 'A', 'C', 'E'};
+inline constexpr uint32_t frame_trace_version = 1;
+
+class FrameTraceWriter {
+public:
+    // Create (truncate) path. resource_unavailable if it can't be opened.
+    static std::expected<FrameTraceWriter, std::error_code>
+    open(const std::string& path, uint64_t max_bytes = uint64_t{256} * 1024 * 1024);
+
+    FrameTraceWriter(FrameTraceWriter&& other) noexcept;
+    FrameTraceWriter& operator=(FrameTraceWriter&&) = delete;
+    FrameTraceWriter(const FrameTraceWriter&) = delete;
+    FrameTraceWriter& operator=(const FrameTraceWriter&) = delete;
+
+    // Flushes and closes
+    ~FrameTraceWriter() noexcept;
+
+    // Ids for MessageFramer::record_to(), one per accepted connection
+    uint32_t next_connection_id() noexcept {
+        return next_connection_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // Thread-safe. Drops the frame (and everything after) once the
+    // size cap is reached.
+    void record(uint32_t connection_id, const Frame& frame) noexcept;
+
+    // Write out buffered records
+    std::error_code flush() noexcept;
+
+    uint64_t frames() const noexcept;
+    bool truncated() const noexcept;
+
+private:
+    FrameTraceWriter() = default;
+    std::error_code flush_locked() noexcept;
+
+    mutable std::mutex mutex_;
+    int fd_ = -1;
+    uint64_t max_bytes_ = 0;
+    uint64_t written_ = 0;  // Including what's buffered
+    uint64_t frames_ = 0;
+    bool truncated_ = false;
+    std::chrono::steady_clock::time_point last_;
+    std::vector<uint8_t> buffer_;
+    std::atomic<uint32_t> next_connection_{1};
+};
+
+struct trace_record {
+    uint64_t offset_ns;      // Since the first frame of the trace
+    uint32_t connection_id;
+    Frame frame;
+};
+
+// Load a whole trace. invalid_message_format for a bad header; a torn
+// last record is dropped silently (see above).
+std::expected<std::vector<trace_record>, std::error_code> read_frame_trace(const std::string& path);
+
+} // namespace vsocky
@@ -0,0 +1,146 @@
+#pragma once
+
+#include "vsocky/protocol/byte_order.hpp"
+#include "vsocky/utils/error.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <system_error>
+#include <vector>
+
+// =============================================================================
+// WHY FRAMING?
+// =============================================================================
+// VSock (like TCP) is a byte stream - it has no idea where one message ends
+// and the next begins. A single read() can return half a message, or one and a
+// half messages. Framing puts boundaries back:
+//
+//   +----------------------+-----------+---------------------------+
+//   | length (u32, big-end)| type (u8) | payload (length bytes)    |
+//   +----------------------+-----------+---------------------------+
+//
+// - Length first: the receiver knows exactly how much to buffer
+// - Big-endian: "network byte order", the convention for wire formats
+// - Type byte: lets JSON control messages and raw binary chunks share one
+//   connection without base64-encoding the binary data
+// =============================================================================
+
+namespace vsocky {
+
+// What the payload of a frame contains
+enum class frame_type : uint8_t {
+    json = 1,          // UTF-8 JSON document
+    blob_query = 2,    // Host -> guest: N raw 32-byte SHA-256 hashes
+    blob_missing = 3,  // Guest -> host: the subset of a query we don't have
+    blob_upload = 4,   // Host -> guest: 32-byte hash followed by the blob bytes
+
+    // Artifact service (guest -> host cache, on its own connection)
+    artifact_get = 5,   // 32-byte artifact key
+    artifact_hit = 6,   // Artifact bytes
+    artifact_miss = 7,  // Empty
+    artifact_put = 8,   // 32-byte key followed by artifact bytes (no reply)
+
+    // Fleet routing (host router -> guest, on a pooled connection)
+    load_query = 9,   // Empty
+    load_report = 10, // Fixed-size binary load report (load_frames.hpp)
+
+    // Output file retrieval (file_frames.hpp)
+    file_list = 11,   // Host -> guest: empty; answered with a json frame
+    file_fetch = 12,  // Host -> guest: [u16 length][path]... files to stream
+    file_chunk = 13,  // Guest -> host: u32 file index, then raw file bytes
+    file_end = 14,    // Guest -> host: u32 file index, u8 status, u64 total size
+
+    // Cancellation (cancel_frames.hpp)
+    cancel = 15,     // Host -> guest: u64 request id
+    cancelled = 16,  // Guest -> host: u64 request id, u8 cancel_outcome
+
+    // Chunked input upload (upload_frames.hpp)
+    upload_chunk = 17,  // Host -> guest: u64 request id, u32 input index, raw bytes
+    upload_end = 18,    // Host -> guest: u64 request id, u32 input index, u64 total size
+
+    // Blobs larger than one frame (blob_frames.hpp)
+    blob_chunk = 19,  // Host -> guest: 32-byte hash, then the next blob bytes
+    blob_end = 20,    // Host -> guest: 32-byte hash, u64 total size
+};
+
+// Size of the fixed header in front of every payload
+inline constexpr size_t frame_header_size = 5;
+
+// Default cap on a single payload (protects us from a bogus length prefix)
+inline constexpr size_t default_max_frame_payload = size_t{16} * 1024 * 1024;
+
+// A complete, decoded frame
+struct Frame {
+    frame_type type;
+    std::vector<uint8_t> payload;
+};
+
+// Build the 5-byte header for a payload of the given type and size
+constexpr std::array<uint8_t, frame_header_size> encode_frame_header(frame_type type,
+                                                                     uint32_t size) noexcept {
+    std::array<uint8_t, frame_header_size> header{};
+    put_be(header.data(), size, 4);  // Length, then the type byte
+    header[4] = static_cast<uint8_t>(type);
+    return header;
+}
+
+class FrameTraceWriter;  // frame_trace.hpp
+
+// Incremental frame decoder: feed it whatever read() returned, pop whole frames
+class MessageFramer {
+public:
+    explicit MessageFramer(size_t max_payload = default_max_frame_payload) noexcept
+        : max_payload_(max_payload) {}
+
+    // Append bytes received from the connection
+    // Returns message_too_large if a header announces more than max_payload;
+    // the stream can't be resynchronised after that, so the caller should
+    // close the connection. The error is sticky until reset().
+    std::error_code feed(std::span<const uint8_t> data);
+
+    // Pop the next complete frame, or nullopt if we need more bytes
+    // (or if the stream is broken - check error())
+    std::optional<Frame> next();
+
+    // Sticky decode error (message_too_large), success otherwise
+    std::error_code error() const noexcept {
+        return error_;
+    }
+
+    // Bytes buffered but not yet returned as frames
+    size_t buffered() const noexcept {
+        return buffer_.size() - consumed_;
+    }
+
+    // Also record every frame next() returns (--trace); nullptr stops.
+    // The writer must outlive the framer.
+    void record_to(FrameTraceWriter* trace, uint32_t connection_id) noexcept {
+        trace_ = trace;
+        trace_connection_ = connection_id;
+    }
+
+    // Drop all buffered data (e.g. after an error)
+    void reset() noexcept {
+        buffer_.clear();
+        consumed_ = 0;
+        error_ = {};
+    }
+
+private:
+    size_t max_payload_;
+
+    // Bytes received so far; [0, consumed_) has already been handed out.
+    // We compact lazily so a burst of small frames doesn't memmove per frame.
+    std::vector<uint8_t> buffer_;
+    size_t consumed_ = 0;
+
+    std::error_code error_;
+
+    FrameTraceWriter* trace_ = nullptr;
+    uint32_t trace_connection_ = 0;
+};
+
+} // namespace vsocky
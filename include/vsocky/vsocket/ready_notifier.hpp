@@ -0,0 +1,59 @@
+#pragma once
+
+#include "vsocky/vsocket/connection.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <system_error>
+
+// =============================================================================
+// READINESS NOTIFICATION
+// =============================================================================
+// Without this the host has to poll-connect to the guest port until a
+// connect finally succeeds, which wastes time between "VM booted" and
+// "first job". Instead, once our listener is bound we dial OUT to the host
+// (VMADDR_CID_HOST) on a port it listens on and send a single frame:
+//
+//   {"type":"ready","version":"0.1.0","port":52000,
+//    "capabilities":["framed_json",...],
+//    "warm_pool":{"enabled":false,"ready":0,"target":0}}
+//
+// then close. The frame uses the normal wire format (message_framer.hpp).
+// =============================================================================
+
+namespace vsocky {
+
+// How warm our pre-spawned helpers are at the moment we report ready
+struct warm_pool_status {
+    bool enabled = false;
+    size_t ready = 0;   // Members ready to take a job
+    size_t target = 0;  // Configured pool size
+};
+
+// Everything that goes into the ready message
+struct ready_info {
+    std::string_view version;
+    uint32_t listen_port = 0;
+    std::span<const std::string_view> capabilities;
+    warm_pool_status warm_pool;
+};
+
+// Default time we wait for the host to accept the notification connection
+inline constexpr int ready_notify_timeout_ms = 2000;
+
+// Render the JSON payload of the ready message
+std::string build_ready_message(const ready_info& info);
+
+// Send the ready frame on an already-connected Connection
+std::error_code send_ready(Connection& conn, const ready_info& info, int timeout_ms) noexcept;
+
+// Connect to (cid, port), send the ready frame and close
+std::error_code notify_host_ready(uint32_t cid,
+                                  uint32_t port,
+                                  const ready_info& info,
+                                  int timeout_ms = ready_notify_timeout_ms) noexcept;
+
+} // namespace vsocky
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "vsocky/utils/error.hpp"
+#include "vsocky/vsocket/connection.hpp"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <system_error>
+
+#include <linux/vm_sockets.h>
+
+// =============================================================================
+// VSOCKSERVER - THE LISTENING SOCKET
+// =============================================================================
+// A listening socket is a different beast from a connected one: it never
+// carries data, it only produces new connected sockets via accept(). So it
+// gets its own small RAII class instead of being a special Connection.
+//
+// Lifecycle:
+//   socket() -> bind() -> listen() -> accept() ... accept() -> close()
+//
+// The host connects to (guest CID, port). We bind to VMADDR_CID_ANY so we
+// don't have to know our own CID. For tests (and host-side tools) the same
+// class can listen on a Unix domain socket path instead.
+// =============================================================================
+
+namespace vsocky {
+
+class VSockServer {
+public:
+    // Pending-connection queue length passed to listen()
+    static constexpr int default_backlog = 128;
+
+    VSockServer() noexcept = default;
+    ~VSockServer() noexcept;
+
+    // Move-only, like Connection
+    VSockServer(VSockServer&& other) noexcept;
+    VSockServer& operator=(VSockServer&& other) noexcept;
+    VSockServer(const VSockServer&) = delete;
+    VSockServer& operator=(const VSockServer&) = delete;
+
+    // Bind to a VSock port and start listening
+    // Returns socket_creation_failed, bind_failed or listen_failed on error
+    std::error_code listen(uint32_t port,
+                           uint32_t cid = VMADDR_CID_ANY,
+                           int backlog = default_backlog) noexcept;
+
+    // Bind to a Unix socket path and start listening (removes a stale file first)
+    std::error_code listen_unix(std::string_view path, int backlog = default_backlog) noexcept;
+
+    // Accept one pending connection
+    // - success + valid out: got a connection (already non-blocking)
+    // - success + invalid out: nothing pending right now (EAGAIN)
+    // - accept_failed / interrupted: as the names say
+    // Same "success with nothing" convention as Connection::read().
+    std::error_code accept(Connection& out) noexcept;
+
+    bool is_listening() const noexcept {
+        return fd_ != -1;
+    }
+
+    // Listening fd, for registering with poll/epoll
+    int fd() const noexcept {
+        return fd_;
+    }
+
+    // Port we're bound to (VSock only, 0 otherwise)
+    uint32_t port() const noexcept {
+        return port_;
+    }
+
+    // Stop listening (also done by the destructor); unlinks the Unix path
+    void close() noexcept;
+
+private:
+    int fd_ = -1;
+    uint32_t port_ = 0;
+    std::string unix_path_;  // Non-empty when listening on a Unix socket
+};
+
+} // namespace vsocky
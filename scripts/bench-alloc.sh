@@ -0,0 +1,36 @@
+#!/bin/bash
+set -e
+
+# Allocation benchmark: glibc and musl malloc against the bundled allocator.
+# Builds the benchmark locally (glibc) and in the Alpine container (musl),
+# then runs all four binaries with the same arguments.
+#
+#   ./scripts/bench-alloc.sh                 # default: --threads 1,2,4,8
+#   ./scripts/bench-alloc.sh --threads 1,16 --ops 500000
+
+ARGS=("$@")
+if [ ${#ARGS[@]} -eq 0 ]; then
+    ARGS=(--threads 1,2,4,8)
+fi
+
+echo "Building allocation benchmark (glibc)..."
+cmake -B build-bench -DCMAKE_BUILD_TYPE=Release -DBUILD_STATIC=OFF -DBUILD_TESTS=OFF > /dev/null
+cmake --build build-bench -j$(nproc) --target vsocky-alloc-bench vsocky-alloc-bench-bundled > /dev/null
+
+echo "Building allocation benchmark (musl, static)..."
+docker run --rm \
+    -v "$PWD:/workspace" \
+    -w /workspace \
+    -u "$(id -u):$(id -g)" \
+    vsocky-alpine-build:latest \
+    sh -c "
+        cmake -B build-bench-alpine -DCMAKE_BUILD_TYPE=Release -DBUILD_STATIC=ON -DBUILD_TESTS=OFF > /dev/null &&
+        cmake --build build-bench-alpine -j\$(nproc) --target vsocky-alloc-bench vsocky-alloc-bench-bundled > /dev/null
+    "
+
+for bench in build-bench/vsocky-alloc-bench build-bench/vsocky-alloc-bench-bundled \
+             build-bench-alpine/vsocky-alloc-bench build-bench-alpine/vsocky-alloc-bench-bundled; do
+    echo ""
+    echo "== $bench"
+    "$bench" "${ARGS[@]}"
+done
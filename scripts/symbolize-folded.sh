@@ -0,0 +1,73 @@
+#!/bin/bash
+# scripts/symbolize-folded.sh - Name the frames of a built-in profiler dump
+#
+# The server's profiler (src/utils/profiler.cpp) reports frames as
+# module+0xoffset because the deployed binary is stripped. Run this against
+# the unstripped build of the same commit to get function names:
+#
+#   scripts/symbolize-folded.sh build/vsocky < raw.folded > named.folded
+#   flamegraph.pl named.folded > cpu.svg
+#
+# Frames from other modules (or other builds) are left as they are.
+
+set -euo pipefail
+
+if [ $# -lt 1 ]; then
+    echo "Usage: $0 UNSTRIPPED_BINARY [FOLDED_FILE]" >&2
+    exit 1
+fi
+
+binary=$1
+input=${2:-/dev/stdin}
+module=$(basename "$binary")
+
+tmp=$(mktemp -d)
+trap 'rm -rf "$tmp"' EXIT
+
+cat "$input" > "$tmp/folded"
+
+# One addr2line run for every distinct address in this module
+grep -o "${module}+0x[0-9a-f]*" "$tmp/folded" | sed "s/^${module}+//" | sort -u > "$tmp/addrs" || true
+if [ ! -s "$tmp/addrs" ]; then
+    echo "Warning: no frames from ${module} in the input" >&2
+    cat "$tmp/folded"
+    exit 0
+fi
+
+# -f prints "function\nfile:line" per address; keep the function
+addr2line -f -C -e "$binary" < "$tmp/addrs" | paste - - | cut -f1 > "$tmp/names"
+paste "$tmp/addrs" "$tmp/names" > "$tmp/map"
+
+awk -v module="$module" '
+    BEGIN { FS = "\t" }
+    NR == FNR {
+        name = $2
+        gsub(/;/, ":", name)   # ";" separates frames
+        gsub(/ /, "_", name)   # " " separates the count
+        if (name != "??") {
+            names[module "+" $1] = name
+        }
+        next
+    }
+    {
+        split_at = match($0, / [0-9]+$/)
+        stack = substr($0, 1, split_at - 1)
+        count = substr($0, split_at + 1)
+        n = split(stack, frames, ";")
+        out = ""
+        for (i = 1; i <= n; i++) {
+            frame = (frames[i] in names) ? names[frames[i]] : frames[i]
+            out = (i == 1) ? frame : out ";" frame
+        }
+        # Different offsets in one function become one stack
+        if (!(out in total)) {
+            order[++lines] = out
+        }
+        total[out] += count
+    }
+    END {
+        for (i = 1; i <= lines; i++) {
+            print order[i], total[order[i]]
+        }
+    }
+' "$tmp/map" "$tmp/folded"
@@ -0,0 +1,167 @@
+#include "vsocky/exec/namespace_pool.hpp"
+
+#include <cstring>
+#include <utility>
+
+#include <fcntl.h>       // open()
+#include <net/if.h>      // ifreq, IFF_UP
+#include <sched.h>       // unshare(), setns()
+#include <sys/ioctl.h>   // SIOCSIFFLAGS
+#include <sys/socket.h>
+#include <unistd.h>      // sethostname()
+
+namespace vsocky {
+
+namespace {
+
+constexpr int template_flags = CLONE_NEWNET | CLONE_NEWIPC | CLONE_NEWUTS;
+constexpr char sandbox_hostname[] = "sandbox";
+
+int open_ns(const char* name) noexcept {
+    char path[32] = "/proc/self/ns/";
+    std::strcat(path, name);
+    return ::open(path, O_RDONLY | O_CLOEXEC);
+}
+
+// A new network namespace has only lo, and it's down: "localhost" wouldn't
+// work for the job. Async-signal-safe (the slow path runs it in the child).
+bool configure_current() noexcept {
+    const int fd = ::socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (fd == -1) {
+        return false;
+    }
+    ifreq request{};
+    std::memcpy(request.ifr_name, "lo", 3);
+    bool ok = ::ioctl(fd, SIOCGIFFLAGS, &request) == 0;
+    if (ok) {
+        request.ifr_flags = static_cast<short>(request.ifr_flags | IFF_UP | IFF_RUNNING);
+        ok = ::ioctl(fd, SIOCSIFFLAGS, &request) == 0;
+    }
+    ::close(fd);
+    return ok && ::sethostname(sandbox_hostname, sizeof(sandbox_hostname) - 1) == 0;
+}
+
+} // anonymous namespace
+
+std::expected<NamespacePool, std::error_code> NamespacePool::create(size_t count) {
+    NamespacePool pool;
+    pool.home_ = {open_ns("net"), open_ns("ipc"), open_ns("uts")};
+    if (pool.home_.net_fd == -1 || pool.home_.ipc_fd == -1 || pool.home_.uts_fd == -1) {
+        return std::unexpected(make_error_code(error_code::resource_unavailable));
+    }
+
+    pool.sets_.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        namespace_set set;
+        if (!pool.build_set(set)) {
+            return std::unexpected(make_error_code(error_code::resource_unavailable));
+        }
+        pool.sets_.push_back(set);
+        pool.free_.push_back(i);
+    }
+    return pool;
+}
+
+NamespacePool::NamespacePool(NamespacePool&& other) noexcept
+    : sets_(std::move(other.sets_)),
+      free_(std::move(other.free_)),
+      home_(std::exchange(other.home_, namespace_set{})) {
+    other.sets_.clear();
+}
+
+NamespacePool::~NamespacePool() noexcept {
+    for (auto& set : sets_) {
+        close_set(set);
+    }
+    close_set(home_);
+}
+
+void NamespacePool::close_set(namespace_set& set) noexcept {
+    for (int* fd : {&set.net_fd, &set.ipc_fd, &set.uts_fd}) {
+        if (*fd != -1) {
+            ::close(*fd);
+            *fd = -1;
+        }
+    }
+}
+
+bool NamespacePool::build_set(namespace_set& set) noexcept {
+    if (::unshare(template_flags) != 0) {
+        return false;
+    }
+    const bool ok = configure_current();
+    if (ok) {
+        set = {open_ns("net"), open_ns("ipc"), open_ns("uts")};
+    }
+
+    // Back home whatever happened - the supervisor must not end up living
+    // in (and spawning into) a template by accident
+    if (::setns(home_.net_fd, CLONE_NEWNET) != 0 ||
+        ::setns(home_.ipc_fd, CLONE_NEWIPC) != 0 ||
+        ::setns(home_.uts_fd, CLONE_NEWUTS) != 0) {
+        ::_exit(1);  // Can't continue with the wrong namespaces
+    }
+    if (!ok || set.net_fd == -1 || set.ipc_fd == -1 || set.uts_fd == -1) {
+        close_set(set);
+        return false;
+    }
+    return true;
+}
+
+// Only IPC carries state an unprivileged job can leave behind (see header):
+// swap in a fresh namespace, which takes SysV objects and POSIX message
+// queues alike with the old one once its last fd is closed
+bool NamespacePool::reset_set(namespace_set& set) noexcept {
+    if (::unshare(CLONE_NEWIPC) != 0) {
+        return false;
+    }
+    const int fresh = open_ns("ipc");
+    if (::setns(home_.ipc_fd, CLONE_NEWIPC) != 0) {
+        ::_exit(1);
+    }
+    if (fresh == -1) {
+        return false;
+    }
+    ::close(set.ipc_fd);
+    set.ipc_fd = fresh;
+    return true;
+}
+
+std::optional<size_t> NamespacePool::acquire() noexcept {
+    if (free_.empty()) {
+        return std::nullopt;
+    }
+    const size_t slot = free_.front();
+    free_.pop_front();
+    return slot;
+}
+
+void NamespacePool::release(size_t slot) noexcept {
+    if (slot >= sets_.size()) {
+        return;
+    }
+    if (!reset_set(sets_[slot])) {
+        // Dirty set: replace it, or retire the slot if we can't
+        close_set(sets_[slot]);
+        if (!build_set(sets_[slot])) {
+            return;
+        }
+    }
+    try {
+        free_.push_back(slot);
+    } catch (...) {
+        // Slot is lost; its namespaces stay alive until the pool goes away
+    }
+}
+
+bool enter_namespaces(const namespace_set& set) noexcept {
+    return ::setns(set.net_fd, CLONE_NEWNET) == 0 &&
+           ::setns(set.ipc_fd, CLONE_NEWIPC) == 0 &&
+           ::setns(set.uts_fd, CLONE_NEWUTS) == 0;
+}
+
+bool unshare_namespaces() noexcept {
+    return ::unshare(template_flags) == 0 && configure_current();
+}
+
+} // namespace vsocky
@@ -0,0 +1,93 @@
+#include "vsocky/exec/perf_counters.hpp"
+
+#include <cerrno>
+#include <utility>
+
+#include <linux/perf_event.h>
+#include <sys/syscall.h>  // No libc wrapper for perf_event_open()
+#include <unistd.h>
+
+namespace vsocky {
+
+namespace {
+
+int open_counter(pid_t pid, uint32_t type, uint64_t config) noexcept {
+    perf_event_attr attr{};
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = 1;
+    attr.enable_on_exec = 1;
+    attr.inherit = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return static_cast<int>(::syscall(SYS_perf_event_open, &attr, pid, -1, -1, PERF_FLAG_FD_CLOEXEC));
+}
+
+uint64_t read_counter(int fd) noexcept {
+    uint64_t value = 0;
+    if (fd == -1 || ::read(fd, &value, sizeof(value)) != sizeof(value)) {
+        return 0;
+    }
+    return value;
+}
+
+} // anonymous namespace
+
+PerfCounters::PerfCounters(PerfCounters&& other) noexcept
+    : instructions_fd_(std::exchange(other.instructions_fd_, -1)),
+      task_clock_fd_(std::exchange(other.task_clock_fd_, -1)) {}
+
+PerfCounters& PerfCounters::operator=(PerfCounters&& other) noexcept {
+    if (this != &other) {
+        close();
+        instructions_fd_ = std::exchange(other.instructions_fd_, -1);
+        task_clock_fd_ = std::exchange(other.task_clock_fd_, -1);
+    }
+    return *this;
+}
+
+PerfCounters::~PerfCounters() noexcept {
+    close();
+}
+
+void PerfCounters::close() noexcept {
+    for (int* fd : {&instructions_fd_, &task_clock_fd_}) {
+        if (*fd != -1) {
+            ::close(*fd);
+            *fd = -1;
+        }
+    }
+}
+
+std::error_code PerfCounters::open(pid_t pid, uint32_t which) noexcept {
+    close();
+    int first_error = 0;
+    if (which & perf_instructions) {
+        instructions_fd_ = open_counter(pid, PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+        if (instructions_fd_ == -1) {
+            first_error = errno;
+        }
+    }
+    if (which & perf_task_clock) {
+        task_clock_fd_ = open_counter(pid, PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK);
+        if (task_clock_fd_ == -1 && first_error == 0) {
+            first_error = errno;
+        }
+    }
+    return first_error != 0 ? std::error_code(first_error, std::system_category()) : std::error_code();
+}
+
+uint32_t PerfCounters::valid() const noexcept {
+    return (instructions_fd_ != -1 ? perf_instructions : 0u) | (task_clock_fd_ != -1 ? perf_task_clock : 0u);
+}
+
+perf_reading PerfCounters::read() const noexcept {
+    return {
+        .valid = valid(),
+        .instructions = read_counter(instructions_fd_),
+        .task_clock_ns = read_counter(task_clock_fd_),
+    };
+}
+
+} // namespace vsocky
@@ -0,0 +1,75 @@
+#include "vsocky/exec/request_pipeline.hpp"
+
+#include <algorithm>
+#include <utility>
+
+namespace vsocky {
+
+RequestPipeline::RequestPipeline(std::vector<input_stage> inputs, bool compiled)
+    : stages_(std::move(inputs)),
+      complete_(stages_.size(), false),
+      pending_total_(stages_.size()),
+      compile_(compiled ? step::waiting : step::skipped) {
+    if (compiled) {
+        pending_compile_ = static_cast<size_t>(std::count(stages_.begin(), stages_.end(), input_stage::compile));
+    }
+}
+
+std::error_code RequestPipeline::input_complete(uint32_t index) noexcept {
+    if (finished_) {
+        return error_code::success;
+    }
+    if (index >= stages_.size()) {
+        return error_code::invalid_field_value;
+    }
+    if (complete_[index]) {
+        return error_code::invalid_message_format;
+    }
+    complete_[index] = true;
+    --pending_total_;
+    if (compile_ != step::skipped && stages_[index] == input_stage::compile) {
+        --pending_compile_;
+    }
+    if (compile_ == step::running) {
+        ++overlapped_;
+    }
+    return error_code::success;
+}
+
+void RequestPipeline::compile_finished(bool succeeded) noexcept {
+    if (compile_ == step::running) {
+        compile_ = succeeded ? step::succeeded : step::failed;
+    }
+}
+
+void RequestPipeline::run_finished() noexcept {
+    if (run_ == step::running) {
+        run_ = step::succeeded;
+    }
+}
+
+void RequestPipeline::abort() noexcept {
+    aborted_ = true;
+}
+
+pipeline_action RequestPipeline::next() noexcept {
+    if (finished_) {
+        return pipeline_action::none;
+    }
+    if (aborted_ || compile_ == step::failed || run_ == step::succeeded) {
+        finished_ = true;
+        return pipeline_action::finish;
+    }
+    if (compile_ == step::waiting && pending_compile_ == 0) {
+        compile_ = step::running;
+        return pipeline_action::start_compile;
+    }
+    if (run_ == step::waiting && pending_total_ == 0 &&
+        (compile_ == step::succeeded || compile_ == step::skipped)) {
+        run_ = step::running;
+        return pipeline_action::start_run;
+    }
+    return pipeline_action::none;
+}
+
+} // namespace vsocky
@@ -0,0 +1,1669 @@
+#include "vsocky/exec/supervisor.hpp"
+#include "vsocky/exec/namespace_pool.hpp"
+#include "vsocky/exec/perf_counters.hpp"
+#include "vsocky/exec/uid_pool.hpp"
+#include "vsocky/exec/workspace_template.hpp"
+#include "vsocky/utils/deadline.hpp"
+#include "vsocky/utils/probes.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <deque>
+#include <new>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <dirent.h>          // fdopendir()
+#include <fcntl.h>           // open()
+#include <grp.h>             // setgroups()
+#include <poll.h>            // poll()
+#include <sched.h>           // sched_setaffinity(), sched_setscheduler()
+#include <sys/eventfd.h>     // eventfd()
+#include <sys/mman.h>        // memfd_create(), mmap()
+#include <sys/mount.h>       // umount2()
+#include <sys/prctl.h>       // PR_SET_PDEATHSIG, PR_SET_NO_NEW_PRIVS
+#include <sys/resource.h>    // setrlimit(), rusage
+#include <sys/signalfd.h>    // signalfd()
+#include <sys/socket.h>      // socketpair(), sendmsg(), SCM_RIGHTS
+#include <sys/stat.h>        // fstat()
+#include <sys/wait.h>        // wait4()
+#include <unistd.h>          // fork(), execvpe()
+
+namespace vsocky {
+
+namespace {
+
+// Everything the two processes share
+struct shared_block {
+    command_ring::storage commands;
+    completion_ring::storage completions;
+};
+
+// What travels with a completion's captured output fds over the socketpair
+struct output_handover {
+    uint64_t request_id;
+    uint32_t captured;  // capture_flags, in fd order
+};
+
+using steady = std::chrono::steady_clock;
+
+void signal_event_fd(int fd) noexcept {
+    const uint64_t one = 1;
+    [[maybe_unused]] auto n = ::write(fd, &one, sizeof(one));
+}
+
+void drain_event_fd(int fd) noexcept {
+    uint64_t value;
+    [[maybe_unused]] auto n = ::read(fd, &value, sizeof(value));
+}
+
+void close_pipe(int (&fds)[2]) noexcept {
+    for (int& fd : fds) {
+        if (fd != -1) {
+            ::close(fd);
+            fd = -1;
+        }
+    }
+}
+
+// How often instruction budgets are checked while such a job runs
+constexpr auto instruction_poll_interval = std::chrono::milliseconds(10);
+
+bool is_terminated(const char* field, size_t size) noexcept {
+    return std::memchr(field, '\0', size) != nullptr;
+}
+
+// =============================================================================
+// WORKSPACE RESOLUTION
+// =============================================================================
+// A workdir is a path the front end picked, and the supervisor is root. So
+// it's never handed to chdir() or open() as a whole: we walk down from the
+// workspace root one component at a time, O_NOFOLLOW, and a symlink, "."
+// or ".." anywhere on the way fails the walk instead of leading out. From
+// then on the job's chdir() and everything else goes through the fd.
+// =============================================================================
+
+// Open path (absolute, strictly beneath root, which root_fd is open on) as
+// a directory fd; -1 with errno set if it isn't one or lies elsewhere
+int open_workdir(int root_fd, std::string_view root, const char* path) noexcept {
+    std::string_view rest(path);
+    if (root_fd == -1 || !rest.starts_with(root) || rest.size() <= root.size() + 1 || rest[root.size()] != '/') {
+        errno = EINVAL;
+        return -1;
+    }
+    rest.remove_prefix(root.size() + 1);
+
+    int fd = ::fcntl(root_fd, F_DUPFD_CLOEXEC, 0);
+    char name[max_exec_path_bytes];
+    while (fd != -1 && !rest.empty()) {
+        const size_t slash = std::min(rest.find('/'), rest.size());
+        const std::string_view component = rest.substr(0, slash);
+        rest.remove_prefix(std::min(slash + 1, rest.size()));
+        if (component.empty() || component == "." || component == ".." || component.size() >= sizeof(name)) {
+            ::close(fd);
+            errno = EINVAL;
+            return -1;
+        }
+        std::memcpy(name, component.data(), component.size());
+        name[component.size()] = '\0';
+        const int next = ::openat(fd, name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+        const int open_errno = errno;
+        ::close(fd);
+        fd = next;
+        errno = open_errno;
+    }
+    return fd;
+}
+
+// Open the directory path's last component lives in (beneath root, or root
+// itself) and point name at that component inside path. Same rules as
+// open_workdir() for the whole path; -1 with errno set if they're broken.
+int open_workdir_parent(int root_fd, std::string_view root, const char* path, const char*& name) noexcept {
+    const char* slash = std::strrchr(path, '/');
+    if (root_fd == -1 || slash == nullptr) {
+        errno = EINVAL;
+        return -1;
+    }
+    name = slash + 1;
+    if (name[0] == '\0' || std::strcmp(name, ".") == 0 || std::strcmp(name, "..") == 0) {
+        errno = EINVAL;
+        return -1;
+    }
+    const std::string_view parent(path, static_cast<size_t>(slash - path));
+    if (parent == root) {
+        return ::fcntl(root_fd, F_DUPFD_CLOEXEC, 0);
+    }
+    char copy[max_exec_path_bytes];
+    if (parent.size() >= sizeof(copy)) {
+        errno = EINVAL;
+        return -1;
+    }
+    std::memcpy(copy, parent.data(), parent.size());
+    copy[parent.size()] = '\0';
+    return open_workdir(root_fd, root, copy);
+}
+
+bool is_empty_directory(int fd) noexcept {
+    const int dup_fd = ::fcntl(fd, F_DUPFD_CLOEXEC, 0);
+    DIR* dir = dup_fd == -1 ? nullptr : ::fdopendir(dup_fd);
+    if (dir == nullptr) {
+        if (dup_fd != -1) {
+            ::close(dup_fd);
+        }
+        return false;
+    }
+    bool empty = true;
+    while (const dirent* entry = ::readdir(dir)) {
+        if (std::strcmp(entry->d_name, ".") != 0 && std::strcmp(entry->d_name, "..") != 0) {
+            empty = false;
+            break;
+        }
+    }
+    ::closedir(dir);
+    return empty;
+}
+
+// /proc/self/fd/<fd>: mount() and umount2() get exactly what fd is open on
+// through it, not whatever a path names by the time they look
+std::array<char, 32> fd_path(int fd) noexcept {
+    std::array<char, 32> path{"/proc/self/fd/"};
+    const size_t prefix = std::strlen(path.data());
+    std::to_chars(path.data() + prefix, path.data() + path.size() - 1, fd);
+    return path;
+}
+
+// Remove name, in the directory parent_fd is open on, and everything under
+// it. Always relative to an fd and O_NOFOLLOW: a symlink is unlinked, never
+// followed, however the tree is changed while we walk it.
+void remove_tree(int parent_fd, const char* name) noexcept {
+    if (::unlinkat(parent_fd, name, 0) == 0 || errno != EISDIR) {
+        return;
+    }
+    const int fd = ::openat(parent_fd, name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+    if (fd == -1) {
+        return;
+    }
+    if (DIR* dir = ::fdopendir(fd)) {
+        while (const dirent* entry = ::readdir(dir)) {
+            if (std::strcmp(entry->d_name, ".") != 0 && std::strcmp(entry->d_name, "..") != 0) {
+                remove_tree(::dirfd(dir), entry->d_name);
+            }
+        }
+        ::closedir(dir);
+    } else {
+        ::close(fd);
+    }
+    ::unlinkat(parent_fd, name, AT_REMOVEDIR);
+}
+
+// =============================================================================
+// CHILD SETUP (runs between fork() and exec())
+// =============================================================================
+// Only async-signal-safe calls from here on: the child is a copy of the
+// supervisor at an arbitrary point. Each failing step reports its errno
+// through the CLOEXEC pipe - if exec succeeds the pipe closes with nothing
+// written, which is how the supervisor knows the job really started.
+// =============================================================================
+[[noreturn]] void fail_child(int error_fd) noexcept {
+    const int err = errno;
+    [[maybe_unused]] auto n = ::write(error_fd, &err, sizeof(err));
+    ::_exit(127);
+}
+
+void redirect(const char* path, int target_fd, int flags, int error_fd) noexcept {
+    const int fd = ::open(path[0] != '\0' ? path : "/dev/null", flags | O_CLOEXEC, 0644);
+    if (fd == -1) {
+        fail_child(error_fd);
+    }
+    if (::dup2(fd, target_fd) == -1) {  // dup2 clears CLOEXEC on the copy
+        fail_child(error_fd);
+    }
+    ::close(fd);
+}
+
+void set_limit(int resource, uint64_t value, int error_fd) noexcept {
+    if (value == 0) {
+        return;
+    }
+    const rlimit limit{static_cast<rlim_t>(value), static_cast<rlim_t>(value)};
+    if (::setrlimit(resource, &limit) != 0) {
+        fail_child(error_fd);
+    }
+}
+
+// memfds for the streams in flags (capture_flags), -1 for the others.
+// Sized to the limit up front - shmem only allocates what's written - and
+// sealed against growing, so the program can't write past it.
+int open_capture(uint32_t flags, uint64_t limit, int (&fds)[2]) noexcept {
+    const uint32_t streams[2] = {capture_stdout, capture_stderr};
+    const char* names[2] = {"vsocky-stdout", "vsocky-stderr"};
+    for (size_t i = 0; i < 2; ++i) {
+        if (!(flags & streams[i])) {
+            continue;
+        }
+        fds[i] = ::memfd_create(names[i], MFD_CLOEXEC | MFD_ALLOW_SEALING);
+        if (fds[i] == -1 || ::ftruncate(fds[i], static_cast<off_t>(limit)) != 0 ||
+            ::fcntl(fds[i], F_ADD_SEALS, F_SEAL_GROW) != 0) {
+            const int capture_errno = errno;
+            close_pipe(fds);
+            return capture_errno;
+        }
+    }
+    return 0;
+}
+
+// A stdio stream from an fd the supervisor set up (capture memfd,
+// interactor pipe) instead of a file
+void redirect_stdio(int fd, const char* path, int target_fd, int flags, int error_fd) noexcept {
+    if (fd == -1) {
+        redirect(path, target_fd, flags, error_fd);
+    } else if (::dup2(fd, target_fd) == -1) {
+        fail_child(error_fd);
+    }
+}
+
+// namespaces: template to enter, or nullptr to unshare fresh ones;
+// only looked at when isolate is set. go_fd (-1 = don't wait): exec only
+// after the supervisor has attached perf counters and written a byte here.
+// workdir_fd: the resolved workdir, -1 = none. stdio: fds for
+// stdin/stdout/stderr, -1 = open the command's path. supervisor: its pid,
+// to tell whether it died before the death signal was armed.
+[[noreturn]] void run_child(const supervisor_command& cmd, const supervisor_options& options,
+                            pid_t supervisor, sandbox_identity identity,
+                            bool isolate, const namespace_set* namespaces, int go_fd, int workdir_fd,
+                            const int (&stdio)[3], char* const* argv, char* const* envp,
+                            int error_fd) noexcept {
+    // Own process group: kill(-pid) reaches everything the job forks
+    ::setpgid(0, 0);
+
+    // Undo the supervisor's signal setup - jobs start with a clean slate
+    sigset_t none;
+    sigemptyset(&none);
+    ::sigprocmask(SIG_SETMASK, &none, nullptr);
+    for (int sig = 1; sig < NSIG; ++sig) {
+        ::signal(sig, SIG_DFL);
+    }
+
+    set_limit(RLIMIT_CPU, (uint64_t{cmd.cpu_time_limit_ms} + 999) / 1000, error_fd);
+    set_limit(RLIMIT_AS, cmd.memory_limit_bytes, error_fd);
+    set_limit(RLIMIT_FSIZE, cmd.file_size_limit_bytes, error_fd);
+    set_limit(RLIMIT_NPROC, cmd.max_processes, error_fd);
+
+    // Off the server's vCPUs and below it in the scheduler. The job can
+    // move itself back onto the server's vCPUs (cpu_partition.hpp, LIMITS),
+    // and from SCHED_BATCH back to SCHED_OTHER - any task may switch
+    // between the fair policies. What sticks is nice 19 with RLIMIT_NICE
+    // at 0: an unprivileged job can't lower its nice again, nor leave
+    // SCHED_IDLE.
+    if (options.job_cpus && ::sched_setaffinity(0, sizeof(cpu_set_t), &*options.job_cpus) != 0) {
+        fail_child(error_fd);
+    }
+    if (const auto policy = std::max(cmd.sched_policy, options.job_sched); policy != job_sched_policy::normal) {
+        const sched_param param{};
+        const rlimit no_renice{0, 0};
+        if (::sched_setscheduler(0, sched_policy_value(policy), &param) != 0 ||
+            ::setpriority(PRIO_PROCESS, 0, 19) != 0 || ::setrlimit(RLIMIT_NICE, &no_renice) != 0) {
+            fail_child(error_fd);
+        }
+    }
+
+    // Needs CAP_SYS_ADMIN, so before the credentials switch
+    if (isolate) {
+        const bool entered = namespaces != nullptr ? enter_namespaces(*namespaces) : unshare_namespaces();
+        if (!entered) {
+            fail_child(error_fd);
+        }
+    }
+
+    // Group first: after setuid() we'd no longer be allowed to change it
+    if (identity.gid != static_cast<gid_t>(-1)) {
+        if (::setgroups(0, nullptr) != 0 || ::setresgid(identity.gid, identity.gid, identity.gid) != 0) {
+            fail_child(error_fd);
+        }
+    }
+    if (identity.uid != static_cast<uid_t>(-1)) {
+        if (::setresuid(identity.uid, identity.uid, identity.uid) != 0) {
+            fail_child(error_fd);
+        }
+    }
+
+    // Only now, as the job: the stdio paths come from the front end, and
+    // opening them as root would let them name any file root can write
+    if (workdir_fd != -1 && ::fchdir(workdir_fd) != 0) {
+        fail_child(error_fd);
+    }
+    redirect_stdio(stdio[0], cmd.stdin_path.data(), STDIN_FILENO, O_RDONLY, error_fd);
+    redirect_stdio(stdio[1], cmd.stdout_path.data(), STDOUT_FILENO, O_WRONLY | O_CREAT | O_TRUNC, error_fd);
+    redirect_stdio(stdio[2], cmd.stderr_path.data(), STDERR_FILENO, O_WRONLY | O_CREAT | O_TRUNC, error_fd);
+
+    if (go_fd != -1) {
+        char go;
+        ssize_t n;
+        do {
+            n = ::read(go_fd, &go, 1);
+        } while (n == -1 && errno == EINTR);
+        if (n != 1) {
+            ::_exit(127);  // Supervisor gave up on us
+        }
+    }
+
+    // Supervisor dies -> the job is killed: nothing else would enforce its
+    // wall clock, budget or UID sweep. Armed only now because changing
+    // credentials clears the death signal; the parent check covers a
+    // supervisor that died before the prctl.
+    if (::prctl(PR_SET_PDEATHSIG, SIGKILL) != 0) {
+        fail_child(error_fd);
+    }
+    if (::getppid() != supervisor) {
+        ::_exit(127);
+    }
+    ::execvpe(argv[0], argv, envp);
+    fail_child(error_fd);
+}
+
+// =============================================================================
+// THE SUPERVISOR PROCESS
+// =============================================================================
+// Single-threaded. Sleeps in poll() on three things:
+//   - the command eventfd (front end queued something)
+//   - a signalfd for SIGCHLD (a job exited) and SIGTERM (front end died,
+//     via PR_SET_PDEATHSIG)
+// Should the supervisor itself die, its jobs get SIGKILL: each one arms its
+// own PR_SET_PDEATHSIG in run_child(), after switching credentials.
+//   - the nearest wall-clock deadline (poll timeout)
+// =============================================================================
+class supervisor_process {
+public:
+    supervisor_process(shared_block* shared, int command_fd, int completion_fd, int output_fd,
+                       const supervisor_options& options) noexcept
+        : commands_(&shared->commands),
+          completions_(&shared->completions),
+          command_fd_(command_fd),
+          completion_fd_(completion_fd),
+          output_fd_(output_fd),
+          options_(options) {
+        if (options.uid_pool_size != 0) {
+            uid_pool_.emplace(options.uid_pool_base, options.uid_pool_size);
+        }
+    }
+
+    [[noreturn]] void run() noexcept {
+        ::prctl(PR_SET_NAME, "vsocky-super");
+
+        // Ctrl-C in a terminal hits the whole process group; the supervisor
+        // must only stop when the front end says so (or dies)
+        ::signal(SIGINT, SIG_IGN);
+        ::signal(SIGHUP, SIG_IGN);
+        ::signal(SIGUSR1, SIG_IGN);
+        ::signal(SIGPIPE, SIG_IGN);
+
+        sigset_t mask;
+        sigemptyset(&mask);
+        sigaddset(&mask, SIGCHLD);
+        sigaddset(&mask, SIGTERM);
+        ::sigprocmask(SIG_BLOCK, &mask, nullptr);
+        signal_fd_ = ::signalfd(-1, &mask, SFD_CLOEXEC | SFD_NONBLOCK);
+
+        // Namespace templates are built here, in the process that will use
+        // them. If that fails every job takes the unshare() slow path - and
+        // fails to spawn if that can't work either, rather than silently
+        // running without isolation.
+        if (options_.namespace_pool_size != 0) {
+            if (auto pool = NamespacePool::create(options_.namespace_pool_size)) {
+                namespace_pool_.emplace(std::move(*pool));
+            }
+        }
+
+        // Without it every spawn that names a workdir fails (EINVAL)
+        if (!options_.workspace_root.empty()) {
+            workspace_root_ = options_.workspace_root;
+            while (!workspace_root_.empty() && workspace_root_.back() == '/') {
+                workspace_root_.remove_suffix(1);
+            }
+            workspace_root_fd_ = ::open(options_.workspace_root.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        }
+
+        while (!stopping_) {
+            drain_commands();
+            flush_completions();
+            enforce_deadlines();
+
+            if (stopping_) {
+                break;
+            }
+            if (!commands_.consumer_may_sleep()) {
+                continue;
+            }
+
+            pollfd fds[2] = {{command_fd_, POLLIN, 0}, {signal_fd_, POLLIN, 0}};
+            if (::poll(fds, 2, poll_timeout_ms()) > 0) {
+                if (fds[0].revents & POLLIN) {
+                    drain_event_fd(command_fd_);
+                }
+                if (fds[1].revents & POLLIN) {
+                    handle_signals();
+                }
+            }
+        }
+
+        // Shutting down: no job outlives us
+        for (const auto& j : jobs_) {
+            ::kill(-j.pid, SIGKILL);
+            if (j.pooled_uid) {
+                kill_all_processes_of(j.identity.uid);
+            }
+        }
+        while (::waitpid(-1, nullptr, 0) > 0 || errno == EINTR) {
+        }
+        for (const auto& o : overlays_) {
+            unmount_overlay(o);
+        }
+        ::_exit(0);
+    }
+
+private:
+    // A workdir with a template overlay mounted
+    struct overlay {
+        std::string workdir;
+        int root_fd;  // O_PATH, on the overlay's root
+    };
+
+    struct job {
+        uint64_t request_id;
+        pid_t pid;
+        steady::time_point started;
+        steady::time_point deadline;  // time_point::max() = none
+        bool deadline_from_request = false;  // deadline is the request's, not the wall limit
+        sandbox_identity identity;
+        bool pooled_uid = false;      // identity came from uid_pool_ - give it back on reap
+        std::optional<size_t> namespace_slot{};  // Template in use, if any
+        PerfCounters perf{};
+        uint64_t instruction_limit = 0;
+        bool wall_time_exceeded = false;
+        bool instruction_limit_exceeded = false;
+        bool cancelled = false;
+        std::string cancel_workdir{};  // Removed once the job is reaped and swept
+        std::array<int, 2> capture{-1, -1};  // stdout/stderr memfds (capture_flags)
+        uint64_t capture_limit = 0;
+        // Interactive pair: the other half's pid, and its result once it has
+        // been reaped - the pair reports once, when both are gone
+        pid_t peer = 0;
+        bool interactor = false;
+        std::optional<supervisor_completion> peer_result{};
+    };
+
+    static uint32_t reported_uid(sandbox_identity identity) noexcept {
+        return static_cast<uint32_t>(identity.uid != static_cast<uid_t>(-1) ? identity.uid : ::geteuid());
+    }
+
+    void drain_commands() noexcept {
+        supervisor_command cmd;
+        while (commands_.try_pop(cmd)) {
+            switch (cmd.op) {
+                case supervisor_op::spawn:
+                    spawn(cmd);
+                    break;
+                case supervisor_op::kill:
+                    for (const auto& j : jobs_) {
+                        if (j.request_id == cmd.request_id) {
+                            ::kill(-j.pid, SIGKILL);
+                        }
+                    }
+                    break;
+                case supervisor_op::cancel:
+                    cancel(cmd);
+                    break;
+                case supervisor_op::release:
+                    release(cmd);
+                    break;
+                case supervisor_op::shutdown:
+                    stopping_ = true;
+                    return;
+                default:
+                    break;  // Garbage from a confused front end - ignore
+            }
+        }
+    }
+
+    void cancel(const supervisor_command& cmd) noexcept {
+        const char* workdir = is_terminated(cmd.workdir.data(), cmd.workdir.size()) ? cmd.workdir.data() : "";
+        bool running = false;
+        for (auto& j : jobs_) {
+            if (j.request_id == cmd.request_id) {
+                running = true;
+                j.cancelled = true;
+                try {
+                    j.cancel_workdir = workdir;
+                } catch (...) {
+                    // Killed all the same; the workdir stays behind
+                }
+                ::kill(-j.pid, SIGKILL);
+            }
+        }
+        if (!running) {
+            // Already exited (its completion may still be on its way) or
+            // never spawned: nothing to kill, but the workdir can go
+            release_workspace(workdir);
+            supervisor_completion result;
+            result.event = supervisor_event::cancelled;
+            result.request_id = cmd.request_id;
+            complete(result);
+        }
+    }
+
+    void release(const supervisor_command& cmd) noexcept {
+        if (!is_terminated(cmd.workdir.data(), cmd.workdir.size()) ||
+            std::any_of(jobs_.begin(), jobs_.end(),
+                        [&](const job& j) { return j.request_id == cmd.request_id; })) {
+            return;
+        }
+        release_workspace(cmd.workdir.data());
+    }
+
+    void release_workspace(const char* path) noexcept {
+        drop_overlay(path);
+        release_workdir(path);
+    }
+
+    // Overlay cmd.workspace_template on cmd.workdir; errno on failure. The
+    // target must be an existing, empty directory beneath the workspace
+    // root: it's resolved like any workdir (WORKSPACE RESOLUTION) and
+    // mounted on through its fd, so the mount can't land anywhere else or
+    // hide files already there.
+    int mount_template(const supervisor_command& cmd) noexcept {
+        if (options_.template_root.empty()) {
+            return EOPNOTSUPP;
+        }
+        if (!is_terminated(cmd.workspace_template.data(), cmd.workspace_template.size()) ||
+            !is_valid_template_name(cmd.workspace_template.data())) {
+            return EINVAL;
+        }
+        if (find_overlay(cmd.workdir.data()) != overlays_.end()) {
+            return EBUSY;  // Previous job's overlay not released yet
+        }
+        const char* name = nullptr;
+        const int parent_fd = open_workdir_parent(workspace_root_fd_, workspace_root_, cmd.workdir.data(), name);
+        if (parent_fd == -1) {
+            return errno;
+        }
+        const int target_fd = ::openat(parent_fd, name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+        struct stat target;
+        int result = 0;
+        if (target_fd == -1 || ::fstat(target_fd, &target) != 0) {
+            result = errno;
+        } else if (!is_empty_directory(target_fd)) {
+            result = ENOTEMPTY;
+        }
+
+        bool mounted = false;
+        if (result == 0) {
+            try {
+                overlays_.push_back({cmd.workdir.data(), -1});
+                result = mount_template_workspace(options_.template_root + "/" + cmd.workspace_template.data(),
+                                                  fd_path(target_fd).data(), options_.template_scratch_root,
+                                                  options_.template_upper_bytes);
+                mounted = result == 0;
+            } catch (...) {
+                result = ENOMEM;
+            }
+        }
+
+        // Keep the overlay's root for the unmount. A mount point can't be
+        // renamed or removed, so name leads to it now - unless the directory
+        // was swapped before the mount, and then ours comes off again.
+        if (mounted) {
+            struct stat root;
+            const int root_fd = ::openat(parent_fd, name, O_PATH | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+            if (root_fd != -1 && ::fstat(root_fd, &root) == 0 && root.st_dev != target.st_dev) {
+                overlays_.back().root_fd = root_fd;
+            } else {
+                if (root_fd != -1) {
+                    ::close(root_fd);
+                }
+                ::umount2(fd_path(target_fd).data(), MNT_DETACH);
+                result = EBUSY;
+            }
+        }
+        if (result != 0 && !overlays_.empty() && overlays_.back().root_fd == -1) {
+            overlays_.pop_back();
+        }
+        if (target_fd != -1) {
+            ::close(target_fd);
+        }
+        ::close(parent_fd);
+        return result;
+    }
+
+    std::vector<overlay>::iterator find_overlay(const char* path) noexcept {
+        return std::find_if(overlays_.begin(), overlays_.end(),
+                            [&](const overlay& o) { return o.workdir == path; });
+    }
+
+    static void unmount_overlay(const overlay& o) noexcept {
+        ::umount2(fd_path(o.root_fd).data(), MNT_DETACH);
+        ::close(o.root_fd);
+    }
+
+    // Unmount the overlay on path, if we put one there. Only overlays we
+    // mounted ourselves, through the root we kept: the front end can't make
+    // us unmount anything else.
+    void drop_overlay(const char* path) noexcept {
+        const auto it = find_overlay(path);
+        if (it != overlays_.end()) {
+            unmount_overlay(*it);
+            overlays_.erase(it);
+        }
+    }
+
+    // Delete a cancelled job's workspace. Only a directory beneath the
+    // workspace root owned by a pool UID that's currently free qualifies: no
+    // job can still be writing to it (the sweep killed them all), and the
+    // path can't name anything the supervisor didn't hand to a job itself.
+    // Found and removed through fds (WORKSPACE RESOLUTION).
+    void release_workdir(const char* path) noexcept {
+        if (!uid_pool_) {
+            return;
+        }
+        const char* name = nullptr;
+        const int parent_fd = open_workdir_parent(workspace_root_fd_, workspace_root_, path, name);
+        if (parent_fd == -1) {
+            return;
+        }
+        struct stat st;
+        const int fd = ::openat(parent_fd, name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+        const bool releasable = fd != -1 && ::fstat(fd, &st) == 0 && uid_pool_->owns(st.st_uid) &&
+                                !uid_pool_->in_use(st.st_uid);
+        if (fd != -1) {
+            ::close(fd);
+        }
+        if (releasable) {
+            remove_tree(parent_fd, name);
+        }
+        ::close(parent_fd);
+    }
+
+    // Validate everything read from shared memory before using it: the
+    // front end might be compromised, or still writing (it isn't, by the
+    // ring protocol, but we don't rely on its good behaviour)
+    bool build_argv(const supervisor_command& cmd, std::vector<char*>& argv) noexcept {
+        if (!is_terminated(cmd.workdir.data(), cmd.workdir.size()) ||
+            !is_terminated(cmd.stdin_path.data(), cmd.stdin_path.size()) ||
+            !is_terminated(cmd.stdout_path.data(), cmd.stdout_path.size()) ||
+            !is_terminated(cmd.stderr_path.data(), cmd.stderr_path.size())) {
+            return false;
+        }
+        if (cmd.argc == 0 || cmd.argc > 256 || cmd.interactor_argc > 256 ||
+            cmd.sched_policy > job_sched_policy::idle) {
+            return false;
+        }
+
+        // Interactive: the interactor's argv follows the job's, after its nullptr
+        args_copy_ = cmd.args;
+        try {
+            argv.clear();
+            size_t offset = 0;
+            for (uint32_t i = 0; i < cmd.argc + cmd.interactor_argc; ++i) {
+                if (i == cmd.argc) {
+                    argv.push_back(nullptr);
+                }
+                if (offset >= args_copy_.size()) {
+                    return false;
+                }
+                const void* end = std::memchr(args_copy_.data() + offset, '\0', args_copy_.size() - offset);
+                if (end == nullptr) {
+                    return false;
+                }
+                argv.push_back(args_copy_.data() + offset);
+                offset = static_cast<size_t>(static_cast<const char*>(end) - args_copy_.data()) + 1;
+            }
+            argv.push_back(nullptr);
+        } catch (...) {
+            return false;
+        }
+        return true;
+    }
+
+    // in_workdir: HOME and TMPDIR in cmd's workdir (if it has one), else
+    // HOME=/tmp - for the interactor, which mustn't use anything the job
+    // can write
+    bool build_envp(const supervisor_command& cmd, bool in_workdir, std::array<char*, 6>& envp) noexcept {
+        static char path_env[] = "PATH=/usr/local/bin:/usr/bin:/bin";
+        static char lang_env[] = "LANG=C.UTF-8";
+        static char home_tmp_env[] = "HOME=/tmp";
+        try {
+            envp = {path_env, lang_env, home_tmp_env, nullptr, nullptr, nullptr};
+            if (!in_workdir || cmd.workdir[0] == '\0') {
+                return true;
+            }
+            home_env_ = std::string("HOME=") + cmd.workdir.data();
+            tmpdir_env_ = std::string("TMPDIR=") + cmd.workdir.data();
+        } catch (...) {
+            return false;
+        }
+        envp[2] = home_env_.data();
+        envp[3] = tmpdir_env_.data();
+        return true;
+    }
+
+    // Fork and exec the interactor of an interactive spawn, with stdin and
+    // stdout on the pipes to the job and stderr on stderr_fd (a capture
+    // memfd, -1 = /dev/null). It's trusted code: no rlimits. It starts in
+    // "/": the workdir belongs to the job's UID, which could swap any file
+    // the interactor opens there. Returns its pid, or -1 with
+    // error_number set.
+    pid_t start_interactor(const supervisor_command& cmd, sandbox_identity identity, char* const* argv,
+                           char* const* envp, int stdin_fd, int stdout_fd, int stderr_fd,
+                           int& error_number) noexcept {
+        interactor_cmd_ = cmd;
+        interactor_cmd_.cpu_time_limit_ms = 0;
+        interactor_cmd_.memory_limit_bytes = 0;
+        interactor_cmd_.file_size_limit_bytes = 0;
+        interactor_cmd_.max_processes = 0;
+        interactor_cmd_.stderr_path = {};
+
+        const int root_fd = ::open("/", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (root_fd == -1) {
+            error_number = errno;
+            return -1;
+        }
+        int error_pipe[2];
+        if (::pipe2(error_pipe, O_CLOEXEC) != 0) {
+            error_number = errno;
+            ::close(root_fd);
+            return -1;
+        }
+        const pid_t pid = ::fork();
+        if (pid == 0) {
+            ::close(error_pipe[0]);
+            const int stdio[3] = {stdin_fd, stdout_fd, stderr_fd};
+            run_child(interactor_cmd_, options_, self_, identity, false, nullptr, -1, root_fd, stdio, argv, envp,
+                      error_pipe[1]);
+        }
+        ::close(error_pipe[1]);
+        ::close(root_fd);
+        if (pid == -1) {
+            error_number = errno;
+            ::close(error_pipe[0]);
+            return -1;
+        }
+        ::setpgid(pid, pid);
+
+        int child_errno = 0;
+        ssize_t n;
+        do {
+            n = ::read(error_pipe[0], &child_errno, sizeof(child_errno));
+        } while (n == -1 && errno == EINTR);
+        ::close(error_pipe[0]);
+        if (n == sizeof(child_errno)) {
+            ::waitpid(pid, nullptr, 0);
+            error_number = child_errno;
+            return -1;
+        }
+        return pid;
+    }
+
+    void spawn(const supervisor_command& cmd) noexcept {
+        supervisor_completion result;
+        result.request_id = cmd.request_id;
+
+        // Sat in the ring past its deadline: the host has given up on it,
+        // and running it now only delays the work it's still waiting for
+        if (deadline_passed(cmd.deadline_ns, monotonic_now_ns())) {
+            result.event = supervisor_event::expired;
+            complete(result);
+            return;
+        }
+
+        // Built before fork(): the child may not allocate. HOME and TMPDIR
+        // point into the workspace so concurrent jobs don't meet in /tmp.
+        std::vector<char*> argv;
+        std::array<char*, 6> envp{};
+        std::array<char*, 6> interactor_envp{};
+        if (!build_argv(cmd, argv) || !build_envp(cmd, true, envp) || !build_envp(cmd, false, interactor_envp)) {
+            result.event = supervisor_event::spawn_failed;
+            result.error_number = EINVAL;
+            complete(result);
+            return;
+        }
+
+        // The template overlay goes first: the chown below has to apply to
+        // the overlay's root, not the directory underneath it
+        const bool templated = cmd.workspace_template[0] != '\0';
+        if (templated) {
+            if (const int mount_errno = mount_template(cmd)) {
+                result.event = supervisor_event::spawn_failed;
+                result.error_number = mount_errno;
+                complete(result);
+                return;
+            }
+        }
+
+        // After the mount, so it's the overlay's root (WORKSPACE RESOLUTION)
+        int workdir_fd = -1;
+        if (cmd.workdir[0] != '\0') {
+            workdir_fd = open_workdir(workspace_root_fd_, workspace_root_, cmd.workdir.data());
+            if (workdir_fd == -1) {
+                result.event = supervisor_event::spawn_failed;
+                result.error_number = errno;
+                if (templated) {
+                    drop_overlay(cmd.workdir.data());
+                }
+                complete(result);
+                return;
+            }
+        }
+
+        sandbox_identity identity{options_.job_uid, options_.job_gid};
+        if (uid_pool_) {
+            auto acquired = uid_pool_->acquire();
+            if (!acquired) {
+                // Every sandbox UID is running a job - the front end should
+                // cap concurrency at the pool size
+                result.event = supervisor_event::spawn_failed;
+                result.error_number = EAGAIN;
+                if (workdir_fd != -1) {
+                    ::close(workdir_fd);
+                }
+                if (templated) {
+                    drop_overlay(cmd.workdir.data());
+                }
+                complete(result);
+                return;
+            }
+            identity = *acquired;
+        }
+
+        // The workspace was created by the front end; the job has to be
+        // able to write its outputs there (stdio too: it's opened as the
+        // job). Only the directory itself - inputs stay read-only - and
+        // through the resolved fd, never the path.
+        if (workdir_fd != -1 && identity.uid != static_cast<uid_t>(-1) &&
+            ::fchown(workdir_fd, identity.uid, identity.gid) != 0) {
+            result.event = supervisor_event::spawn_failed;
+            result.error_number = errno;
+            if (uid_pool_) {
+                uid_pool_->release(identity.uid);
+            }
+            ::close(workdir_fd);
+            if (templated) {
+                drop_overlay(cmd.workdir.data());
+            }
+            complete(result);
+            return;
+        }
+        const bool isolate = options_.namespace_pool_size != 0;
+        std::optional<size_t> namespace_slot;
+        if (isolate && namespace_pool_) {
+            namespace_slot = namespace_pool_->acquire();
+        }
+
+        int capture[2] = {-1, -1};
+        int to_job[2] = {-1, -1};
+        int to_interactor[2] = {-1, -1};
+        std::optional<sandbox_identity> interactor_identity;
+        pid_t interactor_pid = 0;
+        bool job_ran = false;  // Past exec(): its UID needs a sweep before reuse
+        const auto fail = [&](int error_number) noexcept {
+            result.event = supervisor_event::spawn_failed;
+            result.error_number = error_number;
+            // Unless it ran, the child never ran job code. Same rules as reap().
+            const bool swept = uid_pool_ && (!job_ran || kill_all_processes_of(identity.uid));
+            if (swept) {
+                uid_pool_->release(identity.uid);
+            }
+            if (namespace_slot && (swept || !uid_pool_)) {
+                namespace_pool_->release(*namespace_slot);
+            }
+            if (templated) {
+                drop_overlay(cmd.workdir.data());
+            }
+            if (workdir_fd != -1) {
+                ::close(workdir_fd);
+            }
+            close_pipe(capture);
+            close_pipe(to_job);
+            close_pipe(to_interactor);
+            if (interactor_pid > 0) {
+                ::kill(-interactor_pid, SIGKILL);
+                ::waitpid(interactor_pid, nullptr, 0);
+            }
+            if (interactor_identity && uid_pool_ &&
+                (interactor_pid == 0 || kill_all_processes_of(interactor_identity->uid))) {
+                uid_pool_->release(interactor_identity->uid);
+            }
+            complete(result);
+        };
+
+        // perf counters have to be attached between fork() and exec(), so
+        // a measured child waits for a byte on the go pipe
+        const uint32_t counters = cmd.perf_counters | (cmd.instruction_limit != 0 ? perf_instructions : 0u);
+        int go_pipe[2] = {-1, -1};
+        if (counters != 0 && ::pipe2(go_pipe, O_CLOEXEC) != 0) {
+            fail(errno);
+            return;
+        }
+
+        const uint64_t capture_limit =
+            cmd.capture_limit_bytes != 0 ? cmd.capture_limit_bytes : default_capture_limit_bytes;
+        if (const int capture_errno = open_capture(cmd.capture_flags, capture_limit, capture)) {
+            close_pipe(go_pipe);
+            fail(capture_errno);
+            return;
+        }
+
+        // The interactor starts first, blocked on its stdin until the job
+        // writes. It gets a UID of its own: sharing the job's would let the
+        // job kill or ptrace it. The stdout capture is its stderr: the job's
+        // stdout is the interactor's stdin.
+        const bool interactive = cmd.interactor_argc != 0;
+        const auto started = steady::now();
+        if (interactive) {
+            if (uid_pool_) {
+                auto acquired = uid_pool_->acquire();
+                if (!acquired) {
+                    close_pipe(go_pipe);
+                    fail(EAGAIN);
+                    return;
+                }
+                interactor_identity = *acquired;
+            } else {
+                interactor_identity = sandbox_identity{options_.job_uid, options_.job_gid};
+            }
+            int interactor_errno = 0;
+            if (::pipe2(to_job, O_CLOEXEC) != 0 || ::pipe2(to_interactor, O_CLOEXEC) != 0) {
+                interactor_errno = errno;
+            } else {
+                const pid_t spawned =
+                    start_interactor(cmd, *interactor_identity, argv.data() + cmd.argc + 1, interactor_envp.data(),
+                                     to_interactor[0], to_job[1], capture[0], interactor_errno);
+                interactor_pid = spawned > 0 ? spawned : 0;
+            }
+            if (interactor_errno != 0) {
+                close_pipe(go_pipe);
+                fail(interactor_errno);
+                return;
+            }
+        }
+        const int stdio[3] = {to_job[0], interactive ? to_interactor[1] : capture[0], capture[1]};
+
+        int error_pipe[2];
+        if (::pipe2(error_pipe, O_CLOEXEC) != 0) {
+            const int pipe_errno = errno;
+            close_pipe(go_pipe);
+            fail(pipe_errno);
+            return;
+        }
+
+        const pid_t pid = ::fork();
+        if (pid == 0) {
+            ::close(error_pipe[0]);
+            if (go_pipe[1] != -1) {
+                ::close(go_pipe[1]);
+            }
+            run_child(cmd, options_, self_, identity, isolate, namespace_slot ? &namespace_pool_->get(*namespace_slot) : nullptr,
+                      go_pipe[0], workdir_fd, stdio, argv.data(), envp.data(), error_pipe[1]);
+        }
+        ::close(error_pipe[1]);
+        close_pipe(to_job);  // Only the two children hold the ends now
+        close_pipe(to_interactor);
+
+        if (pid == -1) {
+            const int fork_errno = errno;
+            ::close(error_pipe[0]);
+            close_pipe(go_pipe);
+            fail(fork_errno);
+            return;
+        }
+        ::setpgid(pid, pid);  // Also in the child - whichever runs first wins
+
+        PerfCounters perf;
+        int perf_errno = 0;
+        if (counters != 0) {
+            const auto ec = perf.open(pid, counters);
+            // Measurements are best effort; a limit we can't enforce is not.
+            // Without the go byte the child exits at EOF.
+            if (cmd.instruction_limit != 0 && !(perf.valid() & perf_instructions)) {
+                perf_errno = ec ? ec.value() : EOPNOTSUPP;
+            } else {
+                const char go = 1;
+                [[maybe_unused]] auto written = ::write(go_pipe[1], &go, 1);
+            }
+            close_pipe(go_pipe);
+        }
+
+        // Blocks only until exec() (or the failure report) - microseconds
+        int child_errno = 0;
+        ssize_t n;
+        do {
+            n = ::read(error_pipe[0], &child_errno, sizeof(child_errno));
+        } while (n == -1 && errno == EINTR);
+        ::close(error_pipe[0]);
+
+        if (n == sizeof(child_errno) || perf_errno != 0) {
+            ::waitpid(pid, nullptr, 0);
+            fail(n == sizeof(child_errno) ? child_errno : perf_errno);
+            return;
+        }
+
+        // No point running past the request deadline either: the wall time
+        // limit is capped at what's left of it. RLIMIT_CPU is left alone:
+        // the wall clock kill bounds CPU time as well.
+        const auto started_ns = static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(started.time_since_epoch()).count());
+        const uint32_t wall_limit_ms = cap_to_deadline(cmd.wall_time_limit_ms, cmd.deadline_ns, started_ns);
+        const auto deadline = wall_limit_ms != 0 ? started + std::chrono::milliseconds(wall_limit_ms)
+                                                 : steady::time_point::max();
+        const bool deadline_from_request = wall_limit_ms != cmd.wall_time_limit_ms;
+        try {
+            jobs_.reserve(jobs_.size() + 2);  // Both halves of a pair, or neither
+            jobs_.push_back({
+                .request_id = cmd.request_id,
+                .pid = pid,
+                .started = started,
+                .deadline = deadline,
+                .deadline_from_request = deadline_from_request,
+                .identity = identity,
+                .pooled_uid = uid_pool_.has_value(),
+                .namespace_slot = namespace_slot,
+                .perf = std::move(perf),
+                .instruction_limit = cmd.instruction_limit,
+                .capture = {capture[0], capture[1]},
+                .capture_limit = capture_limit,
+                .peer = interactor_pid,
+            });
+            if (interactive) {
+                jobs_.push_back({
+                    .request_id = cmd.request_id,
+                    .pid = interactor_pid,
+                    .started = started,
+                    .deadline = deadline,
+                    .deadline_from_request = deadline_from_request,
+                    .identity = *interactor_identity,
+                    .pooled_uid = uid_pool_.has_value(),
+                    .peer = pid,
+                    .interactor = true,
+                });
+            }
+        } catch (...) {
+            // Can't track it - don't let it run untracked, and don't report
+            // a start no exit would ever follow. Nothing was added: only
+            // reserve() can throw.
+            ::kill(-pid, SIGKILL);
+            ::waitpid(pid, nullptr, 0);
+            job_ran = true;
+            fail(ENOMEM);
+            return;
+        }
+        if (workdir_fd != -1) {
+            ::close(workdir_fd);
+        }
+
+        VSOCKY_PROBE2(spawn, cmd.request_id, pid);
+        result.event = supervisor_event::started;
+        result.pid = pid;
+        result.uid = reported_uid(identity);
+        complete(result);
+    }
+
+    void handle_signals() noexcept {
+        signalfd_siginfo info;
+        while (::read(signal_fd_, &info, sizeof(info)) == sizeof(info)) {
+            if (info.ssi_signo == SIGTERM) {
+                stopping_ = true;
+            }
+        }
+        reap();
+    }
+
+    // One SIGCHLD may stand for several exits - reap until nothing's left
+    void reap() noexcept {
+        while (true) {
+            int status = 0;
+            rusage usage{};
+            const pid_t pid = ::wait4(-1, &status, WNOHANG, &usage);
+            if (pid <= 0) {
+                return;
+            }
+
+            auto it = std::find_if(jobs_.begin(), jobs_.end(), [pid](const job& j) { return j.pid == pid; });
+            if (it == jobs_.end()) {
+                continue;
+            }
+
+            VSOCKY_PROBE3(exit, it->request_id, pid, status);
+            supervisor_completion result;
+            result.event = supervisor_event::exited;
+            result.request_id = it->request_id;
+            result.pid = pid;
+            result.uid = reported_uid(it->identity);
+            if (WIFEXITED(status)) {
+                result.exit_code = WEXITSTATUS(status);
+            } else if (WIFSIGNALED(status)) {
+                result.term_signal = WTERMSIG(status);
+            }
+            result.cancelled = it->cancelled;
+            result.wall_time_exceeded = it->wall_time_exceeded;
+            result.deadline_exceeded = it->wall_time_exceeded && it->deadline_from_request;
+            result.wall_time_us = static_cast<uint64_t>(
+                std::chrono::duration_cast<std::chrono::microseconds>(steady::now() - it->started).count());
+            result.user_time_us = static_cast<uint64_t>(usage.ru_utime.tv_sec) * 1'000'000 +
+                                  static_cast<uint64_t>(usage.ru_utime.tv_usec);
+            result.system_time_us = static_cast<uint64_t>(usage.ru_stime.tv_sec) * 1'000'000 +
+                                    static_cast<uint64_t>(usage.ru_stime.tv_usec);
+            result.max_rss_kb = static_cast<uint64_t>(usage.ru_maxrss);
+
+            // Read before the kill below: whatever it takes down stops
+            // counting here, same as on every other run of this job
+            const perf_reading counted = it->perf.read();
+            result.perf_valid = counted.valid;
+            result.instructions = counted.instructions;
+            result.task_clock_ns = counted.task_clock_ns;
+            result.instruction_limit_exceeded =
+                it->instruction_limit_exceeded ||
+                (it->instruction_limit != 0 && counted.instructions > it->instruction_limit);
+
+            // The job leader is gone; make sure nothing it forked survives it.
+            // The group kill misses processes that left the group (setsid());
+            // with a pooled UID we can find those by UID before the next job
+            // gets it. If the sweep fails the UID is retired, not reused.
+            ::kill(-pid, SIGKILL);
+            const bool swept = it->pooled_uid && kill_all_processes_of(it->identity.uid);
+            if (swept) {
+                uid_pool_->release(it->identity.uid);
+            }
+            // Without a sweep something of the job may still live in its
+            // namespaces; best effort when there's no UID pool at all
+            if (it->namespace_slot && (swept || !it->pooled_uid)) {
+                namespace_pool_->release(*it->namespace_slot);
+            }
+            // First half of an interactive pair to go: hold the result (and
+            // any captured output - the fds must travel with the completion)
+            // for the other. An interactor that gave a failing verdict ends
+            // the job - it has nobody left to talk to.
+            const auto peer = it->peer != 0 ? std::find_if(jobs_.begin(), jobs_.end(),
+                                                           [&](const job& j) { return j.pid == it->peer; })
+                                            : jobs_.end();
+            if (peer != jobs_.end()) {
+                if (it->interactor && (result.term_signal != 0 || result.exit_code != 0)) {
+                    ::kill(-peer->pid, SIGKILL);
+                }
+                peer->peer_result = result;
+                if (!it->interactor) {
+                    peer->capture = std::exchange(it->capture, {-1, -1});
+                    peer->capture_limit = it->capture_limit;
+                }
+                jobs_.erase(it);
+                continue;
+            }
+            if (it->peer_result) {
+                result = merge_interactive(it->interactor ? *it->peer_result : result,
+                                           it->interactor ? result : *it->peer_result);
+            }
+
+            // After the sweep: nothing of the job can still be writing
+            hand_over_output(*it, result);
+
+            if (it->cancelled) {
+                release_workspace(it->cancel_workdir.c_str());
+            }
+            jobs_.erase(it);
+            complete(result);
+        }
+    }
+
+    // One exited completion for an interactive pair: the job's, plus how
+    // the interactor ended
+    static supervisor_completion merge_interactive(const supervisor_completion& job_result,
+                                                   const supervisor_completion& interactor_result) noexcept {
+        supervisor_completion merged = job_result;
+        merged.interactive = true;
+        merged.interactor_exit_code = interactor_result.exit_code;
+        merged.interactor_term_signal = interactor_result.term_signal;
+        merged.wall_time_us = std::max(job_result.wall_time_us, interactor_result.wall_time_us);
+        return merged;
+    }
+
+    // Cut the job's capture memfds to what it wrote, seal them and send
+    // them to the front end - ahead of the completion, which poll() pairs
+    // them with. A cancelled job's output is just dropped.
+    void hand_over_output(job& j, supervisor_completion& result) noexcept {
+        const uint32_t streams[2] = {capture_stdout, capture_stderr};
+        uint64_t* sizes[2] = {&result.stdout_bytes, &result.stderr_bytes};
+        output_handover handover{j.request_id, 0};
+        int fds[2];
+        size_t count = 0;
+        for (size_t i = 0; i < 2; ++i) {
+            const int fd = j.capture[i];
+            if (fd == -1) {
+                continue;
+            }
+            // The memfd shares its file offset with the job's stdout/stderr:
+            // the offset is how far the job wrote
+            const off_t written = ::lseek(fd, 0, SEEK_CUR);
+            const uint64_t size = std::min(static_cast<uint64_t>(std::max<off_t>(written, 0)), j.capture_limit);
+            // The size seal is what makes streaming it safe (file_frames.hpp);
+            // the write seal fails if a leftover process mapped it - fine
+            if (::ftruncate(fd, static_cast<off_t>(size)) != 0 ||
+                ::fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK) != 0) {
+                result.capture_error = errno;
+            }
+            ::fcntl(fd, F_ADD_SEALS, F_SEAL_WRITE);
+            ::fcntl(fd, F_ADD_SEALS, F_SEAL_SEAL);
+            fds[count++] = fd;
+            handover.captured |= streams[i];
+            *sizes[i] = size;
+        }
+
+        if (count != 0 && !j.cancelled && result.capture_error == 0) {
+            alignas(cmsghdr) char control[CMSG_SPACE(sizeof(fds))] = {};
+            iovec iov{&handover, sizeof(handover)};
+            msghdr msg{};
+            msg.msg_iov = &iov;
+            msg.msg_iovlen = 1;
+            msg.msg_control = control;
+            msg.msg_controllen = CMSG_SPACE(count * sizeof(int));
+            cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+            cmsg->cmsg_level = SOL_SOCKET;
+            cmsg->cmsg_type = SCM_RIGHTS;
+            cmsg->cmsg_len = CMSG_LEN(count * sizeof(int));
+            std::memcpy(CMSG_DATA(cmsg), fds, count * sizeof(int));
+            // Never block on the front end: if it has let the socket fill
+            // up, the output is lost but the completion still goes out
+            if (::sendmsg(output_fd_, &msg, MSG_DONTWAIT | MSG_NOSIGNAL) == sizeof(handover)) {
+                result.captured = handover.captured;
+            } else {
+                result.capture_error = errno;
+            }
+        }
+        if (result.captured == 0) {
+            result.stdout_bytes = result.stderr_bytes = 0;
+        }
+        for (int& fd : j.capture) {
+            if (fd != -1) {
+                ::close(fd);  // The front end has its own references now
+                fd = -1;
+            }
+        }
+    }
+
+    void enforce_deadlines() noexcept {
+        const auto now = steady::now();
+        for (auto& j : jobs_) {
+            if (!j.wall_time_exceeded && now >= j.deadline) {
+                j.wall_time_exceeded = true;
+                ::kill(-j.pid, SIGKILL);
+            }
+            // Polled, so the job overshoots by up to a tick's worth of
+            // instructions before it dies. The verdict doesn't depend on
+            // that: it compares the final count against the limit.
+            if (j.instruction_limit != 0 && !j.instruction_limit_exceeded &&
+                j.perf.read().instructions > j.instruction_limit) {
+                j.instruction_limit_exceeded = true;
+                ::kill(-j.pid, SIGKILL);
+            }
+        }
+    }
+
+    int poll_timeout_ms() const noexcept {
+        if (!pending_.empty()) {
+            return 5;  // Front end isn't draining - retry soon
+        }
+        auto nearest = steady::time_point::max();
+        for (const auto& j : jobs_) {
+            if (!j.wall_time_exceeded) {
+                nearest = std::min(nearest, j.deadline);
+            }
+            if (j.instruction_limit != 0 && !j.instruction_limit_exceeded) {
+                nearest = std::min(nearest, steady::now() + instruction_poll_interval);
+            }
+        }
+        if (nearest == steady::time_point::max()) {
+            return -1;
+        }
+        const auto left = std::chrono::ceil<std::chrono::milliseconds>(nearest - steady::now()).count();
+        return static_cast<int>(std::clamp<int64_t>(left, 0, 60'000));
+    }
+
+    void complete(const supervisor_completion& result) noexcept {
+        try {
+            pending_.push_back(result);
+        } catch (...) {
+            // Out of memory in the supervisor - the event is lost
+        }
+        flush_completions();
+    }
+
+    void flush_completions() noexcept {
+        bool wake = false;
+        while (!pending_.empty()) {
+            const auto pushed = completions_.try_push(pending_.front());
+            if (pushed == ring_push_result::full) {
+                break;
+            }
+            wake |= pushed == ring_push_result::pushed_wake;
+            pending_.pop_front();
+        }
+        if (wake) {
+            signal_event_fd(completion_fd_);
+        }
+    }
+
+    command_ring commands_;
+    completion_ring completions_;
+    int command_fd_;
+    int completion_fd_;
+    int output_fd_;
+    int signal_fd_ = -1;
+    supervisor_options options_;
+    pid_t self_ = ::getpid();  // Constructed in the supervisor's own process
+    int workspace_root_fd_ = -1;
+    std::string_view workspace_root_;  // options_.workspace_root without trailing slashes
+    std::optional<UidPool> uid_pool_;
+    std::optional<NamespacePool> namespace_pool_;
+
+    std::vector<job> jobs_;
+    std::vector<overlay> overlays_;
+    std::deque<supervisor_completion> pending_;  // Completions that didn't fit the ring
+    std::array<char, max_exec_args_bytes> args_copy_{};
+    supervisor_command interactor_cmd_{};
+    std::string home_env_;
+    std::string tmpdir_env_;
+    bool stopping_ = false;
+};
+
+} // anonymous namespace
+
+bool set_command_args(supervisor_command& cmd, std::span<const std::string_view> argv) noexcept {
+    return set_interactive_args(cmd, argv, {});
+}
+
+bool set_interactive_args(supervisor_command& cmd, std::span<const std::string_view> argv,
+                          std::span<const std::string_view> interactor_argv) noexcept {
+    size_t offset = 0;
+    for (const auto& list : {argv, interactor_argv}) {
+        for (auto arg : list) {
+            if (arg.find('\0') != std::string_view::npos || offset + arg.size() + 1 > cmd.args.size()) {
+                return false;
+            }
+            std::memcpy(cmd.args.data() + offset, arg.data(), arg.size());
+            offset += arg.size();
+            cmd.args[offset++] = '\0';
+        }
+    }
+    cmd.argc = static_cast<uint32_t>(argv.size());
+    cmd.interactor_argc = static_cast<uint32_t>(interactor_argv.size());
+    return !argv.empty();
+}
+
+bool set_command_path(std::array<char, max_exec_path_bytes>& field, std::string_view path) noexcept {
+    if (path.size() >= field.size() || path.find('\0') != std::string_view::npos) {
+        return false;
+    }
+    std::memcpy(field.data(), path.data(), path.size());
+    field[path.size()] = '\0';
+    return true;
+}
+
+bool set_command_template(supervisor_command& cmd, std::string_view name) noexcept {
+    if (!is_valid_template_name(name) || name.size() >= cmd.workspace_template.size()) {
+        return false;
+    }
+    std::memcpy(cmd.workspace_template.data(), name.data(), name.size());
+    cmd.workspace_template[name.size()] = '\0';
+    return true;
+}
+
+// =============================================================================
+// SupervisorClient
+// =============================================================================
+
+SupervisorClient::SupervisorClient(SupervisorClient&& other) noexcept
+    : mapping_(std::exchange(other.mapping_, nullptr)),
+      mapping_size_(other.mapping_size_),
+      pid_(std::exchange(other.pid_, -1)),
+      command_event_fd_(std::exchange(other.command_event_fd_, -1)),
+      completion_event_fd_(std::exchange(other.completion_event_fd_, -1)),
+      output_fd_(std::exchange(other.output_fd_, -1)),
+      commands_(other.commands_),
+      completions_(other.completions_) {}
+
+SupervisorClient::~SupervisorClient() noexcept {
+    shutdown();
+}
+
+void SupervisorClient::shutdown() noexcept {
+    if (pid_ == -1) {
+        return;
+    }
+
+    supervisor_command cmd;
+    cmd.op = supervisor_op::shutdown;
+    if (submit(cmd)) {
+        ::kill(pid_, SIGTERM);  // Ring full - the signal path works too
+    }
+    while (::waitpid(pid_, nullptr, 0) == -1 && errno == EINTR) {
+    }
+    pid_ = -1;
+
+    ::close(command_event_fd_);
+    ::close(completion_event_fd_);
+    ::close(output_fd_);
+    ::munmap(mapping_, mapping_size_);
+    command_event_fd_ = completion_event_fd_ = output_fd_ = -1;
+    mapping_ = nullptr;
+}
+
+std::error_code SupervisorClient::submit(const supervisor_command& cmd) noexcept {
+    if (pid_ == -1) {
+        return error_code::resource_unavailable;
+    }
+    switch (commands_.try_push(cmd)) {
+        case ring_push_result::full:
+            return error_code::resource_unavailable;
+        case ring_push_result::pushed_wake:
+            signal_event_fd(command_event_fd_);
+            break;
+        case ring_push_result::pushed:
+            break;
+    }
+    return error_code::success;
+}
+
+std::error_code SupervisorClient::kill(uint64_t request_id) noexcept {
+    supervisor_command cmd;
+    cmd.op = supervisor_op::kill;
+    cmd.request_id = request_id;
+    return submit(cmd);
+}
+
+std::error_code SupervisorClient::cancel(uint64_t request_id, std::string_view workdir) noexcept {
+    supervisor_command cmd;
+    cmd.op = supervisor_op::cancel;
+    cmd.request_id = request_id;
+    if (!set_command_path(cmd.workdir, workdir)) {
+        return error_code::invalid_field_value;
+    }
+    return submit(cmd);
+}
+
+std::error_code SupervisorClient::release(uint64_t request_id, std::string_view workdir) noexcept {
+    supervisor_command cmd;
+    cmd.op = supervisor_op::release;
+    cmd.request_id = request_id;
+    if (!set_command_path(cmd.workdir, workdir)) {
+        return error_code::invalid_field_value;
+    }
+    return submit(cmd);
+}
+
+bool SupervisorClient::poll(supervisor_completion& out) noexcept {
+    if (pid_ == -1 || !completions_.try_pop(out)) {
+        return false;
+    }
+    if (out.captured != 0) {
+        receive_output(out);
+    }
+    return true;
+}
+
+// The supervisor sent the fds before it pushed the completion, so they're
+// already queued - and in completion order, the socket being FIFO too
+void SupervisorClient::receive_output(supervisor_completion& out) noexcept {
+    output_handover handover{};
+    alignas(cmsghdr) char control[CMSG_SPACE(2 * sizeof(int))] = {};
+    iovec iov{&handover, sizeof(handover)};
+    msghdr msg{};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    const ssize_t n = ::recvmsg(output_fd_, &msg, MSG_DONTWAIT | MSG_CMSG_CLOEXEC);
+
+    int fds[2] = {-1, -1};
+    size_t count = 0;
+    if (n > 0) {
+        for (cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+            if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) {
+                count = std::min<size_t>((cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int), 2);
+                std::memcpy(fds, CMSG_DATA(cmsg), count * sizeof(int));
+            }
+        }
+    }
+
+    const auto expected = static_cast<size_t>(std::popcount(out.captured));
+    if (n != sizeof(handover) || (msg.msg_flags & MSG_CTRUNC) || handover.request_id != out.request_id ||
+        handover.captured != out.captured || count != expected) {
+        close_pipe(fds);
+        out.captured = 0;
+        out.capture_error = EPROTO;
+        out.stdout_bytes = out.stderr_bytes = 0;
+        return;
+    }
+    size_t next = 0;
+    if (out.captured & capture_stdout) {
+        out.stdout_fd = fds[next++];
+    }
+    if (out.captured & capture_stderr) {
+        out.stderr_fd = fds[next++];
+    }
+}
+
+bool SupervisorClient::wait(supervisor_completion& out, int timeout_ms) noexcept {
+    const auto deadline = steady::now() + std::chrono::milliseconds(timeout_ms);
+    while (true) {
+        if (poll(out)) {
+            return true;
+        }
+        if (pid_ == -1) {
+            return false;
+        }
+        if (!completions_.consumer_may_sleep()) {
+            continue;
+        }
+
+        const auto left = std::chrono::ceil<std::chrono::milliseconds>(deadline - steady::now()).count();
+        if (left <= 0) {
+            return false;
+        }
+        pollfd pfd{completion_event_fd_, POLLIN, 0};
+        if (::poll(&pfd, 1, static_cast<int>(left)) > 0) {
+            drain_event_fd(completion_event_fd_);
+        }
+    }
+}
+
+std::expected<SupervisorClient, std::error_code> start_supervisor(const supervisor_options& options) {
+    SupervisorClient client;
+    client.mapping_size_ = sizeof(shared_block);
+
+    // =========================================================================
+    // SHARED MEMORY
+    // =========================================================================
+    // memfd gives the region an fd (so a future exec'd supervisor could map
+    // it too); sealing its size means neither side can shrink it under the
+    // other (which would SIGBUS the reader). We map it MAP_SHARED before
+    // fork(), so both processes see the same pages.
+    // =========================================================================
+    const int memfd = ::memfd_create("vsocky-supervisor", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (memfd == -1) {
+        return std::unexpected(make_error_code(error_code::resource_unavailable));
+    }
+    if (::ftruncate(memfd, static_cast<off_t>(client.mapping_size_)) != 0 ||
+        ::fcntl(memfd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW) != 0) {
+        ::close(memfd);
+        return std::unexpected(make_error_code(error_code::resource_unavailable));
+    }
+    void* mapping = ::mmap(nullptr, client.mapping_size_, PROT_READ | PROT_WRITE, MAP_SHARED, memfd, 0);
+    ::close(memfd);  // The mapping keeps the memory alive
+    if (mapping == MAP_FAILED) {
+        return std::unexpected(make_error_code(error_code::resource_unavailable));
+    }
+    client.mapping_ = mapping;
+    auto* shared = new (mapping) shared_block;
+
+    client.command_event_fd_ = ::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    client.completion_event_fd_ = ::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    int output_pair[2] = {-1, -1};
+    if (client.command_event_fd_ == -1 || client.completion_event_fd_ == -1 ||
+        ::socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, output_pair) != 0) {
+        ::close(client.command_event_fd_);
+        ::close(client.completion_event_fd_);
+        ::munmap(mapping, client.mapping_size_);
+        return std::unexpected(make_error_code(error_code::resource_unavailable));
+    }
+
+    const pid_t parent = ::getpid();
+    const pid_t pid = ::fork();
+    if (pid == -1) {
+        ::close(client.command_event_fd_);
+        ::close(client.completion_event_fd_);
+        close_pipe(output_pair);
+        ::munmap(mapping, client.mapping_size_);
+        return std::unexpected(make_error_code(error_code::resource_unavailable));
+    }
+
+    if (pid == 0) {
+        // Front end dies -> we get SIGTERM -> we kill every job and exit.
+        // Check the parent afterwards: it may have died before the prctl.
+        ::prctl(PR_SET_PDEATHSIG, SIGTERM);
+        if (::getppid() != parent) {
+            ::_exit(0);
+        }
+        ::close(output_pair[0]);
+        supervisor_process(shared, client.command_event_fd_, client.completion_event_fd_, output_pair[1],
+                           options).run();
+    }
+
+    ::close(output_pair[1]);
+    client.output_fd_ = output_pair[0];
+    client.pid_ = pid;
+    client.commands_ = command_ring(&shared->commands);
+    client.completions_ = completion_ring(&shared->completions);
+    return client;
+}
+
+std::error_code drop_privileges(uid_t uid, gid_t gid) noexcept {
+    if (::setgroups(0, nullptr) != 0 ||
+        ::setresgid(gid, gid, gid) != 0 ||
+        ::setresuid(uid, uid, uid) != 0 ||
+        ::prctl(PR_SET_NO_NEW_PRIVS, 1, 0, 0, 0) != 0) {
+        return error_code::internal_error;
+    }
+
+    // Paranoia: make sure there's no way back
+    if (uid != 0 && ::setuid(0) == 0) {
+        return error_code::internal_error;
+    }
+    return error_code::success;
+}
+
+} // namespace vsocky
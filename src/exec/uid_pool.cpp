@@ -0,0 +1,71 @@
+#include "vsocky/exec/uid_pool.hpp"
+
+#include <cerrno>
+#include <csignal>
+
+#include <sys/wait.h>  // waitpid()
+#include <unistd.h>    // fork(), setresuid()
+
+namespace vsocky {
+
+UidPool::UidPool(uid_t base, size_t count) : base_(base), in_use_(count, false) {
+    for (size_t i = 0; i < count; ++i) {
+        free_.push_back(static_cast<uint32_t>(i));
+    }
+}
+
+std::optional<sandbox_identity> UidPool::acquire() noexcept {
+    if (free_.empty()) {
+        return std::nullopt;
+    }
+    const uint32_t offset = free_.front();
+    free_.pop_front();
+    in_use_[offset] = true;
+    const auto id = static_cast<uid_t>(base_ + offset);
+    return sandbox_identity{id, static_cast<gid_t>(id)};
+}
+
+void UidPool::release(uid_t uid) noexcept {
+    if (!owns(uid) || !in_use_[uid - base_]) {
+        return;
+    }
+    in_use_[uid - base_] = false;
+    try {
+        free_.push_back(static_cast<uint32_t>(uid - base_));
+    } catch (...) {
+        in_use_[uid - base_] = true;  // Can't track it as free - leak the UID rather than reuse it twice
+    }
+}
+
+// =============================================================================
+// KILLING BY UID
+// =============================================================================
+// There's no "kill all processes of user X" syscall, but kill(-1, sig) sends
+// sig to every process the caller may signal - for an unprivileged caller,
+// exactly the processes with its own UID. So: fork, become the UID, kill(-1).
+// No /proc scan, and no race with a process that forks while we scan.
+// =============================================================================
+bool kill_all_processes_of(uid_t uid) noexcept {
+    const pid_t pid = ::fork();
+    if (pid == -1) {
+        return false;
+    }
+    if (pid == 0) {
+        if (::setresuid(uid, uid, uid) != 0) {
+            ::_exit(1);
+        }
+        // Skips ourselves; ESRCH just means nothing was left
+        ::kill(-1, SIGKILL);
+        ::_exit(0);
+    }
+
+    int status = 0;
+    while (::waitpid(pid, &status, 0) == -1) {
+        if (errno != EINTR) {
+            return false;
+        }
+    }
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+} // namespace vsocky
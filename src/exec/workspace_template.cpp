@@ -0,0 +1,83 @@
+#include "vsocky/exec/workspace_template.hpp"
+
+#include <cerrno>
+#include <cstdlib>
+#include <string>
+
+#include <sys/mount.h>  // mount(), umount2()
+#include <sys/stat.h>   // mkdir()
+#include <unistd.h>     // rmdir()
+
+namespace vsocky {
+
+namespace {
+
+constexpr unsigned long job_mount_flags = MS_NOSUID | MS_NODEV;
+
+} // anonymous namespace
+
+bool is_valid_template_name(std::string_view name) noexcept {
+    if (name.empty() || name.size() > 63 || name[0] == '.') {
+        return false;
+    }
+    for (const char c : name) {
+        const bool ok = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') ||
+                        c == '.' || c == '_' || c == '-';
+        if (!ok) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int mount_template_workspace(const std::string& template_dir, const std::string& target,
+                             const std::string& scratch_root, uint64_t upper_bytes) noexcept {
+    // Overlay options can't contain these unescaped; nobody needs them in a path
+    for (const auto* path : {&template_dir, &target}) {
+        if (path->find_first_of(",:\\") != std::string::npos) {
+            return EINVAL;
+        }
+    }
+    if (::mkdir(scratch_root.c_str(), 0700) != 0 && errno != EEXIST) {
+        return errno;
+    }
+
+    try {
+        std::string scratch = scratch_root + "/ovl.XXXXXX";
+        if (::mkdtemp(scratch.data()) == nullptr) {
+            return errno;
+        }
+
+        const std::string size = "size=" + std::to_string(upper_bytes) + ",mode=0755";
+        if (::mount("tmpfs", scratch.c_str(), "tmpfs", job_mount_flags, size.c_str()) != 0) {
+            const int mount_errno = errno;
+            ::rmdir(scratch.c_str());
+            return mount_errno;
+        }
+
+        const std::string upper = scratch + "/upper";
+        const std::string work = scratch + "/work";
+        int result = 0;
+        if (::mkdir(upper.c_str(), 0755) != 0 || ::mkdir(work.c_str(), 0700) != 0) {
+            result = errno;
+        } else {
+            const std::string options = "lowerdir=" + template_dir + ",upperdir=" + upper + ",workdir=" + work;
+            if (::mount("overlay", target.c_str(), "overlay", job_mount_flags, options.c_str()) != 0) {
+                result = errno;
+            }
+        }
+
+        // The overlay holds the tmpfs; its own mount point is no longer needed
+        ::umount2(scratch.c_str(), MNT_DETACH);
+        ::rmdir(scratch.c_str());
+        return result;
+    } catch (...) {
+        return ENOMEM;
+    }
+}
+
+int unmount_template_workspace(const std::string& target) noexcept {
+    return ::umount2(target.c_str(), MNT_DETACH | UMOUNT_NOFOLLOW) == 0 ? 0 : errno;
+}
+
+} // namespace vsocky
@@ -0,0 +1,203 @@
+#include "vsocky/host/fleet_router.hpp"
+#include "vsocky/utils/error.hpp"
+#include "vsocky/vsocket/frame_io.hpp"
+
+#include <algorithm>
+#include <limits>
+
+namespace vsocky {
+
+// =============================================================================
+// lease
+// =============================================================================
+
+FleetRouter::lease& FleetRouter::lease::operator=(lease&& other) noexcept {
+    if (this != &other) {
+        release();
+        vm_ = std::move(other.vm_);
+        conn_ = std::move(other.conn_);
+        pool_size_ = other.pool_size_;
+    }
+    return *this;
+}
+
+FleetRouter::lease::~lease() noexcept {
+    release();
+}
+
+const std::string& FleetRouter::lease::vm_id() const noexcept {
+    return vm_->id;
+}
+
+void FleetRouter::lease::release() noexcept {
+    if (!vm_) {
+        return;  // Moved-from
+    }
+    if (conn_.is_valid()) {
+        std::lock_guard lock(vm_->pool_mutex);
+        if (vm_->idle.size() < pool_size_) {
+            try {
+                vm_->idle.push_back(std::move(conn_));
+            } catch (...) {
+                // Couldn't grow the pool - the connection just closes
+            }
+        }
+    }
+    conn_.close();
+    vm_.reset();
+}
+
+// =============================================================================
+// FleetRouter
+// =============================================================================
+
+void FleetRouter::add_vm(const std::string& id, vm_connector connect) {
+    auto vm = std::make_shared<vm_state>();
+    vm->id = id;
+    vm->connect = std::move(connect);
+
+    std::lock_guard lock(mutex_);
+    vms_[id] = std::move(vm);  // Outstanding leases keep the old state alive
+}
+
+void FleetRouter::remove_vm(const std::string& id) {
+    std::lock_guard lock(mutex_);
+    vms_.erase(id);
+}
+
+std::expected<Connection, std::error_code> FleetRouter::checkout(vm_state& vm) {
+    {
+        std::lock_guard lock(vm.pool_mutex);
+        while (!vm.idle.empty()) {
+            Connection conn = std::move(vm.idle.back());
+            vm.idle.pop_back();
+
+            // An idle connection has nothing to read. If poll() says it's
+            // readable, the VM closed it (restart, idle timeout) - drop it.
+            if (conn.wait_readable(0) == error_code::timeout) {
+                return conn;
+            }
+        }
+    }
+    return vm.connect();
+}
+
+size_t FleetRouter::refresh() {
+    std::vector<std::shared_ptr<vm_state>> vms;
+    {
+        std::lock_guard lock(mutex_);
+        for (const auto& [id, vm] : vms_) {
+            vms.push_back(vm);
+        }
+    }
+
+    // No router lock during I/O: routing keeps working on the previous
+    // reports while a slow VM times out
+    size_t healthy = 0;
+    for (const auto& vm : vms) {
+        std::optional<load_report> report;
+
+        if (auto conn = checkout(*vm)) {
+            MessageFramer framer(load_report_max_size);
+            std::expected<Frame, std::error_code> reply =
+                std::unexpected(make_error_code(error_code::internal_error));
+            if (!send_frame(*conn, frame_type::load_query, {}, options_.timeout_ms)) {
+                reply = receive_frame(*conn, framer, options_.timeout_ms);
+            }
+            if (reply && reply->type == frame_type::load_report) {
+                if (auto decoded = decode_load_report(reply->payload)) {
+                    report = *decoded;
+                }
+            }
+
+            // Only a clean round trip leaves the connection reusable
+            if (report) {
+                lease returned(vm, std::move(*conn), options_.pool_size);
+            }  // ~lease puts it back in the pool
+        }
+
+        std::lock_guard lock(mutex_);
+        if (report) {
+            vm->load = *report;
+            vm->routed_since_report = 0;
+            vm->healthy = true;
+            ++healthy;
+        } else {
+            vm->healthy = false;
+        }
+    }
+    return healthy;
+}
+
+int64_t FleetRouter::cost_locked(const vm_state& vm, const job_hint& hint) const noexcept {
+    const auto& load = vm.load;
+    const int64_t outstanding = int64_t{load.queue_depth} + load.running_jobs + vm.routed_since_report;
+    int64_t cost = outstanding * 1000 / std::max<int64_t>(load.capacity, 1);
+
+    if (load.warm_pool.enabled && load.warm_pool.ready == 0) {
+        cost += options_.cold_start_penalty;
+    }
+    if (hint.artifact && load.cache.may_contain(*hint.artifact)) {
+        cost -= options_.cache_affinity_bonus;
+    }
+    return cost;
+}
+
+std::expected<FleetRouter::lease, std::error_code> FleetRouter::route(const job_hint& hint) {
+    while (true) {
+        std::shared_ptr<vm_state> best;
+        {
+            std::lock_guard lock(mutex_);
+            int64_t best_cost = std::numeric_limits<int64_t>::max();
+            for (const auto& [id, vm] : vms_) {
+                if (!vm->healthy) {
+                    continue;
+                }
+                const int64_t cost = cost_locked(*vm, hint);
+                if (cost < best_cost) {
+                    best_cost = cost;
+                    best = vm;
+                }
+            }
+            if (!best) {
+                return std::unexpected(make_error_code(error_code::resource_unavailable));
+            }
+
+            // Count the job now, so concurrent route() calls see it and
+            // spread out instead of all picking the same idle VM
+            ++best->routed_since_report;
+        }
+
+        if (auto conn = checkout(*best)) {
+            return lease(best, std::move(*conn), options_.pool_size);
+        }
+
+        // Can't reach it: take it out of rotation until the next good refresh
+        std::lock_guard lock(mutex_);
+        --best->routed_since_report;
+        best->healthy = false;
+    }
+}
+
+std::vector<vm_snapshot> FleetRouter::snapshot() const {
+    std::vector<vm_snapshot> result;
+    std::lock_guard lock(mutex_);
+    result.reserve(vms_.size());
+    for (const auto& [id, vm] : vms_) {
+        vm_snapshot snap{
+            .id = id,
+            .healthy = vm->healthy,
+            .load = vm->load,
+            .routed_since_report = vm->routed_since_report,
+            .idle_connections = 0,
+        };
+        {
+            std::lock_guard pool_lock(vm->pool_mutex);
+            snap.idle_connections = vm->idle.size();
+        }
+        result.push_back(std::move(snap));
+    }
+    return result;
+}
+
+} // namespace vsocky
@@ -0,0 +1,161 @@
+#include "vsocky/host/trace_replay.hpp"
+#include "vsocky/vsocket/frame_io.hpp"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <thread>
+
+#include <poll.h>
+
+namespace vsocky {
+
+namespace {
+
+using steady = std::chrono::steady_clock;
+
+struct replay_connection {
+    Connection conn{-1};
+    MessageFramer framer;
+    bool failed = false;
+};
+
+class replayer {
+public:
+    replayer(const replay_connector& connect, const replay_options& options) noexcept
+        : connect_(connect), options_(options) {}
+
+    replay_stats run(const std::vector<trace_record>& records) {
+        const auto start = steady::now();
+        for (const auto& record : records) {
+            if (options_.speed > 0) {
+                const auto due = start + std::chrono::nanoseconds(
+                                             static_cast<int64_t>(static_cast<double>(record.offset_ns) / options_.speed));
+                while (steady::now() < due) {
+                    if (!pump(std::chrono::ceil<std::chrono::milliseconds>(due - steady::now()).count()) &&
+                        !has_open()) {
+                        std::this_thread::sleep_until(due);  // Nothing to listen to meanwhile
+                    }
+                }
+                const auto lag = static_cast<uint64_t>(
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(steady::now() - due).count());
+                stats_.max_lag_ns = std::max(stats_.max_lag_ns, lag);
+            }
+            pump(0);
+            send(record);
+        }
+
+        // Wait for the stragglers
+        while (pump(options_.drain_timeout_ms)) {
+        }
+
+        stats_.duration_ns = static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(steady::now() - start).count());
+        return stats_;
+    }
+
+private:
+    void send(const trace_record& record) {
+        auto& slot = connections_[record.connection_id];
+        if (!slot) {
+            slot = std::make_unique<replay_connection>();
+            ++stats_.connections;
+            auto connected = connect_();
+            if (connected) {
+                slot->conn = std::move(*connected);
+            } else {
+                fail(*slot);
+            }
+        }
+        if (!slot->failed && !slot->conn.is_valid()) {
+            fail(*slot);  // Server hung up earlier, and the trace wasn't done with it
+        }
+        if (slot->failed) {
+            ++stats_.frames_skipped;
+            return;
+        }
+        if (send_frame(slot->conn, record.frame.type, record.frame.payload, options_.io_timeout_ms)) {
+            fail(*slot);
+            ++stats_.frames_skipped;
+            return;
+        }
+        ++stats_.frames_sent;
+        stats_.bytes_sent += frame_header_size + record.frame.payload.size();
+    }
+
+    bool has_open() const noexcept {
+        return std::any_of(connections_.begin(), connections_.end(),
+                           [](const auto& entry) { return entry.second->conn.is_valid(); });
+    }
+
+    void fail(replay_connection& connection) noexcept {
+        connection.failed = true;
+        connection.conn.close();
+        ++stats_.failed_connections;
+    }
+
+    // Wait up to timeout_ms for responses on any connection and consume
+    // whatever is there. Returns whether anything arrived.
+    bool pump(int64_t timeout_ms) {
+        std::vector<pollfd> fds;
+        std::vector<replay_connection*> owners;
+        for (auto& [id, connection] : connections_) {
+            if (!connection->failed && connection->conn.is_valid()) {
+                fds.push_back({connection->conn.fd(), POLLIN, 0});
+                owners.push_back(connection.get());
+            }
+        }
+        if (fds.empty()) {
+            return false;
+        }
+        if (::poll(fds.data(), fds.size(), static_cast<int>(std::clamp<int64_t>(timeout_ms, 0, 60'000))) <= 0) {
+            return false;
+        }
+
+        bool received = false;
+        std::array<uint8_t, 64 * 1024> buffer;
+        for (size_t i = 0; i < fds.size(); ++i) {
+            if (!(fds[i].revents & (POLLIN | POLLHUP | POLLERR))) {
+                continue;
+            }
+            replay_connection& connection = *owners[i];
+            size_t n = 0;
+            if (connection.conn.read(buffer, n)) {
+                // The server hung up (or the read failed). Only a failure
+                // if the trace still has frames for it - see send().
+                connection.conn.close();
+                continue;
+            }
+            if (n == 0) {
+                continue;  // Spurious wakeup
+            }
+            received = true;
+            stats_.bytes_received += n;
+            connection.framer.feed({buffer.data(), n});
+            while (connection.framer.next()) {
+                ++stats_.frames_received;
+            }
+            if (connection.framer.error()) {
+                fail(connection);
+            }
+        }
+        return received;
+    }
+
+    const replay_connector& connect_;
+    replay_options options_;
+    replay_stats stats_;
+    std::map<uint32_t, std::unique_ptr<replay_connection>> connections_;
+};
+
+} // anonymous namespace
+
+replay_stats replay_trace(const std::vector<trace_record>& records,
+                          const replay_connector& connect,
+                          const replay_options& options) {
+    return replayer(connect, options).run(records);
+}
+
+} // namespace vsocky
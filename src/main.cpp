@@ -1,8 +1,23 @@
 #include "vsocky/utils/signal_handler.hpp"
 #include "vsocky/utils/error.hpp"
+#include "vsocky/utils/prefault.hpp"
+#include "vsocky/utils/config.hpp"
+#include "vsocky/utils/cpu_partition.hpp"
+#include "vsocky/vsocket/vsock_server.hpp"
+#include "vsocky/vsocket/ready_notifier.hpp"
+#include "vsocky/vsocket/frame_trace.hpp"
+#include "vsocky/protocol/capabilities.hpp"
+#include "vsocky/exec/supervisor.hpp"
 
 #include <thread>
 #include <chrono>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include <pwd.h>     // getpwnam() for --user
+#include <unistd.h>  // geteuid()
 
 // Version info
 constexpr const char* VSOCKY_VERSION = "0.1.0";
@@ -13,6 +28,20 @@ void print_usage(const char* program_name) {
     std::println("  --version    Show version information");
     std::println("  --help       Show this help message");
     std::println("  --port PORT  VSock port to listen on (default: 52000)");
+    std::println("  --config FILE  Config file (SIGHUP re-reads and validates it)");
+    std::println("  --prefault   Prefault hot memory on SIGUSR1 (send after snapshot restore)");
+    std::println("  --notify-port PORT  Send a ready message to the host on this VSock port");
+    std::println("  --notify-cid CID    CID to send the ready message to (default: 2, the host)");
+    std::println("  --user USER  Run the network front end as USER; a privileged supervisor");
+    std::println("               keeps root for spawning jobs (as the 'sandbox' user)");
+    std::println("  --sandbox-uids BASE:COUNT  With --user, run each job as its own UID from");
+    std::println("               BASE..BASE+COUNT-1 instead of the 'sandbox' user");
+    std::println("  --namespace-pool N  With --sandbox-uids, run jobs in private net/ipc/uts");
+    std::println("               namespaces, N of them pre-built at startup");
+    std::println("  --trace FILE  Record every received frame to FILE for vsocky-replay");
+    std::println("  --templates DIR  With --user, workspace templates (one directory each)");
+    std::println("               that jobs can get as a copy-on-write overlay");
+    std::println("  --workspaces DIR  With --user, the directory job workspaces are created in");
 }
 
 void print_version() {
@@ -28,6 +57,11 @@ void print_version() {
 #else
     std::println("  JSON parser: none (error!)");
 #endif
+#ifdef VSOCKY_BUNDLED_MALLOC
+    std::println("  Allocator: bundled (thread-caching)");
+#else
+    std::println("  Allocator: libc");
+#endif
 #ifdef ALPINE_BUILD
     std::println("  Build type: Alpine Linux (musl)");
 #else
@@ -38,6 +72,16 @@ void print_version() {
 int main(int argc, char* argv[]) {
     // Parse command line arguments
     uint16_t port = 52000;
+    bool prefault = false;
+    std::string config_path;
+    std::optional<uint32_t> notify_port;
+    uint32_t notify_cid = VMADDR_CID_HOST;
+    std::string run_as_user;
+    std::optional<std::pair<uid_t, size_t>> sandbox_uids;
+    size_t namespace_pool_size = 0;
+    std::string trace_path;
+    std::string template_root;
+    std::string workspace_root;
     
     for (int i = 1; i < argc; ++i) {
         std::string_view arg(argv[i]);
@@ -55,6 +99,59 @@ int main(int argc, char* argv[]) {
                 std::println(stderr, "Error: Invalid port number");
                 return 1;
             }
+        } else if ((arg == "--notify-port" || arg == "--notify-cid") && i + 1 < argc) {
+            try {
+                auto value = static_cast<uint32_t>(std::stoul(argv[++i]));
+                if (arg == "--notify-port") {
+                    notify_port = value;
+                } else {
+                    notify_cid = value;
+                }
+            } catch (...) {
+                std::println(stderr, "Error: Invalid value for {}", arg);
+                return 1;
+            }
+        } else if (arg == "--user" && i + 1 < argc) {
+            run_as_user = argv[++i];
+        } else if (arg == "--sandbox-uids" && i + 1 < argc) {
+            // BASE:COUNT; base 0 would hand out root, and a pool bigger than
+            // the pid space is a typo
+            std::string_view value(argv[++i]);
+            const auto colon = value.find(':');
+            try {
+                if (colon == std::string_view::npos) {
+                    throw std::invalid_argument("missing ':'");
+                }
+                const auto base = std::stoul(std::string(value.substr(0, colon)));
+                const auto count = std::stoul(std::string(value.substr(colon + 1)));
+                if (base == 0 || count == 0 || count > 65536 || base + count > 0xFFFFFFFEul) {
+                    throw std::out_of_range("range");
+                }
+                sandbox_uids.emplace(static_cast<uid_t>(base), static_cast<size_t>(count));
+            } catch (...) {
+                std::println(stderr, "Error: Invalid value for --sandbox-uids (expected BASE:COUNT)");
+                return 1;
+            }
+        } else if (arg == "--namespace-pool" && i + 1 < argc) {
+            try {
+                namespace_pool_size = std::stoul(argv[++i]);
+                if (namespace_pool_size == 0 || namespace_pool_size > 1024) {
+                    throw std::out_of_range("range");
+                }
+            } catch (...) {
+                std::println(stderr, "Error: Invalid value for --namespace-pool (1-1024)");
+                return 1;
+            }
+        } else if (arg == "--trace" && i + 1 < argc) {
+            trace_path = argv[++i];
+        } else if (arg == "--templates" && i + 1 < argc) {
+            template_root = argv[++i];
+        } else if (arg == "--workspaces" && i + 1 < argc) {
+            workspace_root = argv[++i];
+        } else if (arg == "--config" && i + 1 < argc) {
+            config_path = argv[++i];
+        } else if (arg == "--prefault") {
+            prefault = true;
         } else {
             std::println(stderr, "Error: Unknown argument: {}", arg);
             print_usage(argv[0]);
@@ -62,26 +159,188 @@ int main(int argc, char* argv[]) {
         }
     }
     
+    // Load the config file (if any) - a broken file at startup is fatal
+    vsocky::server_config initial_config;
+    if (!config_path.empty()) {
+        std::string detail;
+        auto loaded = vsocky::load_config_file(config_path, &detail);
+        if (!loaded) {
+            std::println(stderr, "Error: Invalid config {}: {}", config_path, detail);
+            return 1;
+        }
+        initial_config = *loaded;
+    }
+    vsocky::config_store config(initial_config);
+    
+    // CPU partitioning: pin ourselves before the supervisor or any thread
+    // exists, so all of them inherit the server's vCPUs
+    std::optional<cpu_set_t> job_cpus;
+    if (initial_config.server_cpus != 0) {
+        auto partition = vsocky::partition_cpus(initial_config.server_cpus);
+        if (!partition) {
+            std::println(stderr, "Warning: Can't partition vCPUs: {}", partition.error().message());
+        } else if (partition->shared) {
+            std::println(stderr, "Warning: server_cpus = {} leaves no vCPU for jobs, sharing all of them",
+                         initial_config.server_cpus);
+        } else if (auto ec = vsocky::pin_current_thread(partition->server)) {
+            std::println(stderr, "Warning: Can't pin the server to vCPUs {}: {}",
+                         vsocky::format_cpu_list(partition->server), ec.message());
+        } else {
+            job_cpus = partition->jobs;
+            std::println("Server on vCPUs {}, jobs on vCPUs {}", vsocky::format_cpu_list(partition->server),
+                         vsocky::format_cpu_list(partition->jobs));
+        }
+    }
+    
+    // What the ready message may advertise (capabilities.hpp). No frame
+    // dispatch yet: the event loop below is still a TODO, so nothing
+    // answers blob, file or job frames.
+    uint32_t features = 0;
+    
+    // Privilege separation: fork the supervisor FIRST (before any thread
+    // exists), then give up root in this process for good
+    std::optional<vsocky::SupervisorClient> supervisor;
+    if (!run_as_user.empty()) {
+        const passwd* front_end = ::getpwnam(run_as_user.c_str());
+        if (front_end == nullptr) {
+            std::println(stderr, "Error: Unknown user {}", run_as_user);
+            return 1;
+        }
+        const uid_t front_uid = front_end->pw_uid;
+        const gid_t front_gid = front_end->pw_gid;
+        
+        vsocky::supervisor_options supervisor_opts;
+        supervisor_opts.workspace_root = workspace_root;
+        supervisor_opts.template_root = template_root;
+        supervisor_opts.job_cpus = job_cpus;
+        supervisor_opts.job_sched = initial_config.job_sched;
+        if (sandbox_uids) {
+            supervisor_opts.uid_pool_base = sandbox_uids->first;
+            supervisor_opts.uid_pool_size = sandbox_uids->second;
+            supervisor_opts.namespace_pool_size = namespace_pool_size;
+        } else if (const passwd* sandbox = ::getpwnam("sandbox")) {
+            supervisor_opts.job_uid = sandbox->pw_uid;
+            supervisor_opts.job_gid = sandbox->pw_gid;
+        } else {
+            std::println(stderr, "Warning: No 'sandbox' user - jobs would run as the supervisor's user");
+        }
+        
+        auto started = vsocky::start_supervisor(supervisor_opts);
+        if (!started) {
+            std::println(stderr, "Error: Failed to start supervisor: {}", started.error().message());
+            return 1;
+        }
+        supervisor.emplace(std::move(*started));
+        features |= vsocky::feature_supervisor;
+        
+        if (::geteuid() == 0) {
+            if (auto ec = vsocky::drop_privileges(front_uid, front_gid)) {
+                std::println(stderr, "Error: Failed to drop privileges: {}", ec.message());
+                return 1;
+            }
+        } else {
+            std::println(stderr, "Warning: Not running as root, --user has no effect on the front end");
+        }
+    }
+    
+    if (sandbox_uids && run_as_user.empty()) {
+        std::println(stderr, "Warning: --sandbox-uids has no effect without --user");
+    }
+    if (namespace_pool_size != 0 && !sandbox_uids) {
+        // A template is reused only after the UID sweep emptied it
+        std::println(stderr, "Warning: --namespace-pool has no effect without --sandbox-uids");
+    }
+    
     // Set up signal handling
     vsocky::signal_handler::setup();
     
+    // Post-restore prefault pass (runs in the background, triggered by SIGUSR1)
+    vsocky::prefaulter prefaulter;
+    if (prefault) {
+        if (auto ec = prefaulter.start()) {
+            std::println(stderr, "Warning: Failed to start prefaulter: {}", ec.message());
+        } else {
+            vsocky::signal_handler::set_restore_notify_fd(prefaulter.notify_fd());
+            features |= vsocky::feature_prefault;
+        }
+    }
+    
     std::println("VSocky v{} starting...", VSOCKY_VERSION);
+    
+    vsocky::VSockServer server;
+    if (auto ec = server.listen(port)) {
+        std::println(stderr, "Error: Failed to listen on VSock port {}: {}", port, ec.message());
+        return 1;
+    }
     std::println("Listening on VSock port {}", port);
     
+    // Frame recording: every connection's framer gets record_to(&*trace, ...)
+    std::optional<vsocky::FrameTraceWriter> trace;
+    if (!trace_path.empty()) {
+        auto opened = vsocky::FrameTraceWriter::open(trace_path);
+        if (!opened) {
+            std::println(stderr, "Error: Can't create trace file {}: {}", trace_path, opened.error().message());
+            return 1;
+        }
+        trace.emplace(std::move(*opened));
+        std::println("Recording frames to {}", trace_path);
+    }
+    
+    // Tell the host we're ready instead of making it poll-connect
+    if (notify_port) {
+        const auto capabilities = vsocky::enabled_capabilities(features | vsocky::feature_ready_notify);
+        vsocky::ready_info info{
+            .version = VSOCKY_VERSION,
+            .listen_port = port,
+            .capabilities = capabilities,
+            .warm_pool = {},  // No warm pool yet
+        };
+        if (auto ec = vsocky::notify_host_ready(notify_cid, *notify_port, info)) {
+            std::println(stderr, "Warning: Ready notification to CID {} port {} failed: {}",
+                         notify_cid, *notify_port, ec.message());
+        }
+    }
+    
     // TODO: Phase 1 implementation
-    // 1. Create VSock server
-    // 2. Start main event loop
-    // 3. Accept connections
-    // 4. Process JSON messages
-    // 5. Send responses
+    // 1. Start main event loop
+    // 2. Accept connections
+    // 3. Process JSON messages
+    // 4. Send responses
     
     std::println("Server implementation coming in Phase 1...");
     
     // Temporary: wait for shutdown signal
     while (!vsocky::signal_handler::should_shutdown()) {
+        // Top of the loop is our quiescent point: nothing holds a config
+        // reference from the previous iteration, so retired versions can go
+        config.reclaim();
+        
+        if (vsocky::signal_handler::consume_reload_request()) {
+            if (config_path.empty()) {
+                std::println(stderr, "Warning: SIGHUP received but no --config file was given");
+            } else {
+                // A bad file keeps the old config active rather than killing the server
+                std::string detail;
+                if (auto loaded = vsocky::load_config_file(config_path, &detail)) {
+                    config.publish(*loaded);
+                    // Published for the event loop to pick up; nothing reads it yet
+                    std::println("Configuration re-read (generation {}), not applied until the event loop exists",
+                                 config.generation());
+                } else {
+                    std::println(stderr, "Warning: Config reload failed, keeping current: {}",
+                                 detail);
+                }
+            }
+        }
+        
         std::this_thread::sleep_for(std::chrono::seconds(1));
     }
     
     std::println("\nShutting down gracefully...");
+    if (trace) {
+        trace->flush();
+        std::println("Recorded {} frames{}", trace->frames(), trace->truncated() ? " (size cap reached)" : "");
+    }
+    vsocky::signal_handler::set_restore_notify_fd(-1);
     return 0;
 }
\ No newline at end of file
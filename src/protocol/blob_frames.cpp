@@ -0,0 +1,106 @@
+#include "vsocky/protocol/blob_frames.hpp"
+#include "vsocky/protocol/byte_order.hpp"
+#include "vsocky/utils/error.hpp"
+
+#include <algorithm>
+
+namespace vsocky {
+
+std::expected<std::vector<uint8_t>, std::error_code>
+handle_blob_query(const BlobStore& store, std::span<const uint8_t> payload) {
+    if (payload.size() % blob_hash_size != 0) {
+        return std::unexpected(make_error_code(error_code::invalid_message_format));
+    }
+
+    std::vector<blob_hash> hashes(payload.size() / blob_hash_size);
+    for (size_t i = 0; i < hashes.size(); ++i) {
+        std::copy_n(payload.data() + i * blob_hash_size, blob_hash_size, hashes[i].begin());
+    }
+
+    const auto missing = store.missing(hashes);
+
+    std::vector<uint8_t> response;
+    response.reserve(missing.size() * blob_hash_size);
+    for (const auto& hash : missing) {
+        response.insert(response.end(), hash.begin(), hash.end());
+    }
+    return response;
+}
+
+std::error_code handle_blob_upload(BlobStore& store, std::span<const uint8_t> payload) noexcept {
+    if (payload.size() < blob_hash_size) {
+        return error_code::invalid_message_format;
+    }
+
+    blob_hash hash;
+    std::copy_n(payload.data(), blob_hash_size, hash.begin());
+    return store.put(hash, payload.subspan(blob_hash_size));
+}
+
+std::vector<uint8_t> encode_blob_end(const blob_hash& hash, uint64_t size) {
+    std::vector<uint8_t> payload(hash.begin(), hash.end());
+    append_be(payload, size, 8);
+    return payload;
+}
+
+std::error_code BlobUploadAssembler::handle_chunk(std::span<const uint8_t> payload) noexcept {
+    if (payload.size() < blob_hash_size) {
+        return error_code::invalid_message_format;
+    }
+
+    blob_hash hash;
+    std::copy_n(payload.data(), blob_hash_size, hash.begin());
+    const auto data = payload.subspan(blob_hash_size);
+
+    auto it = std::ranges::find(pending_, hash, &BlobWriter::hash);
+    if (it == pending_.end()) {
+        if (pending_.size() >= limits_.max_pending) {
+            return error_code::resource_unavailable;
+        }
+        auto writer = store_.begin_put(hash);
+        if (!writer) {
+            return writer.error();
+        }
+        try {
+            pending_.push_back(std::move(*writer));
+        } catch (...) {
+            return error_code::resource_unavailable;
+        }
+        it = pending_.end() - 1;
+    }
+
+    if (data.size() > limits_.max_blob_bytes - it->size()) {
+        pending_.erase(it);
+        return error_code::message_too_large;
+    }
+    if (auto ec = it->append(data)) {
+        pending_.erase(it);
+        return ec;
+    }
+    return error_code::success;
+}
+
+std::error_code BlobUploadAssembler::handle_end(std::span<const uint8_t> payload) noexcept {
+    if (payload.size() != blob_end_size) {
+        return error_code::invalid_message_format;
+    }
+
+    blob_hash hash;
+    std::copy_n(payload.data(), blob_hash_size, hash.begin());
+    const uint64_t size = get_be(payload.data() + blob_hash_size, 8);
+
+    auto it = std::ranges::find(pending_, hash, &BlobWriter::hash);
+    if (it == pending_.end()) {
+        // No chunks: only the empty blob can end here
+        return size == 0 ? store_.put(hash, {}) : error_code::invalid_field_value;
+    }
+
+    std::error_code ec = error_code::invalid_field_value;
+    if (it->size() == size) {
+        ec = it->commit();
+    }
+    pending_.erase(it);
+    return ec;
+}
+
+} // namespace vsocky
@@ -0,0 +1,39 @@
+#include "vsocky/protocol/cancel_frames.hpp"
+#include "vsocky/protocol/byte_order.hpp"
+#include "vsocky/utils/error.hpp"
+
+namespace vsocky {
+
+std::vector<uint8_t> encode_cancel(uint64_t request_id) {
+    std::vector<uint8_t> out;
+    out.reserve(cancel_size);
+    append_be(out, request_id, 8);
+    return out;
+}
+
+std::vector<uint8_t> encode_cancelled(const cancelled_info& info) {
+    std::vector<uint8_t> out;
+    out.reserve(cancelled_size);
+    append_be(out, info.request_id, 8);
+    out.push_back(static_cast<uint8_t>(info.outcome));
+    return out;
+}
+
+std::expected<uint64_t, std::error_code> decode_cancel(std::span<const uint8_t> payload) noexcept {
+    if (payload.size() != cancel_size) {
+        return std::unexpected(make_error_code(error_code::invalid_message_format));
+    }
+    return get_be(payload.data(), 8);
+}
+
+std::expected<cancelled_info, std::error_code> decode_cancelled(std::span<const uint8_t> payload) noexcept {
+    if (payload.size() != cancelled_size || payload[8] > static_cast<uint8_t>(cancel_outcome::finished)) {
+        return std::unexpected(make_error_code(error_code::invalid_message_format));
+    }
+    return cancelled_info{
+        .request_id = get_be(payload.data(), 8),
+        .outcome = static_cast<cancel_outcome>(payload[8]),
+    };
+}
+
+} // namespace vsocky
@@ -0,0 +1,99 @@
+#include "vsocky/protocol/error_frames.hpp"
+#include "vsocky/vsocket/frame_io.hpp"
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+
+namespace vsocky {
+
+namespace {
+
+// '{"type":"error","code":"<name>","message":"<text>"' - the frame up to
+// the optional fields, one per error_code
+struct error_fragment {
+    std::array<char, 112> text{};
+    size_t size = 0;
+};
+
+constexpr error_fragment render_fragment(error_code code) {
+    error_fragment fragment;
+    const auto append = [&](std::string_view part) {
+        for (const char c : part) {
+            // Names and messages are plain ASCII - nothing to escape. A
+            // quote or backslash would stop the build here.
+            if (c == '"' || c == '\\' || static_cast<unsigned char>(c) < 0x20) {
+                throw "error text needs JSON escaping";
+            }
+            fragment.text.at(fragment.size++) = c;
+        }
+    };
+    const auto append_raw = [&](std::string_view part) {
+        for (const char c : part) {
+            fragment.text.at(fragment.size++) = c;
+        }
+    };
+    append_raw(R"({"type":"error","code":")");
+    append(error_code_name(code));
+    append_raw(R"(","message":")");
+    append(error_to_string(code));
+    append_raw(R"(")");
+    return fragment;
+}
+
+constexpr auto fragments = [] {
+    std::array<error_fragment, error_code_count> table{};
+    for (size_t i = 0; i < table.size(); ++i) {
+        table[i] = render_fragment(static_cast<error_code>(i));
+    }
+    return table;
+}();
+
+// Longest fragment + ',"errno":' + 11 digits + ',"errno_name":"' + name
+// + '","id":' + 20 digits + '}'
+static_assert(std::ranges::max(fragments, {}, &error_fragment::size).size + 9 + 11 + 15 + 16 + 7 + 20 + 1 <=
+              max_error_message_bytes);
+
+char* append(char* pos, std::string_view text) noexcept {
+    return std::copy(text.begin(), text.end(), pos);
+}
+
+template <typename Int>
+char* append_number(char* pos, Int value) noexcept {
+    return std::to_chars(pos, pos + 24, value).ptr;
+}
+
+} // anonymous namespace
+
+std::string_view render_error_message(sys_error error, uint64_t request_id,
+                                      std::span<char, max_error_message_bytes> out) noexcept {
+    const auto index = static_cast<size_t>(error.code);
+    const error_fragment& fragment = fragments[index < fragments.size() ? index
+                                                                        : static_cast<size_t>(error_code::internal_error)];
+    char* pos = std::copy_n(fragment.text.data(), fragment.size, out.data());
+    if (error.sys_errno != 0) {
+        pos = append(pos, R"(,"errno":)");
+        pos = append_number(pos, error.sys_errno);
+        // Unknown errnos go without a name; the ones we name are plain identifiers
+        if (const auto name = errno_name(error.sys_errno); !name.empty() && name.size() <= 16) {
+            pos = append(pos, R"(,"errno_name":")");
+            pos = append(pos, name);
+            pos = append(pos, R"(")");
+        }
+    }
+    if (request_id != 0) {
+        pos = append(pos, R"(,"id":)");
+        pos = append_number(pos, request_id);
+    }
+    *pos++ = '}';
+    return {out.data(), static_cast<size_t>(pos - out.data())};
+}
+
+std::error_code send_error(Connection& conn, sys_error error, uint64_t request_id, int timeout_ms) noexcept {
+    std::array<char, max_error_message_bytes> buffer;
+    const auto message = render_error_message(error, request_id, buffer);
+    return send_frame(conn, frame_type::json,
+                      std::span(reinterpret_cast<const uint8_t*>(message.data()), message.size()), timeout_ms);
+}
+
+} // namespace vsocky
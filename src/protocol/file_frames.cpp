@@ -0,0 +1,150 @@
+#include "vsocky/protocol/file_frames.hpp"
+#include "vsocky/protocol/byte_order.hpp"
+#include "vsocky/protocol/json_writer.hpp"
+#include "vsocky/utils/error.hpp"
+#include "vsocky/vsocket/frame_io.hpp"
+#include "vsocky/vsocket/message_framer.hpp"
+
+#include <algorithm>
+#include <array>
+
+#include <sys/stat.h>  // fstat()
+#include <unistd.h>    // close()
+
+namespace vsocky {
+
+namespace {
+
+std::error_code send_file_end(Connection& conn, uint32_t index, file_status status,
+                              uint64_t size, int timeout_ms) noexcept {
+    std::array<uint8_t, 13> payload{};
+    put_be(payload.data(), index, 4);
+    payload[4] = static_cast<uint8_t>(status);
+    put_be(payload.data() + 5, size, 8);
+    return send_frame(conn, frame_type::file_end, payload, timeout_ms);
+}
+
+} // anonymous namespace
+
+std::string build_file_list_message(std::span<const workspace_file> files) {
+    JsonWriter w(64 + files.size() * 48);
+    w.begin_object();
+    w.key("type").value("files");
+    w.key("files").begin_array();
+    for (const auto& file : files) {
+        w.begin_object();
+        w.key("path").value(file.path);
+        w.key("size").value(file.size);
+        w.key("mode").value(file.mode);
+        w.end_object();
+    }
+    w.end_array();
+    w.end_object();
+    return w.take();
+}
+
+std::expected<std::vector<uint8_t>, std::error_code>
+encode_file_fetch(std::span<const std::string> paths) {
+    std::vector<uint8_t> out;
+    for (const auto& path : paths) {
+        if (path.size() > UINT16_MAX) {
+            // A wrapped length would name a different (truncated) path
+            return std::unexpected(make_error_code(error_code::message_too_large));
+        }
+        append_be(out, path.size(), 2);
+        out.insert(out.end(), path.begin(), path.end());
+    }
+    return out;
+}
+
+std::expected<std::vector<std::string>, std::error_code>
+decode_file_fetch(std::span<const uint8_t> payload) {
+    std::vector<std::string> paths;
+    while (!payload.empty()) {
+        if (payload.size() < 2) {
+            return std::unexpected(make_error_code(error_code::invalid_message_format));
+        }
+        const size_t length = get_be(payload.data(), 2);
+        if (payload.size() - 2 < length) {
+            return std::unexpected(make_error_code(error_code::invalid_message_format));
+        }
+        paths.emplace_back(payload.begin() + 2, payload.begin() + 2 + static_cast<ptrdiff_t>(length));
+        payload = payload.subspan(2 + length);
+    }
+    return paths;
+}
+
+std::expected<file_end_info, std::error_code>
+decode_file_end(std::span<const uint8_t> payload) noexcept {
+    if (payload.size() != 13 || payload[4] > static_cast<uint8_t>(file_status::read_error)) {
+        return std::unexpected(make_error_code(error_code::invalid_message_format));
+    }
+    return file_end_info{
+        .index = get_be32(payload.data()),
+        .status = static_cast<file_status>(payload[4]),
+        .size = get_be(payload.data() + 5, 8),
+    };
+}
+
+std::error_code stream_file(Connection& conn, uint32_t index, int fd, int timeout_ms, size_t chunk_size) noexcept {
+    // Chunk frames must fit the peer's framer limit (4 bytes go to the index)
+    chunk_size = std::clamp<size_t>(chunk_size, 1, default_max_frame_payload - 4);
+
+    struct stat st{};
+    if (::fstat(fd, &st) != 0) {
+        return send_file_end(conn, index, file_status::read_error, 0, timeout_ms);
+    }
+
+    const auto size = static_cast<uint64_t>(st.st_size);
+    for (uint64_t offset = 0; offset < size;) {
+        const auto n = static_cast<size_t>(std::min<uint64_t>(chunk_size, size - offset));
+
+        // Frame header + file index from userspace, the data by sendfile()
+        std::array<uint8_t, frame_header_size + 4> prefix{};
+        const auto header = encode_frame_header(frame_type::file_chunk, static_cast<uint32_t>(4 + n));
+        std::copy(header.begin(), header.end(), prefix.begin());
+        put_be(prefix.data() + frame_header_size, index, 4);
+
+        std::error_code ec = conn.write_all(prefix, timeout_ms);
+        if (!ec) {
+            ec = conn.send_file(fd, offset, n, timeout_ms);
+        }
+        if (ec) {
+            return ec;  // Half a frame may be on the wire - stream is unusable
+        }
+        offset += n;
+    }
+
+    return send_file_end(conn, index, file_status::ok, size, timeout_ms);
+}
+
+std::error_code stream_workspace_files(Connection& conn,
+                                       const std::string& root,
+                                       std::span<const std::string> paths,
+                                       int timeout_ms,
+                                       size_t chunk_size) noexcept {
+    for (size_t i = 0; i < paths.size(); ++i) {
+        const auto index = static_cast<uint32_t>(i);
+
+        auto opened = open_workspace_file(root, paths[i]);
+        if (!opened) {
+            const auto status = opened.error() == error_code::resource_unavailable
+                                    ? file_status::not_found
+                                    : file_status::refused;
+            if (auto ec = send_file_end(conn, index, status, 0, timeout_ms)) {
+                return ec;
+            }
+            continue;
+        }
+
+        const auto ec = stream_file(conn, index, *opened, timeout_ms, chunk_size);
+        ::close(*opened);
+        if (ec) {
+            return ec;
+        }
+    }
+
+    return error_code::success;
+}
+
+} // namespace vsocky
@@ -0,0 +1,79 @@
+#include "vsocky/protocol/json_writer.hpp"
+
+#include <array>
+#include <charconv>
+
+namespace vsocky {
+
+namespace {
+
+constexpr std::array<char, 16> hex_digits = {'0', '1', '2', '3', '4', '5', '6', '7',
+                                             '8', '9', 'a', 'b', 'c', 'd', 'e', 'f'};
+
+// Shared by both integer overloads - to_chars never allocates
+template <typename T>
+void append_number(std::string& out, T n) {
+    std::array<char, 24> buffer;
+    auto [end, ec] = std::to_chars(buffer.data(), buffer.data() + buffer.size(), n);
+    out.append(buffer.data(), end);
+}
+
+} // anonymous namespace
+
+// =============================================================================
+// JSON STRING ESCAPING
+// =============================================================================
+// JSON strings must escape: the quote, the backslash, and every control
+// character below 0x20. Everything else (including UTF-8 multi-byte
+// sequences) can be copied through unchanged.
+//
+// We copy runs of "safe" bytes in one append() instead of byte-by-byte,
+// since real-world strings are almost entirely safe characters.
+// =============================================================================
+void append_json_string(std::string& out, std::string_view s) {
+    out.push_back('"');
+
+    size_t run_start = 0;
+    for (size_t i = 0; i < s.size(); ++i) {
+        const auto c = static_cast<unsigned char>(s[i]);
+        if (c >= 0x20 && c != '"' && c != '\\') {
+            continue;
+        }
+
+        out.append(s.substr(run_start, i - run_start));
+        run_start = i + 1;
+
+        switch (c) {
+            case '"':  out.append("\\\""); break;
+            case '\\': out.append("\\\\"); break;
+            case '\n': out.append("\\n");  break;
+            case '\r': out.append("\\r");  break;
+            case '\t': out.append("\\t");  break;
+            default:
+                // \u00XX for the remaining control characters
+                out.append("\\u00");
+                out.push_back(hex_digits[c >> 4]);
+                out.push_back(hex_digits[c & 0x0F]);
+                break;
+        }
+    }
+    out.append(s.substr(run_start));
+
+    out.push_back('"');
+}
+
+JsonWriter& JsonWriter::value(int64_t n) {
+    separate();
+    append_number(out_, n);
+    need_comma_ = true;
+    return *this;
+}
+
+JsonWriter& JsonWriter::value(uint64_t n) {
+    separate();
+    append_number(out_, n);
+    need_comma_ = true;
+    return *this;
+}
+
+} // namespace vsocky
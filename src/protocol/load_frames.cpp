@@ -0,0 +1,68 @@
+#include "vsocky/protocol/load_frames.hpp"
+#include "vsocky/protocol/byte_order.hpp"
+#include "vsocky/utils/error.hpp"
+
+#include <algorithm>
+#include <limits>
+
+namespace vsocky {
+
+namespace {
+
+void put_count(std::vector<uint8_t>& out, uint64_t value) {
+    // Saturate instead of wrapping: a huge count must not look like an idle VM
+    append_be(out, std::min<uint64_t>(value, std::numeric_limits<uint32_t>::max()), 4);
+}
+
+} // anonymous namespace
+
+std::vector<uint8_t> encode_load_report(const load_report& report) {
+    const auto summary = report.cache.bytes();
+
+    std::vector<uint8_t> out;
+    out.reserve(load_report_header_size + summary.size());
+
+    out.push_back(load_report_version);
+    put_count(out, report.queue_depth);
+    put_count(out, report.running_jobs);
+    put_count(out, report.capacity);
+    out.push_back(report.warm_pool.enabled ? 1 : 0);
+    put_count(out, report.warm_pool.ready);
+    put_count(out, report.warm_pool.target);
+    out.push_back(static_cast<uint8_t>(report.cache.probes()));
+    put_count(out, summary.size());
+    out.insert(out.end(), summary.begin(), summary.end());
+    return out;
+}
+
+std::expected<load_report, std::error_code>
+decode_load_report(std::span<const uint8_t> payload) noexcept {
+    if (payload.size() < load_report_header_size || payload[0] != load_report_version) {
+        return std::unexpected(make_error_code(error_code::invalid_message_format));
+    }
+
+    const uint8_t* p = payload.data() + 1;
+    const size_t probes = p[21];
+    const size_t summary_size = get_be32(p + 22);
+    if (probes == 0 || probes > artifact_summary::max_probes || summary_size == 0 ||
+        summary_size > artifact_summary::max_size_bytes ||
+        payload.size() != load_report_header_size + summary_size) {
+        return std::unexpected(make_error_code(error_code::invalid_message_format));
+    }
+
+    try {
+        load_report report;
+        report.cache = artifact_summary(payload.subspan(load_report_header_size), probes);
+        report.queue_depth = get_be32(p);
+        report.running_jobs = get_be32(p + 4);
+        report.capacity = get_be32(p + 8);
+        report.warm_pool.enabled = p[12] != 0;
+        report.warm_pool.ready = get_be32(p + 13);
+        report.warm_pool.target = get_be32(p + 17);
+        return report;
+    } catch (...) {
+        return std::unexpected(make_error_code(error_code::resource_unavailable));
+    }
+}
+
+} // namespace vsocky
@@ -0,0 +1,53 @@
+#include "vsocky/protocol/upload_frames.hpp"
+#include "vsocky/protocol/byte_order.hpp"
+#include "vsocky/utils/error.hpp"
+
+namespace vsocky {
+
+std::array<uint8_t, upload_chunk_header_size> encode_upload_chunk_header(uint64_t request_id,
+                                                                         uint32_t index) noexcept {
+    std::array<uint8_t, upload_chunk_header_size> header;
+    put_be(put_be(header.data(), request_id, 8), index, 4);
+    return header;
+}
+
+std::vector<uint8_t> encode_upload_chunk(uint64_t request_id, uint32_t index, std::span<const uint8_t> data) {
+    const auto header = encode_upload_chunk_header(request_id, index);
+    std::vector<uint8_t> out;
+    out.reserve(header.size() + data.size());
+    out.insert(out.end(), header.begin(), header.end());
+    out.insert(out.end(), data.begin(), data.end());
+    return out;
+}
+
+std::vector<uint8_t> encode_upload_end(const upload_end_info& info) {
+    std::vector<uint8_t> out(upload_end_size);
+    put_be(put_be(put_be(out.data(), info.request_id, 8), info.index, 4), info.size, 8);
+    return out;
+}
+
+std::expected<upload_chunk_view, std::error_code>
+decode_upload_chunk(std::span<const uint8_t> payload) noexcept {
+    if (payload.size() < upload_chunk_header_size) {
+        return std::unexpected(make_error_code(error_code::invalid_message_format));
+    }
+    return upload_chunk_view{
+        .request_id = get_be(payload.data(), 8),
+        .index = get_be32(payload.data() + 8),
+        .data = payload.subspan(upload_chunk_header_size),
+    };
+}
+
+std::expected<upload_end_info, std::error_code>
+decode_upload_end(std::span<const uint8_t> payload) noexcept {
+    if (payload.size() != upload_end_size) {
+        return std::unexpected(make_error_code(error_code::invalid_message_format));
+    }
+    return upload_end_info{
+        .request_id = get_be(payload.data(), 8),
+        .index = get_be32(payload.data() + 8),
+        .size = get_be(payload.data() + 12, 8),
+    };
+}
+
+} // namespace vsocky
@@ -0,0 +1,423 @@
+#include "vsocky/storage/artifact_cache.hpp"
+#include "vsocky/vsocket/frame_io.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <fstream>
+#include <iterator>
+
+#include <dirent.h>     // opendir() for indexing at startup
+#include <fcntl.h>      // open()
+#include <sys/stat.h>   // mkdir(), stat()
+#include <unistd.h>     // rename(), unlink()
+
+namespace vsocky {
+
+namespace {
+
+// Write a whole file atomically (unique temp name + rename), so a concurrent
+// load() sees the old artifact or the new one, never a torn one
+bool write_file_atomic(const std::string& path, std::span<const uint8_t> data) {
+    static std::atomic<uint64_t> counter{0};
+    const std::string temp = path + ".tmp-" + std::to_string(::getpid()) + "-" +
+                             std::to_string(counter.fetch_add(1));
+    const int fd = ::open(temp.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0444);
+    if (fd == -1) {
+        return false;
+    }
+
+    while (!data.empty()) {
+        const ssize_t n = ::write(fd, data.data(), data.size());
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            ::close(fd);
+            ::unlink(temp.c_str());
+            return false;
+        }
+        data = data.subspan(static_cast<size_t>(n));
+    }
+
+    ::close(fd);
+    if (::rename(temp.c_str(), path.c_str()) != 0) {
+        ::unlink(temp.c_str());
+        return false;
+    }
+    return true;
+}
+
+} // anonymous namespace
+
+artifact_key make_artifact_key(std::span<const std::string_view> parts) noexcept {
+    sha256 h;
+    for (auto part : parts) {
+        // 8-byte little-endian length prefix makes the encoding unambiguous
+        uint8_t length[8];
+        for (size_t i = 0; i < sizeof(length); ++i) {
+            length[i] = static_cast<uint8_t>(static_cast<uint64_t>(part.size()) >> (8 * i));
+        }
+        h.update(length);
+        h.update(part);
+    }
+    return h.finish();
+}
+
+// =============================================================================
+// LocalArtifactCache
+// =============================================================================
+
+size_t LocalArtifactCache::key_hasher::operator()(const artifact_key& key) const noexcept {
+    size_t value = 0;
+    for (size_t i = 0; i < sizeof(value); ++i) {
+        value = (value << 8) | key[i];
+    }
+    return value;
+}
+
+LocalArtifactCache::LocalArtifactCache(std::string root, uint64_t budget_bytes)
+    : root_(std::move(root)), budget_(budget_bytes) {}
+
+std::string LocalArtifactCache::path_of(const artifact_key& key) const {
+    return root_ + "/" + to_hex(key);
+}
+
+std::error_code LocalArtifactCache::open() noexcept {
+    if (::mkdir(root_.c_str(), 0755) != 0 && errno != EEXIST) {
+        return error_code::resource_unavailable;
+    }
+
+    DIR* dir = ::opendir(root_.c_str());
+    if (dir == nullptr) {
+        return error_code::resource_unavailable;
+    }
+
+    // =========================================================================
+    // REBUILD THE INDEX
+    // =========================================================================
+    // The cache directory may survive a restart (or come from a snapshot), so
+    // pick up what's there. File mtime orders entries for LRU: older files
+    // get smaller clock values and are evicted first.
+    // =========================================================================
+    std::vector<std::pair<int64_t, std::pair<artifact_key, uint64_t>>> found;
+    try {
+        while (auto* ent = ::readdir(dir)) {
+            auto key = parse_sha256_hex(ent->d_name);
+            if (!key) {
+                continue;  // ".", "..", leftover .tmp files
+            }
+            struct stat st{};
+            if (::stat(path_of(*key).c_str(), &st) == 0 && S_ISREG(st.st_mode)) {
+                found.push_back({st.st_mtime, {*key, static_cast<uint64_t>(st.st_size)}});
+            }
+        }
+        ::closedir(dir);
+        dir = nullptr;
+
+        std::sort(found.begin(), found.end(),
+                  [](const auto& a, const auto& b) { return a.first < b.first; });
+
+        std::lock_guard lock(mutex_);
+        for (const auto& [mtime, item] : found) {
+            index_[item.first] = {item.second, ++clock_};
+            used_ += item.second;
+        }
+        evict_locked();
+    } catch (...) {
+        if (dir != nullptr) {
+            ::closedir(dir);
+        }
+        return error_code::resource_unavailable;
+    }
+
+    return error_code::success;
+}
+
+std::optional<std::vector<uint8_t>> LocalArtifactCache::load(const artifact_key& key) {
+    {
+        std::lock_guard lock(mutex_);
+        auto it = index_.find(key);
+        if (it == index_.end()) {
+            return std::nullopt;
+        }
+        it->second.last_used = ++clock_;
+    }
+
+    std::ifstream in(path_of(key), std::ios::binary);
+    if (!in) {
+        // Deleted behind our back - forget it
+        std::lock_guard lock(mutex_);
+        if (auto it = index_.find(key); it != index_.end()) {
+            used_ -= it->second.size;
+            index_.erase(it);
+        }
+        return std::nullopt;
+    }
+    return std::vector<uint8_t>(std::istreambuf_iterator<char>(in), {});
+}
+
+std::error_code LocalArtifactCache::store(const artifact_key& key,
+                                          std::span<const uint8_t> data) noexcept {
+    if (data.size() > budget_) {
+        return error_code::resource_unavailable;  // Would evict everything and still not fit
+    }
+
+    try {
+        if (!write_file_atomic(path_of(key), data)) {
+            return error_code::resource_unavailable;
+        }
+
+        std::lock_guard lock(mutex_);
+        auto& slot = index_[key];
+        used_ = used_ - slot.size + data.size();
+        slot = {data.size(), ++clock_};
+        evict_locked();
+    } catch (...) {
+        return error_code::resource_unavailable;
+    }
+
+    return error_code::success;
+}
+
+void LocalArtifactCache::set_budget(uint64_t budget_bytes) noexcept {
+    std::lock_guard lock(mutex_);
+    budget_ = budget_bytes;
+    evict_locked();
+}
+
+uint64_t LocalArtifactCache::size_bytes() const noexcept {
+    std::lock_guard lock(mutex_);
+    return used_;
+}
+
+size_t LocalArtifactCache::entries() const noexcept {
+    std::lock_guard lock(mutex_);
+    return index_.size();
+}
+
+artifact_summary LocalArtifactCache::summary() const {
+    std::lock_guard lock(mutex_);
+    artifact_summary result(index_.size());
+    for (const auto& [key, info] : index_) {
+        result.add(key);
+    }
+    return result;
+}
+
+void LocalArtifactCache::evict_locked() noexcept {
+    // Linear scan for the LRU entry: the cache holds at most a few thousand
+    // artifacts and eviction only happens on insert, so this stays cheap
+    // and saves maintaining a separate LRU list.
+    while (used_ > budget_ && !index_.empty()) {
+        auto oldest = index_.begin();
+        for (auto it = index_.begin(); it != index_.end(); ++it) {
+            if (it->second.last_used < oldest->second.last_used) {
+                oldest = it;
+            }
+        }
+        try {
+            ::unlink(path_of(oldest->first).c_str());
+        } catch (...) {
+            // Can't build the path (OOM) - drop from the index anyway
+        }
+        used_ -= oldest->second.size;
+        index_.erase(oldest);
+    }
+}
+
+// =============================================================================
+// RemoteArtifactClient
+// =============================================================================
+
+artifact_connector vsock_artifact_connector(uint32_t cid, uint32_t port, int timeout_ms) {
+    return [=] { return Connection::connect_vsock(cid, port, timeout_ms); };
+}
+
+artifact_connector unix_artifact_connector(std::string path, int timeout_ms) {
+    return [path = std::move(path), timeout_ms] {
+        return Connection::connect_unix(path, timeout_ms);
+    };
+}
+
+RemoteArtifactClient::RemoteArtifactClient(artifact_connector connect,
+                                           remote_cache_options options)
+    : connect_(std::move(connect)),
+      options_(options),
+      publisher_([this] { publisher_loop(); }) {}
+
+RemoteArtifactClient::~RemoteArtifactClient() noexcept {
+    {
+        std::lock_guard lock(queue_mutex_);
+        stopping_ = true;
+    }
+    queue_cv_.notify_all();
+    publisher_.join();
+}
+
+bool RemoteArtifactClient::ensure_connected(std::optional<Connection>& conn,
+                                            clock::time_point& retry_after) {
+    if (conn && conn->is_valid()) {
+        return true;
+    }
+
+    // =========================================================================
+    // RECONNECT BACKOFF
+    // =========================================================================
+    // If the host service is down, every compile would otherwise pay a full
+    // connect timeout before falling back to compiling. After one failure we
+    // stop trying for a while and go straight to the local result.
+    // =========================================================================
+    if (clock::now() < retry_after) {
+        return false;
+    }
+
+    auto fresh = connect_();
+    if (!fresh) {
+        retry_after = clock::now() + std::chrono::milliseconds(options_.reconnect_backoff_ms);
+        errors_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    conn.emplace(std::move(*fresh));
+    return true;
+}
+
+std::optional<std::vector<uint8_t>> RemoteArtifactClient::fetch(const artifact_key& key) {
+    std::lock_guard lock(fetch_mutex_);
+
+    if (!ensure_connected(fetch_conn_, fetch_retry_after_)) {
+        return std::nullopt;
+    }
+
+    // A fresh framer per request: after a timeout the stream position is
+    // unknown, so we also drop the connection rather than resynchronise
+    MessageFramer framer(options_.max_artifact_size);
+    auto fail = [&]() -> std::optional<std::vector<uint8_t>> {
+        fetch_conn_.reset();
+        errors_.fetch_add(1, std::memory_order_relaxed);
+        return std::nullopt;
+    };
+
+    if (send_frame(*fetch_conn_, frame_type::artifact_get, key, options_.timeout_ms)) {
+        return fail();
+    }
+    auto reply = receive_frame(*fetch_conn_, framer, options_.timeout_ms);
+    if (!reply) {
+        return fail();
+    }
+
+    switch (reply->type) {
+        case frame_type::artifact_hit:
+            hits_.fetch_add(1, std::memory_order_relaxed);
+            return std::move(reply->payload);
+        case frame_type::artifact_miss:
+            misses_.fetch_add(1, std::memory_order_relaxed);
+            return std::nullopt;
+        default:
+            return fail();  // Protocol violation
+    }
+}
+
+bool RemoteArtifactClient::publish_async(const artifact_key& key, std::vector<uint8_t> data) {
+    {
+        std::lock_guard lock(queue_mutex_);
+        if (queue_.size() >= options_.max_pending_publishes ||
+            data.size() + key.size() > options_.max_artifact_size) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        queue_.emplace_back(key, std::move(data));
+    }
+    queue_cv_.notify_one();
+    return true;
+}
+
+void RemoteArtifactClient::flush() {
+    std::unique_lock lock(queue_mutex_);
+    idle_cv_.wait(lock, [this] { return queue_.empty() && !publishing_; });
+}
+
+remote_cache_stats RemoteArtifactClient::stats() const noexcept {
+    return {
+        .hits = hits_.load(std::memory_order_relaxed),
+        .misses = misses_.load(std::memory_order_relaxed),
+        .errors = errors_.load(std::memory_order_relaxed),
+        .published = published_.load(std::memory_order_relaxed),
+        .dropped = dropped_.load(std::memory_order_relaxed),
+    };
+}
+
+void RemoteArtifactClient::publisher_loop() noexcept {
+    std::optional<Connection> conn;
+    clock::time_point retry_after{};
+
+    while (true) {
+        std::pair<artifact_key, std::vector<uint8_t>> item;
+        {
+            std::unique_lock lock(queue_mutex_);
+            queue_cv_.wait(lock, [this] { return stopping_ || !queue_.empty(); });
+            if (stopping_) {
+                return;
+            }
+            item = std::move(queue_.front());
+            queue_.pop_front();
+            publishing_ = true;
+        }
+
+        try {
+            if (ensure_connected(conn, retry_after)) {
+                // Key and artifact go out as one frame: [key][bytes]
+                std::vector<uint8_t> payload;
+                payload.reserve(item.first.size() + item.second.size());
+                payload.insert(payload.end(), item.first.begin(), item.first.end());
+                payload.insert(payload.end(), item.second.begin(), item.second.end());
+
+                if (send_frame(*conn, frame_type::artifact_put, payload, options_.timeout_ms * 4)) {
+                    conn.reset();
+                    errors_.fetch_add(1, std::memory_order_relaxed);
+                } else {
+                    published_.fetch_add(1, std::memory_order_relaxed);
+                }
+            } else {
+                dropped_.fetch_add(1, std::memory_order_relaxed);
+            }
+        } catch (...) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        {
+            std::lock_guard lock(queue_mutex_);
+            publishing_ = false;
+        }
+        idle_cv_.notify_all();
+    }
+}
+
+// =============================================================================
+// ArtifactCache
+// =============================================================================
+
+std::optional<std::vector<uint8_t>> ArtifactCache::lookup(const artifact_key& key) {
+    if (auto local = local_.load(key)) {
+        return local;
+    }
+    if (remote_ == nullptr) {
+        return std::nullopt;
+    }
+
+    auto remote = remote_->fetch(key);
+    if (remote) {
+        // Next time this VM compiles it, it's a local hit
+        local_.store(key, *remote);
+    }
+    return remote;
+}
+
+void ArtifactCache::insert(const artifact_key& key, std::vector<uint8_t> artifact) {
+    local_.store(key, artifact);
+    if (remote_ != nullptr) {
+        remote_->publish_async(key, std::move(artifact));
+    }
+}
+
+} // namespace vsocky
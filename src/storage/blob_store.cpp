@@ -0,0 +1,413 @@
+#include "vsocky/storage/blob_store.hpp"
+#include "vsocky/utils/error.hpp"
+
+#include <atomic>
+#include <cerrno>
+#include <unordered_set>
+#include <utility>
+
+#include <fcntl.h>       // open()
+#include <linux/fs.h>    // FICLONE
+#include <sys/ioctl.h>   // ioctl()
+#include <sys/stat.h>    // mkdir(), stat()
+#include <unistd.h>      // link(), rename(), unlink(), copy_file_range()
+
+namespace vsocky {
+
+namespace {
+
+// Hash functor so blob hashes can go into an unordered_set
+// (the first 8 bytes of a SHA-256 are already uniformly distributed)
+struct blob_hash_hasher {
+    size_t operator()(const blob_hash& hash) const noexcept {
+        size_t value = 0;
+        for (size_t i = 0; i < sizeof(value); ++i) {
+            value = (value << 8) | hash[i];
+        }
+        return value;
+    }
+};
+
+// RAII wrapper so every early return closes the fd
+class scoped_fd {
+public:
+    explicit scoped_fd(int fd) noexcept : fd_(fd) {}
+    ~scoped_fd() noexcept {
+        if (fd_ != -1) {
+            ::close(fd_);
+        }
+    }
+    scoped_fd(const scoped_fd&) = delete;
+    scoped_fd& operator=(const scoped_fd&) = delete;
+
+    int get() const noexcept {
+        return fd_;
+    }
+
+private:
+    int fd_;
+};
+
+// mkdir that treats "already exists" as success
+bool ensure_dir(const std::string& path) noexcept {
+    return ::mkdir(path.c_str(), 0755) == 0 || errno == EEXIST;
+}
+
+// write() until everything is written (regular files: short writes are rare
+// but legal, e.g. on signal delivery)
+bool write_fully(int fd, std::span<const uint8_t> data) noexcept {
+    while (!data.empty()) {
+        const ssize_t written = ::write(fd, data.data(), data.size());
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data = data.subspan(static_cast<size_t>(written));
+    }
+    return true;
+}
+
+// =============================================================================
+// COPYING WITHOUT COPYING
+// =============================================================================
+// In order of preference:
+// 1. ioctl(FICLONE): reflink - the new file shares the old file's extents
+//    copy-on-write. O(1), no data moves. Needs btrfs/xfs (not tmpfs/ext4).
+// 2. copy_file_range(): the kernel copies page-cache to page-cache, no
+//    round trip through user space.
+// 3. read()/write(): the portable last resort.
+// =============================================================================
+bool clone_or_copy(int src, int dst) noexcept {
+    if (::ioctl(dst, FICLONE, src) == 0) {
+        return true;
+    }
+
+    struct stat st{};
+    if (::fstat(src, &st) != 0) {
+        return false;
+    }
+
+    auto remaining = static_cast<size_t>(st.st_size);
+    while (remaining > 0) {
+        const ssize_t copied = ::copy_file_range(src, nullptr, dst, nullptr, remaining, 0);
+        if (copied > 0) {
+            remaining -= static_cast<size_t>(copied);
+            continue;
+        }
+        if (copied == 0) {
+            return false;  // Source shrank underneath us
+        }
+        if (errno == EINTR) {
+            continue;
+        }
+        if (errno != EXDEV && errno != EINVAL && errno != ENOSYS && errno != EOPNOTSUPP) {
+            return false;
+        }
+
+        // Kernel can't do it for this pair of files - do it ourselves
+        uint8_t buffer[64 * 1024];
+        while (true) {
+            const ssize_t n = ::read(src, buffer, sizeof(buffer));
+            if (n == 0) {
+                return true;
+            }
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return false;
+            }
+            if (!write_fully(dst, std::span(buffer, static_cast<size_t>(n)))) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+// Create every directory on the way to `path`'s parent (like mkdir -p `dirname path`)
+bool create_parents(const std::string& path) noexcept {
+    for (size_t slash = path.find('/', 1); slash != std::string::npos;
+         slash = path.find('/', slash + 1)) {
+        if (!ensure_dir(path.substr(0, slash))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// =============================================================================
+// ATOMIC PUBLISH: write to a temp name, then rename()
+// =============================================================================
+// rename() is atomic within a filesystem, so a concurrent reader sees
+// either no blob or the complete blob - never a half-written one.
+// Two writers racing on the same blob both succeed; the content is
+// identical by construction.
+// =============================================================================
+int open_temp(const std::string& final_path, std::string& temp_path) {
+    const std::string dir = final_path.substr(0, final_path.rfind('/'));
+    if (!ensure_dir(dir)) {
+        return -1;
+    }
+
+    static std::atomic<uint64_t> counter{0};
+    temp_path = dir + "/.tmp-" + std::to_string(::getpid()) + "-" + std::to_string(counter.fetch_add(1));
+
+    // 0444: the open fd may write, but nobody can open it for writing later
+    return ::open(temp_path.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0444);
+}
+
+} // anonymous namespace
+
+BlobStore::BlobStore(std::string root) : root_(std::move(root)) {
+    while (root_.size() > 1 && root_.back() == '/') {
+        root_.pop_back();
+    }
+}
+
+std::error_code BlobStore::open() noexcept {
+    try {
+        if (!create_parents(root_ + "/") ) {
+            return error_code::resource_unavailable;
+        }
+    } catch (...) {
+        return error_code::resource_unavailable;
+    }
+    return error_code::success;
+}
+
+std::string BlobStore::blob_path(const blob_hash& hash) const {
+    const std::string hex = to_hex(hash);
+    return root_ + "/" + hex.substr(0, 2) + "/" + hex;
+}
+
+bool BlobStore::contains(const blob_hash& hash) const noexcept {
+    try {
+        struct stat st{};
+        return ::stat(blob_path(hash).c_str(), &st) == 0 && S_ISREG(st.st_mode);
+    } catch (...) {
+        return false;
+    }
+}
+
+std::vector<blob_hash> BlobStore::missing(std::span<const blob_hash> hashes) const {
+    std::vector<blob_hash> result;
+    std::unordered_set<blob_hash, blob_hash_hasher> seen;
+    seen.reserve(hashes.size());
+
+    for (const auto& hash : hashes) {
+        if (seen.insert(hash).second && !contains(hash)) {
+            result.push_back(hash);
+        }
+    }
+    return result;
+}
+
+std::error_code BlobStore::put(const blob_hash& hash, std::span<const uint8_t> data) noexcept {
+    // Never trust the sender's claim - a wrong hash would poison every
+    // future job that references it
+    if (sha256::hash(data) != hash) {
+        return error_code::invalid_field_value;
+    }
+    if (contains(hash)) {
+        return error_code::success;
+    }
+
+    try {
+        const std::string final_path = blob_path(hash);
+        std::string temp_path;
+        scoped_fd fd(open_temp(final_path, temp_path));
+        if (fd.get() == -1) {
+            return error_code::resource_unavailable;
+        }
+        if (!write_fully(fd.get(), data) || ::rename(temp_path.c_str(), final_path.c_str()) != 0) {
+            ::unlink(temp_path.c_str());
+            return error_code::resource_unavailable;
+        }
+    } catch (...) {
+        return error_code::resource_unavailable;
+    }
+
+    return error_code::success;
+}
+
+std::expected<BlobWriter, std::error_code> BlobStore::begin_put(const blob_hash& hash) noexcept {
+    try {
+        std::string final_path = blob_path(hash);
+        std::string temp_path;
+        const int fd = open_temp(final_path, temp_path);
+        if (fd == -1) {
+            return std::unexpected(make_error_code(error_code::resource_unavailable));
+        }
+        return BlobWriter(hash, std::move(temp_path), std::move(final_path), fd);
+    } catch (...) {
+        return std::unexpected(make_error_code(error_code::resource_unavailable));
+    }
+}
+
+// =============================================================================
+// BlobWriter
+// =============================================================================
+
+BlobWriter::BlobWriter(const blob_hash& hash, std::string temp_path, std::string final_path, int fd) noexcept
+    : hash_(hash), temp_path_(std::move(temp_path)), final_path_(std::move(final_path)), fd_(fd) {}
+
+BlobWriter::BlobWriter(BlobWriter&& other) noexcept
+    : hash_(other.hash_),
+      temp_path_(std::move(other.temp_path_)),
+      final_path_(std::move(other.final_path_)),
+      fd_(std::exchange(other.fd_, -1)),
+      hasher_(other.hasher_),
+      size_(other.size_) {}
+
+BlobWriter& BlobWriter::operator=(BlobWriter&& other) noexcept {
+    if (this != &other) {
+        discard();
+        hash_ = other.hash_;
+        temp_path_ = std::move(other.temp_path_);
+        final_path_ = std::move(other.final_path_);
+        fd_ = std::exchange(other.fd_, -1);
+        hasher_ = other.hasher_;
+        size_ = other.size_;
+    }
+    return *this;
+}
+
+BlobWriter::~BlobWriter() noexcept {
+    discard();
+}
+
+void BlobWriter::discard() noexcept {
+    if (fd_ != -1) {
+        ::close(std::exchange(fd_, -1));
+        ::unlink(temp_path_.c_str());
+    }
+}
+
+std::error_code BlobWriter::append(std::span<const uint8_t> data) noexcept {
+    if (fd_ == -1) {
+        return error_code::invalid_message_format;  // Already committed
+    }
+    if (!write_fully(fd_, data)) {
+        return error_code::resource_unavailable;
+    }
+    hasher_.update(data);
+    size_ += data.size();
+    return error_code::success;
+}
+
+std::error_code BlobWriter::commit() noexcept {
+    if (fd_ == -1) {
+        return error_code::invalid_message_format;
+    }
+    ::close(std::exchange(fd_, -1));
+
+    // Same rule as put(): the sender's claim is checked before anyone can
+    // see the blob under its name
+    if (hasher_.finish() != hash_) {
+        ::unlink(temp_path_.c_str());
+        return error_code::invalid_field_value;
+    }
+    if (::rename(temp_path_.c_str(), final_path_.c_str()) != 0) {
+        ::unlink(temp_path_.c_str());
+        return error_code::resource_unavailable;
+    }
+    return error_code::success;
+}
+
+std::error_code BlobStore::materialize(const blob_hash& hash,
+                                       const std::string& dest,
+                                       materialize_mode mode) const noexcept {
+    try {
+        const std::string source = blob_path(hash);
+
+        // Read-only files: a hard link costs one directory entry, no data
+        if (mode == materialize_mode::read_only) {
+            if (::link(source.c_str(), dest.c_str()) == 0) {
+                return error_code::success;
+            }
+            if (errno == ENOENT) {
+                return error_code::invalid_field_value;  // Unknown blob
+            }
+            if (errno == EEXIST) {
+                return error_code::resource_unavailable;
+            }
+            // EXDEV (different filesystem), EMLINK (link count limit): copy
+        }
+
+        scoped_fd src(::open(source.c_str(), O_RDONLY | O_CLOEXEC));
+        if (src.get() == -1) {
+            return errno == ENOENT ? error_code::invalid_field_value
+                                   : error_code::resource_unavailable;
+        }
+
+        const mode_t perms = mode == materialize_mode::writable ? 0644 : 0444;
+        scoped_fd dst(::open(dest.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, perms));
+        if (dst.get() == -1) {
+            return error_code::resource_unavailable;
+        }
+        if (!clone_or_copy(src.get(), dst.get())) {
+            ::unlink(dest.c_str());
+            return error_code::resource_unavailable;
+        }
+    } catch (...) {
+        return error_code::resource_unavailable;
+    }
+
+    return error_code::success;
+}
+
+std::error_code BlobStore::materialize_workspace(const std::string& workspace_root,
+                                                 std::span<const blob_file_ref> files) const noexcept {
+    // Validate everything before touching the filesystem, so a malicious
+    // request can't leave half a workspace behind
+    for (const auto& file : files) {
+        if (!is_safe_relative_path(file.path)) {
+            return error_code::invalid_field_value;
+        }
+    }
+
+    try {
+        for (const auto& file : files) {
+            const std::string dest = workspace_root + "/" + file.path;
+            if (!create_parents(dest)) {
+                return error_code::resource_unavailable;
+            }
+            if (auto ec = materialize(file.hash, dest, file.mode)) {
+                return ec;
+            }
+        }
+    } catch (...) {
+        return error_code::resource_unavailable;
+    }
+
+    return error_code::success;
+}
+
+bool is_safe_relative_path(std::string_view path) noexcept {
+    if (path.empty() || path.front() == '/' || path.find('\0') != std::string_view::npos) {
+        return false;
+    }
+
+    // Every component must be a real name: no "", ".", or ".."
+    while (!path.empty()) {
+        const auto slash = path.find('/');
+        const auto component = path.substr(0, slash);
+        if (component.empty() || component == "." || component == "..") {
+            return false;
+        }
+        if (slash == std::string_view::npos) {
+            break;
+        }
+        path.remove_prefix(slash + 1);
+        if (path.empty()) {
+            return false;  // Trailing slash
+        }
+    }
+    return true;
+}
+
+} // namespace vsocky
@@ -0,0 +1,153 @@
+#include "vsocky/storage/workspace_files.hpp"
+#include "vsocky/storage/blob_store.hpp"  // is_safe_relative_path()
+
+#include <algorithm>
+#include <cerrno>
+#include <unordered_set>
+
+#include <dirent.h>     // fdopendir(), readdir()
+#include <fcntl.h>      // openat()
+#include <sys/stat.h>   // fstatat()
+#include <unistd.h>     // close(), dup()
+
+namespace vsocky {
+
+namespace {
+
+constexpr int dir_flags = O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC;
+
+struct walker {
+    const std::unordered_set<std::string_view>& exclude;
+    const workspace_list_options& options;
+    std::vector<workspace_file>& out;
+
+    // Walk the directory open at dir_fd (consumed). prefix is "" or "a/b/".
+    std::error_code walk(int dir_fd, const std::string& prefix, size_t depth) {
+        DIR* dir = ::fdopendir(dir_fd);
+        if (dir == nullptr) {
+            ::close(dir_fd);
+            return error_code::resource_unavailable;
+        }
+
+        std::error_code result;
+        while (auto* ent = ::readdir(dir)) {
+            const std::string_view name = ent->d_name;
+            if (name == "." || name == "..") {
+                continue;
+            }
+
+            // fstatat with AT_SYMLINK_NOFOLLOW: a symlink reports as a
+            // symlink and is skipped below, never resolved
+            struct stat st{};
+            if (::fstatat(::dirfd(dir), ent->d_name, &st, AT_SYMLINK_NOFOLLOW) != 0) {
+                continue;  // Deleted while we were listing
+            }
+
+            std::string path = prefix + std::string(name);
+            if (S_ISREG(st.st_mode)) {
+                if (exclude.contains(path)) {
+                    continue;
+                }
+                if (out.size() >= options.max_entries) {
+                    result = error_code::message_too_large;
+                    break;
+                }
+                out.push_back({std::move(path), static_cast<uint64_t>(st.st_size),
+                               static_cast<uint32_t>(st.st_mode & 07777)});
+            } else if (S_ISDIR(st.st_mode) && depth < options.max_depth) {
+                const int child = ::openat(::dirfd(dir), ent->d_name, dir_flags);
+                if (child == -1) {
+                    continue;  // Replaced by a symlink since fstatat, or unreadable
+                }
+                if ((result = walk(child, path + "/", depth + 1))) {
+                    break;
+                }
+            }
+        }
+
+        ::closedir(dir);
+        return result;
+    }
+};
+
+} // anonymous namespace
+
+std::expected<std::vector<workspace_file>, std::error_code>
+list_workspace_files(const std::string& root,
+                     std::span<const std::string> exclude,
+                     const workspace_list_options& options) {
+    const int root_fd = ::open(root.c_str(), dir_flags);
+    if (root_fd == -1) {
+        return std::unexpected(make_error_code(error_code::resource_unavailable));
+    }
+
+    std::unordered_set<std::string_view> excluded(exclude.begin(), exclude.end());
+    std::vector<workspace_file> files;
+    walker w{excluded, options, files};
+    if (auto ec = w.walk(root_fd, "", 0)) {
+        return std::unexpected(ec);
+    }
+
+    std::sort(files.begin(), files.end(),
+              [](const auto& a, const auto& b) { return a.path < b.path; });
+    return files;
+}
+
+std::expected<int, std::error_code>
+open_workspace_file(const std::string& root, std::string_view path) noexcept {
+    if (!is_safe_relative_path(path)) {
+        return std::unexpected(make_error_code(error_code::invalid_field_value));
+    }
+
+    int dir_fd = ::open(root.c_str(), dir_flags);
+    if (dir_fd == -1) {
+        return std::unexpected(make_error_code(error_code::resource_unavailable));
+    }
+
+    // =========================================================================
+    // COMPONENT-BY-COMPONENT OPEN
+    // =========================================================================
+    // O_NOFOLLOW only protects the LAST component of a path, so we open each
+    // directory ourselves (relative to the previous one, O_NOFOLLOW each
+    // time). A symlink anywhere on the way gives ELOOP/ENOTDIR.
+    // =========================================================================
+    char name[256];
+    while (true) {
+        const auto slash = path.find('/');
+        const auto component = path.substr(0, slash);
+        if (component.size() >= sizeof(name)) {
+            ::close(dir_fd);
+            return std::unexpected(make_error_code(error_code::invalid_field_value));
+        }
+        component.copy(name, component.size());
+        name[component.size()] = '\0';
+
+        const bool last = slash == std::string_view::npos;
+        const int fd = ::openat(dir_fd, name,
+                                last ? (O_RDONLY | O_NOFOLLOW | O_NONBLOCK | O_CLOEXEC) : dir_flags);
+        const int saved_errno = errno;
+        ::close(dir_fd);
+
+        if (fd == -1) {
+            return std::unexpected(make_error_code(
+                saved_errno == ENOENT ? error_code::resource_unavailable
+                                      : error_code::invalid_field_value));
+        }
+        if (!last) {
+            dir_fd = fd;
+            path.remove_prefix(slash + 1);
+            continue;
+        }
+
+        // O_NONBLOCK above keeps a FIFO from hanging the open; reject it
+        // (and anything else that isn't a plain file) here
+        struct stat st{};
+        if (::fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+            ::close(fd);
+            return std::unexpected(make_error_code(error_code::invalid_field_value));
+        }
+        return fd;
+    }
+}
+
+} // namespace vsocky
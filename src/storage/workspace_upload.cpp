@@ -0,0 +1,188 @@
+#include "vsocky/storage/workspace_upload.hpp"
+#include "vsocky/storage/blob_store.hpp"  // is_safe_relative_path()
+
+#include <array>
+#include <cerrno>
+#include <utility>
+
+#include <fcntl.h>     // openat()
+#include <sys/stat.h>  // mkdirat()
+#include <unistd.h>    // write(), close()
+
+namespace vsocky {
+
+namespace {
+
+constexpr int dir_flags = O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC;
+
+// base64 text is decoded through a fixed buffer this many characters at a time
+constexpr size_t base64_slice = 64 * 1024;
+
+bool write_all_fd(int fd, const uint8_t* data, size_t size) noexcept {
+    while (size > 0) {
+        const ssize_t n = ::write(fd, data, size);
+        if (n == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data += n;
+        size -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+} // anonymous namespace
+
+std::expected<WorkspaceUpload, std::error_code>
+WorkspaceUpload::create(const std::string& root, std::vector<std::string> paths, const upload_limits& limits) {
+    for (const auto& path : paths) {
+        if (!is_safe_relative_path(path)) {
+            return std::unexpected(make_error_code(error_code::invalid_field_value));
+        }
+    }
+
+    WorkspaceUpload upload;
+    upload.root_fd_ = ::open(root.c_str(), dir_flags);
+    if (upload.root_fd_ == -1) {
+        return std::unexpected(make_error_code(error_code::resource_unavailable));
+    }
+    upload.limits_ = limits;
+    upload.inputs_.resize(paths.size());
+    for (size_t i = 0; i < paths.size(); ++i) {
+        upload.inputs_[i].path = std::move(paths[i]);
+    }
+    return upload;
+}
+
+WorkspaceUpload::WorkspaceUpload(WorkspaceUpload&& other) noexcept
+    : root_fd_(std::exchange(other.root_fd_, -1)),
+      limits_(other.limits_),
+      total_(other.total_),
+      inputs_(std::move(other.inputs_)) {}
+
+WorkspaceUpload::~WorkspaceUpload() noexcept {
+    for (auto& in : inputs_) {
+        if (in.fd != -1) {
+            ::close(in.fd);
+        }
+    }
+    if (root_fd_ != -1) {
+        ::close(root_fd_);
+    }
+}
+
+// Create the file, and any missing parent directories, without following
+// a symlink anywhere on the way (see open_workspace_file())
+std::error_code WorkspaceUpload::open_input(input& in) noexcept {
+    std::string_view path = in.path;
+    int dir_fd = root_fd_;
+    char name[256];
+    while (true) {
+        const auto slash = path.find('/');
+        const auto component = path.substr(0, slash);
+        if (component.size() >= sizeof(name)) {
+            break;
+        }
+        component.copy(name, component.size());
+        name[component.size()] = '\0';
+
+        const bool last = slash == std::string_view::npos;
+        int fd;
+        if (last) {
+            fd = ::openat(dir_fd, name, O_WRONLY | O_CREAT | O_EXCL | O_NOFOLLOW | O_CLOEXEC, 0644);
+        } else {
+            if (::mkdirat(dir_fd, name, 0755) != 0 && errno != EEXIST) {
+                break;
+            }
+            fd = ::openat(dir_fd, name, dir_flags);
+        }
+        if (dir_fd != root_fd_) {
+            ::close(dir_fd);
+        }
+        if (fd == -1) {
+            return error_code::invalid_field_value;
+        }
+        if (last) {
+            in.fd = fd;
+            return error_code::success;
+        }
+        dir_fd = fd;
+        path.remove_prefix(slash + 1);
+    }
+    if (dir_fd != root_fd_) {
+        ::close(dir_fd);
+    }
+    return error_code::invalid_field_value;
+}
+
+std::error_code WorkspaceUpload::write(uint32_t index, std::span<const uint8_t> data) noexcept {
+    if (index >= inputs_.size()) {
+        return error_code::invalid_field_value;
+    }
+    input& in = inputs_[index];
+    if (in.finished) {
+        return error_code::invalid_message_format;
+    }
+    if (data.size() > limits_.max_file_bytes - in.size || data.size() > limits_.max_total_bytes - total_) {
+        return error_code::message_too_large;
+    }
+    if (in.fd == -1) {
+        if (auto ec = open_input(in)) {
+            return ec;
+        }
+    }
+    if (!write_all_fd(in.fd, data.data(), data.size())) {
+        return error_code::write_failed;
+    }
+    in.size += data.size();
+    total_ += data.size();
+    return error_code::success;
+}
+
+std::error_code WorkspaceUpload::write_base64(uint32_t index, std::string_view text) noexcept {
+    if (index >= inputs_.size()) {
+        return error_code::invalid_field_value;
+    }
+    std::array<uint8_t, base64_decoder::max_output(base64_slice)> buffer;
+    while (!text.empty()) {
+        const auto slice = text.substr(0, base64_slice);
+        text.remove_prefix(slice.size());
+        auto decoded = inputs_[index].decoder.decode(slice, buffer);
+        if (!decoded) {
+            return decoded.error();
+        }
+        if (auto ec = write(index, {buffer.data(), *decoded})) {
+            return ec;
+        }
+    }
+    return error_code::success;
+}
+
+std::error_code WorkspaceUpload::finish(uint32_t index, uint64_t size) noexcept {
+    if (index >= inputs_.size()) {
+        return error_code::invalid_field_value;
+    }
+    input& in = inputs_[index];
+    if (in.finished) {
+        return error_code::invalid_message_format;
+    }
+    if (auto ec = in.decoder.finish()) {
+        return ec;
+    }
+    if (in.size != size) {
+        return error_code::invalid_field_value;
+    }
+    if (in.fd == -1) {
+        if (auto ec = open_input(in)) {  // Empty input: no chunk ever created it
+            return ec;
+        }
+    }
+    const bool closed = ::close(in.fd) == 0;
+    in.fd = -1;
+    in.finished = true;
+    return closed ? error_code::success : error_code::write_failed;
+}
+
+} // namespace vsocky
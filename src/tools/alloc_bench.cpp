@@ -0,0 +1,217 @@
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <print>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#ifdef VSOCKY_BUNDLED_MALLOC
+#include "vsocky/utils/allocator.hpp"
+#endif
+
+// =============================================================================
+// vsocky-alloc-bench: malloc throughput, single- and multi-threaded
+// =============================================================================
+// Built twice from this file: vsocky-alloc-bench uses whatever libc provides
+// (glibc or musl), vsocky-alloc-bench-bundled links utils/allocator.cpp.
+// Same workloads, same seeds, so the numbers compare directly:
+//
+//   vsocky-alloc-bench --threads 1,2,4,8
+//   vsocky-alloc-bench-bundled --threads 1,2,4,8
+//
+// WORKLOADS:
+// - churn:   each thread keeps a window of live blocks (16-512 bytes) and
+//            replaces a random one per op - request parsing and responses
+// - mixed:   same, sizes 16 bytes - 64 KiB - output buffers, file chunks
+// - handoff: threads free blocks another thread allocated - what happens
+//            when the offload pool completes work the reactor submitted
+// =============================================================================
+
+namespace {
+
+using steady = std::chrono::steady_clock;
+
+// Deterministic and cheap: the benchmark should measure malloc, not the RNG
+struct xorshift {
+    uint64_t state;
+    uint64_t next() noexcept {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        return state;
+    }
+};
+
+constexpr size_t window = 512;
+
+size_t pick_size(xorshift& rng, size_t max_size) noexcept {
+    // Skewed towards small sizes, like real allocation traffic
+    const size_t bits = 4 + rng.next() % (std::bit_width(max_size) - 4);
+    return std::max<size_t>(16, rng.next() & ((size_t{1} << bits) - 1));
+}
+
+// Replace one random live block per op; touch each new block once
+void run_window(uint64_t ops, uint64_t seed, size_t max_size) {
+    xorshift rng{seed};
+    std::vector<void*> live(window, nullptr);
+    for (uint64_t i = 0; i < ops; ++i) {
+        const size_t slot = rng.next() % window;
+        std::free(live[slot]);
+        const size_t size = pick_size(rng, max_size);
+        live[slot] = std::malloc(size);
+        static_cast<char*>(live[slot])[0] = 1;
+    }
+    for (void* p : live) {
+        std::free(p);
+    }
+}
+
+// Single-slot mailboxes around a ring of threads: thread i allocates,
+// thread i+1 frees
+struct alignas(64) mailbox {
+    std::atomic<void*> slot{nullptr};
+};
+
+void run_handoff(uint64_t ops, uint64_t seed, mailbox& out, mailbox& in, std::atomic<size_t>& finished,
+                 size_t threads) {
+    xorshift rng{seed};
+    uint64_t sent = 0;
+    // Keep draining our inbox until every thread is done sending, so the
+    // last blocks don't wait on a thread that already left
+    while (sent < ops || finished.load(std::memory_order_acquire) < threads) {
+        if (void* p = in.slot.exchange(nullptr, std::memory_order_acq_rel)) {
+            std::free(p);
+        }
+        if (sent < ops) {
+            void* expected = nullptr;
+            void* block = std::malloc(pick_size(rng, 512));
+            if (!out.slot.compare_exchange_strong(expected, block, std::memory_order_acq_rel)) {
+                std::free(block);  // Neighbour hasn't taken the last one yet
+            }
+            ++sent;
+            if (sent == ops) {
+                finished.fetch_add(1, std::memory_order_acq_rel);
+            }
+        }
+    }
+    if (void* p = in.slot.exchange(nullptr, std::memory_order_acq_rel)) {
+        std::free(p);
+    }
+}
+
+// Run body on n threads; returns wall-clock nanoseconds per op of one thread
+template <typename Body>
+double measure(size_t threads, uint64_t ops_per_thread, Body body) {
+    std::vector<std::thread> workers;
+    std::atomic<bool> go{false};
+    for (size_t t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t] {
+            while (!go.load(std::memory_order_acquire)) {
+                std::this_thread::yield();
+            }
+            body(t);
+        });
+    }
+    const auto start = steady::now();
+    go.store(true, std::memory_order_release);
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    const auto elapsed = std::chrono::duration<double, std::nano>(steady::now() - start).count();
+    return elapsed / static_cast<double>(ops_per_thread);
+}
+
+std::string_view allocator_name() {
+#if defined(VSOCKY_BUNDLED_MALLOC)
+    return "bundled";
+#elif defined(__GLIBC__)
+    return "glibc";
+#else
+    return "musl";
+#endif
+}
+
+std::vector<size_t> parse_list(std::string_view text) {
+    std::vector<size_t> values;
+    while (!text.empty()) {
+        const auto comma = text.find(',');
+        values.push_back(std::stoul(std::string(text.substr(0, comma))));
+        text = comma == std::string_view::npos ? std::string_view{} : text.substr(comma + 1);
+    }
+    return values;
+}
+
+void print_usage(const char* program_name) {
+    std::println("Usage: {} [options]", program_name);
+    std::println("Options:");
+    std::println("  --threads LIST  Thread counts to run, comma-separated (default: 1,2,4,8)");
+    std::println("  --ops N         Operations per thread per workload (default: 2000000)");
+}
+
+} // anonymous namespace
+
+int main(int argc, char* argv[]) {
+    std::vector<size_t> thread_counts = {1, 2, 4, 8};
+    uint64_t ops = 2'000'000;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string_view arg(argv[i]);
+        try {
+            if (arg == "--help" || arg == "-h") {
+                print_usage(argv[0]);
+                return 0;
+            } else if (arg == "--threads" && i + 1 < argc) {
+                thread_counts = parse_list(argv[++i]);
+            } else if (arg == "--ops" && i + 1 < argc) {
+                ops = std::stoull(argv[++i]);
+            } else {
+                std::println(stderr, "Unknown option: {}", arg);
+                print_usage(argv[0]);
+                return 1;
+            }
+        } catch (const std::exception&) {
+            std::println(stderr, "Invalid value for {}", arg);
+            return 1;
+        }
+    }
+    if (thread_counts.empty() || ops == 0) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    std::println("allocator: {}", allocator_name());
+    std::println("{:<10} {:>8} {:>10} {:>10}", "workload", "threads", "ns/op", "Mops/s");
+    const auto report = [](std::string_view name, size_t threads, double ns) {
+        std::println("{:<10} {:>8} {:>10.1f} {:>10.1f}", name, threads, ns, static_cast<double>(threads) * 1e3 / ns);
+    };
+
+    for (const size_t threads : thread_counts) {
+        if (threads == 0) {
+            continue;
+        }
+        report("churn", threads, measure(threads, ops, [&](size_t t) { run_window(ops, 0x9e3779b97f4a7c15 + t, 512); }));
+        report("mixed", threads, measure(threads, ops / 4, [&](size_t t) {
+            run_window(ops / 4, 0xbf58476d1ce4e5b9 + t, 64 * 1024);
+        }));
+        if (threads >= 2) {
+            std::vector<mailbox> boxes(threads);
+            std::atomic<size_t> finished{0};
+            report("handoff", threads, measure(threads, ops, [&](size_t t) {
+                run_handoff(ops, 0x94d049bb133111eb + t, boxes[t], boxes[(t + threads - 1) % threads], finished,
+                            threads);
+            }));
+        }
+    }
+
+#ifdef VSOCKY_BUNDLED_MALLOC
+    const auto stats = vsocky::bundled_allocator_stats();
+    std::println("spans mapped: {} KiB, large live: {}", stats.span_bytes / 1024, stats.large_allocations);
+#endif
+    return 0;
+}
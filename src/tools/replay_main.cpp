@@ -0,0 +1,100 @@
+#include "vsocky/host/trace_replay.hpp"
+#include "vsocky/vsocket/frame_trace.hpp"
+
+#include <csignal>
+#include <optional>
+#include <print>
+#include <string>
+#include <string_view>
+
+// =============================================================================
+// vsocky-replay: play a --trace recording back against a server
+// =============================================================================
+//   vsocky-replay --trace /tmp/vsocky.trace --vsock 3:52000
+//   vsocky-replay --trace /tmp/vsocky.trace --unix /tmp/vsocky.sock --fast
+// =============================================================================
+
+void print_usage(const char* program_name) {
+    std::println("Usage: {} --trace FILE (--vsock CID:PORT | --unix PATH) [options]", program_name);
+    std::println("Options:");
+    std::println("  --speed X     Replay X times faster than recorded (default: 1)");
+    std::println("  --fast        No pacing: send every frame as soon as possible");
+    std::println("  --drain-ms N  After the last frame, wait until responses stop for N ms (default: 2000)");
+}
+
+int main(int argc, char* argv[]) {
+    std::string trace_path;
+    std::string unix_path;
+    std::optional<std::pair<uint32_t, uint32_t>> vsock;
+    vsocky::replay_options options;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string_view arg(argv[i]);
+        try {
+            if (arg == "--help" || arg == "-h") {
+                print_usage(argv[0]);
+                return 0;
+            } else if (arg == "--trace" && i + 1 < argc) {
+                trace_path = argv[++i];
+            } else if (arg == "--unix" && i + 1 < argc) {
+                unix_path = argv[++i];
+            } else if (arg == "--vsock" && i + 1 < argc) {
+                const std::string value(argv[++i]);
+                const auto colon = value.find(':');
+                if (colon == std::string::npos) {
+                    throw std::invalid_argument("missing ':'");
+                }
+                vsock.emplace(static_cast<uint32_t>(std::stoul(value.substr(0, colon))),
+                              static_cast<uint32_t>(std::stoul(value.substr(colon + 1))));
+            } else if (arg == "--speed" && i + 1 < argc) {
+                options.speed = std::stod(argv[++i]);
+                if (!(options.speed > 0)) {
+                    throw std::out_of_range("speed");
+                }
+            } else if (arg == "--fast") {
+                options.speed = 0;
+            } else if (arg == "--drain-ms" && i + 1 < argc) {
+                options.drain_timeout_ms = std::stoi(argv[++i]);
+            } else {
+                std::println(stderr, "Error: Unknown argument: {}", arg);
+                print_usage(argv[0]);
+                return 1;
+            }
+        } catch (...) {
+            std::println(stderr, "Error: Invalid value for {}", arg);
+            return 1;
+        }
+    }
+    if (trace_path.empty() || unix_path.empty() == !vsock.has_value()) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    auto records = vsocky::read_frame_trace(trace_path);
+    if (!records) {
+        std::println(stderr, "Error: Can't read trace {}: {}", trace_path, records.error().message());
+        return 1;
+    }
+
+    signal(SIGPIPE, SIG_IGN);
+    const vsocky::replay_connector connect = [&]() -> std::expected<vsocky::Connection, std::error_code> {
+        if (vsock) {
+            return vsocky::Connection::connect_vsock(vsock->first, vsock->second, options.io_timeout_ms);
+        }
+        return vsocky::Connection::connect_unix(unix_path, options.io_timeout_ms);
+    };
+
+    std::println("Replaying {} frames from {}{}", records->size(), trace_path,
+                 options.speed == 0 ? " (no pacing)" : "");
+    const auto stats = vsocky::replay_trace(*records, connect, options);
+
+    std::println("Connections:  {} ({} failed)", stats.connections, stats.failed_connections);
+    std::println("Sent:         {} frames, {} bytes ({} skipped)", stats.frames_sent, stats.bytes_sent,
+                 stats.frames_skipped);
+    std::println("Received:     {} frames, {} bytes", stats.frames_received, stats.bytes_received);
+    std::println("Duration:     {:.3f} s", static_cast<double>(stats.duration_ns) / 1e9);
+    if (options.speed > 0) {
+        std::println("Max lag:      {:.3f} ms behind schedule", static_cast<double>(stats.max_lag_ns) / 1e6);
+    }
+    return stats.failed_connections == 0 ? 0 : 2;
+}
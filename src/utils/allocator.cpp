@@ -0,0 +1,757 @@
+#include "vsocky/utils/allocator.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+#include <malloc.h>    // malloc_usable_size(), memalign()
+#include <pthread.h>   // pthread_key_create(), pthread_atfork()
+#include <sched.h>     // sched_yield()
+#include <sys/mman.h>  // mmap(), munmap()
+#include <unistd.h>    // sysconf()
+
+// glibc declares its allocator functions __THROW (noexcept in C++) and our
+// definitions must match; musl declares them without, and has no __THROW
+#ifndef __THROW
+#define __THROW
+#endif
+
+namespace vsocky {
+
+namespace {
+
+// =============================================================================
+// LAYOUT
+// =============================================================================
+// Every pointer we hand out sits less than span_bytes after a span_bytes
+// aligned header, so free() finds it with one mask:
+//
+//   small:  [header | obj | obj | obj | ...]         one span, one class
+//   large:  [header | (alignment pad) | object....]  one mmap per object
+//
+// (p - 1) rather than p: a large object may start exactly span_bytes after
+// its header (alignment >= span_bytes).
+// =============================================================================
+constexpr size_t span_bytes = size_t{256} * 1024;
+constexpr uintptr_t span_mask = span_bytes - 1;
+constexpr size_t header_bytes = 64;  // Keeps objects up to 64-byte aligned
+constexpr size_t min_alignment = 16;
+constexpr size_t max_small = size_t{32} * 1024;
+constexpr size_t class_count = 40;
+constexpr size_t chunk_bytes = size_t{4} * 1024 * 1024;  // Spans are carved from these
+constexpr uint32_t large_class = UINT32_MAX;
+// Empty spans kept ready for any class; past this many, an emptied span's
+// pages go back to the kernel (it stays mapped, for reuse)
+constexpr size_t resident_empty_spans = 16;
+
+// A free object: the first word links to the next one
+struct free_object {
+    free_object* next;
+};
+
+struct span_header {
+    uint32_t size_class;  // large_class for a large object
+
+    // Small only, under the class's central lock (span_lock while empty).
+    // Objects are carved from the span in order; in use = carved - free_count.
+    uint32_t carved;
+    uint32_t free_count;
+    bool released;       // Empty, and its pages were handed back
+    free_object* free;   // This span's freed objects
+    span_header* prev;   // In its class's list of spans with room
+    span_header* next;   // ...or in the list of empty spans
+
+    size_t mapping_bytes;  // Large only: length to munmap from the header
+    size_t usable;         // Large only: bytes after the user pointer
+};
+static_assert(sizeof(span_header) <= header_bytes);
+
+// 16, 32, ... 128, then four classes per power of two up to 32 KiB:
+// 160, 192, 224, 256, 320, 384, ...
+constexpr size_t class_size(size_t index) noexcept {
+    if (index < 8) {
+        return (index + 1) * 16;
+    }
+    const size_t base = size_t{128} << ((index - 8) / 4);
+    return base + ((index - 8) % 4 + 1) * (base / 4);
+}
+static_assert(class_size(class_count - 1) == max_small);
+
+// Smallest class that holds n bytes (n <= max_small)
+inline size_t class_index(size_t n) noexcept {
+    if (n <= 128) {
+        return n == 0 ? 0 : (n - 1) / 16;
+    }
+    const size_t log = 63 - static_cast<size_t>(__builtin_clzll(n - 1));  // 2^log < n <= 2^(log+1)
+    return 8 + (log - 7) * 4 + ((n - 1 - (size_t{1} << log)) >> (log - 2));
+}
+
+// Objects moved between a thread cache and the central list at once; a
+// thread cache holds at most two batches per class
+constexpr uint32_t batch_size(size_t index) noexcept {
+    return static_cast<uint32_t>(std::clamp<size_t>(32 * 1024 / class_size(index), 2, 64));
+}
+
+// Held for a handful of pointer operations, so spinning beats sleeping.
+// A plain flag (not a pthread mutex) so a forked child can just reset it.
+class spin_lock {
+public:
+    void lock() noexcept {
+        for (unsigned spins = 0; locked_.exchange(true, std::memory_order_acquire); ++spins) {
+            while (locked_.load(std::memory_order_relaxed)) {
+                if (++spins > 64) {
+                    ::sched_yield();
+                }
+            }
+        }
+    }
+    void unlock() noexcept {
+        locked_.store(false, std::memory_order_release);
+    }
+    void reset() noexcept {
+        locked_.store(false, std::memory_order_relaxed);
+    }
+
+private:
+    std::atomic<bool> locked_{false};
+};
+
+class spin_guard {
+public:
+    explicit spin_guard(spin_lock& lock) noexcept : lock_(lock) {
+        lock_.lock();
+    }
+    ~spin_guard() {
+        lock_.unlock();
+    }
+    spin_guard(const spin_guard&) = delete;
+    spin_guard& operator=(const spin_guard&) = delete;
+
+private:
+    spin_lock& lock_;
+};
+
+// Spans of one class with an object to spare (freed or not carved yet).
+// A full span is on no list; the first object freed back puts it here, the
+// last one takes it off again for the empty spans.
+struct alignas(64) central_list {
+    spin_lock lock;
+    span_header* spans = nullptr;
+};
+
+// Per-thread free lists; trivial, so thread_local costs nothing to set up
+struct thread_cache {
+    free_object* head[class_count];
+    uint32_t count[class_count];
+    bool registered;  // Will be flushed at thread exit (pthread key destructor)
+    bool dead;        // Already flushed, the thread is exiting: don't cache
+};
+
+constinit central_list central[class_count];
+constinit thread_local thread_cache cache{};
+
+constinit spin_lock span_lock;
+constinit char* chunk_next = nullptr;
+constinit char* chunk_end = nullptr;
+constinit span_header* empty_spans = nullptr;  // Reused before carving the chunk
+constinit size_t resident_empty = 0;           // ...that still have their pages
+
+// Recently freed large objects (up to large_cache_max_bytes, no extra
+// alignment), kept for reuse: a vector growing past 32 KiB would otherwise
+// cost an mmap and a munmap per reallocation
+constexpr size_t large_cache_slots = 16;
+constexpr size_t large_cache_max_bytes = size_t{1} << 20;
+constinit spin_lock large_lock;
+constinit span_header* large_cache[large_cache_slots] = {};
+constinit size_t large_cache_next = 0;  // Slot to evict when all are taken
+
+constinit std::atomic<size_t> mapped_span_bytes{0};
+constinit std::atomic<size_t> released_span_bytes{0};
+constinit std::atomic<size_t> live_large_bytes{0};
+constinit std::atomic<size_t> live_large_count{0};
+
+// 0 = not started, 1 = in progress, 2 = done
+constinit std::atomic<int> init_state{0};
+pthread_key_t cache_key;
+
+size_t page_size() noexcept {
+    static const size_t size = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+    return size;
+}
+
+constexpr uintptr_t align_up(uintptr_t value, size_t alignment) noexcept {
+    return (value + alignment - 1) & ~(static_cast<uintptr_t>(alignment) - 1);
+}
+
+// Objects of class index that fit in a span after the header
+constexpr uint32_t span_capacity(size_t index) noexcept {
+    return static_cast<uint32_t>((span_bytes - header_bytes) / class_size(index));
+}
+
+inline span_header* header_of(const void* p) noexcept {
+    return reinterpret_cast<span_header*>((reinterpret_cast<uintptr_t>(p) - 1) & ~span_mask);
+}
+
+void link_span(span_header*& head, span_header* span) noexcept {
+    span->prev = nullptr;
+    span->next = head;
+    if (head != nullptr) {
+        head->prev = span;
+    }
+    head = span;
+}
+
+void unlink_span(span_header*& head, span_header* span) noexcept {
+    if (span->prev != nullptr) {
+        span->prev->next = span->next;
+    } else {
+        head = span->next;
+    }
+    if (span->next != nullptr) {
+        span->next->prev = span->prev;
+    }
+}
+
+void retire_span(span_header* span) noexcept;
+
+// =============================================================================
+// FORK AND THREAD EXIT
+// =============================================================================
+// fork() copies whatever locks other threads hold at that moment, and a
+// child that then allocates (before exec, say) would wait forever. So
+// every lock is taken around fork(), in the same order refill() nests them.
+// =============================================================================
+void before_fork() noexcept {
+    for (auto& list : central) {
+        list.lock.lock();
+    }
+    span_lock.lock();
+    large_lock.lock();
+}
+
+void after_fork_parent() noexcept {
+    large_lock.unlock();
+    span_lock.unlock();
+    for (auto& list : central) {
+        list.lock.unlock();
+    }
+}
+
+void after_fork_child() noexcept {
+    large_lock.reset();
+    span_lock.reset();
+    for (auto& list : central) {
+        list.lock.reset();
+    }
+}
+
+// Give the chain starting at first (nullptr-terminated) back to the spans
+// its objects came from. Spans it empties are retired once the class lock
+// is dropped.
+void spill(size_t index, free_object* first) noexcept {
+    const uint32_t capacity = span_capacity(index);
+    central_list& list = central[index];
+    span_header* emptied = nullptr;
+    {
+        spin_guard guard(list.lock);
+        while (first != nullptr) {
+            free_object* obj = first;
+            first = obj->next;
+            span_header* span = header_of(obj);
+            if (span->free_count == 0 && span->carved == capacity) {
+                link_span(list.spans, span);  // Was full
+            }
+            obj->next = span->free;
+            span->free = obj;
+            if (++span->free_count == span->carved) {
+                unlink_span(list.spans, span);
+                span->next = emptied;
+                emptied = span;
+            }
+        }
+    }
+    while (emptied != nullptr) {
+        span_header* span = emptied;
+        emptied = span->next;
+        retire_span(span);
+    }
+}
+
+void flush_cache(void* arg) noexcept {
+    auto* tc = static_cast<thread_cache*>(arg);
+    for (size_t i = 0; i < class_count; ++i) {
+        if (free_object* first = tc->head[i]) {
+            spill(i, first);
+            tc->head[i] = nullptr;
+            tc->count[i] = 0;
+        }
+    }
+    // Later frees on this thread (other TLS destructors) go straight to the
+    // central lists
+    tc->registered = false;
+    tc->dead = true;
+}
+
+void ensure_init() noexcept {
+    if (init_state.load(std::memory_order_acquire) == 2) {
+        return;
+    }
+    int expected = 0;
+    if (init_state.compare_exchange_strong(expected, 1, std::memory_order_acq_rel)) {
+        ::pthread_key_create(&cache_key, flush_cache);
+        init_state.store(2, std::memory_order_release);
+        // Last: musl's pthread_atfork() calls malloc, which must find us ready
+        ::pthread_atfork(before_fork, after_fork_parent, after_fork_child);
+        return;
+    }
+    while (init_state.load(std::memory_order_acquire) != 2) {
+        ::sched_yield();
+    }
+}
+
+void register_cache(thread_cache& tc) noexcept {
+    ensure_init();
+    tc.registered = true;
+    ::pthread_setspecific(cache_key, &tc);
+}
+
+// =============================================================================
+// SPANS AND LARGE OBJECTS
+// =============================================================================
+
+// mmap size bytes aligned to alignment (trimming the slack)
+char* map_aligned(size_t size, size_t alignment) noexcept {
+    void* raw = ::mmap(nullptr, size + alignment, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (raw == MAP_FAILED) {
+        return nullptr;
+    }
+    const auto begin = reinterpret_cast<uintptr_t>(raw);
+    const uintptr_t aligned = align_up(begin, alignment);
+    if (aligned != begin) {
+        ::munmap(raw, aligned - begin);
+    }
+    if (const size_t tail = begin + alignment - aligned; tail != 0) {
+        ::munmap(reinterpret_cast<void*>(aligned + size), tail);
+    }
+    return reinterpret_cast<char*>(aligned);
+}
+
+// What an empty span gives back: everything past the page holding its
+// header (16K or 64K on many aarch64 kernels, so not a constant). 0 if the
+// page is the whole span.
+size_t releasable_bytes() noexcept {
+    return page_size() < span_bytes ? span_bytes - page_size() : 0;
+}
+
+// A span for class index, empty, header filled in (call with span_lock
+// free). An emptied one if there is any, else the next of the chunk.
+span_header* new_span(size_t index) noexcept {
+    span_header* span;
+    {
+        spin_guard guard(span_lock);
+        if (empty_spans != nullptr) {
+            span = empty_spans;
+            empty_spans = span->next;
+            if (span->released) {
+                // Touching it again faults in zero pages
+                released_span_bytes.fetch_sub(releasable_bytes(), std::memory_order_relaxed);
+            } else {
+                --resident_empty;
+            }
+        } else {
+            if (chunk_next == chunk_end) {
+                chunk_next = map_aligned(chunk_bytes, span_bytes);
+                if (chunk_next == nullptr) {
+                    chunk_end = nullptr;
+                    return nullptr;
+                }
+                chunk_end = chunk_next + chunk_bytes;
+                mapped_span_bytes.fetch_add(chunk_bytes, std::memory_order_relaxed);
+            }
+            span = reinterpret_cast<span_header*>(chunk_next);
+            chunk_next += span_bytes;
+        }
+    }
+    span->size_class = static_cast<uint32_t>(index);
+    span->carved = 0;
+    span->free_count = 0;
+    span->released = false;
+    span->free = nullptr;
+    return span;
+}
+
+// Every object of span is free again: keep it for any class to reuse. The
+// first resident_empty_spans stay as they are; past those, the pages go
+// back to the kernel first (madvise, outside the lock - the span isn't on
+// any list until it's done). If there's nothing to give or madvise fails,
+// it stays resident and isn't counted as released.
+void retire_span(span_header* span) noexcept {
+    bool keep = false;
+    {
+        spin_guard guard(span_lock);
+        keep = resident_empty < resident_empty_spans;
+    }
+    const size_t releasable = releasable_bytes();
+    bool released = false;
+    if (!keep && releasable != 0) {
+        released = ::madvise(reinterpret_cast<char*>(span) + (span_bytes - releasable), releasable,
+                             MADV_DONTNEED) == 0;
+    }
+    if (released) {
+        released_span_bytes.fetch_add(releasable, std::memory_order_relaxed);
+    }
+    spin_guard guard(span_lock);
+    if (!released) {
+        ++resident_empty;
+    }
+    span->released = released;
+    span->next = empty_spans;
+    empty_spans = span;
+}
+
+// Smallest cached object that holds n bytes without wasting half of it
+span_header* take_cached_large(size_t n) noexcept {
+    spin_guard guard(large_lock);
+    span_header** best = nullptr;
+    for (auto& slot : large_cache) {
+        if (slot != nullptr && slot->usable >= n && slot->usable / 2 <= n &&
+            (best == nullptr || slot->usable < (*best)->usable)) {
+            best = &slot;
+        }
+    }
+    if (best == nullptr) {
+        return nullptr;
+    }
+    span_header* header = *best;
+    *best = nullptr;
+    return header;
+}
+
+// Keep header for reuse; returns the one it displaced (to be unmapped), if any.
+// Full slots are recycled round-robin, so the cache follows recent sizes.
+span_header* cache_large(span_header* header) noexcept {
+    spin_guard guard(large_lock);
+    for (auto& slot : large_cache) {
+        if (slot == nullptr) {
+            slot = header;
+            return nullptr;
+        }
+    }
+    span_header* evicted = large_cache[large_cache_next];
+    large_cache[large_cache_next] = header;
+    large_cache_next = (large_cache_next + 1) % large_cache_slots;
+    return evicted;
+}
+
+void* allocate_large(size_t n, size_t alignment, bool zero = false) noexcept {
+    if (alignment <= header_bytes && n <= large_cache_max_bytes) {
+        if (span_header* h = take_cached_large(n)) {
+            live_large_bytes.fetch_add(h->mapping_bytes, std::memory_order_relaxed);
+            live_large_count.fetch_add(1, std::memory_order_relaxed);
+            char* object = reinterpret_cast<char*>(h) + header_bytes;
+            if (zero) {
+                std::memset(object, 0, n);
+            }
+            return object;
+        }
+    }
+
+    // A fresh mapping is zero already
+    const size_t page = page_size();
+    alignment = std::max(alignment, min_alignment);
+    // Header to object distance: enough for the header and the alignment
+    const size_t offset = std::clamp(alignment, header_bytes, span_bytes);
+    const size_t slack = std::max(alignment, span_bytes) + span_bytes;
+    if (n > SIZE_MAX / 2 - slack) {
+        errno = ENOMEM;
+        return nullptr;
+    }
+    const size_t reserve = align_up(n + slack, page);
+
+    void* raw = ::mmap(nullptr, reserve, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (raw == MAP_FAILED) {
+        errno = ENOMEM;
+        return nullptr;
+    }
+    const auto begin = reinterpret_cast<uintptr_t>(raw);
+    uintptr_t header;
+    uintptr_t object;
+    if (alignment <= span_bytes) {
+        header = align_up(begin, span_bytes);
+        object = header + offset;
+    } else {
+        object = align_up(begin + span_bytes, alignment);
+        header = object - span_bytes;
+    }
+    const uintptr_t end = align_up(object + n, page);
+    if (header != begin) {
+        ::munmap(raw, header - begin);
+    }
+    if (end != begin + reserve) {
+        ::munmap(reinterpret_cast<void*>(end), begin + reserve - end);
+    }
+
+    auto* h = reinterpret_cast<span_header*>(header);
+    h->size_class = large_class;
+    h->mapping_bytes = end - header;
+    h->usable = end - object;
+    live_large_bytes.fetch_add(h->mapping_bytes, std::memory_order_relaxed);
+    live_large_count.fetch_add(1, std::memory_order_relaxed);
+    return reinterpret_cast<void*>(object);
+}
+
+// =============================================================================
+// SMALL OBJECTS
+// =============================================================================
+
+// Cache empty: take a batch from the class's spans (freed objects first,
+// then carving new ones, then a new span), keep all but one in the thread
+// cache, return that one
+[[gnu::noinline]] void* refill(size_t index) noexcept {
+    thread_cache& tc = cache;
+    if (!tc.registered && !tc.dead) {
+        register_cache(tc);
+    }
+    const uint32_t want = tc.dead ? 1 : batch_size(index);
+    const size_t size = class_size(index);
+    const uint32_t capacity = span_capacity(index);
+
+    free_object* head = nullptr;
+    uint32_t got = 0;
+    central_list& list = central[index];
+    {
+        spin_guard guard(list.lock);
+        while (got < want) {
+            span_header* span = list.spans;
+            if (span == nullptr) {
+                span = new_span(index);
+                if (span == nullptr) {
+                    break;
+                }
+                link_span(list.spans, span);
+            }
+            free_object* obj;
+            if (span->free != nullptr) {
+                obj = span->free;
+                span->free = obj->next;
+                --span->free_count;
+            } else {
+                obj = reinterpret_cast<free_object*>(reinterpret_cast<char*>(span) + header_bytes +
+                                                     span->carved * size);
+                ++span->carved;
+            }
+            if (span->free == nullptr && span->carved == capacity) {
+                unlink_span(list.spans, span);  // Full
+            }
+            obj->next = head;
+            head = obj;
+            ++got;
+        }
+    }
+
+    if (head == nullptr) {
+        errno = ENOMEM;
+        return nullptr;
+    }
+    tc.head[index] = head->next;
+    tc.count[index] = got - 1;
+    return head;
+}
+
+// Cache over its limit: hand one batch back
+[[gnu::noinline]] void spill_batch(thread_cache& tc, size_t index) noexcept {
+    const uint32_t batch = batch_size(index);
+    free_object* first = tc.head[index];
+    free_object* last = first;
+    for (uint32_t i = 1; i < batch; ++i) {
+        last = last->next;
+    }
+    tc.head[index] = last->next;
+    tc.count[index] -= batch;
+    last->next = nullptr;
+    spill(index, first);
+}
+
+inline void* allocate_class(size_t index) noexcept {
+    thread_cache& tc = cache;
+    if (free_object* obj = tc.head[index]) {
+        tc.head[index] = obj->next;
+        --tc.count[index];
+        return obj;
+    }
+    return refill(index);
+}
+
+inline void* allocate(size_t n) noexcept {
+    if (n <= max_small) [[likely]] {
+        return allocate_class(class_index(n));
+    }
+    return allocate_large(n, min_alignment);
+}
+
+void* allocate_aligned(size_t alignment, size_t n) noexcept {
+    if (alignment <= min_alignment) {
+        return allocate(n);
+    }
+    // Objects sit at header_bytes + k * size in a span, so a class whose
+    // size is a multiple of the alignment gives aligned objects
+    if (alignment <= header_bytes && n <= max_small) {
+        const size_t rounded = align_up(std::max<size_t>(n, 1), alignment);
+        for (size_t index = class_index(rounded); index < class_count; ++index) {
+            if (class_size(index) % alignment == 0) {
+                return allocate_class(index);
+            }
+        }
+    }
+    return allocate_large(n, alignment);
+}
+
+inline void release(void* p) noexcept {
+    if (p == nullptr) {
+        return;
+    }
+    span_header* header = header_of(p);
+    if (header->size_class == large_class) [[unlikely]] {
+        live_large_bytes.fetch_sub(header->mapping_bytes, std::memory_order_relaxed);
+        live_large_count.fetch_sub(1, std::memory_order_relaxed);
+        const bool cacheable = static_cast<char*>(p) == reinterpret_cast<char*>(header) + header_bytes &&
+                               header->usable <= large_cache_max_bytes;
+        if (span_header* unmap = cacheable ? cache_large(header) : header) {
+            ::munmap(unmap, unmap->mapping_bytes);
+        }
+        return;
+    }
+
+    const size_t index = header->size_class;
+    auto* obj = static_cast<free_object*>(p);
+    thread_cache& tc = cache;
+    if (!tc.registered) [[unlikely]] {
+        if (tc.dead) {
+            obj->next = nullptr;
+            spill(index, obj);
+            return;
+        }
+        register_cache(tc);
+    }
+    obj->next = tc.head[index];
+    tc.head[index] = obj;
+    if (++tc.count[index] > 2 * batch_size(index)) [[unlikely]] {
+        spill_batch(tc, index);
+    }
+}
+
+inline size_t usable_size(const void* p) noexcept {
+    const span_header* header = header_of(p);
+    return header->size_class == large_class ? header->usable : class_size(header->size_class);
+}
+
+bool is_power_of_two(size_t value) noexcept {
+    return value != 0 && (value & (value - 1)) == 0;
+}
+
+} // anonymous namespace
+
+allocator_stats bundled_allocator_stats() noexcept {
+    return {
+        .span_bytes = mapped_span_bytes.load(std::memory_order_relaxed),
+        .released_span_bytes = released_span_bytes.load(std::memory_order_relaxed),
+        .large_bytes = live_large_bytes.load(std::memory_order_relaxed),
+        .large_allocations = live_large_count.load(std::memory_order_relaxed),
+    };
+}
+
+} // namespace vsocky
+
+// =============================================================================
+// THE C INTERFACE
+// =============================================================================
+// Linked statically, these definitions win over libc's, and libc's own
+// internal allocations (stdio buffers, pthread_atfork, ...) land here too.
+// Everything that can allocate or free is replaced, so no pointer from the
+// libc allocator ever reaches our free().
+// =============================================================================
+
+extern "C" {
+
+void* malloc(size_t n) __THROW {
+    return vsocky::allocate(n);
+}
+
+void free(void* p) __THROW {
+    vsocky::release(p);
+}
+
+void* calloc(size_t count, size_t size) __THROW {
+    size_t total;
+    if (__builtin_mul_overflow(count, size, &total)) {
+        errno = ENOMEM;
+        return nullptr;
+    }
+    if (total > vsocky::max_small) {
+        return vsocky::allocate_large(total, vsocky::min_alignment, true);
+    }
+    void* p = vsocky::allocate(total);
+    if (p != nullptr) {
+        std::memset(p, 0, total);
+    }
+    return p;
+}
+
+void* realloc(void* p, size_t n) __THROW {
+    if (p == nullptr) {
+        return vsocky::allocate(n);
+    }
+    const size_t usable = vsocky::usable_size(p);
+    // Still fits and not much smaller: keep it
+    if (n <= usable && n >= usable / 2) {
+        return p;
+    }
+    void* moved = vsocky::allocate(n);
+    if (moved != nullptr) {
+        std::memcpy(moved, p, std::min(n, usable));
+        vsocky::release(p);
+    }
+    return moved;
+}
+
+void* aligned_alloc(size_t alignment, size_t n) __THROW {
+    if (!vsocky::is_power_of_two(alignment)) {
+        errno = EINVAL;
+        return nullptr;
+    }
+    return vsocky::allocate_aligned(alignment, n);
+}
+
+void* memalign(size_t alignment, size_t n) __THROW {
+    return aligned_alloc(alignment, n);
+}
+
+int posix_memalign(void** out, size_t alignment, size_t n) __THROW {
+    if (!vsocky::is_power_of_two(alignment) || alignment % sizeof(void*) != 0) {
+        return EINVAL;
+    }
+    void* p = vsocky::allocate_aligned(alignment, n);
+    if (p == nullptr) {
+        return ENOMEM;
+    }
+    *out = p;
+    return 0;
+}
+
+void* valloc(size_t n) __THROW {
+    return vsocky::allocate_aligned(vsocky::page_size(), n);
+}
+
+void* pvalloc(size_t n) __THROW {
+    const size_t page = vsocky::page_size();
+    return vsocky::allocate_aligned(page, vsocky::align_up(n, page));
+}
+
+size_t malloc_usable_size(void* p) __THROW {
+    return p == nullptr ? 0 : vsocky::usable_size(p);
+}
+
+} // extern "C"
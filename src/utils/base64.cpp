@@ -257,6 +257,52 @@ base64_decode(std::string_view encoded) {
     return result;
 }
 
+std::expected<size_t, std::error_code>
+base64_decoder::decode(std::string_view text, std::span<uint8_t> out) noexcept {
+    if (failed_ || out.size() < max_output(text.size())) {
+        failed_ = true;
+        return std::unexpected(make_error_code(error_code::invalid_base64_encoding));
+    }
+
+    size_t written = 0;
+    for (const char c : text) {
+        const int8_t value = decode_table[static_cast<unsigned char>(c)];
+        // Nothing may follow the padded quantum; '=' only in its last two slots
+        if (value == -1 || padded_ || (value == -2 && carried_ < 2) ||
+            (value != -2 && carried_ == 3 && carry_[2] == -2)) {
+            failed_ = true;
+            return std::unexpected(make_error_code(error_code::invalid_base64_encoding));
+        }
+        carry_[carried_++] = value;
+        if (carried_ < 4) {
+            continue;
+        }
+
+        // Same reassembly as base64_decode(), one quantum at a time
+        const uint32_t triple = (static_cast<uint32_t>(carry_[0]) << 18) |
+                                (static_cast<uint32_t>(carry_[1]) << 12) |
+                                (static_cast<uint32_t>(carry_[2] == -2 ? 0 : carry_[2]) << 6) |
+                                 static_cast<uint32_t>(carry_[3] == -2 ? 0 : carry_[3]);
+        out[written++] = static_cast<uint8_t>(triple >> 16);
+        if (carry_[2] != -2) {
+            out[written++] = static_cast<uint8_t>(triple >> 8);
+        }
+        if (carry_[3] != -2) {
+            out[written++] = static_cast<uint8_t>(triple);
+        }
+        padded_ = carry_[3] == -2;
+        carried_ = 0;
+    }
+    return written;
+}
+
+std::error_code base64_decoder::finish() const noexcept {
+    if (failed_ || carried_ != 0) {
+        return error_code::invalid_base64_encoding;
+    }
+    return error_code::success;
+}
+
 std::expected<std::string, std::error_code>
 base64_decode_string(std::string_view encoded) {
     auto decoded = base64_decode(encoded);
@@ -0,0 +1,232 @@
+#include "vsocky/utils/config.hpp"
+#include "vsocky/utils/error.hpp"
+
+#include <charconv>
+#include <fstream>
+#include <limits>
+#include <optional>
+#include <span>
+#include <sstream>
+
+namespace vsocky {
+
+namespace {
+
+// =============================================================================
+// KEY TABLE
+// =============================================================================
+// One row per config key. A captureless lambda converts to a plain function
+// pointer, so the whole table is constexpr and lives in .rodata.
+//
+// - byte_suffix: value may use K/M/G suffixes (sizes in bytes)
+// - max: sanity bound, mostly to catch unit mix-ups ("5000" meant as seconds)
+// - words: if set, the value is one of these and assign() gets its index
+// =============================================================================
+struct key_spec {
+    std::string_view name;
+    bool byte_suffix;
+    uint64_t max;
+    void (*assign)(server_config&, uint64_t);
+    std::span<const std::string_view> words = {};
+};
+
+constexpr uint64_t KiB = 1024;
+constexpr uint64_t MiB = 1024 * KiB;
+constexpr uint64_t GiB = 1024 * MiB;
+
+// In job_sched_policy order
+constexpr std::string_view sched_policy_words[] = {"normal", "batch", "idle"};
+
+constexpr key_spec keys[] = {
+    {"warm_pool_size", false, 1024,
+     [](server_config& c, uint64_t v) { c.warm_pool_size = v; }},
+    {"workspace_pool_size", false, 1024,
+     [](server_config& c, uint64_t v) { c.workspace_pool_size = v; }},
+    {"max_message_size", true, 1 * GiB,
+     [](server_config& c, uint64_t v) { c.max_message_size = v; }},
+    {"max_concurrent_jobs", false, 4096,
+     [](server_config& c, uint64_t v) { c.max_concurrent_jobs = v; }},
+    {"default_time_limit_ms", false, 3'600'000,
+     [](server_config& c, uint64_t v) { c.default_time_limit_ms = static_cast<uint32_t>(v); }},
+    {"default_memory_limit_bytes", true, 64 * GiB,
+     [](server_config& c, uint64_t v) { c.default_memory_limit_bytes = v; }},
+    {"max_output_bytes", true, 1 * GiB,
+     [](server_config& c, uint64_t v) { c.max_output_bytes = v; }},
+    {"compile_cache_bytes", true, 1024 * GiB,
+     [](server_config& c, uint64_t v) { c.compile_cache_bytes = v; }},
+    {"worker_count", false, 1024,
+     [](server_config& c, uint64_t v) { c.worker_count = v; }},
+    {"server_cpus", false, CPU_SETSIZE,
+     [](server_config& c, uint64_t v) { c.server_cpus = v; }},
+    {"job_sched", false, 2,
+     [](server_config& c, uint64_t v) { c.job_sched = static_cast<job_sched_policy>(v); },
+     sched_policy_words},
+};
+
+// Index of text in words; nullopt if it isn't one of them
+std::optional<uint64_t> parse_word(std::string_view text, std::span<const std::string_view> words) noexcept {
+    for (size_t i = 0; i < words.size(); ++i) {
+        if (words[i] == text) {
+            return i;
+        }
+    }
+    return std::nullopt;
+}
+
+std::string_view trim(std::string_view s) noexcept {
+    const auto first = s.find_first_not_of(" \t\r");
+    if (first == std::string_view::npos) {
+        return {};
+    }
+    const auto last = s.find_last_not_of(" \t\r");
+    return s.substr(first, last - first + 1);
+}
+
+// Parse "123", or "64M" when suffixes are allowed; nullopt on any error
+std::optional<uint64_t> parse_number(std::string_view text, bool byte_suffix) noexcept {
+    uint64_t value = 0;
+    auto [end, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+    if (ec != std::errc{} || end == text.data()) {
+        return std::nullopt;
+    }
+
+    std::string_view rest(end, static_cast<size_t>(text.data() + text.size() - end));
+    if (rest.empty()) {
+        return value;
+    }
+    if (!byte_suffix || rest.size() != 1) {
+        return std::nullopt;
+    }
+
+    uint64_t multiplier = 0;
+    switch (rest[0]) {
+        case 'K': case 'k': multiplier = KiB; break;
+        case 'M': case 'm': multiplier = MiB; break;
+        case 'G': case 'g': multiplier = GiB; break;
+        default: return std::nullopt;
+    }
+    if (value > std::numeric_limits<uint64_t>::max() / multiplier) {
+        return std::nullopt;  // Overflow
+    }
+    return value * multiplier;
+}
+
+} // anonymous namespace
+
+std::expected<server_config, std::error_code>
+parse_config(std::string_view text, std::string* detail) {
+    server_config config;
+    bool sched_given = false;
+
+    auto fail = [&](size_t line_no, std::string_view what) {
+        if (detail != nullptr) {
+            *detail = "line " + std::to_string(line_no) + ": " + std::string(what);
+        }
+        return std::unexpected(make_error_code(error_code::invalid_field_value));
+    };
+
+    size_t line_no = 0;
+    while (!text.empty()) {
+        ++line_no;
+        const auto newline = text.find('\n');
+        std::string_view line = text.substr(0, newline);
+        text = newline == std::string_view::npos ? std::string_view{} : text.substr(newline + 1);
+
+        // Strip comments, then whitespace
+        line = trim(line.substr(0, line.find('#')));
+        if (line.empty()) {
+            continue;
+        }
+
+        const auto equals = line.find('=');
+        if (equals == std::string_view::npos) {
+            return fail(line_no, "expected 'key = value'");
+        }
+        const auto key = trim(line.substr(0, equals));
+        const auto value_text = trim(line.substr(equals + 1));
+
+        const key_spec* spec = nullptr;
+        for (const auto& candidate : keys) {
+            if (candidate.name == key) {
+                spec = &candidate;
+                break;
+            }
+        }
+        if (spec == nullptr) {
+            return fail(line_no, "unknown key '" + std::string(key) + "'");
+        }
+
+        const auto value = spec->words.empty() ? parse_number(value_text, spec->byte_suffix)
+                                               : parse_word(value_text, spec->words);
+        if (!value) {
+            return fail(line_no, "invalid value for '" + std::string(key) + "'");
+        }
+        if (*value > spec->max) {
+            return fail(line_no, "value for '" + std::string(key) + "' is too large");
+        }
+        spec->assign(config, *value);
+        sched_given = sched_given || spec->name == "job_sched";
+    }
+
+    // Without SCHED_BATCH a waking job still preempts the server wherever
+    // the two share a vCPU (all of them if partition_cpus() can't split)
+    if (config.server_cpus != 0 && !sched_given) {
+        config.job_sched = job_sched_policy::batch;
+    }
+    return config;
+}
+
+std::expected<server_config, std::error_code>
+load_config_file(const std::string& path, std::string* detail) {
+    std::ifstream file(path);
+    if (!file) {
+        if (detail != nullptr) {
+            *detail = "cannot open " + path;
+        }
+        return std::unexpected(make_error_code(error_code::resource_unavailable));
+    }
+
+    std::ostringstream contents;
+    contents << file.rdbuf();
+    return parse_config(contents.str(), detail);
+}
+
+// =============================================================================
+// config_store
+// =============================================================================
+
+config_store::config_store(server_config initial)
+    : current_(new server_config(initial)) {}
+
+config_store::~config_store() noexcept {
+    // No readers can exist any more - free the current version too
+    delete current_.load(std::memory_order_acquire);
+}
+
+void config_store::publish(const server_config& next) {
+    // Allocate and fill the new version BEFORE it becomes visible
+    auto fresh = std::make_unique<const server_config>(next);
+
+    std::lock_guard lock(writer_mutex_);
+    retired_.reserve(retired_.size() + 1);  // Can't throw after the swap
+
+    // =========================================================================
+    // THE SWAP
+    // =========================================================================
+    // memory_order_acq_rel: the release half makes the fully-built config
+    // visible to readers that acquire-load current_; the acquire half gives
+    // us the old pointer so we can retire it.
+    // =========================================================================
+    const server_config* old = current_.exchange(fresh.release(), std::memory_order_acq_rel);
+    retired_.emplace_back(old);
+    generation_.fetch_add(1, std::memory_order_release);
+}
+
+size_t config_store::reclaim() noexcept {
+    std::lock_guard lock(writer_mutex_);
+    const size_t freed = retired_.size();
+    retired_.clear();
+    return freed;
+}
+
+} // namespace vsocky
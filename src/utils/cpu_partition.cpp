@@ -0,0 +1,73 @@
+#include "vsocky/utils/cpu_partition.hpp"
+#include "vsocky/utils/error.hpp"
+
+namespace vsocky {
+
+std::expected<cpu_partition, std::error_code> partition_cpus(size_t server_cpus) noexcept {
+    if (server_cpus == 0) {
+        return std::unexpected(make_error_code(error_code::invalid_field_value));
+    }
+
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (::sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+        return std::unexpected(make_error_code(error_code::resource_unavailable));
+    }
+
+    cpu_partition partition;
+    if (static_cast<size_t>(CPU_COUNT(&allowed)) <= server_cpus) {
+        partition.server = allowed;
+        partition.jobs = allowed;
+        partition.shared = true;
+        return partition;
+    }
+
+    CPU_ZERO(&partition.server);
+    CPU_ZERO(&partition.jobs);
+    size_t taken = 0;
+    for (size_t cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+        if (!CPU_ISSET(cpu, &allowed)) {
+            continue;
+        }
+        if (taken < server_cpus) {
+            CPU_SET(cpu, &partition.server);
+            ++taken;
+        } else {
+            CPU_SET(cpu, &partition.jobs);
+        }
+    }
+    return partition;
+}
+
+std::error_code pin_current_thread(const cpu_set_t& cpus) noexcept {
+    // pid 0 = the calling thread, not the whole process
+    if (::sched_setaffinity(0, sizeof(cpus), &cpus) != 0) {
+        return error_code::resource_unavailable;
+    }
+    return error_code::success;
+}
+
+std::string format_cpu_list(const cpu_set_t& cpus) {
+    std::string text;
+    for (size_t cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+        if (!CPU_ISSET(cpu, &cpus)) {
+            continue;
+        }
+        size_t last = cpu;
+        while (last + 1 < CPU_SETSIZE && CPU_ISSET(last + 1, &cpus)) {
+            ++last;
+        }
+        if (!text.empty()) {
+            text += ',';
+        }
+        text += std::to_string(cpu);
+        if (last != cpu) {
+            text += '-';
+            text += std::to_string(last);
+        }
+        cpu = last;
+    }
+    return text;
+}
+
+} // namespace vsocky
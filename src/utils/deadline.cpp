@@ -0,0 +1,72 @@
+#include "vsocky/utils/deadline.hpp"
+
+#include <algorithm>
+#include <limits>
+
+#include <time.h>  // clock_gettime()
+
+namespace vsocky {
+
+namespace {
+
+uint64_t read_clock_ns(clockid_t clock) noexcept {
+    timespec ts{};
+    ::clock_gettime(clock, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1'000'000'000 + static_cast<uint64_t>(ts.tv_nsec);
+}
+
+// a + b, clamped instead of wrapping (budgets come off the wire)
+uint64_t saturating_add(uint64_t a, uint64_t b) noexcept {
+    return b > std::numeric_limits<uint64_t>::max() - a ? std::numeric_limits<uint64_t>::max() : a + b;
+}
+
+uint64_t ms_to_ns(uint64_t ms) noexcept {
+    return ms > std::numeric_limits<uint64_t>::max() / 1'000'000 ? std::numeric_limits<uint64_t>::max()
+                                                                 : ms * 1'000'000;
+}
+
+} // anonymous namespace
+
+uint64_t monotonic_now_ns() noexcept {
+    return read_clock_ns(CLOCK_MONOTONIC);
+}
+
+uint64_t unix_now_ms() noexcept {
+    return read_clock_ns(CLOCK_REALTIME) / 1'000'000;
+}
+
+uint64_t resolve_deadline(const request_timing& timing, uint64_t received_ns,
+                          uint64_t received_unix_ms) noexcept {
+    uint64_t deadline = 0;
+    const auto take = [&](uint64_t candidate) {
+        // 0 is "none" - an absurdly early deadline still has to read as expired
+        candidate = std::max<uint64_t>(candidate, 1);
+        deadline = deadline == 0 ? candidate : std::min(deadline, candidate);
+    };
+
+    if (timing.budget_ms) {
+        take(saturating_add(received_ns, ms_to_ns(*timing.budget_ms)));
+    }
+    if (timing.deadline_unix_ms) {
+        if (*timing.deadline_unix_ms <= received_unix_ms) {
+            take(received_ns);
+        } else {
+            take(saturating_add(received_ns, ms_to_ns(*timing.deadline_unix_ms - received_unix_ms)));
+        }
+    }
+    return deadline;
+}
+
+uint32_t cap_to_deadline(uint32_t limit_ms, uint64_t deadline_ns, uint64_t now_ns) noexcept {
+    if (deadline_ns == 0) {
+        return limit_ms;
+    }
+    const uint64_t left_ns = deadline_ns > now_ns ? deadline_ns - now_ns : 0;
+    const uint64_t left_ms = std::max<uint64_t>((left_ns + 999'999) / 1'000'000, 1);
+    if (limit_ms != 0 && limit_ms <= left_ms) {
+        return limit_ms;
+    }
+    return static_cast<uint32_t>(std::min<uint64_t>(left_ms, std::numeric_limits<uint32_t>::max()));
+}
+
+} // namespace vsocky
@@ -0,0 +1,223 @@
+#include "vsocky/utils/offload_pool.hpp"
+#include "vsocky/utils/error.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <filesystem>
+#include <new>
+
+#include <fcntl.h>         // open()
+#include <sys/eventfd.h>   // eventfd() for completions
+#include <sys/stat.h>      // mkdir()
+#include <unistd.h>        // read(), write(), close(), lchown()
+
+namespace vsocky {
+
+offload_pool::offload_pool(offload_options options) noexcept : options_(options) {
+    options_.threads = std::max<size_t>(options_.threads, 2);
+}
+
+offload_pool::~offload_pool() noexcept {
+    stop();
+    if (event_fd_ != -1) {
+        ::close(event_fd_);
+    }
+}
+
+std::error_code offload_pool::start() noexcept {
+    if (!workers_.empty()) {
+        return error_code::success;
+    }
+
+    if (event_fd_ == -1) {
+        // Non-blocking: drain() reads it from the reactor, which must not block
+        event_fd_ = ::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+        if (event_fd_ == -1) {
+            return error_code::resource_unavailable;
+        }
+    }
+
+    stopping_ = false;
+    try {
+        workers_.reserve(options_.threads);
+        for (size_t i = 0; i < options_.threads; ++i) {
+            workers_.emplace_back([this] { worker_loop(); });
+        }
+    } catch (...) {
+        stop();
+        return error_code::resource_unavailable;
+    }
+
+    return error_code::success;
+}
+
+void offload_pool::stop() noexcept {
+    {
+        std::lock_guard lock(mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    for (auto& worker : workers_) {
+        worker.join();
+    }
+    workers_.clear();
+}
+
+std::error_code offload_pool::submit(work fn, completion done, offload_lane lane) noexcept {
+    if (workers_.empty()) {
+        return error_code::resource_unavailable;
+    }
+    {
+        std::lock_guard lock(mutex_);
+        if (latency_queue_.size() + bulk_queue_.size() >= options_.max_queued) {
+            return error_code::resource_unavailable;
+        }
+        try {
+            auto& queue = lane == offload_lane::bulk ? bulk_queue_ : latency_queue_;
+            queue.push_back(task{std::move(fn), std::move(done)});
+        } catch (...) {
+            return error_code::resource_unavailable;
+        }
+    }
+    wake_.notify_one();
+    ++in_flight_;
+    return error_code::success;
+}
+
+size_t offload_pool::drain() noexcept {
+    if (event_fd_ == -1) {
+        return 0;
+    }
+
+    // Reset the counter before taking the list: a task finishing in between
+    // writes it again, so it's never lost - at worst we wake once for nothing
+    uint64_t count = 0;
+    [[maybe_unused]] auto result = ::read(event_fd_, &count, sizeof(count));
+
+    std::vector<task> finished;
+    {
+        std::lock_guard lock(mutex_);
+        finished.swap(finished_);
+    }
+    for (auto& item : finished) {
+        if (item.done) {
+            item.done(item.result);
+        }
+    }
+    in_flight_ -= finished.size();
+    return finished.size();
+}
+
+void offload_pool::worker_loop() noexcept {
+    std::unique_lock lock(mutex_);
+    while (true) {
+        // Latency work first; bulk work only while a worker stays free for it
+        const bool bulk_allowed = !bulk_queue_.empty() && bulk_running_ + 1 < options_.threads;
+        if (latency_queue_.empty() && !bulk_allowed) {
+            if (stopping_ && latency_queue_.empty() && bulk_queue_.empty()) {
+                return;
+            }
+            wake_.wait(lock);
+            continue;
+        }
+
+        const bool bulk = latency_queue_.empty();
+        auto& queue = bulk ? bulk_queue_ : latency_queue_;
+        task item = std::move(queue.front());
+        queue.pop_front();
+        bulk_running_ += bulk;
+        lock.unlock();
+
+        try {
+            item.result = item.fn();
+        } catch (const std::bad_alloc&) {
+            item.result = ENOMEM;
+        } catch (...) {
+            item.result = EIO;
+        }
+        item.fn = nullptr;  // Release what the work captured here, not on the reactor
+
+        lock.lock();
+        bulk_running_ -= bulk;
+        const bool was_empty = finished_.empty();
+        try {
+            finished_.push_back(std::move(item));
+        } catch (...) {
+            // Can't record it: the completion is lost, but the reactor must not be
+        }
+        if (bulk) {
+            // A bulk slot opened up; another worker may be waiting for it
+            wake_.notify_one();
+        }
+        if (was_empty) {
+            // Only the first finished task needs to wake the reactor; the
+            // rest are picked up by the same drain()
+            const uint64_t one = 1;
+            [[maybe_unused]] auto result = ::write(event_fd_, &one, sizeof(one));
+        }
+    }
+}
+
+// =============================================================================
+// BLOCKING FILESYSTEM PRIMITIVES
+// =============================================================================
+
+int remove_tree(const std::string& path) noexcept {
+    std::error_code ec;
+    std::filesystem::remove_all(path, ec);  // Never follows symlinks
+    return ec ? ec.value() : 0;
+}
+
+int make_directories(const std::string& path, mode_t mode, uid_t uid, gid_t gid) noexcept {
+    if (path.empty()) {
+        return EINVAL;
+    }
+    try {
+        // Walk the components left to right; existing ones are left alone
+        size_t end = 0;
+        while (end != std::string::npos) {
+            end = path.find('/', end + 1);
+            const std::string prefix = path.substr(0, end);
+            if (::mkdir(prefix.c_str(), mode) == 0) {
+                if (uid != static_cast<uid_t>(-1) && ::lchown(prefix.c_str(), uid, gid) != 0) {
+                    return errno;
+                }
+            } else if (errno != EEXIST) {
+                return errno;
+            }
+        }
+    } catch (...) {
+        return ENOMEM;
+    }
+
+    struct stat st;
+    if (::stat(path.c_str(), &st) != 0) {
+        return errno;
+    }
+    return S_ISDIR(st.st_mode) ? 0 : ENOTDIR;
+}
+
+int write_file(const std::string& path, std::string_view data, mode_t mode) noexcept {
+    const int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC | O_NOFOLLOW, mode);
+    if (fd == -1) {
+        return errno;
+    }
+    int result = 0;
+    while (!data.empty()) {
+        const ssize_t written = ::write(fd, data.data(), data.size());
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            result = errno;
+            break;
+        }
+        data.remove_prefix(static_cast<size_t>(written));
+    }
+    if (::close(fd) != 0 && result == 0) {
+        result = errno;
+    }
+    return result;
+}
+
+} // namespace vsocky
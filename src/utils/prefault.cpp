@@ -0,0 +1,353 @@
+#include "vsocky/utils/prefault.hpp"
+#include "vsocky/utils/error.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <string_view>
+
+#include <sys/eventfd.h>   // eventfd() for the wake-up channel
+#include <sys/mman.h>      // mincore(), madvise()
+#include <sys/resource.h>  // setpriority()
+#include <sys/syscall.h>   // SYS_gettid
+#include <sys/uio.h>       // process_vm_readv()
+#include <unistd.h>        // sysconf(), read(), write(), close()
+
+namespace vsocky {
+
+namespace {
+
+// Pages handled per process_vm_readv() call (matches the kernel's IOV_MAX)
+constexpr size_t iov_batch = 1024;
+
+// Pages queried per mincore() call
+constexpr size_t mincore_batch = 4096;
+
+size_t page_size() noexcept {
+    static const size_t size = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+    return size;
+}
+
+// One line of /proc/<pid>/maps that we might want to warm
+struct mapping {
+    uintptr_t begin;
+    uintptr_t end;
+    bool file_backed;
+};
+
+// =============================================================================
+// PARSING /proc/<pid>/maps
+// =============================================================================
+// Each line looks like:
+//   7f12a0000000-7f12a0021000 rw-p 00000000 00:00 0          [heap]
+//   begin-end                 perms offset dev   inode      path
+//
+// We keep readable mappings only, and skip the kernel-provided special ones
+// ([vvar], [vsyscall], [vdso]) plus device mappings - reading those is either
+// pointless or has side effects. [heap] and [stack] are regular memory.
+// =============================================================================
+std::vector<mapping> read_maps(pid_t pid) {
+    std::vector<mapping> result;
+
+    const std::string path = pid == 0 ? std::string("/proc/self/maps")
+                                      : "/proc/" + std::to_string(pid) + "/maps";
+    FILE* file = std::fopen(path.c_str(), "re");
+    if (file == nullptr) {
+        return result;
+    }
+
+    char* line = nullptr;
+    size_t capacity = 0;
+    while (::getline(&line, &capacity, file) != -1) {
+        unsigned long begin = 0;
+        unsigned long end = 0;
+        unsigned long inode = 0;
+        char perms[5] = {};
+        int path_offset = 0;
+
+        if (std::sscanf(line, "%lx-%lx %4s %*s %*s %lu %n",
+                        &begin, &end, perms, &inode, &path_offset) < 4) {
+            continue;
+        }
+        if (perms[0] != 'r') {
+            continue;  // Guard pages and execute-only text
+        }
+
+        std::string_view name(line + path_offset);
+        while (!name.empty() && (name.back() == '\n' || name.back() == ' ')) {
+            name.remove_suffix(1);
+        }
+        const bool special = name.starts_with('[') && name != "[heap]" && name != "[stack]";
+        if (special || name.starts_with("/dev/")) {
+            continue;
+        }
+
+        result.push_back({begin, end, inode != 0});
+    }
+
+    std::free(line);
+    std::fclose(file);
+    return result;
+}
+
+// =============================================================================
+// FAULTING PAGES IN WITH process_vm_readv
+// =============================================================================
+// For our own mappings and for other processes we read one byte per page with
+// process_vm_readv() instead of dereferencing pointers. The difference matters:
+// - A mapping can disappear between reading /proc/<pid>/maps and touching it
+//   (a thread exits, malloc trims an arena). A plain load would SIGSEGV; the
+//   syscall just returns EFAULT for that iovec.
+// - It works on other processes without stopping them (no ptrace attach).
+//
+// On a partial transfer the return value tells us how many iovecs completed
+// (each is one byte), so we skip the failing page and carry on.
+// =============================================================================
+size_t read_pages(pid_t pid, std::span<const uintptr_t> pages) noexcept {
+    std::array<char, iov_batch> sink;
+    std::array<struct iovec, iov_batch> remote;
+    size_t faulted = 0;
+
+    while (!pages.empty()) {
+        const size_t count = std::min(pages.size(), iov_batch);
+        for (size_t i = 0; i < count; ++i) {
+            remote[i].iov_base = reinterpret_cast<void*>(pages[i]);
+            remote[i].iov_len = 1;
+        }
+        struct iovec local{sink.data(), count};
+
+        const ssize_t result = ::process_vm_readv(pid, &local, 1, remote.data(), count, 0);
+        if (result < 0) {
+            if (errno == ESRCH || errno == EPERM) {
+                return faulted;  // Process gone or not ours - nothing more to do
+            }
+            pages = pages.subspan(1);  // First page is bad, skip it
+            continue;
+        }
+
+        const auto done = static_cast<size_t>(result);
+        faulted += done;
+        // Skip the page that stopped the transfer (if any)
+        pages = pages.subspan(std::min(pages.size(), done < count ? done + 1 : count));
+    }
+
+    return faulted;
+}
+
+// Collect the page addresses of [begin, end) that the guest reports resident
+void collect_resident(uintptr_t begin, uintptr_t end, size_t budget,
+                      std::vector<uintptr_t>& out) {
+    const size_t ps = page_size();
+    std::array<unsigned char, mincore_batch> residency;
+
+    for (uintptr_t chunk = begin; chunk < end && out.size() < budget;) {
+        const size_t pages = std::min<size_t>((end - chunk) / ps, mincore_batch);
+        if (::mincore(reinterpret_cast<void*>(chunk), pages * ps, residency.data()) != 0) {
+            return;  // Mapping went away underneath us
+        }
+        for (size_t i = 0; i < pages && out.size() < budget; ++i) {
+            if (residency[i] & 1) {
+                out.push_back(chunk + i * ps);
+            }
+        }
+        chunk += pages * ps;
+    }
+}
+
+} // anonymous namespace
+
+prefaulter::prefaulter(prefault_options options) noexcept : options_(options) {}
+
+prefaulter::~prefaulter() noexcept {
+    stop();
+}
+
+void prefaulter::add_region(std::span<const std::byte> memory) {
+    if (memory.empty()) {
+        return;
+    }
+
+    // Round outwards to page boundaries
+    const size_t ps = page_size();
+    const auto begin = reinterpret_cast<uintptr_t>(memory.data()) & ~(ps - 1);
+    const auto end = (reinterpret_cast<uintptr_t>(memory.data()) + memory.size() + ps - 1)
+                     & ~(ps - 1);
+
+    std::lock_guard lock(mutex_);
+    regions_.push_back({begin, end});
+}
+
+void prefaulter::add_process(pid_t pid) {
+    std::lock_guard lock(mutex_);
+    if (std::find(pids_.begin(), pids_.end(), pid) == pids_.end()) {
+        pids_.push_back(pid);
+    }
+}
+
+void prefaulter::remove_process(pid_t pid) {
+    std::lock_guard lock(mutex_);
+    std::erase(pids_, pid);
+}
+
+prefault_stats prefaulter::run_once() noexcept {
+    prefault_stats stats;
+    const size_t ps = page_size();
+    const size_t budget = options_.max_bytes / ps;
+
+    // Snapshot the registrations so we don't hold the lock while faulting
+    std::vector<region> regions;
+    std::vector<pid_t> pids;
+    try {
+        std::lock_guard lock(mutex_);
+        regions = regions_;
+        pids = pids_;
+    } catch (...) {
+        return stats;  // Out of memory - skip this pass
+    }
+
+    // =========================================================================
+    // STEP 1: Explicit regions - the caller guarantees these stay mapped, so a
+    // direct volatile load is the cheapest way to touch them.
+    // =========================================================================
+    for (const auto& r : regions) {
+        ::madvise(reinterpret_cast<void*>(r.begin), r.end - r.begin, MADV_WILLNEED);
+        for (uintptr_t page = r.begin; page < r.end && stats.pages < budget; page += ps) {
+            // volatile: the load has no visible effect, so without it the
+            // compiler would happily delete the whole loop
+            [[maybe_unused]] auto touched = *reinterpret_cast<const volatile char*>(page);
+            ++stats.pages;
+        }
+        ++stats.regions;
+    }
+
+    try {
+        // =====================================================================
+        // STEP 2: Our own resident working set
+        // =====================================================================
+        if (options_.include_self_maps && stats.pages < budget) {
+            std::vector<uintptr_t> pages;
+            for (const auto& m : read_maps(0)) {
+                if (m.file_backed) {
+                    // Start guest-side readahead for binaries and data files
+                    ::madvise(reinterpret_cast<void*>(m.begin), m.end - m.begin, MADV_WILLNEED);
+                }
+                collect_resident(m.begin, m.end, budget - stats.pages, pages);
+                ++stats.regions;
+                if (stats.pages + pages.size() >= budget) {
+                    break;
+                }
+            }
+            stats.pages += read_pages(::getpid(), pages);
+        }
+
+        // =====================================================================
+        // STEP 3: Warm-pool processes - no mincore for remote processes, so we
+        // read every readable page (untouched anonymous pages just map the
+        // shared zero page, which costs nothing)
+        // =====================================================================
+        for (pid_t pid : pids) {
+            std::vector<uintptr_t> pages;
+            for (const auto& m : read_maps(pid)) {
+                for (uintptr_t page = m.begin;
+                     page < m.end && stats.remote_pages + pages.size() < budget;
+                     page += ps) {
+                    pages.push_back(page);
+                }
+            }
+            stats.remote_pages += read_pages(pid, pages);
+            ++stats.processes;
+        }
+    } catch (...) {
+        // Allocation failure while building page lists - return what we did
+    }
+
+    return stats;
+}
+
+std::error_code prefaulter::start() noexcept {
+    if (worker_.joinable()) {
+        return error_code::success;
+    }
+
+    // =========================================================================
+    // WHY AN EVENTFD?
+    // =========================================================================
+    // request() is called from a signal handler, where we can't touch mutexes
+    // or condition variables. write() on an eventfd is async-signal-safe, and
+    // the worker simply blocks in read() until the counter becomes non-zero.
+    // Several requests before the worker wakes collapse into one pass.
+    // =========================================================================
+    event_fd_ = ::eventfd(0, EFD_CLOEXEC);
+    if (event_fd_ == -1) {
+        return error_code::resource_unavailable;
+    }
+
+    stopping_.store(false, std::memory_order_release);
+    try {
+        worker_ = std::thread([this] { worker_loop(); });
+    } catch (...) {
+        ::close(event_fd_);
+        event_fd_ = -1;
+        return error_code::resource_unavailable;
+    }
+
+    return error_code::success;
+}
+
+void prefaulter::stop() noexcept {
+    if (!worker_.joinable()) {
+        return;
+    }
+
+    stopping_.store(true, std::memory_order_release);
+    request();  // Wake the worker so it sees stopping_
+    worker_.join();
+
+    ::close(event_fd_);
+    event_fd_ = -1;
+}
+
+void prefaulter::request() noexcept {
+    if (event_fd_ == -1) {
+        return;
+    }
+    const uint64_t one = 1;
+    [[maybe_unused]] auto result = ::write(event_fd_, &one, sizeof(one));
+}
+
+prefault_stats prefaulter::last_stats() const noexcept {
+    std::lock_guard lock(mutex_);
+    return last_stats_;
+}
+
+void prefaulter::worker_loop() noexcept {
+    // Lowest priority: the pass must never compete with real requests.
+    // On Linux nice values are per-thread, so this only affects the worker.
+    ::setpriority(PRIO_PROCESS, static_cast<id_t>(::syscall(SYS_gettid)), 19);
+
+    while (true) {
+        uint64_t pending = 0;
+        const ssize_t result = ::read(event_fd_, &pending, sizeof(pending));
+        if (result != static_cast<ssize_t>(sizeof(pending))) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return;
+        }
+        if (stopping_.load(std::memory_order_acquire)) {
+            return;
+        }
+
+        const prefault_stats stats = run_once();
+        {
+            std::lock_guard lock(mutex_);
+            last_stats_ = stats;
+        }
+        passes_.fetch_add(1, std::memory_order_acq_rel);
+    }
+}
+
+} // namespace vsocky
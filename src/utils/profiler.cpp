@@ -0,0 +1,302 @@
+#include "vsocky/utils/profiler.hpp"
+#include "vsocky/utils/error.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <format>
+#include <fstream>
+#include <map>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <dirent.h>             // opendir() for /proc/self/task
+#include <link.h>               // dl_iterate_phdr()
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace vsocky {
+
+namespace {
+
+// Per-thread ring buffer: 1 metadata page + 2^n data pages
+constexpr size_t ring_data_pages = 32;
+constexpr uint16_t max_stack_depth = 64;
+constexpr auto drain_interval = std::chrono::milliseconds(50);
+
+struct thread_sampler {
+    pid_t tid = -1;
+    int fd = -1;
+    void* ring = nullptr;
+    size_t ring_size = 0;
+};
+
+struct module_range {
+    std::string name;
+    uintptr_t bias;  // Load address minus link address
+    uintptr_t low;   // Executable segment, runtime addresses
+    uintptr_t high;
+};
+
+std::vector<pid_t> list_threads() {
+    std::vector<pid_t> tids;
+    DIR* dir = ::opendir("/proc/self/task");
+    if (dir == nullptr) {
+        return tids;
+    }
+    while (const dirent* entry = ::readdir(dir)) {
+        if (entry->d_name[0] != '.') {
+            tids.push_back(static_cast<pid_t>(std::strtol(entry->d_name, nullptr, 10)));
+        }
+    }
+    ::closedir(dir);
+    return tids;
+}
+
+std::string thread_name(pid_t tid) {
+    std::ifstream comm("/proc/self/task/" + std::to_string(tid) + "/comm");
+    std::string name;
+    std::getline(comm, name);
+    // ';' and ' ' are folded-format syntax
+    std::replace(name.begin(), name.end(), ';', '_');
+    std::replace(name.begin(), name.end(), ' ', '_');
+    return name.empty() ? "[thread]" : name;
+}
+
+std::string base_name(std::string_view path) {
+    const auto slash = path.rfind('/');
+    return std::string(slash == std::string_view::npos ? path : path.substr(slash + 1));
+}
+
+std::vector<module_range> loaded_modules() {
+    std::vector<module_range> modules;
+    char exe[4096] = {};
+    const ssize_t n = ::readlink("/proc/self/exe", exe, sizeof(exe) - 1);
+    const std::string exe_name = n > 0 ? base_name(std::string_view(exe, static_cast<size_t>(n))) : "[exe]";
+
+    struct context {
+        std::vector<module_range>* modules;
+        const std::string* exe_name;
+    } ctx{&modules, &exe_name};
+
+    ::dl_iterate_phdr([](dl_phdr_info* info, size_t, void* data) -> int {
+        auto* c = static_cast<context*>(data);
+        const std::string name = (info->dlpi_name == nullptr || info->dlpi_name[0] == '\0')
+                                     ? *c->exe_name
+                                     : base_name(info->dlpi_name);
+        for (int i = 0; i < info->dlpi_phnum; ++i) {
+            const auto& ph = info->dlpi_phdr[i];
+            if (ph.p_type == PT_LOAD && (ph.p_flags & PF_X)) {
+                const uintptr_t low = info->dlpi_addr + ph.p_vaddr;
+                c->modules->push_back({name, info->dlpi_addr, low, low + ph.p_memsz});
+            }
+        }
+        return 0;
+    }, &ctx);
+    return modules;
+}
+
+std::error_code open_sampler(thread_sampler& sampler, uint32_t frequency_hz) noexcept {
+    perf_event_attr attr{};
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_SOFTWARE;
+    attr.config = PERF_COUNT_SW_CPU_CLOCK;
+    attr.freq = 1;
+    attr.sample_freq = frequency_hz;
+    attr.sample_type = PERF_SAMPLE_TID | PERF_SAMPLE_CALLCHAIN;
+    attr.sample_max_stack = max_stack_depth;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.exclude_callchain_kernel = 1;
+
+    sampler.fd = static_cast<int>(::syscall(SYS_perf_event_open, &attr, sampler.tid, -1, -1, PERF_FLAG_FD_CLOEXEC));
+    if (sampler.fd == -1) {
+        return error_code::resource_unavailable;
+    }
+    sampler.ring_size = (1 + ring_data_pages) * static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+    void* ring = ::mmap(nullptr, sampler.ring_size, PROT_READ | PROT_WRITE, MAP_SHARED, sampler.fd, 0);
+    if (ring == MAP_FAILED) {
+        ::close(sampler.fd);
+        sampler.fd = -1;
+        return error_code::resource_unavailable;
+    }
+    sampler.ring = ring;
+    return error_code::success;
+}
+
+void close_sampler(thread_sampler& sampler) noexcept {
+    if (sampler.ring != nullptr) {
+        ::munmap(sampler.ring, sampler.ring_size);
+    }
+    if (sampler.fd != -1) {
+        ::close(sampler.fd);
+    }
+    sampler = {};
+}
+
+// Raw stacks (innermost first) keyed by thread, as collected
+struct sample_sink {
+    std::map<std::pair<pid_t, std::vector<uint64_t>>, size_t> stacks;
+    size_t samples = 0;
+    size_t lost = 0;
+};
+
+// =============================================================================
+// READING THE RING
+// =============================================================================
+// The kernel advances data_head as it writes; we read up to it and then
+// publish data_tail so it can reuse the space. Records can wrap around the
+// end of the data area, so each one is copied out before parsing.
+// =============================================================================
+void drain(const thread_sampler& sampler, sample_sink& sink) {
+    auto* meta = static_cast<perf_event_mmap_page*>(sampler.ring);
+    const size_t page_size = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+    const auto* data = static_cast<const uint8_t*>(sampler.ring) + (meta->data_offset != 0 ? meta->data_offset : page_size);
+    const uint64_t data_size = meta->data_size != 0 ? meta->data_size : ring_data_pages * page_size;
+
+    const uint64_t head = __atomic_load_n(&meta->data_head, __ATOMIC_ACQUIRE);
+    uint64_t tail = meta->data_tail;
+    std::vector<uint8_t> record;
+
+    while (tail + sizeof(perf_event_header) <= head) {
+        perf_event_header header;
+        for (size_t i = 0; i < sizeof(header); ++i) {
+            reinterpret_cast<uint8_t*>(&header)[i] = data[(tail + i) % data_size];
+        }
+        if (header.size < sizeof(header) || tail + header.size > head) {
+            break;
+        }
+        record.resize(header.size);
+        for (size_t i = 0; i < header.size; ++i) {
+            record[i] = data[(tail + i) % data_size];
+        }
+        tail += header.size;
+
+        const uint8_t* body = record.data() + sizeof(header);
+        const size_t body_size = header.size - sizeof(header);
+        if (header.type == PERF_RECORD_SAMPLE && body_size >= 16) {
+            // PERF_SAMPLE_TID: u32 pid, u32 tid; PERF_SAMPLE_CALLCHAIN: u64 nr, u64 ips[nr]
+            uint32_t tid;
+            uint64_t nr;
+            std::memcpy(&tid, body + 4, sizeof(tid));
+            std::memcpy(&nr, body + 8, sizeof(nr));
+            nr = std::min<uint64_t>(nr, (body_size - 16) / sizeof(uint64_t));
+
+            std::vector<uint64_t> ips;
+            ips.reserve(nr);
+            for (uint64_t i = 0; i < nr; ++i) {
+                uint64_t ip;
+                std::memcpy(&ip, body + 16 + i * sizeof(uint64_t), sizeof(ip));
+                if (ip < static_cast<uint64_t>(PERF_CONTEXT_MAX)) {  // Skip context markers
+                    ips.push_back(ip);
+                }
+            }
+            ++sink.stacks[{static_cast<pid_t>(tid), std::move(ips)}];
+            ++sink.samples;
+        } else if (header.type == PERF_RECORD_LOST && body_size >= 16) {
+            uint64_t lost;
+            std::memcpy(&lost, body + 8, sizeof(lost));
+            sink.lost += lost;
+        }
+    }
+
+    __atomic_store_n(&meta->data_tail, tail, __ATOMIC_RELEASE);
+}
+
+// "module+0xoffset", offset in the module's link-time address space.
+// Return addresses point after the call; back them up into it so
+// addr2line names the calling line.
+std::string frame_name(uint64_t ip, bool leaf, const std::vector<module_range>& modules,
+                       std::unordered_map<uint64_t, std::string>& cache) {
+    const uint64_t pc = leaf ? ip : ip - 1;
+    if (auto it = cache.find(pc); it != cache.end()) {
+        return it->second;
+    }
+    std::string name = std::format("0x{:x}", pc);
+    for (const auto& module : modules) {
+        if (pc >= module.low && pc < module.high) {
+            name = std::format("{}+0x{:x}", module.name, pc - module.bias);
+            break;
+        }
+    }
+    cache.emplace(pc, name);
+    return name;
+}
+
+} // anonymous namespace
+
+std::expected<profile_result, std::error_code> profile_self(const profile_options& options) {
+    if (options.duration_ms == 0 || options.duration_ms > max_profile_duration_ms ||
+        options.frequency_hz == 0 || options.frequency_hz > max_profile_frequency_hz) {
+        return std::unexpected(make_error_code(error_code::invalid_field_value));
+    }
+
+    const pid_t self = static_cast<pid_t>(::syscall(SYS_gettid));
+    std::vector<thread_sampler> samplers;
+    for (pid_t tid : list_threads()) {
+        if (tid == self) {
+            continue;
+        }
+        thread_sampler sampler;
+        sampler.tid = tid;
+        if (!open_sampler(sampler, options.frequency_hz)) {
+            samplers.push_back(sampler);
+        }
+        // A thread that exited since we listed it just isn't sampled
+    }
+    if (samplers.empty()) {
+        return std::unexpected(make_error_code(error_code::resource_unavailable));
+    }
+
+    std::unordered_map<pid_t, std::string> names;
+    for (const auto& sampler : samplers) {
+        names.emplace(sampler.tid, thread_name(sampler.tid));
+        ::ioctl(sampler.fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+
+    sample_sink sink;
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(options.duration_ms);
+    while (std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::min<std::chrono::steady_clock::duration>(
+            drain_interval, deadline - std::chrono::steady_clock::now()));
+        for (const auto& sampler : samplers) {
+            drain(sampler, sink);
+        }
+    }
+    for (auto& sampler : samplers) {
+        ::ioctl(sampler.fd, PERF_EVENT_IOC_DISABLE, 0);
+        drain(sampler, sink);
+        close_sampler(sampler);
+    }
+
+    // Fold: thread;outermost;...;innermost count. Threads sharing a name
+    // (worker pools) merge into one line per stack; std::map keeps it sorted.
+    const auto modules = loaded_modules();
+    std::unordered_map<uint64_t, std::string> cache;
+    std::map<std::string, size_t> folded;
+    for (const auto& [key, count] : sink.stacks) {
+        const auto& [tid, ips] = key;
+        std::string line = names.count(tid) ? names[tid] : "[thread]";
+        for (size_t i = ips.size(); i-- > 0;) {
+            line += ';';
+            line += frame_name(ips[i], i == 0, modules, cache);
+        }
+        folded[line] += count;
+    }
+
+    profile_result result;
+    result.samples = sink.samples;
+    result.lost = sink.lost;
+    result.threads = samplers.size();
+    for (const auto& [stack, count] : folded) {
+        result.folded += std::format("{} {}\n", stack, count);
+    }
+    return result;
+}
+
+} // namespace vsocky
@@ -0,0 +1,164 @@
+#include "vsocky/utils/sha256.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+
+namespace vsocky {
+
+namespace {
+
+// First 32 bits of the fractional parts of the cube roots of the first 64 primes
+constexpr std::array<uint32_t, 64> round_constants = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+int hex_value(char c) noexcept {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+} // anonymous namespace
+
+void sha256::reset() noexcept {
+    // First 32 bits of the fractional parts of the square roots of the first 8 primes
+    state_ = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+              0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+    block_used_ = 0;
+    total_bytes_ = 0;
+}
+
+void sha256::update(std::span<const uint8_t> data) noexcept {
+    total_bytes_ += data.size();
+
+    // Top up a partially filled block first
+    if (block_used_ > 0) {
+        const size_t take = std::min(data.size(), block_.size() - block_used_);
+        std::memcpy(block_.data() + block_used_, data.data(), take);
+        block_used_ += take;
+        data = data.subspan(take);
+        if (block_used_ < block_.size()) {
+            return;
+        }
+        compress(block_.data());
+        block_used_ = 0;
+    }
+
+    // Whole blocks straight from the input - no copy
+    while (data.size() >= block_.size()) {
+        compress(data.data());
+        data = data.subspan(block_.size());
+    }
+
+    std::memcpy(block_.data(), data.data(), data.size());
+    block_used_ = data.size();
+}
+
+sha256_digest sha256::finish() noexcept {
+    // =========================================================================
+    // PADDING
+    // =========================================================================
+    // Append 0x80, then zeros until 8 bytes short of a block boundary, then
+    // the message length in BITS as a big-endian u64.
+    // =========================================================================
+    const uint64_t bit_length = total_bytes_ * 8;
+
+    block_[block_used_++] = 0x80;
+    if (block_used_ > 56) {
+        std::memset(block_.data() + block_used_, 0, block_.size() - block_used_);
+        compress(block_.data());
+        block_used_ = 0;
+    }
+    std::memset(block_.data() + block_used_, 0, 56 - block_used_);
+    for (size_t i = 0; i < 8; ++i) {
+        block_[56 + i] = static_cast<uint8_t>(bit_length >> (56 - 8 * i));
+    }
+    compress(block_.data());
+
+    sha256_digest digest;
+    for (size_t i = 0; i < state_.size(); ++i) {
+        digest[i * 4] = static_cast<uint8_t>(state_[i] >> 24);
+        digest[i * 4 + 1] = static_cast<uint8_t>(state_[i] >> 16);
+        digest[i * 4 + 2] = static_cast<uint8_t>(state_[i] >> 8);
+        digest[i * 4 + 3] = static_cast<uint8_t>(state_[i]);
+    }
+    return digest;
+}
+
+void sha256::compress(const uint8_t* block) noexcept {
+    // Message schedule: 16 big-endian words from the block, 48 derived ones
+    std::array<uint32_t, 64> w;
+    for (size_t i = 0; i < 16; ++i) {
+        w[i] = (static_cast<uint32_t>(block[i * 4]) << 24) |
+               (static_cast<uint32_t>(block[i * 4 + 1]) << 16) |
+               (static_cast<uint32_t>(block[i * 4 + 2]) << 8) |
+                static_cast<uint32_t>(block[i * 4 + 3]);
+    }
+    for (size_t i = 16; i < 64; ++i) {
+        const uint32_t s0 = std::rotr(w[i - 15], 7) ^ std::rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        const uint32_t s1 = std::rotr(w[i - 2], 17) ^ std::rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+    uint32_t a = state_[0], b = state_[1], c = state_[2], d = state_[3];
+    uint32_t e = state_[4], f = state_[5], g = state_[6], h = state_[7];
+
+    for (size_t i = 0; i < 64; ++i) {
+        const uint32_t s1 = std::rotr(e, 6) ^ std::rotr(e, 11) ^ std::rotr(e, 25);
+        const uint32_t ch = (e & f) ^ (~e & g);
+        const uint32_t t1 = h + s1 + ch + round_constants[i] + w[i];
+        const uint32_t s0 = std::rotr(a, 2) ^ std::rotr(a, 13) ^ std::rotr(a, 22);
+        const uint32_t maj = (a & b) ^ (a & c) ^ (b & c);
+        const uint32_t t2 = s0 + maj;
+
+        h = g;
+        g = f;
+        f = e;
+        e = d + t1;
+        d = c;
+        c = b;
+        b = a;
+        a = t1 + t2;
+    }
+
+    state_[0] += a; state_[1] += b; state_[2] += c; state_[3] += d;
+    state_[4] += e; state_[5] += f; state_[6] += g; state_[7] += h;
+}
+
+std::string to_hex(const sha256_digest& digest) {
+    static constexpr char digits[] = "0123456789abcdef";
+    std::string hex;
+    hex.reserve(digest.size() * 2);
+    for (uint8_t byte : digest) {
+        hex.push_back(digits[byte >> 4]);
+        hex.push_back(digits[byte & 0x0F]);
+    }
+    return hex;
+}
+
+std::optional<sha256_digest> parse_sha256_hex(std::string_view hex) noexcept {
+    sha256_digest digest;
+    if (hex.size() != digest.size() * 2) {
+        return std::nullopt;
+    }
+    for (size_t i = 0; i < digest.size(); ++i) {
+        const int high = hex_value(hex[i * 2]);
+        const int low = hex_value(hex[i * 2 + 1]);
+        if (high < 0 || low < 0) {
+            return std::nullopt;
+        }
+        digest[i] = static_cast<uint8_t>((high << 4) | low);
+    }
+    return digest;
+}
+
+} // namespace vsocky
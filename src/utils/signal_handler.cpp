@@ -10,7 +10,9 @@
 // Signals are software interrupts sent to a process. Common signals:
 // - SIGTERM: Polite termination request (e.g., from systemd or kill command)
 // - SIGINT: Interrupt from keyboard (Ctrl+C)
-// - SIGHUP: Terminal disconnected (historical: "hang up")
+// - SIGHUP: Terminal disconnected (historical: "hang up"). Daemons have no
+//   terminal, so by convention it means "reload your configuration"
+// - SIGUSR1: User-defined - we use it as "VM restored from snapshot"
 // - SIGKILL: Force kill (can't be caught or ignored!)
 //
 // WHY sigaction INSTEAD OF signal()?
@@ -30,6 +32,8 @@ namespace vsocky {
 // The 'false' in braces is uniform initialization - the modern C++ way
 // to initialize objects. For atomic<bool>, this sets initial value to false.
 std::atomic<bool> signal_handler::shutdown_requested_{false};
+std::atomic<bool> signal_handler::reload_requested_{false};
+std::atomic<int> signal_handler::restore_notify_fd_{-1};
 
 void signal_handler::setup() {
     // =======================================================================
@@ -110,10 +114,27 @@ void signal_handler::setup() {
         std::println(stderr, "Warning: Failed to install SIGINT handler");
     }
     
-    // Also handle SIGHUP (terminal hangup)
+    // SIGHUP reloads the config file - restarting would throw away warm pools
     if (sigaction(SIGHUP, &sa, nullptr) != 0) {
         std::println(stderr, "Warning: Failed to install SIGHUP handler");
     }
+    
+    // =======================================================================
+    // SIGPIPE - IGNORE IT
+    // Writing to a socket whose peer has gone away raises SIGPIPE, which
+    // kills the process by default. With it ignored, write() just fails with
+    // EPIPE and Connection turns that into connection_closed.
+    // =======================================================================
+    struct sigaction ignore{};
+    ignore.sa_handler = SIG_IGN;
+    if (sigaction(SIGPIPE, &ignore, nullptr) != 0) {
+        std::println(stderr, "Warning: Failed to ignore SIGPIPE");
+    }
+    
+    // SIGUSR1 is sent by whoever resumes the VM after a snapshot restore
+    if (sigaction(SIGUSR1, &sa, nullptr) != 0) {
+        std::println(stderr, "Warning: Failed to install SIGUSR1 handler");
+    }
 }
 
 void signal_handler::handle_signal(int signal) {
@@ -142,12 +163,25 @@ void signal_handler::handle_signal(int signal) {
     switch (signal) {
         case SIGTERM:
         case SIGINT:
-        case SIGHUP:
             // Atomically set the shutdown flag
             // memory_order_release ensures all operations before this are
             // visible to threads that load() with acquire ordering
             shutdown_requested_.store(true, std::memory_order_release);
             break;
+        case SIGHUP:
+            // Just raise a flag - parsing a file here would be far from
+            // async-signal-safe. The main loop does the actual reload.
+            reload_requested_.store(true, std::memory_order_release);
+            break;
+        case SIGUSR1: {
+            // Forward to the prefaulter's eventfd - write() is async-signal-safe
+            const int fd = restore_notify_fd_.load(std::memory_order_acquire);
+            if (fd != -1) {
+                const uint64_t one = 1;
+                [[maybe_unused]] auto result = write(fd, &one, sizeof(one));
+            }
+            break;
+        }
         default:
             // Unexpected signal, ignore
             break;
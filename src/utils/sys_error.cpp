@@ -0,0 +1,88 @@
+#include "vsocky/utils/sys_error.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+
+namespace vsocky {
+
+namespace {
+
+struct errno_entry {
+    int value;
+    std::string_view name;
+};
+
+// Not strerrorname_np(): glibc-only, and musl builds matter here
+constexpr errno_entry errno_names[] = {
+    {EPERM, "EPERM"},
+    {ENOENT, "ENOENT"},
+    {EINTR, "EINTR"},
+    {EIO, "EIO"},
+    {EBADF, "EBADF"},
+    {EAGAIN, "EAGAIN"},
+    {ENOMEM, "ENOMEM"},
+    {EACCES, "EACCES"},
+    {EFAULT, "EFAULT"},
+    {EBUSY, "EBUSY"},
+    {EEXIST, "EEXIST"},
+    {EINVAL, "EINVAL"},
+    {ENFILE, "ENFILE"},
+    {EMFILE, "EMFILE"},
+    {EFBIG, "EFBIG"},
+    {ENOSPC, "ENOSPC"},
+    {EPIPE, "EPIPE"},
+    {ENOSYS, "ENOSYS"},
+    {ENOTSOCK, "ENOTSOCK"},
+    {EMSGSIZE, "EMSGSIZE"},
+    {EADDRINUSE, "EADDRINUSE"},
+    {ENETDOWN, "ENETDOWN"},
+    {ENETUNREACH, "ENETUNREACH"},
+    {ECONNABORTED, "ECONNABORTED"},
+    {ECONNRESET, "ECONNRESET"},
+    {ENOBUFS, "ENOBUFS"},
+    {ENOTCONN, "ENOTCONN"},
+    {ESHUTDOWN, "ESHUTDOWN"},
+    {ETIMEDOUT, "ETIMEDOUT"},
+    {ECONNREFUSED, "ECONNREFUSED"},
+    {EHOSTDOWN, "EHOSTDOWN"},
+    {EHOSTUNREACH, "EHOSTUNREACH"},
+};
+
+// Copy as much of text as fits; returns the new position
+char* append(char* pos, char* end, std::string_view text) noexcept {
+    const auto n = std::min(text.size(), static_cast<size_t>(end - pos));
+    return std::copy_n(text.data(), n, pos);
+}
+
+} // anonymous namespace
+
+std::string_view errno_name(int sys_errno) noexcept {
+    for (const auto& entry : errno_names) {
+        if (entry.value == sys_errno) {
+            return entry.name;
+        }
+    }
+    return {};
+}
+
+std::string_view format_sys_error(sys_error error, std::span<char> out) noexcept {
+    char* const begin = out.data();
+    char* const end = begin + out.size();
+    char* pos = append(begin, end, error_to_string(error.code));
+    if (error.sys_errno != 0) {
+        if (const auto name = errno_name(error.sys_errno); !name.empty()) {
+            pos = append(pos, end, " (");
+            pos = append(pos, end, name);
+        } else {
+            pos = append(pos, end, " (errno ");
+            char digits[16];
+            const auto [digits_end, ec] = std::to_chars(digits, digits + sizeof(digits), error.sys_errno);
+            pos = append(pos, end, {digits, ec == std::errc{} ? digits_end : digits});
+        }
+        pos = append(pos, end, ")");
+    }
+    return {begin, static_cast<size_t>(pos - begin)};
+}
+
+} // namespace vsocky
@@ -2,9 +2,14 @@
 
 #include <unistd.h>      // close(), read(), write()
 #include <fcntl.h>       // fcntl() for non-blocking mode
+#include <poll.h>        // poll() for the blocking helpers
+#include <sys/sendfile.h> // sendfile() for zero-copy file transfer
 #include <sys/socket.h>  // socket operations
+#include <sys/un.h>      // sockaddr_un for Unix domain sockets
 #include <linux/vm_sockets.h> // VSock structures
 #include <cerrno>        // errno for error checking
+#include <cstring>       // std::memcpy for sun_path
+#include <algorithm>     // std::min
 #include <utility>       // std::exchange for move semantics
 
 // =============================================================================
@@ -97,18 +102,47 @@ namespace vsocky {
         return *this;  // Enable chaining: a = b = c;
     }
 
+    namespace {
+        // Shared poll() wrapper for wait_readable / wait_writable and the
+        // blocking writes below
+        sys_error wait_for(int fd, short events, int timeout_ms) noexcept {
+            if (fd == -1) {
+                return {error_code::connection_closed};
+            }
+            
+            struct pollfd pfd{fd, events, 0};
+            int result;
+            do {
+                result = ::poll(&pfd, 1, timeout_ms);
+            } while (result == -1 && errno == EINTR);
+            
+            if (result == 0) {
+                return {error_code::timeout};
+            }
+            if (result < 0) {
+                return {error_code::internal_error, errno};
+            }
+            // POLLHUP with POLLIN still means "data left to read" - only
+            // report closure when the event we wanted isn't there
+            if (!(pfd.revents & events) && (pfd.revents & (POLLHUP | POLLERR | POLLNVAL))) {
+                return {error_code::connection_closed};
+            }
+            return {};
+        }
+    } // anonymous namespace
+
     // =============================================================================
     // READ OPERATION - Receiving Data
     // =============================================================================
-    std::error_code Connection::read(std::span<uint8_t> buffer, size_t& bytes_read) noexcept {
+    sys_error Connection::read(std::span<uint8_t> buffer, size_t& bytes_read) noexcept {
         bytes_read = 0;  // Always initialize output parameters
         
         if (fd_ == -1) {
-            return error_code::connection_closed;
+            return {error_code::connection_closed};
         }
         
         if (buffer.empty()) {
-            return error_code::success;  // Nothing to read into
+            return {};  // Nothing to read into
         }
         
         // ==========================================================================
@@ -131,11 +165,11 @@ namespace vsocky {
         if (result > 0) {
             // Success: Got some data
             bytes_read = static_cast<size_t>(result);
-            return error_code::success;
+            return {};
         } else if (result == 0) {
             // EOF: Peer closed the connection gracefully
             // This is a normal way for connections to end
-            return error_code::connection_closed;
+            return {error_code::connection_closed, 0};
         } else {
             // Error: Check errno for details
             // Common errors in non-blocking mode:
@@ -143,27 +177,27 @@ namespace vsocky {
                 case EAGAIN:      // No data available (non-blocking mode)
                     // This isn't really an error - just no data right now
                     // Caller should try again later
-                    return error_code::success;
+                    return {};
                     
                 case EINTR:
                     // Interrupted by signal - caller should retry
                     // Even with SA_RESTART, some conditions cause EINTR
-                    return error_code::interrupted;
+                    return {error_code::interrupted, EINTR};
                     
                 case ECONNRESET:
                     // Connection reset by peer (ungraceful close)
                     // Different from EOF - this is an error condition
-                    return error_code::connection_closed;
+                    return {error_code::connection_closed, ECONNRESET};
                     
                 case EBADF:
                 case ENOTCONN:
                 case ENOTSOCK:
                     // Programming errors - fd isn't valid/connected
-                    return error_code::read_failed;
+                    return {error_code::read_failed, errno};
                     
                 default:
                     // Other errors (EFAULT, EIO, etc.)
-                    return error_code::read_failed;
+                    return {error_code::read_failed, errno};
             }
         }
     }
@@ -171,15 +205,15 @@ namespace vsocky {
     // =============================================================================
     // WRITE OPERATION - Sending Data
     // =============================================================================
-    std::error_code Connection::write(std::span<const uint8_t> data, size_t& bytes_written) noexcept {
+    sys_error Connection::write(std::span<const uint8_t> data, size_t& bytes_written) noexcept {
         bytes_written = 0;  // Always initialize output parameters
         
         if (fd_ == -1) {
-            return error_code::connection_closed;
+            return {error_code::connection_closed};
         }
         
         if (data.empty()) {
-            return error_code::success;  // Nothing to write
+            return {};  // Nothing to write
         }
         
         // ==========================================================================
@@ -202,37 +236,195 @@ namespace vsocky {
         if (result >= 0) {
             // Success: Wrote some data (possibly 0 bytes in non-blocking mode)
             bytes_written = static_cast<size_t>(result);
-            return error_code::success;
+            return {};
         } else {
             // Error: Check errno for details
             switch (errno) {
                 case EAGAIN:
                     // Output buffer is full - caller should try again later
                     // This is normal in non-blocking mode
-                    return error_code::success;
+                    return {};
                     
                 case EINTR:
                     // Interrupted by signal
-                    return error_code::interrupted;
+                    return {error_code::interrupted, EINTR};
                     
                 case EPIPE:
                 case ECONNRESET:
                     // Peer closed the connection
                     // EPIPE: Writing to a closed pipe/socket
                     // ECONNRESET: Connection reset by peer
-                    return error_code::connection_closed;
+                    return {error_code::connection_closed, errno};
                     
                 case EBADF:
                 case ENOTCONN:
                 case ENOTSOCK:
                     // Programming errors
-                    return error_code::write_failed;
+                    return {error_code::write_failed, errno};
                     
                 default:
                     // Other errors (EFAULT, EIO, ENOSPC, etc.)
-                    return error_code::write_failed;
+                    return {error_code::write_failed, errno};
+            }
+        }
+    }
+
+    // =============================================================================
+    // WRITE ALL - Looping Over Partial Writes
+    // =============================================================================
+    sys_error Connection::write_all(std::span<const uint8_t> data, int timeout_ms) noexcept {
+        while (!data.empty()) {
+            size_t written = 0;
+            auto ec = write(data, written);
+            if (ec && ec != error_code::interrupted) {
+                return ec;
+            }
+            
+            if (written == 0) {
+                // Socket buffer full (EAGAIN) - wait for space rather than spin
+                if (const auto waited = wait_for(fd_, POLLOUT, timeout_ms)) {
+                    return waited;
+                }
+                continue;
+            }
+            
+            data = data.subspan(written);
+        }
+        
+        return {};
+    }
+
+    // =========================================================================
+    // ZERO-COPY FILE TRANSFER
+    // =========================================================================
+    // read() + write() copies every byte twice (kernel -> user -> kernel).
+    // sendfile() moves it kernel-to-kernel: the socket takes the pages
+    // straight from the file's page cache.
+    //
+    // sendfile() refuses some fd combinations (EINVAL: e.g. a procfs file,
+    // ENOSYS: ancient kernels). Then we fall back to pread() + write_all(),
+    // which is slower but always works.
+    // =========================================================================
+    sys_error Connection::send_file(int in_fd, uint64_t offset, size_t count,
+                                    int timeout_ms) noexcept {
+        auto off = static_cast<off_t>(offset);
+        
+        while (count > 0) {
+            const ssize_t sent = ::sendfile(fd_, in_fd, &off, count);
+            if (sent > 0) {
+                count -= static_cast<size_t>(sent);
+                continue;
+            }
+            if (sent == 0) {
+                return {error_code::read_failed, 0};  // File shorter than promised
+            }
+            
+            switch (errno) {
+                case EINTR:
+                    continue;
+                case EAGAIN:
+                    if (const auto waited = wait_for(fd_, POLLOUT, timeout_ms)) {
+                        return waited;
+                    }
+                    continue;
+                case EPIPE:
+                case ECONNRESET:
+                    return {error_code::connection_closed, errno};
+                case EINVAL:
+                case ENOSYS:
+                    break;  // Fallback below
+                default:
+                    return {error_code::write_failed, errno};
+            }
+            
+            uint8_t buffer[64 * 1024];
+            while (count > 0) {
+                const ssize_t n = ::pread(in_fd, buffer, std::min(count, sizeof(buffer)), off);
+                if (n < 0 && errno == EINTR) {
+                    continue;
+                }
+                if (n <= 0) {
+                    return {error_code::read_failed, n < 0 ? errno : 0};
+                }
+                if (auto ec = write_all(std::span(buffer, static_cast<size_t>(n)), timeout_ms)) {
+                    return ec;
+                }
+                off += n;
+                count -= static_cast<size_t>(n);
+            }
+        }
+        
+        return {};
+    }
+
+    namespace {
+        // =========================================================================
+        // NON-BLOCKING CONNECT
+        // =========================================================================
+        // A blocking connect() can hang for a long time if nobody is listening
+        // yet. Instead we:
+        // 1. Create the socket non-blocking (SOCK_NONBLOCK)
+        // 2. connect() returns EINPROGRESS immediately
+        // 3. poll() for writability with our own timeout
+        // 4. Read SO_ERROR to learn whether the connect actually succeeded
+        // =========================================================================
+        std::expected<Connection, std::error_code>
+        connect_to(int family, const struct sockaddr* addr, socklen_t len, int timeout_ms) noexcept {
+            int fd = ::socket(family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+            if (fd == -1) {
+                return std::unexpected(make_error_code(error_code::socket_creation_failed));
+            }
+            Connection conn(fd);  // Owns fd from here on - closes it on every error path
+            
+            if (::connect(fd, addr, len) == 0) {
+                return conn;
             }
+            if (errno != EINPROGRESS && errno != EAGAIN) {
+                return std::unexpected(make_error_code(error_code::connect_failed));
+            }
+            
+            if (auto ec = conn.wait_writable(timeout_ms); ec == error_code::timeout) {
+                return std::unexpected(ec);
+            }
+            
+            int so_error = 0;
+            socklen_t so_len = sizeof(so_error);
+            if (::getsockopt(fd, SOL_SOCKET, SO_ERROR, &so_error, &so_len) != 0 || so_error != 0) {
+                return std::unexpected(make_error_code(error_code::connect_failed));
+            }
+            
+            return conn;
+        }
+    } // anonymous namespace
+
+    std::error_code Connection::wait_readable(int timeout_ms) const noexcept {
+        return wait_for(fd_, POLLIN, timeout_ms);
+    }
+
+    std::error_code Connection::wait_writable(int timeout_ms) const noexcept {
+        return wait_for(fd_, POLLOUT, timeout_ms);
+    }
+
+    std::expected<Connection, std::error_code>
+    Connection::connect_vsock(uint32_t cid, uint32_t port, int timeout_ms) noexcept {
+        struct sockaddr_vm addr{};
+        addr.svm_family = AF_VSOCK;
+        addr.svm_cid = cid;
+        addr.svm_port = port;
+        return connect_to(AF_VSOCK, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr),
+                          timeout_ms);
+    }
+
+    std::expected<Connection, std::error_code>
+    Connection::connect_unix(std::string_view path, int timeout_ms) noexcept {
+        struct sockaddr_un addr{};
+        addr.sun_family = AF_UNIX;
+        if (path.size() >= sizeof(addr.sun_path)) {
+            return std::unexpected(make_error_code(error_code::invalid_field_value));
         }
+        std::memcpy(addr.sun_path, path.data(), path.size());
+        return connect_to(AF_UNIX, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr),
+                          timeout_ms);
     }
 
     // =============================================================================
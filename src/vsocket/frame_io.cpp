@@ -0,0 +1,58 @@
+#include "vsocky/vsocket/frame_io.hpp"
+#include "vsocky/utils/probes.hpp"
+
+#include <array>
+#include <chrono>
+
+namespace vsocky {
+
+std::error_code send_frame(Connection& conn,
+                           frame_type type,
+                           std::span<const uint8_t> payload,
+                           int timeout_ms) noexcept {
+    const auto header = encode_frame_header(type, static_cast<uint32_t>(payload.size()));
+    if (auto ec = conn.write_all(header, timeout_ms)) {
+        return ec;
+    }
+    if (auto ec = conn.write_all(payload, timeout_ms)) {
+        return ec;
+    }
+    VSOCKY_PROBE2(frame_write, static_cast<uint32_t>(type), payload.size());
+    return error_code::success;
+}
+
+std::expected<Frame, std::error_code>
+receive_frame(Connection& conn, MessageFramer& framer, int timeout_ms) {
+    // The timeout covers the whole frame, not each individual read
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+    std::array<uint8_t, 16 * 1024> buffer;
+
+    while (true) {
+        if (auto frame = framer.next()) {
+            return std::move(*frame);
+        }
+        if (framer.error()) {
+            return std::unexpected(framer.error());
+        }
+
+        const auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+            deadline - std::chrono::steady_clock::now());
+        if (left.count() <= 0) {
+            return std::unexpected(make_error_code(error_code::timeout));
+        }
+        if (auto ec = conn.wait_readable(static_cast<int>(left.count()))) {
+            return std::unexpected(ec);
+        }
+
+        size_t n = 0;
+        auto ec = conn.read(buffer, n);
+        if (ec && ec != error_code::interrupted) {
+            return std::unexpected(ec);
+        }
+        if (auto feed_ec = framer.feed(std::span(buffer.data(), n))) {
+            return std::unexpected(feed_ec);
+        }
+    }
+}
+
+} // namespace vsocky
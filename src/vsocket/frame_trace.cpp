@@ -0,0 +1,203 @@
+#include "vsocky/vsocket/frame_trace.hpp"
+#include "vsocky/protocol/byte_order.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <utility>
+
+#include <fcntl.h>   // open()
+#include <unistd.h>  // write(), close()
+
+namespace vsocky {
+
+namespace {
+
+constexpr size_t flush_threshold = 64 * 1024;
+constexpr size_t file_header_size = sizeof(frame_trace_magic) + 4 + 8;
+
+void put_varint(std::vector<uint8_t>& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+bool get_varint(const uint8_t*& p, const uint8_t* end, uint64_t& value) noexcept {
+    value = 0;
+    for (unsigned shift = 0; shift < 64 && p < end; shift += 7) {
+        const uint8_t byte = *p++;
+        value |= uint64_t{byte & 0x7Fu} << shift;
+        if (!(byte & 0x80)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool write_all_fd(int fd, const uint8_t* data, size_t size) noexcept {
+    while (size > 0) {
+        const ssize_t n = ::write(fd, data, size);
+        if (n == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data += n;
+        size -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+} // anonymous namespace
+
+std::expected<FrameTraceWriter, std::error_code>
+FrameTraceWriter::open(const std::string& path, uint64_t max_bytes) {
+    FrameTraceWriter writer;
+    writer.fd_ = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (writer.fd_ == -1) {
+        return std::unexpected(make_error_code(error_code::resource_unavailable));
+    }
+    writer.max_bytes_ = max_bytes;
+    writer.last_ = std::chrono::steady_clock::now();
+    writer.buffer_.reserve(flush_threshold + frame_header_size + 20);
+
+    const auto epoch_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    writer.buffer_.insert(writer.buffer_.end(), std::begin(frame_trace_magic), std::end(frame_trace_magic));
+    append_be(writer.buffer_, frame_trace_version, 4);
+    append_be(writer.buffer_, static_cast<uint64_t>(epoch_ns), 8);
+    writer.written_ = writer.buffer_.size();
+    if (writer.flush()) {
+        return std::unexpected(make_error_code(error_code::resource_unavailable));
+    }
+    return writer;
+}
+
+FrameTraceWriter::FrameTraceWriter(FrameTraceWriter&& other) noexcept {
+    std::lock_guard lock(other.mutex_);
+    fd_ = std::exchange(other.fd_, -1);
+    max_bytes_ = other.max_bytes_;
+    written_ = other.written_;
+    frames_ = other.frames_;
+    truncated_ = other.truncated_;
+    last_ = other.last_;
+    buffer_ = std::move(other.buffer_);
+    next_connection_.store(other.next_connection_.load());
+}
+
+FrameTraceWriter::~FrameTraceWriter() noexcept {
+    if (fd_ != -1) {
+        flush();
+        ::close(fd_);
+    }
+}
+
+void FrameTraceWriter::record(uint32_t connection_id, const Frame& frame) noexcept {
+    const auto now = std::chrono::steady_clock::now();
+    std::lock_guard lock(mutex_);
+    if (fd_ == -1 || truncated_) {
+        return;
+    }
+
+    // Worst case: two 10-byte varints
+    const uint64_t size = 20 + frame_header_size + frame.payload.size();
+    if (written_ + size > max_bytes_) {
+        truncated_ = true;
+        return;
+    }
+
+    const size_t before = buffer_.size();
+    try {
+        const auto delta = std::chrono::duration_cast<std::chrono::nanoseconds>(now - last_).count();
+        put_varint(buffer_, static_cast<uint64_t>(std::max<int64_t>(delta, 0)));
+        put_varint(buffer_, connection_id);
+        const auto header = encode_frame_header(frame.type, static_cast<uint32_t>(frame.payload.size()));
+        buffer_.insert(buffer_.end(), header.begin(), header.end());
+        buffer_.insert(buffer_.end(), frame.payload.begin(), frame.payload.end());
+    } catch (...) {
+        buffer_.resize(before);  // Out of memory: lose this frame, keep the file consistent
+        return;
+    }
+    last_ = now;
+    written_ += buffer_.size() - before;
+    ++frames_;
+
+    if (buffer_.size() >= flush_threshold) {
+        flush_locked();
+    }
+}
+
+std::error_code FrameTraceWriter::flush() noexcept {
+    std::lock_guard lock(mutex_);
+    return flush_locked();
+}
+
+std::error_code FrameTraceWriter::flush_locked() noexcept {
+    if (buffer_.empty()) {
+        return error_code::success;
+    }
+    const bool ok = write_all_fd(fd_, buffer_.data(), buffer_.size());
+    buffer_.clear();
+    if (!ok) {
+        truncated_ = true;  // Disk full or similar - stop instead of writing holes
+        return error_code::write_failed;
+    }
+    return error_code::success;
+}
+
+uint64_t FrameTraceWriter::frames() const noexcept {
+    std::lock_guard lock(mutex_);
+    return frames_;
+}
+
+bool FrameTraceWriter::truncated() const noexcept {
+    std::lock_guard lock(mutex_);
+    return truncated_;
+}
+
+std::expected<std::vector<trace_record>, std::error_code> read_frame_trace(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        return std::unexpected(make_error_code(error_code::resource_unavailable));
+    }
+    const std::vector<uint8_t> data{std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+
+    if (data.size() < file_header_size ||
+        std::memcmp(data.data(), frame_trace_magic, sizeof(frame_trace_magic)) != 0 ||
+        get_be(data.data() + sizeof(frame_trace_magic), 4) != frame_trace_version) {
+        return std::unexpected(make_error_code(error_code::invalid_message_format));
+    }
+
+    std::vector<trace_record> records;
+    const uint8_t* p = data.data() + file_header_size;
+    const uint8_t* const end = data.data() + data.size();
+    uint64_t offset = 0;
+    bool first = true;
+    while (p < end) {
+        uint64_t delta, connection;
+        if (!get_varint(p, end, delta) || !get_varint(p, end, connection) ||
+            static_cast<size_t>(end - p) < frame_header_size) {
+            break;
+        }
+        const uint64_t length = get_be(p, 4);
+        const auto type = static_cast<frame_type>(p[4]);
+        p += frame_header_size;
+        if (static_cast<uint64_t>(end - p) < length) {
+            break;  // Torn last record
+        }
+
+        // The first delta is from when recording started, not a frame
+        offset = first ? 0 : offset + delta;
+        first = false;
+        records.push_back({offset, static_cast<uint32_t>(connection), Frame{type, {p, p + length}}});
+        p += length;
+    }
+    return records;
+}
+
+} // namespace vsocky
@@ -0,0 +1,69 @@
+#include "vsocky/vsocket/message_framer.hpp"
+#include "vsocky/vsocket/frame_trace.hpp"
+#include "vsocky/utils/probes.hpp"
+
+namespace vsocky {
+
+std::error_code MessageFramer::feed(std::span<const uint8_t> data) {
+    if (error_) {
+        return error_;
+    }
+
+    // =========================================================================
+    // LAZY COMPACTION
+    // =========================================================================
+    // Once more than half of the buffer is already-consumed frames, shift the
+    // unread tail to the front. Doing it per frame would be O(n^2) for a burst
+    // of small frames; doing it never would grow the buffer forever.
+    // =========================================================================
+    if (consumed_ > 0 && consumed_ * 2 >= buffer_.size()) {
+        buffer_.erase(buffer_.begin(), buffer_.begin() + static_cast<std::ptrdiff_t>(consumed_));
+        consumed_ = 0;
+    }
+
+    buffer_.insert(buffer_.end(), data.begin(), data.end());
+
+    // Validate the next header as soon as we have it, so an oversized length
+    // is rejected before we buffer megabytes of garbage
+    if (buffered() >= frame_header_size &&
+        get_be32(buffer_.data() + consumed_) > max_payload_) {
+        error_ = error_code::message_too_large;
+    }
+
+    return error_;
+}
+
+std::optional<Frame> MessageFramer::next() {
+    if (error_ || buffered() < frame_header_size) {
+        return std::nullopt;
+    }
+
+    const uint8_t* header = buffer_.data() + consumed_;
+    const uint32_t length = get_be32(header);
+    if (length > max_payload_) {
+        error_ = error_code::message_too_large;
+        return std::nullopt;
+    }
+    if (buffered() < frame_header_size + length) {
+        return std::nullopt;
+    }
+
+    Frame frame{static_cast<frame_type>(header[4]), {}};
+    const auto* payload = header + frame_header_size;
+    frame.payload.assign(payload, payload + length);
+    consumed_ += frame_header_size + length;
+    VSOCKY_PROBE2(frame_read, static_cast<uint32_t>(frame.type), length);
+    if (trace_ != nullptr) {
+        trace_->record(trace_connection_, frame);
+    }
+
+    if (consumed_ == buffer_.size()) {
+        // Everything handed out - cheap full reset
+        buffer_.clear();
+        consumed_ = 0;
+    }
+
+    return frame;
+}
+
+} // namespace vsocky
@@ -0,0 +1,56 @@
+#include "vsocky/vsocket/ready_notifier.hpp"
+#include "vsocky/vsocket/frame_io.hpp"
+#include "vsocky/protocol/json_writer.hpp"
+
+namespace vsocky {
+
+std::string build_ready_message(const ready_info& info) {
+    JsonWriter w(256);
+    w.begin_object();
+    w.key("type").value("ready");
+    w.key("version").value(info.version);
+    w.key("port").value(info.listen_port);
+
+    w.key("capabilities").begin_array();
+    for (auto capability : info.capabilities) {
+        w.value(capability);
+    }
+    w.end_array();
+
+    w.key("warm_pool").begin_object();
+    w.key("enabled").value(info.warm_pool.enabled);
+    w.key("ready").value(info.warm_pool.ready);
+    w.key("target").value(info.warm_pool.target);
+    w.end_object();
+
+    w.end_object();
+    return w.take();
+}
+
+std::error_code send_ready(Connection& conn, const ready_info& info, int timeout_ms) noexcept {
+    std::string payload;
+    try {
+        payload = build_ready_message(info);
+    } catch (...) {
+        return error_code::resource_unavailable;
+    }
+
+    return send_frame(conn,
+                      frame_type::json,
+                      std::span(reinterpret_cast<const uint8_t*>(payload.data()), payload.size()),
+                      timeout_ms);
+}
+
+std::error_code notify_host_ready(uint32_t cid,
+                                  uint32_t port,
+                                  const ready_info& info,
+                                  int timeout_ms) noexcept {
+    auto conn = Connection::connect_vsock(cid, port, timeout_ms);
+    if (!conn) {
+        return conn.error();
+    }
+    return send_ready(*conn, info, timeout_ms);
+    // Connection closes here; the host reads the frame, then sees EOF
+}
+
+} // namespace vsocky
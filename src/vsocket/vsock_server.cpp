@@ -0,0 +1,145 @@
+#include "vsocky/vsocket/vsock_server.hpp"
+#include "vsocky/utils/probes.hpp"
+
+#include <unistd.h>      // close(), unlink()
+#include <sys/socket.h>  // socket(), bind(), listen(), accept4()
+#include <sys/un.h>      // sockaddr_un
+#include <cerrno>
+#include <cstring>
+#include <utility>
+
+namespace vsocky {
+
+VSockServer::~VSockServer() noexcept {
+    close();
+}
+
+VSockServer::VSockServer(VSockServer&& other) noexcept
+    : fd_(std::exchange(other.fd_, -1)),
+      port_(std::exchange(other.port_, 0)),
+      unix_path_(std::move(other.unix_path_)) {
+    other.unix_path_.clear();
+}
+
+VSockServer& VSockServer::operator=(VSockServer&& other) noexcept {
+    if (this != &other) {
+        close();
+        fd_ = std::exchange(other.fd_, -1);
+        port_ = std::exchange(other.port_, 0);
+        unix_path_ = std::move(other.unix_path_);
+        other.unix_path_.clear();
+    }
+    return *this;
+}
+
+std::error_code VSockServer::listen(uint32_t port, uint32_t cid, int backlog) noexcept {
+    close();
+
+    // SOCK_NONBLOCK: accept() must never block the event loop
+    // SOCK_CLOEXEC: don't leak the listening socket into executed programs
+    int fd = ::socket(AF_VSOCK, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd == -1) {
+        return error_code::socket_creation_failed;
+    }
+
+    struct sockaddr_vm addr{};
+    addr.svm_family = AF_VSOCK;
+    addr.svm_cid = cid;
+    addr.svm_port = port;
+
+    if (::bind(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) != 0) {
+        ::close(fd);
+        return error_code::bind_failed;
+    }
+    if (::listen(fd, backlog) != 0) {
+        ::close(fd);
+        return error_code::listen_failed;
+    }
+
+    fd_ = fd;
+    port_ = port;
+    return error_code::success;
+}
+
+std::error_code VSockServer::listen_unix(std::string_view path, int backlog) noexcept {
+    close();
+
+    struct sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    if (path.empty() || path.size() >= sizeof(addr.sun_path)) {
+        return error_code::invalid_field_value;
+    }
+    std::memcpy(addr.sun_path, path.data(), path.size());
+
+    int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd == -1) {
+        return error_code::socket_creation_failed;
+    }
+
+    // A socket file left behind by a previous run would make bind() fail
+    ::unlink(addr.sun_path);
+
+    if (::bind(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) != 0) {
+        ::close(fd);
+        return error_code::bind_failed;
+    }
+    if (::listen(fd, backlog) != 0) {
+        ::close(fd);
+        ::unlink(addr.sun_path);
+        return error_code::listen_failed;
+    }
+
+    try {
+        unix_path_.assign(path);
+    } catch (...) {
+        ::close(fd);
+        ::unlink(addr.sun_path);
+        return error_code::resource_unavailable;
+    }
+    fd_ = fd;
+    return error_code::success;
+}
+
+std::error_code VSockServer::accept(Connection& out) noexcept {
+    out.close();
+
+    if (fd_ == -1) {
+        return error_code::connection_closed;
+    }
+
+    // accept4() lets us set the flags atomically on the new socket
+    int client = ::accept4(fd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (client == -1) {
+        switch (errno) {
+            case EAGAIN:
+                // Nobody waiting - not an error in non-blocking mode
+                return error_code::success;
+            case EINTR:
+                return error_code::interrupted;
+            case ECONNABORTED:
+                // Client gave up between SYN and accept - just skip it
+                return error_code::success;
+            default:
+                // EMFILE/ENFILE (out of fds), ENOMEM, ...
+                return error_code::accept_failed;
+        }
+    }
+
+    VSOCKY_PROBE1(accept, client);
+    out = Connection(client);
+    return error_code::success;
+}
+
+void VSockServer::close() noexcept {
+    if (fd_ != -1) {
+        ::close(fd_);
+        fd_ = -1;
+    }
+    if (!unix_path_.empty()) {
+        ::unlink(unix_path_.c_str());
+        unix_path_.clear();
+    }
+    port_ = 0;
+}
+
+} // namespace vsocky
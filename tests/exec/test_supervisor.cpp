@@ -0,0 +1,1261 @@
+#include "vsocky/exec/namespace_pool.hpp"
+#include "vsocky/exec/perf_counters.hpp"
+#include "vsocky/exec/request_pipeline.hpp"
+#include "vsocky/exec/spsc_ring.hpp"
+#include "vsocky/exec/supervisor.hpp"
+#include "vsocky/exec/uid_pool.hpp"
+#include "vsocky/exec/workspace_template.hpp"
+#include "vsocky/protocol/cancel_frames.hpp"
+#include "vsocky/utils/deadline.hpp"
+#include "vsocky/utils/cpu_partition.hpp"
+
+#include <cassert>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <net/if.h>
+#include <fcntl.h>
+#include <mqueue.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/ioctl.h>
+#include <sys/mount.h>
+#include <sys/shm.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// =============================================================================
+// SUPERVISOR / SPSC RING UNIT TESTS
+// =============================================================================
+// The ring is tested on its own (single thread, then two threads with the
+// eventfd wakeup protocol), then the real supervisor process is started and
+// driven through spawn, failure, limits and kill. Jobs are plain /bin/sh
+// commands; only the pooled-UID and namespace tests need root (and are
+// skipped without it).
+// =============================================================================
+
+namespace vsocky::test {
+
+using small_ring = spsc_ring<uint64_t, 4>;
+
+void test_ring_basics() {
+    std::cout << "Testing SPSC ring basics..." << std::endl;
+
+    auto storage = std::make_unique<small_ring::storage>();
+    small_ring producer(storage.get());
+    small_ring consumer(storage.get());
+
+    uint64_t value = 0;
+    bool popped = consumer.try_pop(value);
+    assert(!popped);
+    assert(consumer.consumer_may_sleep());
+
+    // First push into an empty ring: the consumer may be asleep
+    auto pushed = producer.try_push(1);
+    assert(pushed == ring_push_result::pushed_wake);
+    // Consumer hasn't caught up: no wakeup needed
+    for (uint64_t i = 2; i <= 4; ++i) {
+        pushed = producer.try_push(i);
+        assert(pushed == ring_push_result::pushed);
+    }
+    pushed = producer.try_push(5);
+    assert(pushed == ring_push_result::full);
+
+    assert(!consumer.consumer_may_sleep());
+    for (uint64_t expected = 1; expected <= 4; ++expected) {
+        popped = consumer.try_pop(value);
+        assert(popped && value == expected);
+    }
+    popped = consumer.try_pop(value);
+    assert(!popped);
+
+    // Wraps around the slot array
+    pushed = producer.try_push(6);
+    assert(pushed == ring_push_result::pushed_wake);
+    popped = consumer.try_pop(value);
+    assert(popped && value == 6);
+
+    std::cout << "✓ Push/pop, full detection and wake hints" << std::endl;
+}
+
+void test_ring_threads() {
+    std::cout << "Testing SPSC ring across threads..." << std::endl;
+
+    using ring = spsc_ring<uint64_t, 64>;
+    auto storage = std::make_unique<ring::storage>();
+    const int event_fd = eventfd(0, EFD_CLOEXEC);
+    constexpr uint64_t count = 200'000;
+
+    // Consumer sleeps on the eventfd whenever the ring is empty - if a
+    // wakeup were ever lost, this would hang (and the test time out)
+    std::thread consumer_thread([&] {
+        ring consumer(storage.get());
+        uint64_t expected = 0;
+        while (expected < count) {
+            uint64_t value;
+            if (consumer.try_pop(value)) {
+                assert(value == expected);
+                ++expected;
+                continue;
+            }
+            if (consumer.consumer_may_sleep()) {
+                uint64_t counter;
+                const ssize_t n = read(event_fd, &counter, sizeof(counter));
+                assert(n == sizeof(counter));
+            }
+        }
+    });
+
+    ring producer(storage.get());
+    size_t wakes = 0;
+    for (uint64_t i = 0; i < count;) {
+        const auto result = producer.try_push(i);
+        if (result == ring_push_result::full) {
+            std::this_thread::yield();
+            continue;
+        }
+        if (result == ring_push_result::pushed_wake) {
+            const uint64_t one = 1;
+            const ssize_t n = write(event_fd, &one, sizeof(one));
+            assert(n == sizeof(one));
+            ++wakes;
+        }
+        ++i;
+    }
+    consumer_thread.join();
+    close(event_fd);
+
+    std::cout << "✓ " << count << " items in order, " << wakes << " wakeups" << std::endl;
+}
+
+supervisor_command make_spawn(uint64_t id, std::initializer_list<std::string_view> argv) {
+    supervisor_command cmd;
+    cmd.op = supervisor_op::spawn;
+    cmd.request_id = id;
+    const std::vector<std::string_view> args(argv);
+    const bool fits = set_command_args(cmd, args);
+    assert(fits);
+    return cmd;
+}
+
+// Wait for the next completion for request `id` of the given kind
+supervisor_completion expect(SupervisorClient& supervisor, uint64_t id, supervisor_event event) {
+    supervisor_completion c;
+    const bool arrived = supervisor.wait(c, 5000);
+    assert(arrived);
+    assert(c.request_id == id);
+    assert(c.event == event);
+    return c;
+}
+
+// assert() is compiled out under NDEBUG: calls that do something go
+// through these, so the tests still run their jobs then
+void submit(SupervisorClient& supervisor, const supervisor_command& cmd) {
+    const auto ec = supervisor.submit(cmd);
+    assert(!ec);
+}
+
+void set_path(std::array<char, max_exec_path_bytes>& field, std::string_view path) {
+    const bool fits = set_command_path(field, path);
+    assert(fits);
+}
+
+void set_template(supervisor_command& cmd, std::string_view name) {
+    const bool valid = set_command_template(cmd, name);
+    assert(valid);
+}
+
+void make_dir(const std::string& path, mode_t mode = 0755) {
+    const int rc = mkdir(path.c_str(), mode);
+    assert(rc == 0);
+}
+
+void test_supervisor(const std::string& dir) {
+    std::cout << "Testing supervisor process..." << std::endl;
+
+    supervisor_options options;
+    options.workspace_root = dir;
+    auto started = start_supervisor(options);
+    assert(started.has_value());
+    SupervisorClient& supervisor = *started;
+    assert(supervisor.pid() > 0);
+
+    // Exit codes
+    submit(supervisor, make_spawn(1, {"true"}));
+    auto run = expect(supervisor, 1, supervisor_event::started);
+    assert(run.pid > 0);
+    auto done = expect(supervisor, 1, supervisor_event::exited);
+    assert(done.exit_code == 0 && done.term_signal == 0);
+
+    submit(supervisor, make_spawn(2, {"sh", "-c", "exit 3"}));
+    expect(supervisor, 2, supervisor_event::started);
+    const auto three = expect(supervisor, 2, supervisor_event::exited);
+    assert(three.exit_code == 3);
+
+    // exec failure is reported, not mistaken for exit code 127
+    submit(supervisor, make_spawn(3, {"/nonexistent/binary"}));
+    const auto no_binary = expect(supervisor, 3, supervisor_event::spawn_failed);
+    assert(no_binary.error_number == ENOENT);
+
+    // Malformed command from the front end
+    supervisor_command bad;
+    bad.request_id = 4;
+    submit(supervisor, bad);
+    const auto malformed = expect(supervisor, 4, supervisor_event::spawn_failed);
+    assert(malformed.error_number == EINVAL);
+
+    // Working directory + stdout redirection
+    const std::string work = dir + "/basic";
+    make_dir(work);
+    auto echo = make_spawn(5, {"sh", "-c", "echo hello; pwd"});
+    set_path(echo.workdir, work);
+    set_path(echo.stdout_path, "out.txt");
+    submit(supervisor, echo);
+    expect(supervisor, 5, supervisor_event::started);
+    const auto echoed = expect(supervisor, 5, supervisor_event::exited);
+    assert(echoed.exit_code == 0);
+    std::ifstream out(work + "/out.txt");
+    assert(std::string(std::istreambuf_iterator<char>(out), {}) == "hello\n" + work + "\n");
+
+    // Wall-clock limit
+    auto slow = make_spawn(6, {"sleep", "5"});
+    slow.wall_time_limit_ms = 100;
+    submit(supervisor, slow);
+    expect(supervisor, 6, supervisor_event::started);
+    auto timed_out = expect(supervisor, 6, supervisor_event::exited);
+    assert(timed_out.wall_time_exceeded && timed_out.term_signal == SIGKILL);
+    assert(timed_out.wall_time_us >= 100'000 && timed_out.wall_time_us < 4'000'000);
+
+    // Kill on request
+    submit(supervisor, make_spawn(7, {"sleep", "5"}));
+    expect(supervisor, 7, supervisor_event::started);
+    const auto kill_ec = supervisor.kill(7);
+    assert(!kill_ec);
+    auto killed = expect(supervisor, 7, supervisor_event::exited);
+    assert(killed.term_signal == SIGKILL && !killed.wall_time_exceeded);
+
+    // Shutdown takes running jobs down with it
+    submit(supervisor, make_spawn(8, {"sleep", "5"}));
+    const pid_t orphan = expect(supervisor, 8, supervisor_event::started).pid;
+    supervisor.shutdown();
+    assert(::kill(orphan, 0) == -1);
+    const auto after_shutdown = supervisor.submit(make_spawn(9, {"true"}));
+    assert(after_shutdown == error_code::resource_unavailable);
+
+    std::cout << "✓ Spawn, failures, limits and kill go through the rings" << std::endl;
+}
+
+void test_deadlines() {
+    std::cout << "Testing request deadlines..." << std::endl;
+
+    auto started = start_supervisor();
+    assert(started.has_value());
+    SupervisorClient& supervisor = *started;
+
+    // Expired while queued: dropped without running
+    auto stale = make_spawn(1, {"touch", "/tmp/vsocky_test_stale_ran"});
+    stale.deadline_ns = monotonic_now_ns() - 1;
+    submit(supervisor, stale);
+    const auto dropped = expect(supervisor, 1, supervisor_event::expired);
+    assert(dropped.pid == 0);
+    assert(::access("/tmp/vsocky_test_stale_ran", F_OK) != 0);
+
+    // Runs, but only for what's left of the budget
+    auto slow = make_spawn(2, {"sleep", "5"});
+    slow.wall_time_limit_ms = 10'000;
+    slow.deadline_ns = resolve_deadline({.budget_ms = 150}, monotonic_now_ns(), unix_now_ms());
+    submit(supervisor, slow);
+    expect(supervisor, 2, supervisor_event::started);
+    auto capped = expect(supervisor, 2, supervisor_event::exited);
+    assert(capped.wall_time_exceeded && capped.deadline_exceeded && capped.term_signal == SIGKILL);
+    assert(capped.wall_time_us < 4'000'000);
+
+    // The job's own limit, when it's the tighter one, isn't blamed on the deadline
+    auto limited = make_spawn(3, {"sleep", "5"});
+    limited.wall_time_limit_ms = 100;
+    limited.deadline_ns = resolve_deadline({.budget_ms = 60'000}, monotonic_now_ns(), unix_now_ms());
+    submit(supervisor, limited);
+    expect(supervisor, 3, supervisor_event::started);
+    auto own = expect(supervisor, 3, supervisor_event::exited);
+    assert(own.wall_time_exceeded && !own.deadline_exceeded);
+
+    // A deadline that leaves room changes nothing
+    auto quick = make_spawn(4, {"true"});
+    quick.deadline_ns = resolve_deadline({.budget_ms = 60'000}, monotonic_now_ns(), unix_now_ms());
+    submit(supervisor, quick);
+    expect(supervisor, 4, supervisor_event::started);
+    auto fine = expect(supervisor, 4, supervisor_event::exited);
+    assert(fine.exit_code == 0 && !fine.wall_time_exceeded && !fine.deadline_exceeded);
+
+    std::cout << "✓ Expired work is dropped and limits are capped at the deadline" << std::endl;
+}
+
+void test_perf_counters() {
+    std::cout << "Testing perf counters..." << std::endl;
+
+    auto started = start_supervisor();
+    assert(started.has_value());
+    SupervisorClient& supervisor = *started;
+
+    // task-clock is a software counter: available even without a PMU
+    auto busy = make_spawn(1, {"sh", "-c", "i=0; while [ $i -lt 20000 ]; do i=$((i+1)); done"});
+    busy.perf_counters = perf_instructions | perf_task_clock;
+    submit(supervisor, busy);
+    expect(supervisor, 1, supervisor_event::started);
+    const auto measured = expect(supervisor, 1, supervisor_event::exited);
+    assert(measured.exit_code == 0 && !measured.instruction_limit_exceeded);
+    assert(measured.perf_valid & perf_task_clock);
+    assert(measured.task_clock_ns > 0);
+    const bool have_pmu = measured.perf_valid & perf_instructions;
+    assert(!have_pmu || measured.instructions > 1'000'000);
+
+    auto spin = make_spawn(2, {"sh", "-c", "while :; do :; done"});
+    spin.instruction_limit = 50'000'000;
+    spin.wall_time_limit_ms = 10'000;
+    submit(supervisor, spin);
+    if (have_pmu) {
+        expect(supervisor, 2, supervisor_event::started);
+        const auto stopped = expect(supervisor, 2, supervisor_event::exited);
+        assert(stopped.instruction_limit_exceeded && !stopped.wall_time_exceeded);
+        assert(stopped.term_signal == SIGKILL && stopped.instructions > spin.instruction_limit);
+        std::cout << "✓ Instructions and task-clock counted; budget enforced" << std::endl;
+    } else {
+        // A limit that can't be enforced refuses to run rather than run unlimited
+        const auto refused = expect(supervisor, 2, supervisor_event::spawn_failed);
+        assert(refused.error_number != 0);
+        std::cout << "✓ task-clock counted; no PMU, so the instruction budget is refused" << std::endl;
+    }
+}
+
+void test_uid_pool() {
+    std::cout << "Testing UID pool..." << std::endl;
+
+    UidPool pool(20000, 3);
+    assert(pool.capacity() == 3 && pool.available() == 3);
+
+    auto a = pool.acquire();
+    auto b = pool.acquire();
+    auto c = pool.acquire();
+    assert(a && b && c);
+    assert(a->uid == 20000 && a->gid == 20000);
+    assert(b->uid == 20001 && c->uid == 20002);
+    const auto exhausted = pool.acquire();
+    assert(!exhausted);
+
+    // Oldest released comes back first
+    pool.release(b->uid);
+    pool.release(a->uid);
+    const auto first = pool.acquire();
+    const auto second = pool.acquire();
+    assert(first && first->uid == 20001);
+    assert(second && second->uid == 20000);
+
+    // Foreign UIDs and double releases don't corrupt the free list
+    pool.release(c->uid);
+    pool.release(c->uid);
+    pool.release(0);
+    pool.release(20003);
+    assert(pool.available() == 1);
+    assert(pool.owns(20002) && !pool.owns(19999) && !pool.owns(20003));
+
+    std::cout << "✓ FIFO reuse, exhaustion and bogus releases" << std::endl;
+}
+
+bool process_alive(pid_t pid) {
+    // A killed process may linger as a zombie until init reaps it
+    std::ifstream stat("/proc/" + std::to_string(pid) + "/stat");
+    std::string line;
+    if (!std::getline(stat, line)) {
+        return false;
+    }
+    const auto paren = line.rfind(')');
+    return paren != std::string::npos && line.size() > paren + 2 && line[paren + 2] != 'Z';
+}
+
+void test_pooled_supervisor(const std::string& dir) {
+    std::cout << "Testing supervisor with a UID pool..." << std::endl;
+    if (geteuid() != 0) {
+        std::cout << "- Skipped (needs root)" << std::endl;
+        return;
+    }
+
+    supervisor_options options;
+    options.workspace_root = dir;
+    options.uid_pool_base = 47000;
+    options.uid_pool_size = 2;
+    auto started = start_supervisor(options);
+    assert(started.has_value());
+    SupervisorClient& supervisor = *started;
+
+    // The job can write into its (root-created) workspace as its own UID
+    chmod(dir.c_str(), 0755);
+    const std::string work = dir + "/pooled";
+    make_dir(work);
+    auto who = make_spawn(1, {"sh", "-c", "id -u; id -g; echo $TMPDIR"});
+    set_path(who.workdir, work);
+    set_path(who.stdout_path, "out.txt");
+    submit(supervisor, who);
+    const auto ran_as = expect(supervisor, 1, supervisor_event::started);
+    assert(ran_as.uid == 47000);
+    const auto who_done = expect(supervisor, 1, supervisor_event::exited);
+    assert(who_done.exit_code == 0);
+    std::ifstream out(work + "/out.txt");
+    assert(std::string(std::istreambuf_iterator<char>(out), {}) == "47000\n47000\n" + work + "\n");
+
+    // Concurrent jobs get distinct UIDs; a third has to wait
+    submit(supervisor, make_spawn(2, {"sleep", "5"}));
+    submit(supervisor, make_spawn(3, {"sleep", "5"}));
+    const auto uid2 = expect(supervisor, 2, supervisor_event::started).uid;
+    const auto uid3 = expect(supervisor, 3, supervisor_event::started).uid;
+    assert(uid2 != uid3 && uid2 >= 47000 && uid3 >= 47000 && uid2 < 47002 && uid3 < 47002);
+    submit(supervisor, make_spawn(4, {"true"}));
+    const auto busy = expect(supervisor, 4, supervisor_event::spawn_failed);
+    assert(busy.error_number == EAGAIN);
+    auto kill_ec = supervisor.kill(2);
+    assert(!kill_ec);
+    kill_ec = supervisor.kill(3);
+    assert(!kill_ec);
+    for (int reaped = 0; reaped < 2; ++reaped) {  // Either may be reaped first
+        supervisor_completion c;
+        const bool arrived = supervisor.wait(c, 5000);
+        assert(arrived);
+        assert(c.event == supervisor_event::exited && (c.request_id == 2 || c.request_id == 3));
+    }
+
+    // The workdir is only handed over (chowned) if it really is beneath the
+    // workspace root: not through a symlink, not outside, not via ".."
+    const std::string outside = dir + "_outside";
+    make_dir(outside);
+    const int linked = ::symlink(outside.c_str(), (dir + "/link").c_str());
+    assert(linked == 0);
+    uint64_t id = 10;
+    for (const std::string& path : {dir + "/link", dir + "/link/", outside, work + "/../../" + outside.substr(5),
+                                    dir, std::string("relative")}) {
+        auto escaping = make_spawn(id, {"true"});
+        set_path(escaping.workdir, path);
+        submit(supervisor, escaping);
+        const auto rejected = expect(supervisor, id++, supervisor_event::spawn_failed);
+        assert(rejected.error_number == ELOOP || rejected.error_number == ENOTDIR ||
+               rejected.error_number == EINVAL);
+    }
+    struct stat untouched{};
+    const int stat_rc = ::stat(outside.c_str(), &untouched);
+    assert(stat_rc == 0 && untouched.st_uid == 0);
+    const int relinked = ::symlink(outside.c_str(), (work + "/escape").c_str());
+    assert(relinked == 0);
+    auto nested = make_spawn(id, {"true"});
+    set_path(nested.workdir, work + "/escape");
+    submit(supervisor, nested);
+    const auto through_link = expect(supervisor, id, supervisor_event::spawn_failed);
+    assert(through_link.error_number == ELOOP || through_link.error_number == ENOTDIR);
+    std::system(("rm -rf " + outside).c_str());
+
+    // A daemon that escaped the process group dies before its UID is reused
+    auto escape = make_spawn(5, {"sh", "-c",
+                                 "setsid sh -c 'echo $$ > pid.tmp; mv pid.tmp pid; exec sleep 30' &"
+                                 " while [ ! -f pid ]; do :; done"});
+    set_path(escape.workdir, work);
+    submit(supervisor, escape);
+    expect(supervisor, 5, supervisor_event::started);
+    const auto escape_done = expect(supervisor, 5, supervisor_event::exited);
+    assert(escape_done.exit_code == 0);
+    std::ifstream pid_file(work + "/pid");
+    pid_t daemon = 0;
+    pid_file >> daemon;
+    assert(daemon > 0);
+    // SIGKILL is already pending when the exit is reported; give the
+    // scheduler a moment to actually run it
+    for (int i = 0; i < 100 && process_alive(daemon); ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    assert(!process_alive(daemon));
+
+    // stdio paths are opened as the job, not as root: one its UID can't
+    // write fails the spawn instead of being created for it
+    const std::string locked = dir + "/root_only";
+    make_dir(locked, 0700);
+    auto sneaky = make_spawn(6, {"true"});
+    set_path(sneaky.workdir, work);
+    set_path(sneaky.stdout_path, locked + "/out.txt");
+    submit(supervisor, sneaky);
+    const auto refused = expect(supervisor, 6, supervisor_event::spawn_failed);
+    assert(refused.error_number == EACCES);
+    assert(::access((locked + "/out.txt").c_str(), F_OK) != 0);
+
+    std::cout << "✓ Per-job UIDs, exhaustion and sweep of escaped processes" << std::endl;
+}
+
+void test_orphaned_jobs(const std::string& dir) {
+    std::cout << "Testing jobs outliving their supervisor..." << std::endl;
+    if (geteuid() != 0) {
+        std::cout << "- Skipped (needs root)" << std::endl;
+        return;
+    }
+
+    supervisor_options options;
+    options.workspace_root = dir;
+    options.uid_pool_base = 47400;
+    options.uid_pool_size = 1;
+    auto started = start_supervisor(options);
+    assert(started.has_value());
+    SupervisorClient& supervisor = *started;
+
+    // A job under a pool UID: its death signal must survive the credential
+    // switch, or nothing would stop it once the supervisor is gone
+    const std::string work = dir + "/orphaned";
+    make_dir(work);
+    auto sleeper = make_spawn(1, {"sh", "-c", "echo $$ > pid.tmp; mv pid.tmp pid; exec sleep 30"});
+    set_path(sleeper.workdir, work);
+    submit(supervisor, sleeper);
+    expect(supervisor, 1, supervisor_event::started);
+    pid_t job = 0;
+    for (int i = 0; i < 500 && job == 0; ++i) {
+        std::ifstream pid_file(work + "/pid");
+        pid_file >> job;
+        if (job == 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+    }
+    assert(job > 0 && process_alive(job));
+
+    const int killed = ::kill(supervisor.pid(), SIGKILL);
+    assert(killed == 0);
+    for (int i = 0; i < 100 && process_alive(job); ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    assert(!process_alive(job));
+
+    std::cout << "✓ Jobs die with the supervisor" << std::endl;
+}
+
+std::string namespace_id(const std::string& path) {
+    char buffer[64] = {};
+    const ssize_t n = readlink(path.c_str(), buffer, sizeof(buffer) - 1);
+    return n > 0 ? std::string(buffer, static_cast<size_t>(n)) : std::string();
+}
+
+// Run fn in a forked child inside the set; its return value is the exit code
+int in_namespaces(const namespace_set& set, int (*fn)()) {
+    const pid_t pid = fork();
+    if (pid == 0) {
+        _exit(enter_namespaces(set) ? fn() : 100);
+    }
+    int status = 0;
+    waitpid(pid, &status, 0);
+    return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+void test_cancel(const std::string& dir) {
+    std::cout << "Testing cancellation..." << std::endl;
+
+    // Wire format
+    const auto cancel = encode_cancel(0x0102030405060708);
+    assert(cancel.size() == cancel_size && cancel[0] == 0x01 && cancel[7] == 0x08);
+    assert(decode_cancel(cancel) == 0x0102030405060708u);
+    assert(!decode_cancel(std::span(cancel).first(7)).has_value());
+    auto cancelled = encode_cancelled({.request_id = 42, .outcome = cancel_outcome::killed});
+    auto decoded = decode_cancelled(cancelled);
+    assert(decoded && decoded->request_id == 42 && decoded->outcome == cancel_outcome::killed);
+    cancelled[8] = 7;
+    assert(!decode_cancelled(cancelled).has_value());
+
+    supervisor_options options;
+    options.workspace_root = dir;
+    if (geteuid() == 0) {
+        options.uid_pool_base = 47100;
+        options.uid_pool_size = 2;
+    }
+    auto started = start_supervisor(options);
+    assert(started.has_value());
+    SupervisorClient& supervisor = *started;
+
+    // Running: killed, with the whole group, and reported as cancelled
+    chmod(dir.c_str(), 0755);
+    const std::string work = dir + "/cancelled";
+    make_dir(work);
+    auto job = make_spawn(1, {"sh", "-c", "echo partial > out.txt; mkdir -p a/b; ln -s / a/root; sleep 30 & sleep 30"});
+    set_path(job.workdir, work);
+    submit(supervisor, job);
+    expect(supervisor, 1, supervisor_event::started);
+    for (int i = 0; i < 200 && ::access((work + "/a/root").c_str(), F_OK) != 0; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    auto ec = supervisor.cancel(1, work);
+    assert(!ec);
+    const auto killed = expect(supervisor, 1, supervisor_event::exited);
+    assert(killed.cancelled && killed.term_signal == SIGKILL && !killed.wall_time_exceeded);
+    assert(killed.wall_time_us < 10'000'000);
+
+    // Not running: answered straight away
+    ec = supervisor.cancel(99);
+    assert(!ec);
+    const auto missed = expect(supervisor, 99, supervisor_event::cancelled);
+    assert(!missed.cancelled && missed.pid == 0);
+    ec = supervisor.cancel(100, std::string(max_exec_path_bytes, 'x'));
+    assert(ec == error_code::invalid_field_value);
+
+    if (geteuid() != 0) {
+        std::cout << "✓ Running and finished jobs cancel (workspace release skipped, needs root)" << std::endl;
+        return;
+    }
+
+    // The job's workspace (owned by its UID by now) is gone by the time
+    // the completion arrives - the symlink in it removed, not followed
+    assert(::access(work.c_str(), F_OK) != 0);
+    assert(::access("/tmp", F_OK) == 0);
+
+    // Only workspaces the supervisor handed out can be removed that way
+    const std::string foreign = dir + "/not_a_workspace";
+    make_dir(foreign);
+    ec = supervisor.cancel(101, foreign);
+    assert(!ec);
+    expect(supervisor, 101, supervisor_event::cancelled);
+    assert(::access(foreign.c_str(), F_OK) == 0);
+
+    // Nor one whose UID is busy with another job
+    const std::string busy = dir + "/busy";
+    make_dir(busy);
+    auto other = make_spawn(2, {"sleep", "30"});
+    set_path(other.workdir, busy);
+    submit(supervisor, other);
+    expect(supervisor, 2, supervisor_event::started);
+    ec = supervisor.cancel(102, busy);
+    assert(!ec);
+    expect(supervisor, 102, supervisor_event::cancelled);
+    assert(::access(busy.c_str(), F_OK) == 0);
+
+    // Nor one reached through a symlink, even to a workspace that would do
+    const int linked = ::symlink(dir.c_str(), (dir + "/alias").c_str());
+    assert(linked == 0);
+    ec = supervisor.cancel(2, dir + "/alias/busy");
+    assert(!ec);
+    const auto cancelled_busy = expect(supervisor, 2, supervisor_event::exited);
+    assert(cancelled_busy.cancelled);
+    assert(::access(busy.c_str(), F_OK) == 0);
+    ec = supervisor.cancel(103, busy);
+    assert(!ec);
+    expect(supervisor, 103, supervisor_event::cancelled);
+    assert(::access(busy.c_str(), F_OK) != 0);
+
+    std::cout << "✓ Cancel kills, releases the UID and removes only the job's own workspace" << std::endl;
+}
+
+std::string read_fd(int fd, uint64_t size) {
+    std::string data(size, '\0');
+    const ssize_t n = ::pread(fd, data.data(), data.size(), 0);
+    assert(n == static_cast<ssize_t>(size));
+    return data;
+}
+
+void test_output_capture(const std::string& dir) {
+    std::cout << "Testing memfd output capture..." << std::endl;
+
+    supervisor_options options;
+    options.workspace_root = dir;
+    auto started = start_supervisor(options);
+    assert(started.has_value());
+    SupervisorClient& supervisor = *started;
+
+    // Both streams, 100 KB of stdout; stdout_path is ignored for a captured stream
+    const std::string work = dir + "/captured";
+    make_dir(work);
+    auto job = make_spawn(1, {"sh", "-c", "echo err >&2; head -c 100000 /dev/zero | tr '\\0' x"});
+    set_path(job.workdir, work);
+    set_path(job.stdout_path, "not_written.txt");
+    job.capture_flags = capture_stdout | capture_stderr;
+    submit(supervisor, job);
+    expect(supervisor, 1, supervisor_event::started);
+    const auto done = expect(supervisor, 1, supervisor_event::exited);
+    assert(done.exit_code == 0 && done.capture_error == 0);
+    assert(done.captured == (capture_stdout | capture_stderr));
+    assert(done.stdout_bytes == 100'000 && done.stderr_bytes == 4);
+    const auto out = read_fd(done.stdout_fd, done.stdout_bytes);
+    assert(out == std::string(100'000, 'x'));
+    const auto err = read_fd(done.stderr_fd, done.stderr_bytes);
+    assert(err == "err\n");
+    assert(::access((work + "/not_written.txt").c_str(), F_OK) != 0);
+
+    // Sealed at its final size: nobody can shrink it under a sendfile()
+    struct stat st{};
+    const int stat_rc = ::fstat(done.stdout_fd, &st);
+    assert(stat_rc == 0 && st.st_size == 100'000);
+    const int seals = ::fcntl(done.stdout_fd, F_GET_SEALS);
+    assert((seals & F_SEAL_SHRINK) && (seals & F_SEAL_GROW) && (seals & F_SEAL_SEAL));
+    const int truncated = ::ftruncate(done.stdout_fd, 0);
+    assert(truncated != 0);
+    ::close(done.stdout_fd);
+    ::close(done.stderr_fd);
+
+    // The limit: a write that doesn't fit fails, what came before stays
+    auto capped = make_spawn(2, {"sh", "-c", "printf 01234; printf 56789abcdef; echo done >&2"});
+    capped.capture_flags = capture_stdout;
+    capped.capture_limit_bytes = 10;
+    submit(supervisor, capped);
+    expect(supervisor, 2, supervisor_event::started);
+    const auto limited = expect(supervisor, 2, supervisor_event::exited);
+    assert(limited.captured == capture_stdout && limited.stderr_fd == -1);
+    assert(limited.stdout_bytes == 5);
+    const auto kept = read_fd(limited.stdout_fd, 5);
+    assert(kept == "01234");
+    ::close(limited.stdout_fd);
+
+    // Without capture nothing changes
+    auto plain = make_spawn(3, {"true"});
+    submit(supervisor, plain);
+    expect(supervisor, 3, supervisor_event::started);
+    const auto uncaptured = expect(supervisor, 3, supervisor_event::exited);
+    assert(uncaptured.captured == 0 && uncaptured.stdout_fd == -1 && uncaptured.stderr_fd == -1);
+
+    std::cout << "✓ Output comes back as sealed memfds with the exit" << std::endl;
+}
+
+std::string read_file(const std::string& path) {
+    std::ifstream in(path);
+    return {std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+}
+
+supervisor_command make_interactive(uint64_t id, std::initializer_list<std::string_view> argv,
+                                    std::initializer_list<std::string_view> interactor_argv) {
+    supervisor_command cmd;
+    cmd.op = supervisor_op::spawn;
+    cmd.request_id = id;
+    const std::vector<std::string_view> args(argv);
+    const std::vector<std::string_view> interactor_args(interactor_argv);
+    const bool fits = set_interactive_args(cmd, args, interactor_args);
+    assert(fits);
+    return cmd;
+}
+
+// The interactor's stderr, captured in the stdout slot
+std::string take_verdict(const supervisor_completion& done) {
+    assert(done.captured == capture_stdout && done.stdout_fd != -1);
+    auto text = read_fd(done.stdout_fd, done.stdout_bytes);
+    ::close(done.stdout_fd);
+    return text;
+}
+
+void test_interactive(const std::string& dir) {
+    std::cout << "Testing interactive jobs..." << std::endl;
+
+    supervisor_options options;
+    options.workspace_root = dir;
+    if (geteuid() == 0) {
+        options.uid_pool_base = 47300;
+        options.uid_pool_size = 2;
+    }
+    auto started = start_supervisor(options);
+    assert(started.has_value());
+    SupervisorClient& supervisor = *started;
+
+    // The interactor asks, the job answers; verdict by exit code
+    const char* interactor =
+        "echo 21; read x; if [ \"$x\" = 42 ]; then echo ok >&2; exit 0; fi; echo \"wrong: $x\" >&2; exit 1";
+    const std::string work = dir + "/interactive";
+    make_dir(work);
+    auto job = make_interactive(1, {"sh", "-c", "read n; echo $((n * 2))"}, {"sh", "-c", interactor});
+    set_path(job.workdir, work);
+    job.capture_flags = capture_stdout;
+    job.wall_time_limit_ms = 10'000;
+    submit(supervisor, job);
+    expect(supervisor, 1, supervisor_event::started);
+    const auto solved = expect(supervisor, 1, supervisor_event::exited);
+    assert(solved.interactive && solved.exit_code == 0 && solved.term_signal == 0);
+    assert(solved.interactor_exit_code == 0 && solved.interactor_term_signal == 0);
+    const auto verdict = take_verdict(solved);
+    assert(verdict == "ok\n");
+
+    // A failing verdict ends a job that would otherwise sit there
+    auto wrong = make_interactive(2, {"sh", "-c", "read n; echo 7; sleep 30"}, {"sh", "-c", interactor});
+    set_path(wrong.workdir, work);
+    wrong.capture_flags = capture_stdout;
+    submit(supervisor, wrong);
+    expect(supervisor, 2, supervisor_event::started);
+    const auto rejected = expect(supervisor, 2, supervisor_event::exited);
+    assert(rejected.interactive && rejected.interactor_exit_code == 1);
+    assert(rejected.term_signal == SIGKILL && !rejected.wall_time_exceeded);
+    assert(rejected.wall_time_us < 10'000'000);
+    const auto wrong_verdict = take_verdict(rejected);
+    assert(wrong_verdict == "wrong: 7\n");
+
+    // The job exiting early: the interactor sees EOF (or EPIPE) and decides
+    auto quitter = make_interactive(3, {"true"}, {"sh", "-c", interactor});
+    submit(supervisor, quitter);
+    expect(supervisor, 3, supervisor_event::started);
+    const auto quit = expect(supervisor, 3, supervisor_event::exited);
+    assert(quit.exit_code == 0 && (quit.interactor_exit_code == 1 || quit.interactor_term_signal == SIGPIPE));
+
+    // Killed as a pair; a missing interactor fails the spawn
+    auto stuck = make_interactive(4, {"sleep", "30"}, {"sleep", "30"});
+    submit(supervisor, stuck);
+    expect(supervisor, 4, supervisor_event::started);
+    const auto kill_ec = supervisor.kill(4);
+    assert(!kill_ec);
+    const auto killed = expect(supervisor, 4, supervisor_event::exited);
+    assert(killed.term_signal == SIGKILL && killed.interactor_term_signal == SIGKILL);
+    auto missing = make_interactive(5, {"true"}, {"/nonexistent/interactor"});
+    submit(supervisor, missing);
+    const auto no_interactor = expect(supervisor, 5, supervisor_event::spawn_failed);
+    assert(no_interactor.error_number == ENOENT);
+
+    // Nothing of the interactor is in the job's workdir: not its cwd, not
+    // HOME or TMPDIR, and its stderr comes back in a memfd
+    auto placed = make_interactive(6, {"sh", "-c", "touch planted"},
+                                   {"sh", "-c", "pwd >&2; echo \"$HOME ${TMPDIR-unset}\" >&2; ls >&2"});
+    set_path(placed.workdir, work);
+    placed.capture_flags = capture_stdout;
+    submit(supervisor, placed);
+    expect(supervisor, 6, supervisor_event::started);
+    const auto outside = expect(supervisor, 6, supervisor_event::exited);
+    const auto report = take_verdict(outside);
+    assert(report.starts_with("/\n/tmp unset\n") && report.find("planted") == std::string::npos);
+
+    // Both UIDs came back (the pool has exactly two)
+    auto again = make_interactive(7, {"true"}, {"true"});
+    submit(supervisor, again);
+    expect(supervisor, 7, supervisor_event::started);
+    const auto paired = expect(supervisor, 7, supervisor_event::exited);
+    assert(paired.interactive);
+
+    std::cout << "✓ Job and interactor talk over pipes and report as one" << std::endl;
+}
+
+void test_workspace_templates(const std::string& dir) {
+    std::cout << "Testing workspace templates..." << std::endl;
+
+    assert(is_valid_template_name("cs101-starter_v2.1"));
+    assert(!is_valid_template_name(""));
+    assert(!is_valid_template_name(".hidden"));
+    assert(!is_valid_template_name("../etc"));
+    assert(!is_valid_template_name("a/b"));
+    assert(!is_valid_template_name(std::string(64, 'a')));
+    supervisor_command cmd;
+    const bool dotdot = set_command_template(cmd, "..");
+    assert(!dotdot);
+    set_template(cmd, "starter");
+
+    if (geteuid() != 0) {
+        std::cout << "✓ Template names validated (mounting skipped, needs root)" << std::endl;
+        return;
+    }
+
+    const std::string templates = dir + "/templates";
+    const std::string scaffold = templates + "/starter";
+    const std::string scratch = dir + "/overlay-scratch";
+    make_dir(templates);
+    make_dir(scaffold);
+    make_dir(scaffold + "/src");
+    std::ofstream(scaffold + "/src/main.c") << "int main(void) { return 0; }\n";
+
+    // The helpers on their own: the job's writes land in the overlay only,
+    // and unmounting throws them away
+    const std::string plain = dir + "/plain";
+    make_dir(plain);
+    int rc = mount_template_workspace(scaffold, plain, scratch, 1 << 20);
+    assert(rc == 0);
+    assert(read_file(plain + "/src/main.c") == "int main(void) { return 0; }\n");
+    std::ofstream(plain + "/src/main.c") << "changed\n";
+    std::ofstream(plain + "/new.txt") << "new\n";
+    assert(read_file(scaffold + "/src/main.c") == "int main(void) { return 0; }\n");
+    assert(::access((scaffold + "/new.txt").c_str(), F_OK) != 0);
+    rc = unmount_template_workspace(plain);
+    assert(rc == 0);
+    assert(::access((plain + "/src").c_str(), F_OK) != 0);
+    rc = mount_template_workspace(scaffold, dir + "/a,b", scratch, 1 << 20);
+    assert(rc == EINVAL);
+
+    // Through the supervisor, with a pooled UID: the job owns the overlay's
+    // root and can write next to the scaffold
+    supervisor_options options;
+    options.workspace_root = dir;
+    options.uid_pool_base = 47200;
+    options.uid_pool_size = 2;
+    options.template_root = templates;
+    options.template_scratch_root = scratch;
+    auto started = start_supervisor(options);
+    assert(started.has_value());
+    SupervisorClient& supervisor = *started;
+
+    const std::string work = dir + "/templated";
+    make_dir(work);
+    auto job = make_spawn(1, {"sh", "-c", "cat src/main.c > copy.c && mkdir build"});
+    set_path(job.workdir, work);
+    set_template(job, "starter");
+    submit(supervisor, job);
+    expect(supervisor, 1, supervisor_event::started);
+    const auto copied = expect(supervisor, 1, supervisor_event::exited);
+    assert(copied.exit_code == 0);
+    assert(read_file(work + "/copy.c") == "int main(void) { return 0; }\n");
+    assert(read_file(scaffold + "/src/main.c") == "int main(void) { return 0; }\n");
+
+    // Same workdir again before release: refused
+    auto again = make_spawn(2, {"true"});
+    set_path(again.workdir, work);
+    set_template(again, "starter");
+    submit(supervisor, again);
+    const auto busy = expect(supervisor, 2, supervisor_event::spawn_failed);
+    assert(busy.error_number == EBUSY);
+
+    // Unknown template
+    const std::string other = dir + "/untemplated";
+    make_dir(other);
+    auto missing = make_spawn(3, {"true"});
+    set_path(missing.workdir, other);
+    set_template(missing, "nope");
+    submit(supervisor, missing);
+    const auto unknown = expect(supervisor, 3, supervisor_event::spawn_failed);
+    assert(unknown.error_number == ENOENT);
+
+    // The mount target has to be an existing, empty directory beneath the
+    // workspace root, reached without symlinks. Anything else is refused
+    // and left as it was - nothing gets hidden under an overlay.
+    const std::string full = dir + "/full";
+    make_dir(full);
+    std::ofstream(full + "/notes.txt") << "mine\n";
+    const std::string linked = dir + "/linked";
+    rc = ::symlink(other.c_str(), linked.c_str());
+    assert(rc == 0);
+    const std::string through_link = linked + "/inner";
+    make_dir(other + "/inner");
+    const struct {
+        std::string workdir;
+        int error_number;
+    } refused[] = {
+        {full, ENOTEMPTY},
+        {dir + "/absent", ENOENT},
+        {linked, ENOTDIR},
+        {through_link, ENOTDIR},
+        {"/tmp", EINVAL},
+        {dir, EINVAL},
+        {dir + "/../" + dir.substr(dir.rfind('/') + 1) + "/untemplated", EINVAL},
+    };
+    uint64_t id = 4;
+    for (const auto& target : refused) {
+        auto bad = make_spawn(id, {"true"});
+        set_path(bad.workdir, target.workdir);
+        set_template(bad, "starter");
+        submit(supervisor, bad);
+        const auto failed = expect(supervisor, id, supervisor_event::spawn_failed);
+        assert(failed.error_number == target.error_number);
+        ++id;
+    }
+    assert(read_file(full + "/notes.txt") == "mine\n");
+    assert(::access((other + "/src").c_str(), F_OK) != 0);
+    assert(::access((other + "/inner/src").c_str(), F_OK) != 0);
+
+    // Release: one unmount and the workdir is back to the empty directory
+    const auto released = supervisor.release(1, work);
+    assert(!released);
+    for (int i = 0; i < 200 && ::access((work + "/copy.c").c_str(), F_OK) == 0; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    assert(::access((work + "/copy.c").c_str(), F_OK) != 0);
+    assert(::access((work + "/src").c_str(), F_OK) != 0);
+    assert(read_file(scaffold + "/src/main.c") == "int main(void) { return 0; }\n");
+
+    std::cout << "✓ Jobs get a private copy-on-write view of the template, gone on release" << std::endl;
+}
+
+void test_namespace_pool(const std::string& dir) {
+    std::cout << "Testing namespace templates..." << std::endl;
+    if (geteuid() != 0) {
+        std::cout << "- Skipped (needs root)" << std::endl;
+        return;
+    }
+    auto created = NamespacePool::create(1);
+    if (!created) {
+        std::cout << "- Skipped (no namespace support)" << std::endl;
+        return;
+    }
+    NamespacePool& pool = *created;
+    assert(pool.capacity() == 1 && pool.available() == 1);
+
+    // Creating the templates left us in our own namespaces
+    const std::string home_net = namespace_id("/proc/self/ns/net");
+    const auto slot = pool.acquire();
+    const auto none_left = pool.acquire();
+    assert(slot && !none_left);
+    const namespace_set& set = pool.get(*slot);
+    assert(namespace_id("/proc/self/fd/" + std::to_string(set.net_fd)) != home_net);
+
+    // Template is configured: lo up, own hostname. Then dirty its IPC, both
+    // SysV and POSIX.
+    const int configured = in_namespaces(set, [] {
+        const int fd = socket(AF_INET, SOCK_DGRAM, 0);
+        ifreq request{};
+        std::strcpy(request.ifr_name, "lo");
+        if (ioctl(fd, SIOCGIFFLAGS, &request) != 0 || !(request.ifr_flags & IFF_UP)) {
+            return 1;
+        }
+        char host[64] = {};
+        gethostname(host, sizeof(host));
+        if (std::string(host) != "sandbox") {
+            return 2;
+        }
+        if (shmget(IPC_PRIVATE, 4096, IPC_CREAT | 0600) < 0) {
+            return 3;
+        }
+        const mqd_t queue = mq_open("/vsocky_test_leftover", O_CREAT | O_RDWR, 0600, nullptr);
+        return queue != static_cast<mqd_t>(-1) ? 0 : 4;
+    });
+    assert(configured == 0);
+
+    // release() resets it: the segment and the queue are gone for the next user
+    pool.release(*slot);
+    assert(pool.available() == 1);
+    const auto again = pool.acquire();
+    assert(again && *again == *slot);
+    const int clean = in_namespaces(pool.get(*again), [] {
+        shm_info info{};
+        shmctl(0, SHM_INFO, reinterpret_cast<shmid_ds*>(&info));
+        if (info.used_ids != 0) {
+            return 1;
+        }
+        const mqd_t queue = mq_open("/vsocky_test_leftover", O_RDONLY);
+        return queue == static_cast<mqd_t>(-1) && errno == ENOENT ? 0 : 2;
+    });
+    assert(clean == 0);
+    pool.release(*again);
+
+    // Through the supervisor: both jobs land in the same template
+    supervisor_options options;
+    options.workspace_root = dir;
+    options.uid_pool_base = 47100;
+    options.uid_pool_size = 2;
+    options.namespace_pool_size = 1;
+    auto started = start_supervisor(options);
+    assert(started.has_value());
+    SupervisorClient& supervisor = *started;
+
+    const std::string work = dir + "/isolated";
+    make_dir(work);
+    std::string seen[2];
+    for (uint64_t id = 1; id <= 2; ++id) {
+        auto job = make_spawn(id, {"sh", "-c", "readlink /proc/self/ns/net; cat /proc/sys/kernel/hostname"});
+        set_path(job.workdir, work);
+        set_path(job.stdout_path, "out" + std::to_string(id) + ".txt");
+        submit(supervisor, job);
+        expect(supervisor, id, supervisor_event::started);
+        const auto done = expect(supervisor, id, supervisor_event::exited);
+        assert(done.exit_code == 0);
+        std::ifstream out(work + "/out" + std::to_string(id) + ".txt");
+        seen[id - 1] = std::string(std::istreambuf_iterator<char>(out), {});
+    }
+    assert(seen[0] == seen[1]);
+    assert(seen[0] != home_net + "\n" && seen[0].ends_with("\nsandbox\n"));
+
+    std::cout << "✓ Templates are configured, reset between uses and entered by jobs" << std::endl;
+}
+
+void test_cpu_placement(const std::string& dir) {
+    std::cout << "Testing job CPU placement and scheduling class..." << std::endl;
+
+    // One vCPU for the server when there are several; jobs get the rest
+    auto partition = partition_cpus(1);
+    assert(partition.has_value());
+    assert(CPU_COUNT(&partition->server) == 1 || partition->shared);
+    assert(!CPU_ISSET(0, &partition->jobs) || partition->shared);
+    const auto none = partition_cpus(0);
+    assert(!none.has_value());
+    const auto all = partition_cpus(CPU_SETSIZE);
+    assert(all.has_value() && all->shared);
+
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(0, &cpus);
+    CPU_SET(2, &cpus);
+    CPU_SET(3, &cpus);
+    CPU_SET(4, &cpus);
+    assert(format_cpu_list(cpus) == "0,2-4");
+
+    make_dir(dir + "/placed");
+    supervisor_options options;
+    options.workspace_root = dir;
+    options.job_cpus = partition->jobs;
+    options.job_sched = job_sched_policy::batch;
+    auto started = start_supervisor(options);
+    assert(started.has_value());
+    SupervisorClient& supervisor = *started;
+
+    // Fields 19 and 41 of /proc/<pid>/stat are the nice value and the
+    // policy (SCHED_BATCH 3, SCHED_IDLE 5); RLIMIT_NICE keeps the job at 19
+    const auto placement = [&](uint64_t id, job_sched_policy policy) {
+        auto job = make_spawn(id, {"sh", "-c",
+                                   "cut -d' ' -f19,41 /proc/self/stat; grep Cpus_allowed_list /proc/self/status;"
+                                   " grep 'Max nice' /proc/self/limits | tr -s ' '"});
+        set_path(job.workdir, dir + "/placed");
+        job.capture_flags = capture_stdout;
+        job.sched_policy = policy;
+        submit(supervisor, job);
+        expect(supervisor, id, supervisor_event::started);
+        const auto done = expect(supervisor, id, supervisor_event::exited);
+        assert(done.exit_code == 0);
+        auto text = read_fd(done.stdout_fd, done.stdout_bytes);
+        ::close(done.stdout_fd);
+        return text;
+    };
+
+    // The configured class is the floor; a command may only go lower
+    const std::string rest = "Cpus_allowed_list:\t" + format_cpu_list(partition->jobs) +
+                             "\nMax nice priority 0 0 \n";
+    const auto batch = placement(1, job_sched_policy::normal);
+    assert(batch == "19 3\n" + rest);
+    const auto idle = placement(2, job_sched_policy::idle);
+    assert(idle == "19 5\n" + rest);
+
+    // Anything else from the ring is rejected
+    auto bogus = make_spawn(3, {"true"});
+    bogus.sched_policy = static_cast<job_sched_policy>(7);
+    submit(supervisor, bogus);
+    const auto rejected = expect(supervisor, 3, supervisor_event::spawn_failed);
+    assert(rejected.error_number == EINVAL);
+
+    std::cout << "✓ Jobs run on the job vCPUs, under the configured class" << std::endl;
+}
+
+// next() and input_complete() move the pipeline on: called outside
+// assert(), which NDEBUG compiles out
+void expect_action(RequestPipeline& pipeline, pipeline_action action) {
+    const auto next = pipeline.next();
+    assert(next == action);
+}
+
+void complete_input(RequestPipeline& pipeline, uint32_t index, error_code expected = error_code::success) {
+    const auto ec = pipeline.input_complete(index);
+    assert(ec == expected);
+}
+
+void test_request_pipeline() {
+    std::cout << "Testing request pipeline..." << std::endl;
+
+    // Compile starts while run inputs are still arriving; run waits for both
+    RequestPipeline p({input_stage::compile, input_stage::run, input_stage::compile}, true);
+    expect_action(p, pipeline_action::none);
+    complete_input(p, 0);
+    expect_action(p, pipeline_action::none);
+    complete_input(p, 2);
+    expect_action(p, pipeline_action::start_compile);
+    expect_action(p, pipeline_action::none);
+    assert(p.inputs_pending() == 1);
+    p.compile_finished(true);
+    expect_action(p, pipeline_action::none);  // Still uploading input 1
+    complete_input(p, 1);
+    assert(p.inputs_overlapped() == 0);
+    expect_action(p, pipeline_action::start_run);
+    expect_action(p, pipeline_action::none);
+    p.run_finished();
+    expect_action(p, pipeline_action::finish);
+    expect_action(p, pipeline_action::none);
+    assert(!p.accepting_uploads());
+
+    // Inputs finishing during the compile are counted as overlap
+    RequestPipeline overlap({input_stage::compile, input_stage::run, input_stage::run}, true);
+    complete_input(overlap, 0);
+    expect_action(overlap, pipeline_action::start_compile);
+    complete_input(overlap, 1);
+    complete_input(overlap, 2);
+    assert(overlap.inputs_overlapped() == 2);
+    expect_action(overlap, pipeline_action::none);  // Compile still running
+    overlap.compile_finished(true);
+    expect_action(overlap, pipeline_action::start_run);
+
+    // Bad events
+    complete_input(overlap, 3, error_code::invalid_field_value);
+    complete_input(overlap, 1, error_code::invalid_message_format);
+
+    // A failed compile ends the request; late uploads are dropped
+    RequestPipeline failing({input_stage::compile, input_stage::run}, true);
+    complete_input(failing, 0);
+    expect_action(failing, pipeline_action::start_compile);
+    failing.compile_finished(false);
+    expect_action(failing, pipeline_action::finish);
+    assert(!failing.accepting_uploads());
+    complete_input(failing, 1);
+
+    // Interpreted: no compile, run once everything is in; stray events ignored
+    RequestPipeline script({input_stage::compile, input_stage::run}, false);
+    script.compile_finished(true);
+    script.run_finished();
+    complete_input(script, 1);
+    expect_action(script, pipeline_action::none);
+    complete_input(script, 0);
+    expect_action(script, pipeline_action::start_run);
+
+    // No inputs at all: compile right away
+    RequestPipeline empty({}, true);
+    expect_action(empty, pipeline_action::start_compile);
+
+    // Abort
+    RequestPipeline aborted({input_stage::run}, true);
+    expect_action(aborted, pipeline_action::start_compile);
+    aborted.abort();
+    expect_action(aborted, pipeline_action::finish);
+
+    std::cout << "✓ Compile overlaps the upload; run waits for both" << std::endl;
+}
+
+void test_command_helpers() {
+    std::cout << "Testing command helpers..." << std::endl;
+
+    supervisor_command cmd;
+    const std::string big(max_exec_args_bytes, 'x');
+    const std::string_view too_long[] = {big};
+    bool fits = set_command_args(cmd, too_long);
+    assert(!fits);
+    const std::string_view with_nul[] = {std::string_view("a\0b", 3)};
+    fits = set_command_args(cmd, with_nul);
+    assert(!fits);
+    fits = set_command_path(cmd.workdir, std::string(max_exec_path_bytes, '/'));
+    assert(!fits);
+
+    std::cout << "✓ Oversized and embedded-NUL strings are rejected" << std::endl;
+}
+
+void run_all_tests() {
+    std::cout << "\n=== Running Supervisor Tests ===" << std::endl;
+
+    char tmpl[] = "/tmp/vsocky_super_XXXXXX";
+    const std::string dir = mkdtemp(tmpl);
+
+    // Fork the supervisor before the threaded ring test (FORK BEFORE THREADS)
+    test_supervisor(dir);
+    test_deadlines();
+    test_pooled_supervisor(dir);
+    test_orphaned_jobs(dir);
+    test_cancel(dir);
+    test_output_capture(dir);
+    test_interactive(dir);
+    test_workspace_templates(dir);
+    test_namespace_pool(dir);
+    test_cpu_placement(dir);
+    test_perf_counters();
+    test_ring_basics();
+    test_ring_threads();
+    test_command_helpers();
+    test_request_pipeline();
+    test_uid_pool();
+
+    std::system(("rm -rf " + dir).c_str());
+
+    std::cout << "\n=== All Tests Passed! ===" << std::endl;
+}
+
+} // namespace vsocky::test
+
+int main() {
+    signal(SIGPIPE, SIG_IGN);
+    vsocky::test::run_all_tests();
+    return 0;
+}
@@ -0,0 +1,352 @@
+#include "vsocky/host/fleet_router.hpp"
+#include "vsocky/protocol/load_frames.hpp"
+#include "vsocky/vsocket/frame_io.hpp"
+#include "vsocky/vsocket/vsock_server.hpp"
+
+#include <atomic>
+#include <cassert>
+#include <csignal>
+#include <iostream>
+#include <memory>
+#include <set>
+#include <string>
+#include <thread>
+
+#include <poll.h>
+#include <unistd.h>
+
+// =============================================================================
+// FLEET ROUTER UNIT TESTS
+// =============================================================================
+// Each "VM" is a local server on a Unix socket that answers load_query with
+// whatever load_report the test sets, and counts the connections it accepts
+// (to check that the router reuses pooled connections).
+// =============================================================================
+
+namespace vsocky::test {
+
+class fake_vm {
+public:
+    explicit fake_vm(const std::string& name)
+        : path_("/tmp/vsocky_test_" + std::to_string(getpid()) + "_" + name + ".sock") {
+        auto ec = server_.listen_unix(path_);
+        assert(!ec);
+        acceptor_ = std::thread([this] { accept_loop(); });
+    }
+
+    ~fake_vm() {
+        stop();
+    }
+
+    void stop() {
+        if (stop_.exchange(true)) {
+            return;
+        }
+        acceptor_.join();
+        for (auto& t : handlers_) {
+            t.join();
+        }
+        server_.close();
+    }
+
+    void set_load(const load_report& report) {
+        std::lock_guard lock(mutex_);
+        report_ = report;
+    }
+
+    vm_connector connector() const {
+        return [path = path_] { return Connection::connect_unix(path, 500); };
+    }
+
+    int accepted() const {
+        return accepted_;
+    }
+
+private:
+    void accept_loop() {
+        while (!stop_) {
+            pollfd pfd{server_.fd(), POLLIN, 0};
+            if (::poll(&pfd, 1, 20) <= 0) {
+                continue;
+            }
+            Connection conn(-1);
+            auto ec = server_.accept(conn);
+            assert(!ec);
+            if (conn.is_valid()) {
+                ++accepted_;
+                handlers_.emplace_back([this, c = std::move(conn)]() mutable { serve(c); });
+            }
+        }
+    }
+
+    void serve(Connection& conn) {
+        MessageFramer framer;
+        while (!stop_) {
+            auto frame = receive_frame(conn, framer, 50);
+            if (!frame) {
+                if (frame.error() == error_code::timeout) {
+                    continue;
+                }
+                return;
+            }
+            if (frame->type == frame_type::load_query) {
+                std::vector<uint8_t> payload;
+                {
+                    std::lock_guard lock(mutex_);
+                    payload = encode_load_report(report_);
+                }
+                send_frame(conn, frame_type::load_report, payload, 1000);
+            }
+        }
+    }
+
+    std::string path_;
+    VSockServer server_;
+    std::atomic<bool> stop_{false};
+    std::atomic<int> accepted_{0};
+    std::mutex mutex_;
+    load_report report_;
+    std::vector<std::thread> handlers_;
+    std::thread acceptor_;
+};
+
+load_report idle_load(uint32_t queue_depth, uint32_t capacity = 1) {
+    load_report report;
+    report.queue_depth = queue_depth;
+    report.capacity = capacity;
+    return report;
+}
+
+// Route one job and release it at once: the VM it went to, "" if none
+std::string routed_vm(FleetRouter& router, const job_hint& hint = {}) {
+    auto lease = router.route(hint);
+    return lease ? lease->vm_id() : std::string();
+}
+
+artifact_key key_of(std::string_view source) {
+    sha256 h;
+    h.update(source);
+    return h.finish();
+}
+
+void test_load_report_encoding() {
+    std::cout << "Testing load report encoding..." << std::endl;
+
+    load_report report;
+    report.queue_depth = 7;
+    report.running_jobs = 2;
+    report.capacity = 4;
+    report.warm_pool = {.enabled = true, .ready = 3, .target = 8};
+    report.cache.add(key_of("hello"));
+
+    const auto bytes = encode_load_report(report);
+    assert(bytes.size() == load_report_header_size + report.cache.bytes().size());
+
+    auto decoded = decode_load_report(bytes);
+    assert(decoded.has_value());
+    assert(decoded->queue_depth == 7 && decoded->running_jobs == 2 && decoded->capacity == 4);
+    assert(decoded->warm_pool.enabled && decoded->warm_pool.ready == 3 &&
+           decoded->warm_pool.target == 8);
+    assert(decoded->cache.may_contain(key_of("hello")));
+    assert(!decoded->cache.may_contain(key_of("not cached")));
+    assert(decoded->cache.probes() == report.cache.probes());
+
+    // Truncated, from a future version, or with a summary out of bounds
+    assert(!decode_load_report(std::span(bytes).first(10)));
+    assert(!decode_load_report(std::span(bytes).first(bytes.size() - 1)));
+    auto future = bytes;
+    future[0] = 99;
+    assert(!decode_load_report(future));
+    auto no_probes = bytes;
+    no_probes[22] = 0;
+    assert(!decode_load_report(no_probes));
+
+    std::cout << "✓ Load reports round-trip" << std::endl;
+}
+
+void test_summary_sizing() {
+    std::cout << "Testing cache summary sizing..." << std::endl;
+
+    // Grows with the cache: ~9.6 bits per key at the default 1%
+    const artifact_summary empty;
+    assert(empty.bytes().size() == artifact_summary::min_size_bytes);
+    const artifact_summary sized(5000);
+    assert(sized.bytes().size() > 5000 && sized.bytes().size() < 7000);
+    assert(sized.probes() == 7);
+    assert(artifact_summary(size_t{1} << 30).bytes().size() == artifact_summary::max_size_bytes);
+
+    // The rate holds once full (a 256-byte filter was ~100% here)
+    artifact_summary full(5000);
+    for (int i = 0; i < 5000; ++i) {
+        full.add(key_of("cached " + std::to_string(i)));
+    }
+    int false_positives = 0;
+    for (int i = 0; i < 10000; ++i) {
+        false_positives += full.may_contain(key_of("absent " + std::to_string(i))) ? 1 : 0;
+    }
+    assert(false_positives < 200);  // 2%: twice the target, room for variance
+
+    std::cout << "✓ Summaries are sized for a 1% false positive rate" << std::endl;
+}
+
+void test_least_loaded(FleetRouter& router, fake_vm& a, fake_vm& b, fake_vm& c) {
+    std::cout << "Testing least-loaded placement..." << std::endl;
+
+    a.set_load(idle_load(5));
+    b.set_load(idle_load(0));
+    c.set_load(idle_load(2));
+    size_t healthy = router.refresh();
+    assert(healthy == 3);
+
+    auto lease = router.route();
+    assert(lease.has_value());
+    assert(lease->vm_id() == "b");
+    assert(lease->connection().is_valid());
+
+    // Capacity matters: 6 queued on 8 slots beats 1 queued on 1 slot
+    a.set_load(idle_load(6, 8));
+    b.set_load(idle_load(1, 1));
+    c.set_load(idle_load(3, 1));
+    router.refresh();
+    assert(routed_vm(router) == "a");
+
+    std::cout << "✓ Jobs go to the VM with the shortest queue per slot" << std::endl;
+}
+
+void test_cache_affinity(FleetRouter& router, fake_vm& a, fake_vm& b, fake_vm& c) {
+    std::cout << "Testing cache affinity..." << std::endl;
+
+    const auto key = key_of("popular.cpp");
+    auto cached = idle_load(1);
+    cached.cache.add(key);
+
+    a.set_load(idle_load(1));
+    b.set_load(idle_load(0));
+    c.set_load(cached);
+    router.refresh();
+
+    // Slightly busier but has the artifact: wins
+    assert(routed_vm(router, {.artifact = key}) == "c");
+    // Without a hint plain load decides
+    assert(routed_vm(router) == "b");
+
+    // Much busier: affinity is not worth it
+    auto swamped = idle_load(10);
+    swamped.cache.add(key);
+    c.set_load(swamped);
+    router.refresh();
+    assert(routed_vm(router, {.artifact = key}) == "b");
+
+    std::cout << "✓ Cache affinity is preferred while the VM isn't swamped" << std::endl;
+}
+
+void test_warm_pool(FleetRouter& router, fake_vm& a, fake_vm& b, fake_vm& c) {
+    std::cout << "Testing warm pool preference..." << std::endl;
+
+    auto cold = idle_load(0);
+    cold.warm_pool = {.enabled = true, .ready = 0, .target = 4};
+    auto warm = idle_load(0);
+    warm.warm_pool = {.enabled = true, .ready = 2, .target = 4};
+
+    a.set_load(cold);
+    b.set_load(cold);
+    c.set_load(warm);
+    router.refresh();
+    assert(routed_vm(router) == "c");
+
+    std::cout << "✓ VMs with ready helpers are preferred" << std::endl;
+}
+
+void test_spread_and_reuse(FleetRouter& router, fake_vm& a, fake_vm& b, fake_vm& c) {
+    std::cout << "Testing spreading and connection reuse..." << std::endl;
+
+    a.set_load(idle_load(0));
+    b.set_load(idle_load(0));
+    c.set_load(idle_load(0));
+    router.refresh();
+
+    // Three jobs before the next report: one per VM, not three on the first
+    std::set<std::string> used;
+    std::vector<FleetRouter::lease> held;
+    for (int i = 0; i < 3; ++i) {
+        auto lease = router.route();
+        assert(lease.has_value());
+        used.insert(lease->vm_id());
+        held.push_back(std::move(*lease));
+    }
+    assert(used.size() == 3);
+    held.clear();
+
+    // Released connections are reused, not reopened
+    const int before = a.accepted() + b.accepted() + c.accepted();
+    router.refresh();
+    for (int i = 0; i < 3; ++i) {
+        router.route();
+    }
+    assert(a.accepted() + b.accepted() + c.accepted() == before);
+
+    for (const auto& snap : router.snapshot()) {
+        assert(snap.healthy);
+        assert(snap.idle_connections >= 1);
+    }
+
+    std::cout << "✓ Load spreads between reports and connections are pooled" << std::endl;
+}
+
+void test_dead_vm(FleetRouter& router, fake_vm& a, fake_vm& b, fake_vm& c) {
+    std::cout << "Testing unreachable VMs..." << std::endl;
+
+    b.set_load(idle_load(0));
+    a.set_load(idle_load(3));
+    c.set_load(idle_load(3));
+    b.stop();
+
+    size_t healthy = router.refresh();
+    assert(healthy == 2);
+    for (int i = 0; i < 4; ++i) {
+        auto lease = router.route();
+        assert(lease.has_value());
+        assert(lease->vm_id() != "b");
+    }
+
+    a.stop();
+    c.stop();
+    router.refresh();
+    auto none = router.route();
+    assert(!none.has_value());
+    assert(none.error() == error_code::resource_unavailable);
+
+    std::cout << "✓ Dead VMs leave the rotation" << std::endl;
+}
+
+void run_all_tests() {
+    std::cout << "\n=== Running Fleet Router Tests ===" << std::endl;
+
+    test_load_report_encoding();
+    test_summary_sizing();
+
+    fake_vm a("vm_a"), b("vm_b"), c("vm_c");
+    FleetRouter router;
+    router.add_vm("a", a.connector());
+    router.add_vm("b", b.connector());
+    router.add_vm("c", c.connector());
+
+    // Unknown until the first refresh
+    assert(routed_vm(router).empty());
+
+    test_least_loaded(router, a, b, c);
+    test_cache_affinity(router, a, b, c);
+    test_warm_pool(router, a, b, c);
+    test_spread_and_reuse(router, a, b, c);
+    test_dead_vm(router, a, b, c);
+
+    std::cout << "\n=== All Tests Passed! ===" << std::endl;
+}
+
+} // namespace vsocky::test
+
+int main() {
+    signal(SIGPIPE, SIG_IGN);
+    vsocky::test::run_all_tests();
+    return 0;
+}
@@ -0,0 +1,294 @@
+#include "vsocky/host/trace_replay.hpp"
+#include "vsocky/vsocket/frame_io.hpp"
+#include "vsocky/vsocket/frame_trace.hpp"
+#include "vsocky/vsocket/vsock_server.hpp"
+
+#include <atomic>
+#include <cassert>
+#include <csignal>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include <poll.h>
+#include <unistd.h>
+
+// =============================================================================
+// FRAME TRACE + REPLAY UNIT TESTS
+// =============================================================================
+// Record through the MessageFramer hook, read back (including a torn tail
+// and the size cap), then replay against an echo server on a Unix socket.
+// =============================================================================
+
+namespace vsocky::test {
+
+std::string temp_path(const std::string& name) {
+    return "/tmp/vsocky_test_" + std::to_string(getpid()) + "_" + name;
+}
+
+std::vector<uint8_t> encoded(frame_type type, std::string_view payload) {
+    const auto header = encode_frame_header(type, static_cast<uint32_t>(payload.size()));
+    std::vector<uint8_t> bytes(header.begin(), header.end());
+    bytes.insert(bytes.end(), payload.begin(), payload.end());
+    return bytes;
+}
+
+std::string text(const Frame& frame) {
+    return {frame.payload.begin(), frame.payload.end()};
+}
+
+// Answers every frame with the same frame
+class echo_server {
+public:
+    echo_server() : path_(temp_path("replay.sock")) {
+        const auto ec = server_.listen_unix(path_);
+        assert(!ec);
+        acceptor_ = std::thread([this] { accept_loop(); });
+    }
+
+    ~echo_server() {
+        stop_ = true;
+        acceptor_.join();
+        for (auto& t : handlers_) {
+            t.join();
+        }
+        server_.close();
+    }
+
+    replay_connector connector() const {
+        return [path = path_] { return Connection::connect_unix(path, 500); };
+    }
+
+    int accepted() const {
+        return accepted_;
+    }
+
+private:
+    void accept_loop() {
+        while (!stop_) {
+            pollfd pfd{server_.fd(), POLLIN, 0};
+            if (::poll(&pfd, 1, 20) <= 0) {
+                continue;
+            }
+            Connection conn(-1);
+            const auto ec = server_.accept(conn);
+            assert(!ec);
+            if (conn.is_valid()) {
+                ++accepted_;
+                handlers_.emplace_back([this, c = std::move(conn)]() mutable { serve(c); });
+            }
+        }
+    }
+
+    void serve(Connection& conn) {
+        MessageFramer framer;
+        while (!stop_) {
+            auto frame = receive_frame(conn, framer, 50);
+            if (!frame) {
+                if (frame.error() == error_code::timeout) {
+                    continue;
+                }
+                return;
+            }
+            send_frame(conn, frame->type, frame->payload, 1000);
+        }
+    }
+
+    std::string path_;
+    VSockServer server_;
+    std::atomic<bool> stop_{false};
+    std::atomic<int> accepted_{0};
+    std::vector<std::thread> handlers_;
+    std::thread acceptor_;
+};
+
+void test_record_and_read() {
+    std::cout << "Testing recording through the framer..." << std::endl;
+
+    const auto path = temp_path("record.trace");
+    {
+        auto writer = FrameTraceWriter::open(path);
+        assert(writer.has_value());
+
+        MessageFramer a, b;
+        a.record_to(&*writer, writer->next_connection_id());
+        b.record_to(&*writer, writer->next_connection_id());
+
+        // Split mid-frame: only whole frames are recorded, once
+        const auto first = encoded(frame_type::json, "{\"a\":1}");
+        auto ec = a.feed({first.data(), 3});
+        assert(!ec);
+        auto frame = a.next();
+        assert(!frame);
+        ec = a.feed({first.data() + 3, first.size() - 3});
+        assert(!ec);
+        frame = a.next();
+        assert(frame);
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        const auto second = encoded(frame_type::json, "{\"b\":2}");
+        ec = b.feed(second);
+        assert(!ec);
+        frame = b.next();
+        assert(frame);
+
+        const auto third = encoded(frame_type::file_end, "");
+        ec = a.feed(third);
+        assert(!ec);
+        frame = a.next();
+        assert(frame);
+
+        // Unhooked framers record nothing
+        a.record_to(nullptr, 0);
+        ec = a.feed(first);
+        assert(!ec);
+        frame = a.next();
+        assert(frame);
+
+        assert(writer->frames() == 3);
+        assert(!writer->truncated());
+    }  // Destructor flushes
+
+    auto records = read_frame_trace(path);
+    assert(records.has_value());
+    assert(records->size() == 3);
+    const auto& r = *records;
+    assert(r[0].offset_ns == 0 && r[0].connection_id == 1 && text(r[0].frame) == "{\"a\":1}");
+    assert(r[1].connection_id == 2 && text(r[1].frame) == "{\"b\":2}");
+    assert(r[1].offset_ns >= 20'000'000);
+    assert(r[2].connection_id == 1 && r[2].frame.type == frame_type::file_end && r[2].frame.payload.empty());
+    assert(r[2].offset_ns >= r[1].offset_ns);
+
+    std::filesystem::remove(path);
+    std::cout << "✓ Frames are recorded with their connection and timing" << std::endl;
+}
+
+void test_torn_and_truncated() {
+    std::cout << "Testing torn traces and the size cap..." << std::endl;
+
+    const auto path = temp_path("torn.trace");
+    {
+        auto writer = FrameTraceWriter::open(path);
+        assert(writer.has_value());
+        for (int i = 0; i < 3; ++i) {
+            writer->record(1, Frame{frame_type::json, std::vector<uint8_t>(100, 'x')});
+        }
+    }
+
+    // A crash mid-write leaves a partial last record
+    std::filesystem::resize_file(path, std::filesystem::file_size(path) - 10);
+    auto torn = read_frame_trace(path);
+    assert(torn.has_value());
+    assert(torn->size() == 2);
+
+    // Not a trace at all
+    {
+        std::ofstream(path, std::ios::binary | std::ios::trunc) << "NOTATRACE0000000000000";
+    }
+    auto bad = read_frame_trace(path);
+    assert(!bad.has_value());
+    assert(bad.error() == error_code::invalid_message_format);
+    assert(!read_frame_trace(temp_path("missing.trace")).has_value());
+
+    // Recording stops at the cap and never writes a partial frame
+    {
+        auto writer = FrameTraceWriter::open(path, 1024);
+        assert(writer.has_value());
+        for (int i = 0; i < 20; ++i) {
+            writer->record(1, Frame{frame_type::json, std::vector<uint8_t>(100, 'y')});
+        }
+        assert(writer->truncated());
+        assert(writer->frames() > 0 && writer->frames() < 10);
+    }
+    assert(std::filesystem::file_size(path) <= 1024);
+    auto capped = read_frame_trace(path);
+    assert(capped.has_value());
+    assert(!capped->empty() && capped->size() < 10);
+
+    std::filesystem::remove(path);
+    std::cout << "✓ Torn tails are dropped and the size cap holds" << std::endl;
+}
+
+std::vector<trace_record> sample_trace() {
+    auto frame = [](std::string_view s) {
+        return Frame{frame_type::json, std::vector<uint8_t>(s.begin(), s.end())};
+    };
+    // Two interleaved connections over 100 ms
+    return {
+        {0, 1, frame("one")},
+        {10'000'000, 2, frame("two")},
+        {50'000'000, 1, frame("three")},
+        {100'000'000, 2, frame("four")},
+    };
+}
+
+void test_replay(echo_server& server) {
+    std::cout << "Testing paced replay..." << std::endl;
+
+    replay_options options;
+    options.drain_timeout_ms = 200;
+    const auto stats = replay_trace(sample_trace(), server.connector(), options);
+
+    assert(stats.connections == 2 && stats.failed_connections == 0);
+    assert(stats.frames_sent == 4 && stats.frames_skipped == 0);
+    assert(stats.bytes_sent == 4 * frame_header_size + 3 + 3 + 5 + 4);
+    assert(stats.frames_received == 4);
+    assert(stats.bytes_received == stats.bytes_sent);
+    assert(stats.duration_ns >= 100'000'000);  // Paced to the recording
+
+    std::cout << "✓ Replay keeps the recorded pacing" << std::endl;
+}
+
+void test_replay_unpaced(echo_server& server) {
+    std::cout << "Testing unpaced replay..." << std::endl;
+
+    replay_options options;
+    options.speed = 0;
+    options.drain_timeout_ms = 200;
+    const auto stats = replay_trace(sample_trace(), server.connector(), options);
+
+    assert(stats.frames_sent == 4 && stats.frames_received == 4);
+    assert(stats.max_lag_ns == 0);
+
+    std::cout << "✓ Unpaced replay sends everything" << std::endl;
+}
+
+void test_replay_no_server() {
+    std::cout << "Testing replay without a server..." << std::endl;
+
+    replay_options options;
+    options.speed = 0;
+    options.drain_timeout_ms = 50;
+    const replay_connector refuse = [] { return Connection::connect_unix(temp_path("nobody.sock"), 100); };
+    const auto stats = replay_trace(sample_trace(), refuse, options);
+
+    assert(stats.connections == 2 && stats.failed_connections == 2);
+    assert(stats.frames_sent == 0 && stats.frames_skipped == 4);
+
+    std::cout << "✓ Unreachable connections are counted, not fatal" << std::endl;
+}
+
+void run_all_tests() {
+    std::cout << "\n=== Running Frame Trace Tests ===" << std::endl;
+
+    test_record_and_read();
+    test_torn_and_truncated();
+
+    echo_server server;
+    test_replay(server);
+    test_replay_unpaced(server);
+    assert(server.accepted() == 4);
+    test_replay_no_server();
+
+    std::cout << "\n=== All Tests Passed! ===" << std::endl;
+}
+
+} // namespace vsocky::test
+
+int main() {
+    signal(SIGPIPE, SIG_IGN);
+    vsocky::test::run_all_tests();
+    return 0;
+}
@@ -0,0 +1,278 @@
+#include "vsocky/storage/artifact_cache.hpp"
+#include "vsocky/vsocket/frame_io.hpp"
+#include "vsocky/vsocket/vsock_server.hpp"
+
+#include <cassert>
+#include <csignal>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <string>
+
+#include <poll.h>
+#include <unistd.h>
+
+// =============================================================================
+// ARTIFACT CACHE UNIT TESTS
+// =============================================================================
+// The host artifact service is replaced by a stand-in: a Unix-socket server
+// thread with an in-memory map that speaks the same artifact_* frames. The
+// client under test talks to it exactly as it would over vsock.
+// =============================================================================
+
+namespace vsocky::test {
+
+std::span<const uint8_t> bytes_of(const std::string& s) {
+    return std::span(reinterpret_cast<const uint8_t*>(s.data()), s.size());
+}
+
+std::vector<uint8_t> vec_of(const std::string& s) {
+    return std::vector<uint8_t>(s.begin(), s.end());
+}
+
+artifact_key key_of(std::string_view source) {
+    const std::string_view parts[] = {"cpp", "g++-13 -O2", source};
+    return make_artifact_key(parts);
+}
+
+// In-memory host artifact service
+class stand_in_service {
+public:
+    explicit stand_in_service(std::string path) : path_(std::move(path)) {
+        auto ec = server_.listen_unix(path_);
+        assert(!ec);
+        acceptor_ = std::thread([this] { accept_loop(); });
+    }
+
+    ~stand_in_service() {
+        stop_ = true;
+        acceptor_.join();
+        for (auto& t : handlers_) {
+            t.join();
+        }
+    }
+
+    void put(const artifact_key& key, const std::string& value) {
+        std::lock_guard lock(mutex_);
+        store_[key] = vec_of(value);
+    }
+
+    std::optional<std::vector<uint8_t>> get(const artifact_key& key) {
+        std::lock_guard lock(mutex_);
+        auto it = store_.find(key);
+        if (it == store_.end()) {
+            return std::nullopt;
+        }
+        return it->second;
+    }
+
+    int requests() const {
+        return requests_;
+    }
+
+private:
+    void accept_loop() {
+        while (!stop_) {
+            pollfd pfd{server_.fd(), POLLIN, 0};
+            if (::poll(&pfd, 1, 20) <= 0) {
+                continue;
+            }
+            Connection conn(-1);
+            auto ec = server_.accept(conn);
+            assert(!ec);
+            if (conn.is_valid()) {
+                handlers_.emplace_back([this, c = std::move(conn)]() mutable { serve(c); });
+            }
+        }
+    }
+
+    void serve(Connection& conn) {
+        MessageFramer framer;
+        while (!stop_) {
+            auto frame = receive_frame(conn, framer, 50);
+            if (!frame) {
+                if (frame.error() == error_code::timeout) {
+                    continue;
+                }
+                return;  // Client went away
+            }
+
+            if (frame->type == frame_type::artifact_get) {
+                ++requests_;
+                artifact_key key{};
+                assert(frame->payload.size() == key.size());
+                std::copy(frame->payload.begin(), frame->payload.end(), key.begin());
+                if (auto value = get(key)) {
+                    send_frame(conn, frame_type::artifact_hit, *value, 1000);
+                } else {
+                    send_frame(conn, frame_type::artifact_miss, {}, 1000);
+                }
+            } else if (frame->type == frame_type::artifact_put) {
+                artifact_key key{};
+                assert(frame->payload.size() >= key.size());
+                std::copy_n(frame->payload.begin(), key.size(), key.begin());
+                std::lock_guard lock(mutex_);
+                store_[key].assign(frame->payload.begin() + key.size(), frame->payload.end());
+            }
+        }
+    }
+
+    std::string path_;
+    VSockServer server_;
+    std::atomic<bool> stop_{false};
+    std::atomic<int> requests_{0};
+    std::mutex mutex_;
+    std::map<artifact_key, std::vector<uint8_t>> store_;
+    std::vector<std::thread> handlers_;
+    std::thread acceptor_;
+};
+
+std::string socket_path(const char* name) {
+    return "/tmp/vsocky_test_" + std::to_string(getpid()) + "_" + name + ".sock";
+}
+
+void test_key_encoding() {
+    std::cout << "Testing artifact keys..." << std::endl;
+
+    const std::string_view a[] = {"ab", "c"};
+    const std::string_view b[] = {"a", "bc"};
+    assert(make_artifact_key(a) != make_artifact_key(b));
+    assert(make_artifact_key(a) == make_artifact_key(a));
+
+    std::cout << "✓ Key parts are length-prefixed" << std::endl;
+}
+
+void test_local_lru(const std::string& dir) {
+    std::cout << "Testing local tier LRU..." << std::endl;
+
+    LocalArtifactCache cache(dir + "/local", 10);
+    auto ec = cache.open();
+    assert(!ec);
+
+    const auto k1 = key_of("one"), k2 = key_of("two"), k3 = key_of("three");
+    ec = cache.store(k1, bytes_of("aaaa"));
+    assert(!ec);
+    ec = cache.store(k2, bytes_of("bbbb"));
+    assert(!ec);
+    auto loaded = cache.load(k1);  // k1 is now more recent than k2
+    assert(loaded);
+
+    ec = cache.store(k3, bytes_of("cccc"));  // 12 > 10: evict k2
+    assert(!ec);
+    assert(cache.entries() == 2);
+    assert(cache.size_bytes() == 8);
+    loaded = cache.load(k2);
+    assert(!loaded);
+    loaded = cache.load(k1);
+    assert(loaded && *loaded == vec_of("aaaa"));
+
+    // Too big for the whole budget
+    ec = cache.store(key_of("big"), bytes_of("0123456789ab"));
+    assert(ec == error_code::resource_unavailable);
+
+    // A second instance on the same directory picks up the entries
+    LocalArtifactCache reopened(dir + "/local", 10);
+    ec = reopened.open();
+    assert(!ec);
+    assert(reopened.entries() == 2);
+    loaded = reopened.load(k3);
+    assert(loaded && *loaded == vec_of("cccc"));
+
+    cache.set_budget(4);
+    assert(cache.entries() == 1);
+
+    std::cout << "✓ Least recently used artifacts are evicted" << std::endl;
+}
+
+void test_remote_tier(const std::string& dir) {
+    std::cout << "Testing host-backed tier..." << std::endl;
+
+    const auto path = socket_path("artifacts");
+    stand_in_service host(path);
+    const auto popular = key_of("int main() {}");
+    host.put(popular, "ELF...");
+
+    LocalArtifactCache local(dir + "/remote", 1 << 20);
+    auto ec = local.open();
+    assert(!ec);
+    RemoteArtifactClient remote(unix_artifact_connector(path, 1000));
+    ArtifactCache cache(local, &remote);
+
+    // Fresh VM: local miss, host hit, copied into the local tier
+    auto hit = cache.lookup(popular);
+    assert(hit && *hit == vec_of("ELF..."));
+    assert(local.entries() == 1);
+    assert(host.requests() == 1);
+
+    // Second lookup never reaches the host
+    hit = cache.lookup(popular);
+    assert(hit);
+    assert(host.requests() == 1);
+
+    // Miss everywhere
+    const auto fresh = key_of("new source");
+    auto miss = cache.lookup(fresh);
+    assert(!miss);
+    assert(remote.stats().misses == 1);
+
+    // Compile result flows back to the host in the background
+    cache.insert(fresh, vec_of("ELF2"));
+    remote.flush();
+    assert(remote.stats().published == 1);
+    for (int i = 0; i < 100 && !host.get(fresh); ++i) {
+        usleep(5000);
+    }
+    assert(host.get(fresh) && *host.get(fresh) == vec_of("ELF2"));
+
+    std::cout << "✓ Host hits fill the local tier, inserts are published" << std::endl;
+}
+
+void test_service_unavailable(const std::string& dir) {
+    std::cout << "Testing unavailable host service..." << std::endl;
+
+    LocalArtifactCache local(dir + "/offline", 1 << 20);
+    auto ec = local.open();
+    assert(!ec);
+    RemoteArtifactClient remote(unix_artifact_connector(socket_path("nobody"), 100),
+                                {.reconnect_backoff_ms = 60'000});
+    ArtifactCache cache(local, &remote);
+
+    // Degrades to a plain miss; backoff means only one connect attempt
+    auto miss = cache.lookup(key_of("x"));
+    assert(!miss);
+    miss = cache.lookup(key_of("y"));
+    assert(!miss);
+    assert(remote.stats().errors == 1);
+
+    // Inserts still work locally; the publish is dropped, not stuck
+    cache.insert(key_of("x"), vec_of("obj"));
+    remote.flush();
+    assert(local.entries() == 1);
+    assert(remote.stats().published == 0);
+
+    std::cout << "✓ Remote failures are misses, not errors" << std::endl;
+}
+
+void run_all_tests() {
+    std::cout << "\n=== Running Artifact Cache Tests ===" << std::endl;
+
+    char tmpl[] = "/tmp/vsocky_artifact_XXXXXX";
+    const std::string dir = mkdtemp(tmpl);
+
+    test_key_encoding();
+    test_local_lru(dir);
+    test_remote_tier(dir);
+    test_service_unavailable(dir);
+
+    std::system(("rm -rf " + dir).c_str());
+
+    std::cout << "\n=== All Tests Passed! ===" << std::endl;
+}
+
+} // namespace vsocky::test
+
+int main() {
+    signal(SIGPIPE, SIG_IGN);
+    vsocky::test::run_all_tests();
+    return 0;
+}
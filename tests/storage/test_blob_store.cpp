@@ -0,0 +1,283 @@
+#include "vsocky/storage/blob_store.hpp"
+#include "vsocky/protocol/blob_frames.hpp"
+
+#include <cassert>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+// =============================================================================
+// BLOB STORE UNIT TESTS
+// =============================================================================
+// Everything runs inside a fresh mkdtemp() directory that is removed at the
+// end, so tests never see each other's blobs.
+// =============================================================================
+
+namespace vsocky::test {
+
+std::span<const uint8_t> bytes_of(const std::string& s) {
+    return std::span(reinterpret_cast<const uint8_t*>(s.data()), s.size());
+}
+
+std::string read_file(const std::string& path) {
+    std::ifstream in(path);
+    return std::string(std::istreambuf_iterator<char>(in), {});
+}
+
+void test_put_and_contains(const std::string& dir) {
+    std::cout << "Testing put/contains..." << std::endl;
+
+    BlobStore store(dir + "/store");
+    auto ec = store.open();
+    assert(!ec);
+
+    const std::string content = "fixture data\n";
+    const auto hash = sha256::hash(bytes_of(content));
+
+    assert(!store.contains(hash));
+    ec = store.put(hash, bytes_of(content));
+    assert(!ec);
+    assert(store.contains(hash));
+    assert(read_file(store.blob_path(hash)) == content);
+
+    // Stored blobs are read-only
+    struct stat st{};
+    int rc = stat(store.blob_path(hash).c_str(), &st);
+    assert(rc == 0);
+    assert((st.st_mode & 0777) == 0444);
+
+    // Second put is a no-op
+    ec = store.put(hash, bytes_of(content));
+    assert(!ec);
+
+    // Content that doesn't match its claimed hash is refused
+    const auto other = sha256::hash(bytes_of(std::string("other")));
+    ec = store.put(other, bytes_of(content));
+    assert(ec == error_code::invalid_field_value);
+    assert(!store.contains(other));
+
+    std::cout << "✓ Blobs are verified and stored read-only" << std::endl;
+}
+
+void test_missing(const std::string& dir) {
+    std::cout << "Testing missing()..." << std::endl;
+
+    BlobStore store(dir + "/store");
+    const auto have = sha256::hash(bytes_of(std::string("fixture data\n")));
+    const auto lack1 = sha256::hash(bytes_of(std::string("a")));
+    const auto lack2 = sha256::hash(bytes_of(std::string("b")));
+
+    const blob_hash query[] = {lack1, have, lack2, lack1};
+    auto result = store.missing(query);
+    assert(result.size() == 2);  // Duplicates reported once
+    assert(result[0] == lack1 && result[1] == lack2);
+
+    std::cout << "✓ missing() reports only unknown hashes" << std::endl;
+}
+
+void test_materialize(const std::string& dir) {
+    std::cout << "Testing workspace materialization..." << std::endl;
+
+    BlobStore store(dir + "/store");
+    const std::string input = "1 2 3\n";
+    const std::string source = "print(sum(map(int, input().split())))\n";
+    const auto input_hash = sha256::hash(bytes_of(input));
+    const auto source_hash = sha256::hash(bytes_of(source));
+    auto ec = store.put(input_hash, bytes_of(input));
+    assert(!ec);
+    ec = store.put(source_hash, bytes_of(source));
+    assert(!ec);
+
+    const std::string workspace = dir + "/ws";
+    int rc = mkdir(workspace.c_str(), 0755);
+    assert(rc == 0);
+
+    const blob_file_ref files[] = {
+        {"tests/01.in", input_hash, materialize_mode::read_only},
+        {"main.py", source_hash, materialize_mode::writable},
+    };
+    ec = store.materialize_workspace(workspace, files);
+    assert(!ec);
+
+    assert(read_file(workspace + "/tests/01.in") == input);
+    assert(read_file(workspace + "/main.py") == source);
+
+    // Read-only files share the stored inode; writable ones are private copies
+    struct stat stored{}, linked{}, copied{};
+    rc = stat(store.blob_path(input_hash).c_str(), &stored);
+    assert(rc == 0);
+    rc = stat((workspace + "/tests/01.in").c_str(), &linked);
+    assert(rc == 0);
+    rc = stat((workspace + "/main.py").c_str(), &copied);
+    assert(rc == 0);
+    assert(linked.st_ino == stored.st_ino);
+    assert((copied.st_mode & 0200) != 0);
+
+    // Writing the private copy must not touch the store
+    std::ofstream(workspace + "/main.py") << "changed";
+    assert(read_file(store.blob_path(source_hash)) == source);
+
+    // Unknown blob and path escapes are rejected
+    const blob_file_ref unknown[] = {{"x", sha256::hash(bytes_of(std::string("?")))}};
+    ec = store.materialize_workspace(workspace, unknown);
+    assert(ec == error_code::invalid_field_value);
+    const blob_file_ref escape[] = {{"../evil", input_hash}};
+    ec = store.materialize_workspace(workspace, escape);
+    assert(ec == error_code::invalid_field_value);
+    assert(access((dir + "/evil").c_str(), F_OK) != 0);
+
+    std::cout << "✓ Workspaces are linked/cloned from the store" << std::endl;
+}
+
+void test_safe_paths() {
+    std::cout << "Testing path validation..." << std::endl;
+
+    assert(is_safe_relative_path("main.py"));
+    assert(is_safe_relative_path("a/b/c.txt"));
+    assert(is_safe_relative_path("..hidden"));
+    assert(!is_safe_relative_path(""));
+    assert(!is_safe_relative_path("/etc/passwd"));
+    assert(!is_safe_relative_path("a/../../b"));
+    assert(!is_safe_relative_path("a//b"));
+    assert(!is_safe_relative_path("./a"));
+    assert(!is_safe_relative_path("a/"));
+
+    std::cout << "✓ Unsafe paths are rejected" << std::endl;
+}
+
+void test_frames(const std::string& dir) {
+    std::cout << "Testing blob_query / blob_upload frames..." << std::endl;
+
+    BlobStore store(dir + "/frames");
+    auto ec = store.open();
+    assert(!ec);
+
+    const std::string content = "dataset";
+    const auto hash = sha256::hash(bytes_of(content));
+
+    // Query: we don't have it yet
+    std::vector<uint8_t> query(hash.begin(), hash.end());
+    auto missing = handle_blob_query(store, query);
+    assert(missing.has_value() && *missing == query);
+
+    // Upload: hash + raw bytes
+    std::vector<uint8_t> upload(hash.begin(), hash.end());
+    upload.insert(upload.end(), content.begin(), content.end());
+    ec = handle_blob_upload(store, upload);
+    assert(!ec);
+
+    // Query again: nothing missing
+    missing = handle_blob_query(store, query);
+    assert(missing.has_value() && missing->empty());
+
+    // Malformed payloads
+    query.pop_back();
+    assert(!handle_blob_query(store, query).has_value());
+    ec = handle_blob_upload(store, std::span(upload).first(10));
+    assert(ec == error_code::invalid_message_format);
+
+    std::cout << "✓ Dedup exchange works end to end" << std::endl;
+}
+
+// Count the store's leftover temp files (a dropped upload must not leave any)
+size_t temp_files(const std::string& root) {
+    size_t count = 0;
+    for (const auto& entry : std::filesystem::recursive_directory_iterator(root)) {
+        count += entry.path().filename().string().starts_with(".tmp-") ? 1 : 0;
+    }
+    return count;
+}
+
+void test_chunked_upload(const std::string& dir) {
+    std::cout << "Testing blob_chunk / blob_end frames..." << std::endl;
+
+    BlobStore store(dir + "/chunked");
+    auto ec = store.open();
+    assert(!ec);
+    BlobUploadAssembler uploads(store, {.max_pending = 2, .max_blob_bytes = 64});
+
+    const std::string content = "a blob that arrives in three frames";
+    const auto hash = sha256::hash(bytes_of(content));
+    auto chunk = [&](const blob_hash& h, std::string_view bytes) {
+        std::vector<uint8_t> payload(h.begin(), h.end());
+        payload.insert(payload.end(), bytes.begin(), bytes.end());
+        return payload;
+    };
+
+    // Pieces of two blobs interleave; nothing is visible before blob_end
+    const std::string other = "second";
+    const auto other_hash = sha256::hash(bytes_of(other));
+    ec = uploads.handle_chunk(chunk(hash, std::string_view(content).substr(0, 10)));
+    assert(!ec);
+    ec = uploads.handle_chunk(chunk(other_hash, other));
+    assert(!ec);
+    ec = uploads.handle_chunk(chunk(hash, std::string_view(content).substr(10, 10)));
+    assert(!ec);
+    ec = uploads.handle_chunk(chunk(hash, std::string_view(content).substr(20)));
+    assert(!ec);
+    assert(uploads.pending() == 2 && !store.contains(hash));
+
+    ec = uploads.handle_end(encode_blob_end(hash, content.size()));
+    assert(!ec);
+    assert(store.contains(hash) && read_file(store.blob_path(hash)) == content);
+
+    // A third blob while two are open is refused
+    const auto third = sha256::hash(bytes_of(std::string("third")));
+    ec = uploads.handle_chunk(chunk(hash, "x"));  // Re-opens the stored blob's hash
+    assert(!ec);
+    ec = uploads.handle_chunk(chunk(third, "third"));
+    assert(ec == error_code::resource_unavailable);
+
+    // Wrong size, wrong content and oversized blobs are dropped
+    ec = uploads.handle_end(encode_blob_end(hash, 2));
+    assert(ec == error_code::invalid_field_value);
+    ec = uploads.handle_end(encode_blob_end(other_hash, other.size() + 1));
+    assert(ec == error_code::invalid_field_value);
+    ec = uploads.handle_chunk(chunk(third, "wrong"));
+    assert(!ec);
+    ec = uploads.handle_end(encode_blob_end(third, 5));
+    assert(ec == error_code::invalid_field_value && !store.contains(third));
+    ec = uploads.handle_chunk(chunk(third, std::string(65, 'x')));
+    assert(ec == error_code::message_too_large);
+    assert(uploads.pending() == 0 && temp_files(store.root()) == 0);
+
+    // No chunks at all: only the empty blob
+    const auto empty = sha256::hash({});
+    ec = uploads.handle_end(encode_blob_end(empty, 0));
+    assert(!ec && store.contains(empty));
+    const auto end = encode_blob_end(empty, 0);
+    ec = uploads.handle_end(std::span(end).first(blob_end_size - 1));
+    assert(ec == error_code::invalid_message_format);
+
+    std::cout << "✓ Blobs larger than a frame are streamed and verified" << std::endl;
+}
+
+void run_all_tests() {
+    std::cout << "\n=== Running BlobStore Tests ===" << std::endl;
+
+    char dir_template[] = "/tmp/vsocky_blob_test_XXXXXX";
+    const std::string dir = mkdtemp(dir_template);
+
+    test_put_and_contains(dir);
+    test_missing(dir);
+    test_materialize(dir);
+    test_safe_paths();
+    test_frames(dir);
+    test_chunked_upload(dir);
+
+    std::system(("rm -rf " + dir).c_str());
+    std::cout << "\n=== All Tests Passed! ===" << std::endl;
+}
+
+} // namespace vsocky::test
+
+int main() {
+    vsocky::test::run_all_tests();
+    return 0;
+}
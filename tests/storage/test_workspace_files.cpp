@@ -0,0 +1,347 @@
+#include "vsocky/storage/workspace_files.hpp"
+#include "vsocky/storage/workspace_upload.hpp"
+#include "vsocky/protocol/file_frames.hpp"
+#include "vsocky/protocol/upload_frames.hpp"
+#include "vsocky/vsocket/frame_io.hpp"
+#include "vsocky/vsocket/message_framer.hpp"
+#include "vsocky/utils/base64.hpp"
+
+#include <cassert>
+#include <csignal>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <string>
+#include <thread>
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// =============================================================================
+// WORKSPACE FILE RETRIEVAL UNIT TESTS
+// =============================================================================
+// A workspace is built in a mkdtemp() directory, including the hostile bits
+// (symlinks out of the workspace, a FIFO). Streaming runs over a socketpair
+// with a reader thread that decodes frames like the host would.
+// =============================================================================
+
+namespace vsocky::test {
+
+void write_file(const std::string& path, const std::string& content) {
+    std::ofstream(path, std::ios::binary) << content;
+}
+
+std::string make_workspace() {
+    char tmpl[] = "/tmp/vsocky_ws_XXXXXX";
+    const std::string dir = mkdtemp(tmpl);
+
+    mkdir((dir + "/out").c_str(), 0755);
+    mkdir((dir + "/out/deep").c_str(), 0755);
+    write_file(dir + "/main.py", "print('hi')\n");
+    write_file(dir + "/out/plot.png", std::string(5000, 'P'));
+    write_file(dir + "/out/deep/data.bin", std::string(300'000, 'D'));
+    write_file(dir + "/empty.txt", "");
+
+    // Hostile entries
+    symlink("/etc", (dir + "/etc_link").c_str());
+    symlink("/etc/hostname", (dir + "/out/host_link").c_str());
+    mkfifo((dir + "/out/fifo").c_str(), 0644);
+    return dir;
+}
+
+void test_listing(const std::string& ws) {
+    std::cout << "Testing workspace listing..." << std::endl;
+
+    const std::string inputs[] = {"main.py"};
+    auto files = list_workspace_files(ws, inputs);
+    assert(files.has_value());
+
+    // Sorted, inputs excluded, symlinks and FIFOs skipped
+    assert(files->size() == 3);
+    assert((*files)[0].path == "empty.txt" && (*files)[0].size == 0);
+    assert((*files)[1].path == "out/deep/data.bin" && (*files)[1].size == 300'000);
+    assert((*files)[2].path == "out/plot.png" && (*files)[2].size == 5000);
+    assert((*files)[2].mode == 0644 || (*files)[2].mode == 0664);
+
+    // Bounded
+    auto capped = list_workspace_files(ws, inputs, {.max_entries = 2});
+    assert(!capped && capped.error() == error_code::message_too_large);
+
+    auto missing = list_workspace_files(ws + "/nope");
+    assert(!missing && missing.error() == error_code::resource_unavailable);
+
+    const auto json = build_file_list_message(std::span(*files).first(1));
+    assert(json == R"({"type":"files","files":[{"path":"empty.txt","size":0,"mode":)" +
+                       std::to_string((*files)[0].mode) + "}]}");
+
+    std::cout << "✓ Only regular output files are listed" << std::endl;
+}
+
+void test_safe_open(const std::string& ws) {
+    std::cout << "Testing safe open..." << std::endl;
+
+    auto ok = open_workspace_file(ws, "out/plot.png");
+    assert(ok.has_value());
+    close(*ok);
+
+    // Symlinks: neither as the last component nor on the way
+    assert(open_workspace_file(ws, "out/host_link").error() == error_code::invalid_field_value);
+    assert(open_workspace_file(ws, "etc_link/hostname").error() == error_code::invalid_field_value);
+    // Escapes and oddities
+    assert(open_workspace_file(ws, "../etc/hostname").error() == error_code::invalid_field_value);
+    assert(open_workspace_file(ws, "/etc/hostname").error() == error_code::invalid_field_value);
+    assert(open_workspace_file(ws, "out/fifo").error() == error_code::invalid_field_value);
+    assert(open_workspace_file(ws, "out").error() == error_code::invalid_field_value);
+    assert(open_workspace_file(ws, "out/missing").error() == error_code::resource_unavailable);
+
+    std::cout << "✓ Symlinks, escapes and special files are refused" << std::endl;
+}
+
+void test_fetch_encoding() {
+    std::cout << "Testing file_fetch encoding..." << std::endl;
+
+    const std::string paths[] = {"a.txt", "out/b.bin", ""};
+    const auto encoded = encode_file_fetch(paths);
+    assert(encoded.has_value());
+    auto decoded = decode_file_fetch(*encoded);
+    assert(decoded.has_value());
+    assert(decoded->size() == 3 && (*decoded)[1] == "out/b.bin" && (*decoded)[2].empty());
+
+    const uint8_t truncated[] = {0x00, 0x05, 'a', 'b'};
+    const auto short_payload = decode_file_fetch(truncated);
+    assert(!short_payload);
+
+    // A length that doesn't fit in u16 is refused, not wrapped
+    const std::string oversize[] = {"ok", std::string(65536, 'x')};
+    const auto refused = encode_file_fetch(oversize);
+    assert(!refused && refused.error() == error_code::message_too_large);
+
+    std::cout << "✓ Path lists round-trip" << std::endl;
+}
+
+void test_upload_encoding() {
+    std::cout << "Testing upload frame encoding..." << std::endl;
+
+    const uint8_t bytes[] = {'a', 'b', 'c'};
+    const auto chunk = encode_upload_chunk(0x1122334455667788, 7, bytes);
+    assert(chunk.size() == upload_chunk_header_size + 3);
+    auto view = decode_upload_chunk(chunk);
+    assert(view && view->request_id == 0x1122334455667788 && view->index == 7);
+    assert(view->data.size() == 3 && view->data[2] == 'c');
+    assert(decode_upload_chunk(std::span(chunk).first(upload_chunk_header_size))->data.empty());
+    assert(!decode_upload_chunk(std::span(chunk).first(11)));
+
+    const auto end = encode_upload_end({.request_id = 9, .index = 2, .size = uint64_t{5} << 32});
+    auto info = decode_upload_end(end);
+    assert(info && info->request_id == 9 && info->index == 2 && info->size == uint64_t{5} << 32);
+    assert(!decode_upload_end(std::span(end).first(19)));
+
+    std::cout << "✓ Chunk and end frames round-trip" << std::endl;
+}
+
+std::string read_file(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    return {std::istreambuf_iterator<char>(in), {}};
+}
+
+void test_upload(const std::string& ws) {
+    std::cout << "Testing streaming upload..." << std::endl;
+
+    const std::string root = ws + "/upload";
+    mkdir(root.c_str(), 0755);
+    auto upload = WorkspaceUpload::create(root, {"src/main.cpp", "tests/big.in", "stdin.txt", "empty"});
+    assert(upload.has_value());
+
+    // Raw chunks, interleaved between inputs, parent directories created
+    std::string big;
+    for (int i = 0; i < 300'000; ++i) {
+        big.push_back(static_cast<char>('a' + i % 26));
+    }
+    const std::string source = "int main() {}\n";
+    const auto bytes = [](std::string_view s) {
+        return std::span(reinterpret_cast<const uint8_t*>(s.data()), s.size());
+    };
+    std::error_code ec;
+    for (size_t pos = 0; pos < big.size(); pos += 65536) {
+        ec = upload->write(1, bytes(std::string_view(big).substr(pos, 65536)));
+        assert(!ec);
+        if (pos == 0) {
+            ec = upload->write(0, bytes(source));
+            assert(!ec);
+            ec = upload->finish(0, source.size());
+            assert(!ec);
+        }
+    }
+    assert(upload->finished(0) && !upload->finished(1));
+    ec = upload->finish(1, big.size());
+    assert(!ec);
+    assert(read_file(root + "/src/main.cpp") == source);
+    assert(read_file(root + "/tests/big.in") == big);
+
+    // base64 text split at awkward places is decoded on the fly
+    const std::string stdin_data(1000, 'x');
+    const auto encoded = base64_encode(stdin_data);
+    ec = upload->write_base64(2, std::string_view(encoded).substr(0, 5));
+    assert(!ec);
+    ec = upload->write_base64(2, std::string_view(encoded).substr(5));
+    assert(!ec);
+    ec = upload->finish(2, stdin_data.size());
+    assert(!ec);
+    assert(read_file(root + "/stdin.txt") == stdin_data);
+
+    // No chunks: created empty
+    ec = upload->finish(3, 0);
+    assert(!ec);
+    struct stat st{};
+    assert(stat((root + "/empty").c_str(), &st) == 0 && st.st_size == 0);
+    assert(upload->bytes_written() == source.size() + big.size() + stdin_data.size());
+
+    // Protocol errors
+    ec = upload->write(0, bytes("more"));
+    assert(ec == error_code::invalid_message_format);
+    ec = upload->finish(0, 0);
+    assert(ec == error_code::invalid_message_format);
+    ec = upload->write(9, bytes("x"));
+    assert(ec == error_code::invalid_field_value);
+
+    std::cout << "✓ Chunks go straight to their files" << std::endl;
+}
+
+void test_upload_refusals(const std::string& ws) {
+    std::cout << "Testing upload refusals..." << std::endl;
+
+    const std::string root = ws + "/upload_hostile";
+    mkdir(root.c_str(), 0755);
+    symlink("/tmp", (root + "/link").c_str());
+    write_file(root + "/existing", "keep");
+    const auto bytes = [](std::string_view s) {
+        return std::span(reinterpret_cast<const uint8_t*>(s.data()), s.size());
+    };
+
+    const auto escaping = WorkspaceUpload::create(root, {"../escape"});
+    assert(escaping.error() == error_code::invalid_field_value);
+    const auto absolute = WorkspaceUpload::create(root, {"/etc/passwd"});
+    assert(absolute.error() == error_code::invalid_field_value);
+    const auto no_root = WorkspaceUpload::create(root + "/missing", {"a"});
+    assert(no_root.error() == error_code::resource_unavailable);
+
+    upload_limits limits;
+    limits.max_file_bytes = 10;
+    limits.max_total_bytes = 15;
+    auto upload = WorkspaceUpload::create(root, {"link/evil", "existing", "a", "b", "c", "d"}, limits);
+    assert(upload.has_value());
+
+    // Through a symlinked directory, or over an existing file
+    auto ec = upload->write(0, bytes("x"));
+    assert(ec == error_code::invalid_field_value);
+    assert(::access("/tmp/evil", F_OK) != 0);
+    ec = upload->write(1, bytes("x"));
+    assert(ec == error_code::invalid_field_value);
+    assert(read_file(root + "/existing") == "keep");
+
+    // Size limits, per file and in total
+    ec = upload->write(2, bytes("0123456789"));
+    assert(!ec);
+    ec = upload->write(2, bytes("!"));
+    assert(ec == error_code::message_too_large);
+    ec = upload->write(3, bytes("01234"));
+    assert(!ec);
+    ec = upload->write(4, bytes("!"));
+    assert(ec == error_code::message_too_large);
+
+    // Size mismatch (a lost chunk) and broken base64
+    ec = upload->finish(3, 6);
+    assert(ec == error_code::invalid_field_value);
+    ec = upload->write_base64(5, "YW@j");
+    assert(ec == error_code::invalid_base64_encoding);
+
+    std::cout << "✓ Symlinks, existing files, limits and short uploads are refused" << std::endl;
+}
+
+void test_streaming(const std::string& ws) {
+    std::cout << "Testing zero-copy streaming..." << std::endl;
+
+    int fds[2];
+    int rc = socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+    assert(rc == 0);
+    Connection guest(fds[0]);
+    Connection host(fds[1]);
+    auto ec = guest.set_non_blocking();
+    assert(!ec);
+    ec = host.set_non_blocking();
+    assert(!ec);
+
+    const std::string wanted[] = {"out/deep/data.bin", "empty.txt", "etc_link/hostname",
+                                  "out/missing", "out/plot.png"};
+
+    // The host side reads concurrently - 300 KB doesn't fit a socket buffer
+    std::map<uint32_t, std::string> received;
+    std::map<uint32_t, file_end_info> ends;
+    size_t chunks = 0;
+    std::thread reader([&] {
+        MessageFramer framer;
+        while (ends.size() < std::size(wanted)) {
+            auto frame = receive_frame(host, framer, 2000);
+            assert(frame.has_value());
+            if (frame->type == frame_type::file_chunk) {
+                const uint32_t index = (uint32_t{frame->payload[0]} << 24) |
+                                       (uint32_t{frame->payload[1]} << 16) |
+                                       (uint32_t{frame->payload[2]} << 8) | frame->payload[3];
+                received[index].append(frame->payload.begin() + 4, frame->payload.end());
+                ++chunks;
+            } else {
+                assert(frame->type == frame_type::file_end);
+                auto end = decode_file_end(frame->payload);
+                assert(end.has_value());
+                ends[end->index] = *end;
+            }
+        }
+    });
+
+    ec = stream_workspace_files(guest, ws, wanted, 2000, 64 * 1024);
+    assert(!ec);
+    reader.join();
+
+    assert(ends[0].status == file_status::ok && ends[0].size == 300'000);
+    assert(received[0] == std::string(300'000, 'D'));
+    assert(chunks >= 5 + 1);  // 300 KB in 64 KB chunks, plus plot.png
+
+    assert(ends[1].status == file_status::ok && ends[1].size == 0);
+    assert(!received.contains(1));
+
+    assert(ends[2].status == file_status::refused);
+    assert(ends[3].status == file_status::not_found);
+
+    assert(ends[4].status == file_status::ok);
+    assert(received[4] == std::string(5000, 'P'));
+
+    std::cout << "✓ Files stream as raw chunk frames" << std::endl;
+}
+
+void run_all_tests() {
+    std::cout << "\n=== Running Workspace File Tests ===" << std::endl;
+
+    const std::string ws = make_workspace();
+
+    test_listing(ws);
+    test_safe_open(ws);
+    test_fetch_encoding();
+    test_upload_encoding();
+    test_upload(ws);
+    test_upload_refusals(ws);
+    test_streaming(ws);
+
+    std::system(("rm -rf " + ws).c_str());
+
+    std::cout << "\n=== All Tests Passed! ===" << std::endl;
+}
+
+} // namespace vsocky::test
+
+int main() {
+    signal(SIGPIPE, SIG_IGN);
+    vsocky::test::run_all_tests();
+    return 0;
+}
@@ -0,0 +1,302 @@
+#include "vsocky/utils/allocator.hpp"
+
+#include <print>
+#include <cassert>
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <malloc.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// Linked with src/utils/allocator.cpp: every allocation in this process -
+// ours, libstdc++'s, libc's - goes through the bundled allocator
+
+using namespace vsocky;
+
+bool aligned(const void* p, size_t alignment) {
+    return reinterpret_cast<uintptr_t>(p) % alignment == 0;
+}
+
+void test_sizes() {
+    std::println("Testing size classes...");
+
+    // Every size gets at least what it asked for, 16-byte aligned, and the
+    // whole usable size can be written without hitting a neighbour
+    std::vector<void*> blocks;
+    for (size_t n = 0; n <= 70 * 1024; n += (n < 1024 ? 1 : 97)) {
+        void* p = std::malloc(n);
+        assert(p != nullptr && aligned(p, 16));
+        const size_t usable = malloc_usable_size(p);
+        assert(usable >= n);
+        std::memset(p, static_cast<int>(n & 0xff), usable);
+        blocks.push_back(p);
+    }
+    for (void* p : blocks) {
+        const auto fill = static_cast<unsigned char*>(p)[0];
+        const size_t usable = malloc_usable_size(p);
+        for (size_t i = 0; i < usable; i += 61) {
+            assert(static_cast<unsigned char*>(p)[i] == fill);
+        }
+        std::free(p);
+    }
+    std::free(nullptr);
+    assert(malloc_usable_size(nullptr) == 0);
+
+    // Freed memory is reused
+    void* first = std::malloc(100);
+    std::free(first);
+    void* second = std::malloc(100);
+    assert(second == first);
+    std::free(second);
+
+    std::println("✓ Size class test passed\n");
+}
+
+void test_calloc_realloc() {
+    std::println("Testing calloc/realloc...");
+
+    // calloc zeroes even reused memory, small and large
+    for (const size_t n : {size_t{100}, size_t{100 * 1024}}) {
+        void* dirty = std::malloc(n);
+        std::memset(dirty, 0xff, n);
+        std::free(dirty);
+        auto* zero = static_cast<unsigned char*>(std::calloc(1, n));
+        for (size_t i = 0; i < n; ++i) {
+            assert(zero[i] == 0);
+        }
+        std::free(zero);
+    }
+    volatile size_t huge = SIZE_MAX / 2;  // Hidden from -Walloc-size-larger-than
+    errno = 0;
+    void* too_big = std::calloc(huge, 4);
+    assert(too_big == nullptr && errno == ENOMEM);
+
+    // Contents survive growing into a large mapping and shrinking back
+    auto* p = static_cast<char*>(std::malloc(40));
+    std::memcpy(p, "0123456789012345678901234567890123456789", 40);
+    char* same = static_cast<char*>(std::realloc(p, 48));
+    assert(same == p);  // Same class: nothing moves
+    p = same;
+    p = static_cast<char*>(std::realloc(p, 200 * 1024));
+    assert(std::memcmp(p, "0123456789", 10) == 0);
+    p[200 * 1024 - 1] = 'x';
+    p = static_cast<char*>(std::realloc(p, 20));
+    assert(std::memcmp(p, "01234567890123456789", 20) == 0);
+    std::free(p);
+    p = static_cast<char*>(std::realloc(nullptr, 10));
+    assert(p != nullptr);
+    std::free(p);
+
+    std::println("✓ calloc/realloc test passed\n");
+}
+
+void test_alignment() {
+    std::println("Testing aligned allocation...");
+
+    for (size_t alignment = 32; alignment <= 1024 * 1024; alignment *= 2) {
+        for (const size_t n : {size_t{1}, size_t{100}, size_t{5000}, size_t{300 * 1024}}) {
+            void* p = std::aligned_alloc(alignment, n);
+            assert(p != nullptr && aligned(p, alignment));
+            assert(malloc_usable_size(p) >= n);
+            std::memset(p, 1, n);
+            std::free(p);
+        }
+    }
+
+    void* p = nullptr;
+    int rc = posix_memalign(&p, 64, 1000);
+    assert(rc == 0 && aligned(p, 64));
+    std::free(p);
+    rc = posix_memalign(&p, 24, 1000);
+    assert(rc == EINVAL);
+    rc = posix_memalign(&p, 4, 1000);  // Not a multiple of sizeof(void*)
+    assert(rc == EINVAL);
+    errno = 0;
+    p = std::aligned_alloc(48, 100);
+    assert(p == nullptr && errno == EINVAL);
+
+    // Over-aligned new goes through aligned_alloc
+    struct alignas(128) line {
+        char bytes[128];
+    };
+    auto* l = new line;
+    assert(aligned(l, 128));
+    delete l;
+
+    p = valloc(10);
+    assert(aligned(p, static_cast<size_t>(sysconf(_SC_PAGESIZE))));
+    std::free(p);
+
+    std::println("✓ Alignment test passed\n");
+}
+
+void test_large_stats() {
+    std::println("Testing large allocations...");
+
+    const auto before = bundled_allocator_stats();
+    // volatile: the compiler may drop a malloc/free pair it can see through
+    void* volatile big = std::malloc(8 * 1024 * 1024);  // Too big to be kept for reuse
+    assert(bundled_allocator_stats().large_allocations == before.large_allocations + 1);
+    assert(bundled_allocator_stats().large_bytes >= before.large_bytes + 8 * 1024 * 1024);
+    std::free(big);
+    assert(bundled_allocator_stats().large_allocations == before.large_allocations);
+    assert(bundled_allocator_stats().span_bytes > 0);
+
+    // A freed mid-size block is handed out again for a similar size
+    void* volatile mid = std::malloc(100 * 1024);
+    std::free(mid);
+    void* volatile again = std::malloc(90 * 1024);
+    assert(again == mid);
+    std::free(again);
+
+    std::println("✓ Large allocation test passed\n");
+}
+
+void test_span_release() {
+    std::println("Testing release of empty spans...");
+
+    // ~25 MiB of 64-byte objects, all freed: past the few spans kept
+    // resident, the emptied ones go back to the kernel
+    std::vector<void*> objects(400'000);
+    for (auto& p : objects) {
+        p = std::malloc(64);
+        std::memset(p, 0xab, 64);
+    }
+    const size_t mapped = bundled_allocator_stats().span_bytes;
+    for (void* p : objects) {
+        std::free(p);
+    }
+    const auto released = bundled_allocator_stats();
+    assert(released.released_span_bytes > 0);
+    assert(released.released_span_bytes <= released.span_bytes);
+    // Whole 256 KiB spans, less the page holding each header - whatever
+    // the page size
+    const size_t per_span = 256 * 1024 - static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    assert(released.released_span_bytes % per_span == 0);
+
+    // Released spans are reused before new ones are mapped, zeroed or not
+    for (auto& p : objects) {
+        p = std::malloc(64);
+        std::memset(p, 0xcd, 64);
+    }
+    const auto reused = bundled_allocator_stats();
+    assert(reused.span_bytes <= mapped + 4 * 1024 * 1024);
+    assert(reused.released_span_bytes < released.released_span_bytes);
+    for (void* p : objects) {
+        assert(static_cast<unsigned char*>(p)[63] == 0xcd);
+        std::free(p);
+    }
+
+    std::println("✓ Span release test passed\n");
+}
+
+void test_threads() {
+    std::println("Testing cross-thread use...");
+
+    // Blocks allocated on one thread, written, and freed on another; short
+    // lived threads so their caches get flushed at exit over and over
+    for (int round = 0; round < 20; ++round) {
+        std::vector<std::vector<char*>> batches(4);
+        std::vector<std::thread> producers;
+        for (size_t t = 0; t < batches.size(); ++t) {
+            producers.emplace_back([&, t] {
+                for (size_t i = 0; i < 2000; ++i) {
+                    const size_t n = 16 + (i * 37 + t * 101) % 3000;
+                    auto* p = static_cast<char*>(std::malloc(n));
+                    std::memset(p, static_cast<int>(t + 1), n);
+                    batches[t].push_back(p);
+                }
+            });
+        }
+        for (auto& producer : producers) {
+            producer.join();
+        }
+
+        std::vector<std::thread> consumers;
+        for (size_t t = 0; t < batches.size(); ++t) {
+            consumers.emplace_back([&, t] {
+                // Thread t frees what thread t+1 allocated
+                for (char* p : batches[(t + 1) % batches.size()]) {
+                    assert(p[0] == static_cast<char>((t + 1) % batches.size() + 1));
+                    std::free(p);
+                }
+            });
+        }
+        for (auto& consumer : consumers) {
+            consumer.join();
+        }
+    }
+
+    // Contended: all threads allocate and free the same classes at once
+    std::atomic<bool> bad{false};
+    std::vector<std::thread> workers;
+    for (int t = 0; t < 8; ++t) {
+        workers.emplace_back([&, t] {
+            std::vector<std::string> strings;
+            for (int i = 0; i < 20000; ++i) {
+                strings.emplace_back(static_cast<size_t>(20 + i % 200), static_cast<char>('a' + t));
+                if (strings.size() > 100) {
+                    bad = bad || strings.front().front() != 'a' + t;
+                    strings.erase(strings.begin());
+                }
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    assert(!bad);
+
+    std::println("✓ Cross-thread test passed\n");
+}
+
+void test_fork() {
+    std::println("Testing fork while other threads allocate...");
+
+    // Locks are held across fork(), so the child can always allocate
+    std::atomic<bool> stop{false};
+    std::thread churn([&] {
+        while (!stop) {
+            std::free(std::malloc(64));
+            std::free(std::malloc(3000));
+        }
+    });
+    for (int i = 0; i < 50; ++i) {
+        const pid_t pid = fork();
+        assert(pid >= 0);
+        if (pid == 0) {
+            std::vector<std::string> strings(100, std::string(100, 'x'));
+            _exit(strings.back().size() == 100 ? 0 : 1);
+        }
+        int status = 0;
+        const pid_t reaped = waitpid(pid, &status, 0);
+        assert(reaped == pid);
+        assert(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    }
+    stop = true;
+    churn.join();
+
+    std::println("✓ Fork test passed\n");
+}
+
+int main() {
+    std::println("Running bundled allocator tests...\n");
+
+    test_sizes();
+    test_calloc_realloc();
+    test_alignment();
+    test_large_stats();
+    test_span_release();
+    test_threads();
+    test_fork();
+
+    std::println("\nAll tests passed! ✓");
+    return 0;
+}
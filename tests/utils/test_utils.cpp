@@ -1,11 +1,29 @@
 #include "vsocky/utils/error.hpp"
 #include "vsocky/utils/base64.hpp"
 #include "vsocky/utils/signal_handler.hpp"
+#include "vsocky/utils/prefault.hpp"
+#include "vsocky/utils/config.hpp"
+#include "vsocky/utils/deadline.hpp"
+#include "vsocky/utils/sha256.hpp"
+#include "vsocky/utils/profiler.hpp"
+#include "vsocky/utils/sys_error.hpp"
+#include "vsocky/utils/offload_pool.hpp"
 
 #include <print>
 #include <cassert>
 #include <thread>
 #include <chrono>
+#include <atomic>
+#include <fstream>
+#include <sstream>
+#include <array>
+#include <cerrno>
+#include <vector>
+#include <filesystem>
+
+#include <poll.h>
+#include <pthread.h>
+#include <unistd.h>
 
 
 using namespace vsocky;
@@ -24,6 +42,26 @@ void test_error_codes() {
     assert(ec.category().name() == std::string("vsocky")); // remember -- category has virt funcs that we override .name() & .message()
     assert(ec.message() == "bind failed"); // error_code defines .message() as `.category().message()` so it's basically an alias
     
+    static_assert(error_code_name(error_code::read_failed) == "read_failed");
+    static_assert(error_code_name(error_code::connect_failed) == "connect_failed");
+    static_assert(error_code_count == 21);
+
+    // sys_error: the vsocky code plus the errno, formatted without allocating
+    const sys_error reset{error_code::read_failed, ECONNRESET};
+    const std::error_code as_std = reset;
+    assert(as_std == error_code::read_failed);
+    assert(reset && !sys_error{});
+    std::array<char, max_sys_error_text> text{};
+    auto formatted = format_sys_error(reset, text);
+    assert(formatted == "read failed (ECONNRESET)");
+    formatted = format_sys_error({error_code::write_failed, 4095}, text);
+    assert(formatted == "write failed (errno 4095)");
+    formatted = format_sys_error({error_code::timeout, 0}, text);
+    assert(formatted == "timeout");
+    std::array<char, 8> small{};
+    formatted = format_sys_error(reset, small);
+    assert(formatted == "read fai");  // Truncated, never overrun
+    assert(errno_name(EPIPE) == "EPIPE" && errno_name(4095).empty());
 
     std::println("✓ Error codes test passed\n");
 }
@@ -98,10 +136,128 @@ void test_base64() {
         assert(encoded == "cHJpbnQoJ0hlbGxvLCBXb3JsZCEnKQ==");
     }
 
+    // Incremental decoding: every split point gives the same bytes
+    {
+        std::vector<uint8_t> binary(1000);
+        for (size_t i = 0; i < binary.size(); ++i) {
+            binary[i] = static_cast<uint8_t>(i * 7);
+        }
+        binary.resize(998);  // Ends in a padded quantum
+        const auto encoded = base64_encode(binary);
+        for (size_t piece : {1, 2, 3, 5, 64, 997}) {
+            base64_decoder decoder;
+            std::vector<uint8_t> out;
+            std::vector<uint8_t> buffer(base64_decoder::max_output(piece));
+            for (size_t pos = 0; pos < encoded.size(); pos += piece) {
+                auto n = decoder.decode(std::string_view(encoded).substr(pos, piece), buffer);
+                assert(n.has_value());
+                out.insert(out.end(), buffer.begin(), buffer.begin() + static_cast<ptrdiff_t>(*n));
+            }
+            const auto finished = decoder.finish();
+            assert(!finished);
+            assert(out == binary);
+        }
+
+        std::array<uint8_t, 16> buffer{};
+        base64_decoder truncated;
+        auto n = truncated.decode("YWJ", buffer);
+        assert(n == size_t{0});
+        const auto unfinished = truncated.finish();
+        assert(unfinished == error_code::invalid_base64_encoding);
+
+        base64_decoder after_padding;
+        n = after_padding.decode("YQ==", buffer);
+        assert(n == size_t{1});
+        n = after_padding.decode("YQ", buffer);
+        assert(!n.has_value());
+
+        base64_decoder bad;
+        n = bad.decode("YW@j", buffer);
+        assert(!n.has_value());
+        n = bad.decode("YWJj", buffer);
+        assert(!n.has_value());  // Stays failed
+
+        base64_decoder misplaced;
+        n = misplaced.decode("Y=Jj", buffer);
+        assert(!n.has_value());
+        base64_decoder pad_then_data;
+        n = pad_then_data.decode("YW=j", buffer);
+        assert(!n.has_value());
+    }
+
 
     std::println("✓ Base64 test passed\n");
 }
 
+void test_sha256() {
+    std::println("Testing SHA-256...");
+
+    // FIPS 180-4 test vectors
+    sha256 h;
+    auto digest = to_hex(h.finish());
+    assert(digest ==
+           "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855");
+
+    h.reset();
+    h.update("abc");
+    digest = to_hex(h.finish());
+    assert(digest ==
+           "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+
+    // Two-block message, fed in awkward pieces to exercise buffering
+    const std::string_view msg = "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq";
+    h.reset();
+    h.update(msg.substr(0, 3));
+    h.update(msg.substr(3, 50));
+    h.update(msg.substr(53));
+    digest = to_hex(h.finish());
+    assert(digest ==
+           "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1");
+
+    // One million 'a's
+    h.reset();
+    const std::string chunk(1000, 'a');
+    for (int i = 0; i < 1000; ++i) {
+        h.update(chunk);
+    }
+    const auto million = h.finish();
+    assert(to_hex(million) ==
+           "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0");
+
+    // Hex round trip
+    auto parsed = parse_sha256_hex(to_hex(million));
+    assert(parsed.has_value() && *parsed == million);
+    assert(!parse_sha256_hex("abc").has_value());
+    assert(!parse_sha256_hex(std::string(64, 'g')).has_value());
+
+    std::println("✓ SHA-256 test passed\n");
+}
+
+void test_deadlines() {
+    std::println("Testing deadline arithmetic...");
+
+    // Resolving: budget from receipt, absolute via the wall clock, earlier wins
+    const uint64_t received = 1'000'000'000'000, unix_ms = 1'700'000'000'000;
+    assert(resolve_deadline({}, received, unix_ms) == 0);
+    assert(resolve_deadline({.budget_ms = 250}, received, unix_ms) == received + 250'000'000);
+    assert(resolve_deadline({.deadline_unix_ms = unix_ms + 100}, received, unix_ms) == received + 100'000'000);
+    assert(resolve_deadline({.deadline_unix_ms = unix_ms + 100, .budget_ms = 50}, received, unix_ms) ==
+           received + 50'000'000);
+    assert(resolve_deadline({.deadline_unix_ms = unix_ms - 5}, received, unix_ms) == received);
+    assert(resolve_deadline({.budget_ms = UINT64_MAX}, received, unix_ms) == UINT64_MAX);
+    assert(deadline_passed(received, received) && !deadline_passed(0, received));
+
+    // Capping: the limit or the time left, whichever is shorter; never "none"
+    assert(cap_to_deadline(5000, 0, received) == 5000);
+    assert(cap_to_deadline(5000, received + 200'000'000, received) == 200);
+    assert(cap_to_deadline(100, received + 200'000'000, received) == 100);
+    assert(cap_to_deadline(0, received + 200'000'000, received) == 200);
+    assert(cap_to_deadline(0, received + 1, received) == 1);
+    assert(cap_to_deadline(100, received, received + 5) == 1);
+
+    std::println("✓ Deadline test passed\n");
+}
+
 void test_signal_handler() {
     std::println("Testing signal handler...");
 
@@ -128,12 +284,334 @@ void test_signal_handler() {
     std::println("✓ Signal handler test passed\n");
 }
 
+void test_prefault() {
+    std::println("Testing prefaulter...");
+
+    // A registered region gets every page touched
+    {
+        std::vector<std::byte> hot(64 * 1024);
+        prefaulter pf(prefault_options{.include_self_maps = false});
+        pf.add_region(hot);
+
+        auto stats = pf.run_once();
+        assert(stats.regions == 1);
+        assert(stats.pages >= hot.size() / 4096);
+        assert(stats.processes == 0);
+    }
+
+    // Our own resident pages + a "warm-pool" process (ourselves) are read
+    {
+        prefaulter pf;
+        pf.add_process(getpid());
+
+        auto stats = pf.run_once();
+        assert(stats.regions > 0);
+        assert(stats.pages > 0);  // At least our stack and text are resident
+        assert(stats.processes == 1);
+        assert(stats.remote_pages > 0);
+
+        pf.remove_process(getpid());
+        auto after = pf.run_once();
+        assert(after.processes == 0);
+    }
+
+    // Budget caps the pass
+    {
+        std::vector<std::byte> hot(1024 * 1024);
+        prefaulter pf(prefault_options{.include_self_maps = false, .max_bytes = 8 * 4096});
+        pf.add_region(hot);
+        auto stats = pf.run_once();
+        assert(stats.pages <= 8);
+    }
+
+    // SIGUSR1 -> signal_handler -> eventfd -> background pass
+    {
+        std::vector<std::byte> hot(16 * 1024);
+        prefaulter pf(prefault_options{.include_self_maps = false});
+        pf.add_region(hot);
+        auto ec = pf.start();
+        assert(!ec);
+        assert(pf.notify_fd() != -1);
+
+        signal_handler::reset();
+        signal_handler::setup();
+        signal_handler::set_restore_notify_fd(pf.notify_fd());
+        raise(SIGUSR1);
+
+        for (int i = 0; i < 200 && pf.passes() == 0; ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+        assert(pf.passes() >= 1);
+        assert(pf.last_stats().regions == 1);
+        assert(!signal_handler::should_shutdown());  // SIGUSR1 is not a shutdown
+
+        signal_handler::set_restore_notify_fd(-1);
+        pf.stop();
+        assert(pf.notify_fd() == -1);
+    }
+
+    std::println("✓ Prefault test passed\n");
+}
+
+void test_config() {
+    std::println("Testing config parsing and reload...");
+
+    // Defaults survive keys that aren't mentioned
+    {
+        auto config = parse_config("");
+        assert(config.has_value());
+        assert(config->workspace_pool_size == server_config{}.workspace_pool_size);
+    }
+
+    // Comments, whitespace and size suffixes
+    {
+        auto config = parse_config(
+            "# pools\n"
+            "warm_pool_size = 8\n"
+            "  compile_cache_bytes=512M   # budget\n"
+            "\n"
+            "default_memory_limit_bytes = 1g\r\n"
+            "worker_count = 3");
+        assert(config.has_value());
+        assert(config->warm_pool_size == 8);
+        assert(config->compile_cache_bytes == 512ull * 1024 * 1024);
+        assert(config->default_memory_limit_bytes == 1024ull * 1024 * 1024);
+        assert(config->worker_count == 3);
+    }
+
+    // Errors carry the line number
+    {
+        std::string detail;
+        auto config = parse_config("worker_count = 2\nwarm_pool_sise = 4\n", &detail);
+        assert(!config.has_value());
+        assert(config.error() == make_error_code(error_code::invalid_field_value));
+        assert(detail.starts_with("line 2:"));
+
+        assert(!parse_config("worker_count = 4K").has_value());      // No suffix on counts
+        assert(!parse_config("worker_count = -1").has_value());
+        assert(!parse_config("worker_count").has_value());
+        assert(!parse_config("worker_count = 100000").has_value());  // Above sanity bound
+    }
+
+    // Keyword values
+    {
+        auto config = parse_config("server_cpus = 1\njob_sched = idle\n");
+        assert(config.has_value());
+        assert(config->server_cpus == 1 && config->job_sched == job_sched_policy::idle);
+        const auto batch = parse_config("job_sched = batch");
+        assert(batch.has_value() && batch->job_sched == job_sched_policy::batch);
+        const auto empty = parse_config("");
+        assert(empty.has_value() && empty->job_sched == job_sched_policy::normal);
+        const auto number = parse_config("job_sched = 2");  // Words only
+        assert(!number.has_value());
+        const auto unknown = parse_config("job_sched = fifo");
+        assert(!unknown.has_value());
+
+        // Reserving vCPUs for the server implies batch for jobs, unless
+        // job_sched says otherwise
+        const auto partitioned = parse_config("server_cpus = 1");
+        assert(partitioned.has_value() && partitioned->job_sched == job_sched_policy::batch);
+        const auto explicit_normal = parse_config("job_sched = normal\nserver_cpus = 2");
+        assert(explicit_normal.has_value() && explicit_normal->job_sched == job_sched_policy::normal);
+    }
+
+    // Files
+    {
+        const std::string path = "/tmp/vsocky_test_config_" + std::to_string(getpid()) + ".conf";
+        std::ofstream(path) << "warm_pool_size = 2\n";
+        auto config = load_config_file(path);
+        assert(config.has_value() && config->warm_pool_size == 2);
+        std::remove(path.c_str());
+
+        assert(load_config_file(path).error() == make_error_code(error_code::resource_unavailable));
+    }
+
+    // RCU store: readers see old or new, never a mix; old versions are retired
+    {
+        config_store store;
+        const server_config* before = &store.current();
+        assert(store.generation() == 0);
+
+        server_config next;
+        next.worker_count = 7;
+        store.publish(next);
+
+        assert(store.generation() == 1);
+        assert(store.current().worker_count == 7);
+        assert(before->worker_count == 0);  // Still readable until reclaim
+        size_t retired = store.reclaim();
+        assert(retired == 1);
+        retired = store.reclaim();
+        assert(retired == 0);
+    }
+
+    // SIGHUP requests a reload, not a shutdown
+    {
+        signal_handler::reset();
+        signal_handler::setup();
+        raise(SIGHUP);
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+        assert(!signal_handler::should_shutdown());
+        bool requested = signal_handler::consume_reload_request();
+        assert(requested);
+        requested = signal_handler::consume_reload_request();
+        assert(!requested);  // Cleared by the first call
+    }
+
+    std::println("✓ Config test passed\n");
+}
+
+// Something for the profiler to find
+[[gnu::noinline]] uint64_t burn(const std::atomic<bool>& stop) {
+    uint64_t x = 1;
+    while (!stop.load(std::memory_order_relaxed)) {
+        x = x * 6364136223846793005ull + 1442695040888963407ull;
+    }
+    return x;
+}
+
+void test_profiler() {
+    std::println("Testing sampling profiler...");
+
+    assert(profile_self({.duration_ms = 0}).error() == make_error_code(error_code::invalid_field_value));
+    assert(profile_self({.duration_ms = 100, .frequency_hz = 100'000}).error() ==
+           make_error_code(error_code::invalid_field_value));
+
+    std::atomic<bool> stop{false};
+    std::thread spinner([&] {
+        pthread_setname_np(pthread_self(), "hot-loop");
+        [[maybe_unused]] volatile uint64_t sink = burn(stop);
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));  // Let it get its name
+
+    auto result = profile_self({.duration_ms = 300, .frequency_hz = 500});
+    stop = true;
+    spinner.join();
+    if (!result) {
+        std::println("- Skipped (perf_event_open unavailable: {})", result.error().message());
+        return;
+    }
+    assert(result->threads >= 1 && result->samples > 0);
+
+    // "thread;frame;...;frame count", frames as module+0xoffset
+    size_t hot = 0;
+    bool own_module = false;
+    std::istringstream lines(result->folded);
+    for (std::string line; std::getline(lines, line);) {
+        const auto space = line.rfind(' ');
+        assert(space != std::string::npos && std::stoul(line.substr(space + 1)) > 0);
+        if (line.starts_with("hot-loop;")) {
+            hot += std::stoul(line.substr(space + 1));
+        }
+        own_module |= line.find("test_utils+0x") != std::string::npos;
+    }
+    assert(hot > 0 && own_module);
+
+    std::println("✓ Profiler test passed ({} samples, {} on the spinning thread)\n", result->samples, hot);
+}
+
+void test_offload_pool() {
+    std::println("Testing offload pool...");
+
+    offload_pool pool;
+    auto ec = pool.submit([] { return 0; }, [](int) {});
+    assert(ec == make_error_code(error_code::resource_unavailable));
+    ec = pool.start();
+    assert(!ec);
+    assert(pool.notify_fd() != -1);
+    size_t ran = pool.drain();
+    assert(ran == 0);  // Nothing finished: the eventfd read just fails
+
+    // Wait for notify_fd like the reactor would, then run the completions
+    const auto wait_for = [&](size_t expected) {
+        size_t ran = 0;
+        for (int i = 0; i < 200 && ran < expected; ++i) {
+            pollfd pfd{pool.notify_fd(), POLLIN, 0};
+            if (::poll(&pfd, 1, 10) > 0) {
+                ran += pool.drain();
+            }
+        }
+        return ran;
+    };
+
+    // Workspace setup and cleanup, completions on this thread
+    const std::string root = "/tmp/vsocky_offload_test";
+    std::filesystem::remove_all(root);
+    const auto caller = std::this_thread::get_id();
+    int results[3] = {-1, -1, -1};
+    ec = pool.submit([&] { return make_directories(root + "/a/b", 0755); },
+                     [&](int err) { assert(std::this_thread::get_id() == caller); results[0] = err; });
+    assert(!ec);
+    ran = wait_for(1);
+    assert(ran == 1 && results[0] == 0);
+    ec = pool.submit([&] { return write_file(root + "/a/b/limit", "max 100000\n"); },
+                     [&](int err) { results[1] = err; });
+    assert(!ec);
+    ec = pool.submit([&] { return write_file(root + "/missing/file", "x"); },
+                     [&](int err) { results[2] = err; });
+    assert(!ec);
+    ran = wait_for(2);
+    assert(ran == 2 && results[1] == 0 && results[2] == ENOENT);
+    assert(std::filesystem::file_size(root + "/a/b/limit") == 11);
+    const int not_dir = make_directories(root + "/a/b/limit", 0755);
+    assert(not_dir == ENOTDIR);
+    assert(pool.in_flight() == 0);
+
+    // Bulk work never takes the last worker: with two stuck cleanups, setup
+    // still gets through
+    std::atomic<bool> release{false};
+    std::atomic<int> bulk_started{0};
+    int bulk_done = 0;
+    for (int i = 0; i < 2; ++i) {
+        ec = pool.submit(
+            [&] {
+                ++bulk_started;
+                while (!release) {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                }
+                return 0;
+            },
+            [&](int) { ++bulk_done; }, offload_lane::bulk);
+        assert(!ec);
+    }
+    while (bulk_started == 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    bool setup_done = false;
+    ec = pool.submit([] { return 0; }, [&](int) { setup_done = true; });
+    assert(!ec);
+    ran = wait_for(1);
+    assert(ran == 1 && setup_done && bulk_done == 0);
+    assert(bulk_started == 1);
+    release = true;
+
+    // stop() finishes queued work; its completions wait for a last drain()
+    ec = pool.submit([&] { return remove_tree(root); }, [&](int err) { results[0] = err; }, offload_lane::bulk);
+    assert(!ec);
+    pool.stop();
+    assert(pool.in_flight() == 3);
+    ran = pool.drain();
+    assert(ran == 3 && bulk_done == 2 && results[0] == 0);
+    assert(!std::filesystem::exists(root));
+    const int gone = remove_tree(root);
+    assert(gone == 0);  // Already gone is fine
+
+    std::println("✓ Offload pool test passed\n");
+}
+
 int main() {
     std::println("Running VSocky utility tests...\n");
     
     test_error_codes();
     test_base64();
+    test_sha256();
+    test_deadlines();
+    test_prefault();
+    test_config();
     test_signal_handler();
+    test_profiler();
+    test_offload_pool();
     
     std::println("\nAll tests passed! ✓");
     return 0;
@@ -0,0 +1,244 @@
+#include "vsocky/vsocket/vsock_server.hpp"
+#include "vsocky/vsocket/message_framer.hpp"
+#include "vsocky/vsocket/ready_notifier.hpp"
+#include "vsocky/protocol/capabilities.hpp"
+#include "vsocky/protocol/error_frames.hpp"
+#include "vsocky/vsocket/frame_io.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cerrno>
+#include <cstdint>
+#include <csignal>
+#include <iostream>
+#include <string>
+#include <unistd.h>
+
+// =============================================================================
+// VSOCKSERVER / READY NOTIFIER UNIT TESTS
+// =============================================================================
+// AF_VSOCK needs the vsock kernel modules, which CI containers usually lack,
+// so the listener is exercised over a Unix socket. The VSock path is only
+// checked when the address family is available.
+// =============================================================================
+
+namespace vsocky::test {
+
+std::string socket_path(const char* name) {
+    return "/tmp/vsocky_test_" + std::to_string(getpid()) + "_" + name + ".sock";
+}
+
+// Accept with a short wait (accept() itself never blocks)
+Connection accept_one(VSockServer& server) {
+    Connection conn(-1);
+    for (int i = 0; i < 200 && !conn.is_valid(); ++i) {
+        auto ec = server.accept(conn);
+        assert(!ec);
+        if (!conn.is_valid()) {
+            usleep(5000);
+        }
+    }
+    return conn;
+}
+
+void test_unix_listen_accept() {
+    std::cout << "Testing listen/accept over a Unix socket..." << std::endl;
+
+    const auto path = socket_path("accept");
+    VSockServer server;
+    auto ec = server.listen_unix(path);
+    assert(!ec);
+    assert(server.is_listening());
+
+    // Nothing pending yet: success with an invalid connection
+    Connection none(-1);
+    ec = server.accept(none);
+    assert(!ec);
+    assert(!none.is_valid());
+
+    auto client = Connection::connect_unix(path, 1000);
+    assert(client.has_value());
+
+    Connection accepted = accept_one(server);
+    assert(accepted.is_valid());
+
+    const uint8_t ping[] = {'p', 'i', 'n', 'g'};
+    ec = client->write_all(ping, 1000);
+    assert(!ec);
+    ec = accepted.wait_readable(1000);
+    assert(!ec);
+
+    uint8_t buffer[8] = {};
+    size_t n = 0;
+    ec = accepted.read(buffer, n);
+    assert(!ec);
+    assert(n == 4);
+
+    server.close();
+    assert(access(path.c_str(), F_OK) != 0);  // Socket file removed
+
+    std::cout << "✓ Unix listener accepts and cleans up" << std::endl;
+}
+
+void test_connect_failure() {
+    std::cout << "Testing connect to nowhere..." << std::endl;
+
+    auto conn = Connection::connect_unix(socket_path("nobody"), 100);
+    assert(!conn.has_value());
+    assert(conn.error() == error_code::connect_failed);
+
+    std::cout << "✓ Connect failure is reported" << std::endl;
+}
+
+void test_capabilities() {
+    std::cout << "Testing capability list..." << std::endl;
+
+    // Only what the given features actually serve
+    auto names = enabled_capabilities(feature_ready_notify);
+    assert(names.size() == 1 && names[0] == "ready_notify");
+    names = enabled_capabilities(feature_ready_notify | feature_prefault);
+    assert(std::ranges::find(names, "prefault") != names.end());
+    assert(std::ranges::find(names, "framed_json") == names.end());
+    // Cancelling needs both something to read the frame and a supervisor
+    names = enabled_capabilities(feature_frame_dispatch);
+    assert(std::ranges::find(names, "cancel") == names.end());
+    names = enabled_capabilities(feature_frame_dispatch | feature_supervisor);
+    assert(std::ranges::find(names, "cancel") != names.end());
+    assert(std::ranges::find(names, "chunked_upload") != names.end());
+    assert(std::ranges::find(names, "capture") != names.end());
+    assert(std::ranges::find(names, "interactive") != names.end());
+    assert(enabled_capabilities(0).empty());
+
+    std::cout << "✓ Capabilities follow the enabled features" << std::endl;
+}
+
+void test_ready_message() {
+    std::cout << "Testing ready message..." << std::endl;
+
+    const std::string_view caps[] = {"framed_json", "with \"quote\""};
+    ready_info info{
+        .version = "1.2.3",
+        .listen_port = 52000,
+        .capabilities = caps,
+        .warm_pool = {.enabled = true, .ready = 3, .target = 4},
+    };
+
+    const auto json = build_ready_message(info);
+    assert(json == R"({"type":"ready","version":"1.2.3","port":52000,)"
+                   R"("capabilities":["framed_json","with \"quote\""],)"
+                   R"("warm_pool":{"enabled":true,"ready":3,"target":4}})");
+
+    // Send it through a real socket and decode it as the host would
+    const auto path = socket_path("ready");
+    VSockServer host;
+    auto listened = host.listen_unix(path);
+    assert(!listened);
+
+    auto guest = Connection::connect_unix(path, 1000);
+    assert(guest.has_value());
+    Connection from_guest = accept_one(host);
+    assert(from_guest.is_valid());
+
+    auto sent = send_ready(*guest, info, 1000);
+    assert(!sent);
+    guest->close();
+
+    MessageFramer framer;
+    std::optional<Frame> frame;
+    while (!frame) {
+        auto ready = from_guest.wait_readable(1000);
+        assert(!ready);
+        uint8_t buffer[64];
+        size_t n = 0;
+        auto ec = from_guest.read(buffer, n);
+        assert(!ec || ec == error_code::connection_closed);
+        auto fed = framer.feed(std::span(buffer, n));
+        assert(!fed);
+        frame = framer.next();
+        assert(frame || !ec);
+    }
+    assert(frame->type == frame_type::json);
+    assert(std::string(frame->payload.begin(), frame->payload.end()) == json);
+
+    std::cout << "✓ Ready message is framed JSON" << std::endl;
+}
+
+void test_error_frames() {
+    std::cout << "Testing error frames..." << std::endl;
+
+    std::array<char, max_error_message_bytes> buffer{};
+    auto rendered = render_error_message({error_code::read_failed, ECONNRESET}, 42, buffer);
+    assert(rendered == R"({"type":"error","code":"read_failed","message":"read failed",)"
+                       R"("errno":104,"errno_name":"ECONNRESET","id":42})");
+    rendered = render_error_message({error_code::timeout, 0}, 0, buffer);
+    assert(rendered == R"({"type":"error","code":"timeout","message":"timeout"})");
+    rendered = render_error_message({error_code::invalid_json, 4095}, 0, buffer);
+    assert(rendered == R"({"type":"error","code":"invalid_json","message":"invalid JSON","errno":4095})");
+    // An out-of-range code still renders valid JSON
+    rendered = render_error_message({static_cast<error_code>(999), 0}, 0, buffer);
+    assert(rendered.starts_with(R"({"type":"error","code":"internal_error")"));
+
+    // Worst case fits the buffer
+    const auto longest = render_error_message({error_code::unsupported_message_type, ECONNABORTED},
+                                              UINT64_MAX, buffer);
+    assert(longest.size() < max_error_message_bytes && longest.ends_with("18446744073709551615}"));
+
+    // As a json frame on a real socket
+    const auto path = socket_path("error");
+    VSockServer host;
+    auto ec = host.listen_unix(path);
+    assert(!ec);
+    auto guest = Connection::connect_unix(path, 1000);
+    assert(guest.has_value());
+    Connection from_guest = accept_one(host);
+    assert(from_guest.is_valid());
+
+    ec = send_error(*guest, {error_code::write_failed, EPIPE}, 7, 1000);
+    assert(!ec);
+    MessageFramer framer;
+    auto frame = receive_frame(from_guest, framer, 1000);
+    assert(frame.has_value() && frame->type == frame_type::json);
+    assert(std::string(frame->payload.begin(), frame->payload.end()) ==
+           R"({"type":"error","code":"write_failed","message":"write failed",)"
+           R"("errno":32,"errno_name":"EPIPE","id":7})");
+
+    std::cout << "✓ Error frames render from pre-built fragments" << std::endl;
+}
+
+void test_vsock_listen() {
+    std::cout << "Testing VSock listen (if available)..." << std::endl;
+
+    VSockServer server;
+    auto ec = server.listen(52999);
+    if (ec == error_code::socket_creation_failed) {
+        std::cout << "  AF_VSOCK unavailable here, skipping" << std::endl;
+        return;
+    }
+    if (!ec) {
+        assert(server.port() == 52999);
+    }
+
+    std::cout << "✓ VSock listen works" << std::endl;
+}
+
+void run_all_tests() {
+    std::cout << "\n=== Running VSockServer Tests ===" << std::endl;
+
+    test_unix_listen_accept();
+    test_connect_failure();
+    test_capabilities();
+    test_ready_message();
+    test_error_frames();
+    test_vsock_listen();
+
+    std::cout << "\n=== All Tests Passed! ===" << std::endl;
+}
+
+} // namespace vsocky::test
+
+int main() {
+    signal(SIGPIPE, SIG_IGN);
+    vsocky::test::run_all_tests();
+    return 0;
+}